@@ -0,0 +1,272 @@
+/* vim: set ai sw=4 sts=4 ts=4 : */
+
+/*
+**  APPEND-BENCH --- measure append throughput and latency
+**
+**		Appends a fixed number of records to an existing log keeping
+**		up to a given number of asynchronous appends outstanding, then
+**		reports appends per second and the distribution of the time
+**		from sending each append to receiving its acknowledgement.
+**
+**		With a window of one each append is synchronous, which gives
+**		the single writer baseline.  Larger windows model many writers
+**		appending to the same log, which is the case gdplogd group
+**		commit is meant to handle.
+**
+**	----- BEGIN LICENSE BLOCK -----
+**	Applications for the Global Data Plane
+**	From the Ubiquitous Swarm Lab, 490 Cory Hall, U.C. Berkeley.
+**
+**	Copyright (c) 2015-2019, Regents of the University of California.
+**	All rights reserved.
+**
+**	Permission is hereby granted, without written agreement and without
+**	license or royalty fees, to use, copy, modify, and distribute this
+**	software and its documentation for any purpose, provided that the above
+**	copyright notice and the following two paragraphs appear in all copies
+**	of this software.
+**
+**	IN NO EVENT SHALL REGENTS BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT,
+**	SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES, INCLUDING LOST
+**	PROFITS, ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION,
+**	EVEN IF REGENTS HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**
+**	REGENTS SPECIFICALLY DISCLAIMS ANY WARRANTIES, INCLUDING, BUT NOT
+**	LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+**	FOR A PARTICULAR PURPOSE. THE SOFTWARE AND ACCOMPANYING DOCUMENTATION,
+**	IF ANY, PROVIDED HEREUNDER IS PROVIDED "AS IS". REGENTS HAS NO
+**	OBLIGATION TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS,
+**	OR MODIFICATIONS.
+**	----- END LICENSE BLOCK -----
+*/
+
+#include <ep/ep.h>
+#include <ep/ep_app.h>
+#include <ep/ep_dbg.h>
+#include <ep/ep_thr.h>
+#include <ep/ep_time.h>
+#include <gdp/gdp.h>
+
+#include <getopt.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sysexits.h>
+
+static EP_THR_MUTEX		Mutex		EP_THR_MUTEX_INITIALIZER;
+static EP_THR_COND		Cond		EP_THR_COND_INITIALIZER;
+static int				Outstanding;	// appends sent but not acked
+static int				NFailures;		// appends that returned an error
+
+static EP_TIME_SPEC		*SendTime;		// when each append was sent
+static int64_t			*Latency;		// usec from send to ack
+
+
+/*
+**  APPEND_DONE --- callback for asynchronous append acknowledgements
+*/
+
+static void
+append_done(gdp_event_t *gev)
+{
+	long i = (long) gdp_event_getudata(gev);
+	EP_STAT estat = gdp_event_getstat(gev);
+	EP_TIME_SPEC now;
+
+	ep_time_now(&now);
+	Latency[i] = ep_time_diff_usec(&SendTime[i], &now);
+	gdp_event_free(gev);
+
+	ep_thr_mutex_lock(&Mutex);
+	if (!EP_STAT_ISOK(estat))
+		NFailures++;
+	Outstanding--;
+	ep_thr_cond_signal(&Cond);
+	ep_thr_mutex_unlock(&Mutex);
+}
+
+
+static int
+cmp_int64(const void *a, const void *b)
+{
+	int64_t x = *(const int64_t *) a;
+	int64_t y = *(const int64_t *) b;
+
+	return (x > y) - (x < y);
+}
+
+
+static int64_t
+percentile(int64_t *sorted, int n, int pct)
+{
+	int i = (int) (((int64_t) n * pct) / 100);
+
+	if (i >= n)
+		i = n - 1;
+	return sorted[i];
+}
+
+
+void
+usage(void)
+{
+	fprintf(stderr,
+			"Usage: %s [-D dbgspec] [-G router_addr] [-n nrecs]\n"
+			"\t[-s size] [-w window] log_name\n"
+			"    -D  set debugging flags\n"
+			"    -G  IP host to contact for gdp_router\n"
+			"    -n  number of records to append (default 10000)\n"
+			"    -s  size of each record in bytes (default 100)\n"
+			"    -w  maximum outstanding appends (default 32;\n"
+			"        1 means synchronous appends)\n",
+			ep_app_getprogname());
+	exit(EX_USAGE);
+}
+
+
+int
+main(int argc, char **argv)
+{
+	gdp_gin_t *gin;
+	gdp_name_t gdpiname;
+	EP_STAT estat;
+	char *gdpd_addr = NULL;
+	int nrecs = 10000;
+	int recsize = 100;
+	int window = 32;
+	bool show_usage = false;
+	int opt;
+	int i;
+
+	while ((opt = getopt(argc, argv, "D:G:n:s:w:")) > 0)
+	{
+		switch (opt)
+		{
+		 case 'D':
+			ep_dbg_set(optarg);
+			break;
+
+		 case 'G':
+			gdpd_addr = optarg;
+			break;
+
+		 case 'n':
+			nrecs = atoi(optarg);
+			break;
+
+		 case 's':
+			recsize = atoi(optarg);
+			break;
+
+		 case 'w':
+			window = atoi(optarg);
+			break;
+
+		 default:
+			show_usage = true;
+			break;
+		}
+	}
+	argc -= optind;
+	argv += optind;
+
+	if (show_usage || argc != 1 || nrecs <= 0 || recsize < 0 || window < 1)
+		usage();
+
+	estat = gdp_init(gdpd_addr);
+	if (!EP_STAT_ISOK(estat))
+	{
+		ep_app_error("GDP Initialization failed");
+		goto fail0;
+	}
+
+	// allow thread to settle to avoid interspersed debug output
+	ep_time_nanosleep(INT64_C(100000000));
+
+	estat = gdp_parse_name(argv[0], gdpiname);
+	EP_STAT_CHECK(estat, goto fail0);
+	estat = gdp_gin_open(gdpiname, GDP_MODE_AO, NULL, &gin);
+	EP_STAT_CHECK(estat, goto fail0);
+
+	SendTime = ep_mem_zalloc(nrecs * sizeof *SendTime);
+	Latency = ep_mem_zalloc(nrecs * sizeof *Latency);
+
+	char *rec = ep_mem_malloc(recsize + 1);
+	memset(rec, 'x', recsize);
+	gdp_datum_t *datum = gdp_datum_new();
+
+	EP_TIME_SPEC start_time, end_time;
+	ep_time_now(&start_time);
+	for (i = 0; i < nrecs; i++)
+	{
+		gdp_datum_reset(datum);
+		gdp_buf_write(gdp_datum_getbuf(datum), rec, recsize);
+
+		if (window == 1)
+		{
+			EP_TIME_SPEC now;
+
+			ep_time_now(&SendTime[i]);
+			estat = gdp_gin_append(gin, datum, NULL);
+			ep_time_now(&now);
+			Latency[i] = ep_time_diff_usec(&SendTime[i], &now);
+			if (!EP_STAT_ISOK(estat))
+				NFailures++;
+			continue;
+		}
+
+		// wait for the window to open up
+		ep_thr_mutex_lock(&Mutex);
+		while (Outstanding >= window)
+			ep_thr_cond_wait(&Cond, &Mutex, NULL);
+		Outstanding++;
+		ep_thr_mutex_unlock(&Mutex);
+
+		ep_time_now(&SendTime[i]);
+		estat = gdp_gin_append_async(gin, 1, &datum, NULL,
+							append_done, (void *) (long) i);
+		if (!EP_STAT_ISOK(estat))
+		{
+			ep_thr_mutex_lock(&Mutex);
+			Outstanding--;
+			NFailures++;
+			ep_thr_mutex_unlock(&Mutex);
+		}
+	}
+
+	// collect the stragglers
+	ep_thr_mutex_lock(&Mutex);
+	while (Outstanding > 0)
+		ep_thr_cond_wait(&Cond, &Mutex, NULL);
+	ep_thr_mutex_unlock(&Mutex);
+	ep_time_now(&end_time);
+
+	gdp_datum_free(datum);
+	ep_mem_free(rec);
+	gdp_gin_close(gin);
+
+	// report
+	{
+		int64_t usec = ep_time_diff_usec(&start_time, &end_time);
+
+		qsort(Latency, nrecs, sizeof *Latency, cmp_int64);
+		printf("%d appends of %d bytes, window %d\n",
+				nrecs, recsize, window);
+		printf("elapsed %.3f s, %.1f appends/s, %d failures\n",
+				usec / 1e6, usec > 0 ? nrecs * 1e6 / usec : 0.0, NFailures);
+		printf("latency (us): p50 %" PRId64 ", p90 %" PRId64
+				", p99 %" PRId64 ", max %" PRId64 "\n",
+				percentile(Latency, nrecs, 50),
+				percentile(Latency, nrecs, 90),
+				percentile(Latency, nrecs, 99),
+				Latency[nrecs - 1]);
+	}
+
+	ep_mem_free(Latency);
+	ep_mem_free(SendTime);
+	estat = NFailures == 0 ? EP_STAT_OK : EP_STAT_ERROR;
+
+fail0:
+	if (!EP_STAT_ISOK(estat))
+		ep_app_message(estat, "exiting with status");
+	return !EP_STAT_ISOK(estat);
+}
@@ -29,7 +29,6 @@
 ***********************************************************************/
 
 #include <ep.h>
-#include <ep_rpool.h>
 #include <ep_stat.h>
 #include <ep_assert.h>
 #include <ep_hash.h>
@@ -41,118 +40,404 @@
 /***********************************************************************
 **
 **  HASH HANDLING
+**
+**	Open addressing with linear probing.  Entries hold the full
+**	64-bit hash so most mismatches are rejected without looking
+**	at the key, and deletion shifts later entries back rather
+**	than leaving tombstones, so searches never get longer.
+**
+**	Tables double when they get 3/4 full, but the entries are
+**	moved incrementally: the old table stays in place and every
+**	operation moves a few of its entries to the new one, so no
+**	single operation pays for rehashing the whole thing.  While
+**	that's happening new entries always go into the new table
+**	and lookups check both.
+**
+**	Optionally the table can be split into several independently
+**	locked (and independently resized) stripes chosen by the top
+**	bits of the hash.
 */
 
 /**************************  BEGIN PRIVATE  **************************/
 
-struct node
+struct hent
 {
+	uint64_t		hval;		// full hash of key
+	const void		*key;		// actual key (NULL => empty)
 	size_t			keylen;		// length of key
-	const void		*key;		// actual key
 	const void		*val;		// value
-	struct node		*next;		// next in chain
+};
+
+struct htab
+{
+	struct hent		*ents;		// the slots
+	size_t			mask;		// number of slots - 1
+	size_t			count;		// number in use
+};
+
+struct stripe
+{
+	EP_THR_MUTEX		mutex;		// lock on this stripe
+	struct htab		cur;		// current table
+	struct htab		old;		// being migrated (ents may be NULL)
+	size_t			migpos;		// next old slot to move
+	size_t			migleft;	// old slots still to look at
 };
 
 struct EP_HASH
 {
-	EP_RPOOL		*rpool;		// resource pool
 	uint32_t		flags;		// flags -- see below
-	EP_THR_MUTEX		mutex;		// lock on this object
-	EP_HASH_HASH_FUNCP	hfunc;		// hashing function
-	int			tabsize;	// size of hash tab
-	struct node		*tab[0];	// actually longer
+	EP_HASH_HASH_FUNCP	hfunc;		// hashing function (NULL => default)
+	int			nstripes;	// number of stripes (power of 2)
+	int			stripeshift;	// shift hash to get stripe
+	struct stripe		stripes[0];	// actually longer
 };
 
 // no flags at this time
 
+#define MIGRATE_STEP	4		// minimum old slots moved per operation
+
+
+/*
+**  Default hash function.
+**
+**	Works a 64-bit word at a time, finishing with the MurmurHash3
+**	finalizer so that every bit of input affects every bit of
+**	output.  GDP names (the most common keys) are already random,
+**	but parameter names and the like are not.
+*/
+
+static inline uint64_t
+fmix64(uint64_t h)
+{
+	h ^= h >> 33;
+	h *= UINT64_C(0xff51afd7ed558ccd);
+	h ^= h >> 33;
+	h *= UINT64_C(0xc4ceb9fe1a85ec53);
+	h ^= h >> 33;
+	return h;
+}
+
+static uint64_t
+def_hfunc(const size_t keylen, const void *_key)
+{
+	const uint8_t *key = (const uint8_t *) _key;
+	uint64_t h = UINT64_C(0x9e3779b97f4a7c15) ^ keylen;
+	size_t i;
+
+	for (i = 0; i + 8 <= keylen; i += 8)
+	{
+		uint64_t w;
+
+		memcpy(&w, key + i, sizeof w);
+		h = (h ^ fmix64(w)) * UINT64_C(0x87c37b91114253d5);
+	}
+	if (i < keylen)
+	{
+		uint64_t w = 0;
+
+		memcpy(&w, key + i, keylen - i);
+		h = (h ^ fmix64(w)) * UINT64_C(0x87c37b91114253d5);
+	}
+	return fmix64(h);
+}
+
+static inline uint64_t
+hash_key(const EP_HASH *hp, size_t keylen, const void *key)
+{
+	if (hp->hfunc == NULL)
+		return def_hfunc(keylen, key);
+
+	// user functions may not be well distributed; stir them up
+	return fmix64((uint64_t) (unsigned int) (*hp->hfunc)(hp, keylen, key));
+}
+
+static inline struct stripe *
+hash_stripe(EP_HASH *hp, uint64_t hval)
+{
+	if (hp->nstripes == 1)
+		return &hp->stripes[0];
+	return &hp->stripes[hval >> hp->stripeshift];
+}
+
+
+static void
+htab_init(struct htab *t, size_t nslots)
+{
+	t->ents = (struct hent *) ep_mem_zalloc(nslots * sizeof *t->ents);
+	t->mask = nslots - 1;
+	t->count = 0;
+}
+
+
+/*
+**  HTAB_FIND --- find slot for key in one table
+**
+**	Returns the slot holding the key if it is present, otherwise
+**	the (empty) slot where it should go.
+*/
+
+static struct hent *
+htab_find(struct htab *t, uint64_t hval, size_t keylen, const void *key)
+{
+	size_t i;
+
+	for (i = hval & t->mask; ; i = (i + 1) & t->mask)
+	{
+		struct hent *e = &t->ents[i];
+
+		if (e->key == NULL)
+			return e;
+		if (e->hval == hval && e->keylen == keylen &&
+		    memcmp(e->key, key, keylen) == 0)
+			return e;
+	}
+}
+
+
+/*
+**  HTAB_REMOVE --- remove an entry, shifting later entries back
+**
+**	Anything further along the cluster that could live in the
+**	vacated slot (that is, whose home slot isn't between the
+**	hole and where it is now) moves back into it, repeatedly.
+*/
+
+static void
+htab_remove(struct htab *t, struct hent *e)
+{
+	size_t hole = e - t->ents;
+	size_t i = hole;
+
+	for (;;)
+	{
+		struct hent *n;
+		size_t home;
+
+		i = (i + 1) & t->mask;
+		n = &t->ents[i];
+		if (n->key == NULL)
+			break;
+		home = n->hval & t->mask;
+
+		// can n move back to hole?  (cyclic: home not in (hole, i])
+		if (((i - home) & t->mask) >= ((i - hole) & t->mask))
+		{
+			t->ents[hole] = *n;
+			hole = i;
+		}
+	}
+	memset(&t->ents[hole], 0, sizeof t->ents[hole]);
+	t->count--;
+}
+
+
+/*
+**  STRIPE_MIGRATE --- move some entries from the old table
+**
+**	Whole clusters are moved at once: taking an entry out of the
+**	middle of a cluster without shifting would hide the entries
+**	after it.  We started at an empty slot, so the clusters
+**	we've already passed are entirely gone.
+*/
+
+static void
+stripe_migrate(struct stripe *s, size_t nslots)
+{
+	struct htab *old = &s->old;
+
+	while (old->ents != NULL && (nslots > 0 || old->count == 0))
+	{
+		struct hent *e = &old->ents[s->migpos];
+
+		if (old->count == 0 || s->migleft == 0)
+		{
+			// done: all entries have moved
+			EP_ASSERT(old->count == 0);
+			ep_mem_free(old->ents);
+			old->ents = NULL;
+			break;
+		}
+		if (e->key != NULL)
+		{
+			struct hent *ne = htab_find(&s->cur, e->hval,
+						e->keylen, e->key);
+
+			*ne = *e;
+			s->cur.count++;
+			memset(e, 0, sizeof *e);
+			old->count--;
+
+			// keep going to the end of this cluster
+			s->migpos = (s->migpos + 1) & old->mask;
+			s->migleft--;
+			continue;
+		}
+		s->migpos = (s->migpos + 1) & old->mask;
+		s->migleft--;
+		if (nslots > 0)
+			nslots--;
+	}
+}
+
+
+/*
+**  STRIPE_GROW --- start moving everything into a table twice as big
+*/
 
-int
-def_hfunc(
-	const EP_HASH *const hp,
-	const size_t keysize,
-	const void *_key)
+static void
+stripe_grow(struct stripe *s)
 {
-	uint8_t *key = (uint8_t *) _key;
-	int hfunc = 0;
 	size_t i;
 
-	for (i = 0; i < keysize; i++)
+	// finish any previous migration first (shouldn't happen often)
+	if (s->old.ents != NULL)
+		stripe_migrate(s, s->old.mask + 1);
+
+	s->old = s->cur;
+	htab_init(&s->cur, (s->old.mask + 1) * 2);
+
+	// start at an empty slot so we never split a cluster
+	for (i = 0; s->old.ents[i].key != NULL; i++)
+		continue;
+	s->migpos = i;
+	s->migleft = s->old.mask + 1;
+}
+
+
+/*
+**  STRIPE_FIND --- find entry in either table of a stripe
+**
+**	Returns NULL if the key isn't present.
+*/
+
+static struct hent *
+stripe_find(struct stripe *s,
+		struct htab **tp,
+		uint64_t hval,
+		size_t keylen,
+		const void *key)
+{
+	struct hent *e;
+
+	e = htab_find(&s->cur, hval, keylen, key);
+	if (e->key != NULL)
+	{
+		*tp = &s->cur;
+		return e;
+	}
+	if (s->old.ents != NULL)
 	{
-		hfunc = ((hfunc << 1) ^ (*(uint8_t*)key++ & 0xff)) % hp->tabsize;
+		e = htab_find(&s->old, hval, keylen, key);
+		if (e->key != NULL)
+		{
+			*tp = &s->old;
+			return e;
+		}
 	}
-	return hfunc;
+	return NULL;
 }
 
 /***************************  END PRIVATE  ***************************/
 
+
+/*
+**  EP_HASH_NEW --- create a new hash table
+**
+**	The tabsize is just a hint for the initial size; the table
+**	will grow as needed.  If hfunc is given, it should return
+**	a hash of the key (any int); it need not be in range.
+**
+**	EP_HASH_NEW_STRIPED is the same, but splits the table into
+**	nstripes (rounded up to a power of two) separately locked
+**	pieces so that unrelated operations need not wait for each
+**	other.
+*/
+
 EP_HASH *
-ep_hash_new(
+ep_hash_new_striped(
 	const char *name,
 	EP_HASH_HASH_FUNCP hfunc,
-	int tabsize)
+	int tabsize,
+	int nstripes)
 {
-	uint32_t flags = 0;
 	EP_HASH *hash;
-	EP_RPOOL *rp;
-	size_t xtra;
+	size_t nslots;
+	int shift;
+	int i;
 
 	if (tabsize == 0)
-		tabsize = ep_adm_getintparam("libep.hash.tabsize", 2003);
-	if (name == NULL)
-		name = "<hash>";
-	if (hfunc == NULL)
-		hfunc = def_hfunc;
+		tabsize = ep_adm_getintparam("libep.hash.tabsize", 64);
+	if (nstripes < 1)
+		nstripes = 1;
 
 	EP_ASSERT(tabsize >= 2);
 
-	rp = ep_rpool_new(name, (size_t) 0);
+	// power of two stripes, selected by the top bits of the hash
+	for (i = 1, shift = 64; i < nstripes; i <<= 1)
+		shift--;
+	nstripes = i;
 
-	// figure how much extra space we need to allocate for table
-	xtra = tabsize * sizeof hash->tab[0];
+	// each stripe starts at least 4/3 of its share, power of two
+	for (nslots = 8; nslots * 3 / 4 < (size_t) tabsize / nstripes; )
+		nslots <<= 1;
 
-	hash = (EP_HASH *) ep_rpool_zalloc(rp, sizeof *hash + xtra);
-	hash->rpool = rp;
+	hash = (EP_HASH *) ep_mem_zalloc(sizeof *hash +
+				nstripes * sizeof hash->stripes[0]);
 	hash->hfunc = hfunc;
-	hash->flags = flags;
-	hash->tabsize = tabsize;
-	ep_thr_mutex_init(&hash->mutex, EP_THR_MUTEX_DEFAULT);
+	hash->flags = 0;
+	hash->nstripes = nstripes;
+	hash->stripeshift = shift;
+	for (i = 0; i < nstripes; i++)
+	{
+		ep_thr_mutex_init(&hash->stripes[i].mutex, EP_THR_MUTEX_DEFAULT);
+		htab_init(&hash->stripes[i].cur, nslots);
+	}
 
 	return hash;
 }
 
-
-void
-ep_hash_free(EP_HASH *hash)
+EP_HASH *
+ep_hash_new(
+	const char *name,
+	EP_HASH_HASH_FUNCP hfunc,
+	int tabsize)
 {
-	EP_ASSERT_POINTER_VALID(hash);
-	ep_thr_mutex_destroy(&hash->mutex);
-	ep_rpool_free(hash->rpool);	// also frees hash
+	return ep_hash_new_striped(name, hfunc, tabsize, 1);
 }
 
 
-struct node **
-find_node_ptr(EP_HASH *hp,
-	size_t keylen,
-	const void *key)
+static void
+htab_free(struct htab *t)
 {
-	int indx;
-	struct node **npp;
-	struct node *n;
-
-	indx = hp->hfunc(hp, keylen, key);
-	npp = &hp->tab[indx];
+	size_t i;
 
-	for (n = *npp; n != NULL; npp = &n->next, n = *npp)
+	if (t->ents == NULL)
+		return;
+	for (i = 0; i <= t->mask; i++)
 	{
-		if (keylen == n->keylen &&
-		    memcmp(key, n->key, keylen) == 0)
-		{
-			// match
-			break;
-		}
+		if (t->ents[i].key != NULL)
+			ep_mem_free((void *) t->ents[i].key);
 	}
+	ep_mem_free(t->ents);
+	t->ents = NULL;
+}
+
+void
+ep_hash_free(EP_HASH *hash)
+{
+	int i;
+
+	EP_ASSERT_POINTER_VALID(hash);
+	for (i = 0; i < hash->nstripes; i++)
+	{
+		struct stripe *s = &hash->stripes[i];
 
-	return npp;
+		ep_thr_mutex_destroy(&s->mutex);
+		htab_free(&s->cur);
+		htab_free(&s->old);
+	}
+	ep_mem_free(hash);
 }
 
 
@@ -162,18 +447,23 @@ ep_hash_search(
 	size_t keylen,
 	const void *key)
 {
-	struct node **npp;
+	uint64_t hval;
+	struct stripe *s;
+	struct htab *t;
+	struct hent *e;
 	const void *val;
 
 	EP_ASSERT_POINTER_VALID(hp);
 
-	ep_thr_mutex_lock(&hp->mutex);
-	npp = find_node_ptr(hp, keylen, key);
-	if (*npp == NULL)
+	hval = hash_key(hp, keylen, key);
+	s = hash_stripe(hp, hval);
+	ep_thr_mutex_lock(&s->mutex);
+	e = stripe_find(s, &t, hval, keylen, key);
+	if (e == NULL)
 		val = NULL;
 	else
-		val = (*npp)->val;
-	ep_thr_mutex_unlock(&hp->mutex);
+		val = e->val;
+	ep_thr_mutex_unlock(&s->mutex);
 	return val;
 }
 
@@ -185,36 +475,43 @@ ep_hash_insert(
 	const void *key,
 	const void *val)
 {
-	struct node **npp;
-	struct node *n;
+	uint64_t hval;
+	struct stripe *s;
+	struct htab *t;
+	struct hent *e;
 	void *kp;
 
 	EP_ASSERT_POINTER_VALID(hp);
 
-	ep_thr_mutex_lock(&hp->mutex);
-	npp = find_node_ptr(hp, keylen, key);
-	if (*npp != NULL)
+	hval = hash_key(hp, keylen, key);
+	s = hash_stripe(hp, hval);
+	ep_thr_mutex_lock(&s->mutex);
+	stripe_migrate(s, MIGRATE_STEP);
+	e = stripe_find(s, &t, hval, keylen, key);
+	if (e != NULL)
 	{
 		// there is an existing value; replace it
 		const void *oldval;
 
-		n = *npp;
-		oldval = n->val;
-		n->val = val;
-		ep_thr_mutex_unlock(&hp->mutex);
+		oldval = e->val;
+		e->val = val;
+		ep_thr_mutex_unlock(&s->mutex);
 		return oldval;
 	}
 
-	// not found -- insert it
-	n = (struct node *) ep_rpool_malloc(hp->rpool, sizeof *n);
-	n->keylen = keylen;
-	kp = ep_rpool_malloc(hp->rpool, keylen);
+	// not found -- insert it (into the current table)
+	// (count what's still to come from the old table too)
+	if ((s->cur.count + s->old.count + 1) * 4 > (s->cur.mask + 1) * 3)
+		stripe_grow(s);
+	e = htab_find(&s->cur, hval, keylen, key);
+	kp = ep_mem_malloc(keylen > 0 ? keylen : 1);
 	memcpy(kp, key, keylen);
-	n->key = kp;
-	n->val = val;
-	n->next = NULL;
-	*npp = n;
-	ep_thr_mutex_unlock(&hp->mutex);
+	e->hval = hval;
+	e->key = kp;
+	e->keylen = keylen;
+	e->val = val;
+	s->cur.count++;
+	ep_thr_mutex_unlock(&s->mutex);
 	return NULL;
 }
 
@@ -225,40 +522,62 @@ ep_hash_delete(
 	size_t keylen,
 	const void *key)
 {
-	struct node **npp;
-	struct node *n;
+	uint64_t hval;
+	struct stripe *s;
+	struct htab *t;
+	struct hent *e;
 	const void *v;
 
 	EP_ASSERT_POINTER_VALID(hp);
 
-	ep_thr_mutex_lock(&hp->mutex);
-	npp = find_node_ptr(hp, keylen, key);
-	if (*npp == NULL)
+	hval = hash_key(hp, keylen, key);
+	s = hash_stripe(hp, hval);
+	ep_thr_mutex_lock(&s->mutex);
+	stripe_migrate(s, MIGRATE_STEP);
+	e = stripe_find(s, &t, hval, keylen, key);
+	if (e == NULL)
 	{
 		// entry does not exist
-		ep_thr_mutex_unlock(&hp->mutex);
+		ep_thr_mutex_unlock(&s->mutex);
 		return NULL;
 	}
 
-	n = *npp;
-	v = n->val;
-	n->val = NULL;
-
-	// since ep_rpool_mfree doesn't free yet, leave this node in
-	// the list to allow re-use of the key without losing more memory
-	//*npp = n->next;
-	//ep_rpool_mfree(hp->rpool, n->key);
-	//ep_rpool_mfree(hp->rpool, n);
-
-	ep_thr_mutex_unlock(&hp->mutex);
+	v = e->val;
+	ep_mem_free((void *) e->key);
+	htab_remove(t, e);
+	ep_thr_mutex_unlock(&s->mutex);
 	return v;
 }
 
 
 /*
 **  EP_HASH_FORALL -- apply a function to all nodes
+**
+**	Stripes are locked one at a time, so with more than one
+**	stripe this isn't an atomic snapshot of the whole table.
+**	The function must not modify the table.
 */
 
+static void
+htab_forall(struct htab *t, EP_HASH_FORALL_FUNCP func, va_list av)
+{
+	size_t i;
+
+	if (t->ents == NULL)
+		return;
+	for (i = 0; i <= t->mask; i++)
+	{
+		struct hent *e = &t->ents[i];
+		va_list lav;
+
+		if (e->key == NULL)
+			continue;
+		va_copy(lav, av);
+		(*func)(e->keylen, e->key, e->val, lav);
+		va_end(lav);
+	}
+}
+
 void
 ep_hash_forall(
 	EP_HASH *hp,
@@ -266,27 +585,21 @@ ep_hash_forall(
 	...)
 {
 	va_list av;
-	struct node *n;
 	int i;
 
 	va_start(av, func);
 
 	EP_ASSERT_POINTER_VALID(hp);
 
-	ep_thr_mutex_lock(&hp->mutex);
-	for (i = 0; i < hp->tabsize; i++)
+	for (i = 0; i < hp->nstripes; i++)
 	{
-		struct node *next;
-		for (n = hp->tab[i]; n != NULL; n = next)
-		{
-			va_list lav;
-			next = n->next;
+		struct stripe *s = &hp->stripes[i];
 
-			va_copy(lav, av);
-			(*func)(n->keylen, n->key, n->val, lav);
-		}
+		ep_thr_mutex_lock(&s->mutex);
+		htab_forall(&s->old, func, av);
+		htab_forall(&s->cur, func, av);
+		ep_thr_mutex_unlock(&s->mutex);
 	}
 
 	va_end(av);
-	ep_thr_mutex_unlock(&hp->mutex);
 }
@@ -55,6 +55,11 @@ extern EP_HASH	*ep_hash_new(
 			const char *name,
 			EP_HASH_HASH_FUNCP hfunc,
 			int tabsize);
+extern EP_HASH	*ep_hash_new_striped(
+			const char *name,
+			EP_HASH_HASH_FUNCP hfunc,
+			int tabsize,
+			int nstripes);
 extern void	ep_hash_free(
 			EP_HASH *hash);
 extern const void
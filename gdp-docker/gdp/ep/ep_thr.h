@@ -310,6 +310,15 @@ void		ep_thr_pool_run(
 			void (*func)(void *),	// the function
 			void *arg);		// passed to func
 
+// same, but in order with (and never concurrently with) others with key
+void		ep_thr_pool_run_serial(
+			uint32_t key,		// serialization key
+			void (*func)(void *),	// the function
+			void *arg);		// passed to func
+
+// from inside such a function: let the next one with its key start
+void		ep_thr_pool_serial_release(void);
+
 # else // ! EP_OSCF_USE_PTHREADS
 
 # define	ep_thr_yield()
@@ -30,120 +30,466 @@
 
 /*
 **  Thread Pools
+**
+**	Each thread that submits work gets its own bounded queue.
+**	Only the owner ever adds to a queue, but any worker may take
+**	from any queue, so idle workers steal from busy ones (and
+**	from the I/O thread, which is usually the main submitter)
+**	without any shared lock.  Work is always taken from the head
+**	of a queue, so each submitter's work is started in the order
+**	it was submitted.
+**
+**	The function and argument are stored directly in the queue
+**	slot, so submitting work doesn't allocate anything.  Only
+**	if a queue is full (or we've run out of queues) does work go
+**	onto a locked overflow list, which is the only place that
+**	still needs twork structures.
+**
+**	Idle workers sleep on their own condition variable and a
+**	submitter wakes exactly one of them rather than signaling a
+**	shared condition --- and only if no worker is already out
+**	looking for work ("spinning"), since that one will find it.
 */
 
 #include <ep.h>
 #include <ep_dbg.h>
 #include <ep_thr.h>
 
+#include <stdatomic.h>
 #include <string.h>
 #include <sys/queue.h>
 
 static EP_DBG	Dbg = EP_DBG_INIT("libep.thr.pool", "Thread Pool");
 
+#define TP_CACHELINE	64		// to keep hot fields apart
+#define TP_XQUEUES	32		// queues for non-worker threads
+#define TP_SPINS	4		// looks for work before sleeping
+#define TP_LOCAL_RUN	4		// own work before checking others
+
+typedef void	(*tp_func_t)(void *);
+
+/*
+**  Work queues.
+**
+**	Single producer, multiple consumer rings.  The owner fills
+**	the slot at "tail" and then advances tail; consumers read
+**	the slot at "head" and then claim it by advancing head
+**	with a compare-and-swap.  The owner only reuses a slot once
+**	head has moved past it, so a consumer that read a slot that
+**	was then overwritten will always lose the CAS and retry.
+*/
+
+struct tp_slot
+{
+	_Atomic(tp_func_t)	func;		// function to run
+	_Atomic(void *)		arg;		// argument to pass
+};
+
+struct tp_queue
+{
+	atomic_ulong	head;			// next slot to take
+	char		pad0[TP_CACHELINE - sizeof (atomic_ulong)];
+	atomic_ulong	tail;			// next slot to fill
+	char		pad1[TP_CACHELINE - sizeof (atomic_ulong)];
+	unsigned long	mask;			// size of ring - 1
+	struct tp_slot	*ring;			// the slots themselves
+	bool		owned;			// has a live owner
+};
+
+static struct tp_queue *
+tp_queue_new(unsigned long size)
+{
+	struct tp_queue *q;
+
+	q = (struct tp_queue *) ep_mem_zalloc(sizeof *q);
+	q->ring = (struct tp_slot *) ep_mem_zalloc(size * sizeof *q->ring);
+	q->mask = size - 1;
+	atomic_init(&q->head, 0);
+	atomic_init(&q->tail, 0);
+	return q;
+}
+
+// called only by the owner of the queue
+static bool
+tp_queue_put(struct tp_queue *q, tp_func_t func, void *arg)
+{
+	unsigned long tail = atomic_load_explicit(&q->tail,
+					memory_order_relaxed);
+	unsigned long head = atomic_load_explicit(&q->head,
+					memory_order_acquire);
+	struct tp_slot *s;
+
+	if (tail - head > q->mask)
+		return false;			// full
+	s = &q->ring[tail & q->mask];
+	atomic_store_explicit(&s->func, func, memory_order_relaxed);
+	atomic_store_explicit(&s->arg, arg, memory_order_relaxed);
+	atomic_store(&q->tail, tail + 1);
+	return true;
+}
+
+// may be called by anyone
+static bool
+tp_queue_take(struct tp_queue *q, tp_func_t *funcp, void **argp)
+{
+	unsigned long head = atomic_load_explicit(&q->head,
+					memory_order_acquire);
+
+	for (;;)
+	{
+		unsigned long tail = atomic_load(&q->tail);
+		struct tp_slot *s;
+		tp_func_t func;
+		void *arg;
+
+		if ((long) (tail - head) <= 0)
+			return false;		// empty
+		s = &q->ring[head & q->mask];
+		func = atomic_load_explicit(&s->func, memory_order_relaxed);
+		arg = atomic_load_explicit(&s->arg, memory_order_relaxed);
+		if (atomic_compare_exchange_weak_explicit(&q->head,
+					&head, head + 1,
+					memory_order_acq_rel,
+					memory_order_acquire))
+		{
+			*funcp = func;
+			*argp = arg;
+			return true;
+		}
+		// lost the race; head has been reloaded
+	}
+}
+
+
+/*
+**  Overflow work, used when a submitter's queue is full.
+**
+**	These are reused for efficiency; they should be rare, so
+**	a single lock is fine.
+*/
+
 struct twork
 {
 	STAILQ_ENTRY(twork)
 			next;			// next work in list
-	void		(*func)(void *);	// function to run
+	tp_func_t	func;			// function to run
 	void		*arg;			// argument to pass
 };
 
 static EP_THR_MUTEX	FreeTWorkMutex	EP_THR_MUTEX_INITIALIZER;
 static STAILQ_HEAD(tworkq, twork)
 			FreeTWork = STAILQ_HEAD_INITIALIZER(FreeTWork);
+static STAILQ_HEAD(, twork)
+			OverflowTWork = STAILQ_HEAD_INITIALIZER(OverflowTWork);
+static atomic_int	NOverflow;
 
-/*
-**  Allocate/free work requests.
-**
-**	These are reused for efficiency, since they probably turn over
-**	quickly.
-*/
-
-static struct twork *
-twork_new(void)
+static void
+twork_put(tp_func_t func, void *arg)
 {
 	struct twork *tw;
 
 	ep_thr_mutex_lock(&FreeTWorkMutex);
 	if ((tw = STAILQ_FIRST(&FreeTWork)) != NULL)
 		STAILQ_REMOVE_HEAD(&FreeTWork, next);
-	ep_thr_mutex_unlock(&FreeTWorkMutex);
-	if (tw == NULL)
+	else
 		tw = (struct twork *) ep_mem_zalloc(sizeof *tw);
-	return tw;
+	tw->func = func;
+	tw->arg = arg;
+	STAILQ_INSERT_TAIL(&OverflowTWork, tw, next);
+	atomic_fetch_add(&NOverflow, 1);
+	ep_thr_mutex_unlock(&FreeTWorkMutex);
 }
 
-static void
-twork_free(struct twork *tw)
+static bool
+twork_take(tp_func_t *funcp, void **argp)
 {
+	struct twork *tw;
+
+	if (atomic_load(&NOverflow) == 0)
+		return false;
 	ep_thr_mutex_lock(&FreeTWorkMutex);
-	STAILQ_INSERT_HEAD(&FreeTWork, tw, next);
+	if ((tw = STAILQ_FIRST(&OverflowTWork)) != NULL)
+	{
+		STAILQ_REMOVE_HEAD(&OverflowTWork, next);
+		atomic_fetch_sub(&NOverflow, 1);
+		*funcp = tw->func;
+		*argp = tw->arg;
+		STAILQ_INSERT_HEAD(&FreeTWork, tw, next);
+	}
 	ep_thr_mutex_unlock(&FreeTWorkMutex);
+	return tw != NULL;
 }
 
 
 
+struct tp_serial;
+
 /*
 **  Implementation of thread pool.
+**
+**	The mutex protects the idle list and changes to the set of
+**	queues; it is never taken just to submit or find work.
 */
 
+struct tp_worker
+{
+	LIST_ENTRY(tp_worker)
+			next_idle;		// on Pool.idle when asleep
+	struct tp_queue	*queue;			// this worker's own queue
+	EP_THR_COND	wakeup;			// signaled to wake this worker
+	bool		wanted;			// set when woken on purpose
+	unsigned int	seed;			// for picking victims
+	int		nlocal;			// own work run in a row
+};
+
 struct thr_pool
 {
 	EP_THR_MUTEX	mutex;
-	EP_THR_COND	has_work;	// signaled when work becomes available
-	int		free_threads;	// number of idle threads
-	int		num_threads;	// number of running threads
+	LIST_HEAD(, tp_worker)
+			idle;			// sleeping workers
+	atomic_int	nidle;			// number of idle threads
+	atomic_int	nspinning;		// number looking for work
+	atomic_int	num_threads;		// number of running threads
 	int		min_threads;	// minimum number of running threads
 	int		max_threads;	// maximum number of running threads
-	int		max_par_threads; // maximum number of parallel threads
-	struct tworkq	work;		// active work list
+	unsigned long	queue_size;		// slots per queue
+	struct tp_queue	**queues;		// all queues, stealable
+	atomic_int	nqueues;		// number of queues in use
+	int		maxqueues;		// size of queues array
+	pthread_key_t	qkey;			// this thread's queue
+	pthread_key_t	serkey;			// serial queue being run
+	struct tp_serial *serial;		// serial queues (see below)
+	unsigned int	nserial;		// number of serial queues
+	int		serial_batch;		// max items per turn
 	bool		initialized:1;	// set if initialized
 };
 
 static struct thr_pool		Pool;	// the pool!
 
+
 /*
-**  Worker thread
+**  TP_ADD_QUEUE --- register a new queue so it can be stolen from
+**
+**	Pool must be locked (or quiescent).  Returns NULL if we
+**	have run out of slots.
+*/
+
+static struct tp_queue *
+tp_add_queue(void)
+{
+	int n = atomic_load_explicit(&Pool.nqueues, memory_order_relaxed);
+	struct tp_queue *q;
+
+	if (n >= Pool.maxqueues)
+		return NULL;
+	q = tp_queue_new(Pool.queue_size);
+	q->owned = true;
+	Pool.queues[n] = q;
+	atomic_store_explicit(&Pool.nqueues, n + 1, memory_order_release);
+	return q;
+}
+
+
+/*
+**  TP_MY_QUEUE --- find (or assign) the queue for this thread
+**
+**	Queues are never freed, since a thief may be looking at
+**	them at any time; instead when a submitting thread exits
+**	its queue is left for the next new thread to adopt.  Any
+**	work still in it gets run in the meantime.
+*/
+
+static void
+tp_queue_orphan(void *a)
+{
+	struct tp_queue *q = (struct tp_queue *) a;
+
+	ep_thr_mutex_lock(&Pool.mutex);
+	q->owned = false;
+	ep_thr_mutex_unlock(&Pool.mutex);
+}
+
+static struct tp_queue *
+tp_my_queue(void)
+{
+	struct tp_queue *q = (struct tp_queue *) pthread_getspecific(Pool.qkey);
+	int i;
+
+	if (q != NULL)
+		return q;
+
+	ep_thr_mutex_lock(&Pool.mutex);
+	for (i = 0; i < atomic_load(&Pool.nqueues); i++)
+	{
+		if (!Pool.queues[i]->owned)
+		{
+			q = Pool.queues[i];
+			q->owned = true;
+			break;
+		}
+	}
+	if (q == NULL)
+		q = tp_add_queue();
+	ep_thr_mutex_unlock(&Pool.mutex);
+	if (q != NULL)
+		pthread_setspecific(Pool.qkey, q);
+	else
+		ep_dbg_cprintf(Dbg, 1, "tp_my_queue: out of queues\n");
+	return q;
+}
+
+
+/*
+**  TP_FIND_WORK --- look for something to do
+**
+**	Our own queue first (it's probably hot in cache), then
+**	everyone else's starting at a random place so that thieves
+**	spread out, then the overflow list.  Work that keeps
+**	submitting more work would starve everyone else if we
+**	always looked at home first, so after a few of our own in
+**	a row we look elsewhere first.
+*/
+
+static bool
+tp_find_work(struct tp_worker *w, tp_func_t *funcp, void **argp)
+{
+	int nq = atomic_load_explicit(&Pool.nqueues, memory_order_acquire);
+	int start;
+	int i;
+
+	if (w->nlocal < TP_LOCAL_RUN && tp_queue_take(w->queue, funcp, argp))
+	{
+		w->nlocal++;
+		return true;
+	}
+	w->nlocal = 0;
+	start = rand_r(&w->seed) % nq;
+	for (i = 0; i < nq; i++)
+	{
+		struct tp_queue *q = Pool.queues[(start + i) % nq];
+
+		if (q != w->queue && tp_queue_take(q, funcp, argp))
+			return true;
+	}
+	if (twork_take(funcp, argp))
+		return true;
+	return tp_queue_take(w->queue, funcp, argp);
+}
+
+
+/*
+**  TP_WAKE_ONE --- wake up one idle worker
 **
-**	These wait for work, and when found they do something.
-**	There's nothing particularly fancy here other than
-**	counting the number of free (unused) threads so we can
-**	implement the hysteresis in the size of the pool.
+**	Pool must be locked.  The most recently idled worker is
+**	chosen since its cache is likely to be warmest.
+*/
+
+static bool
+tp_wake_one(void)
+{
+	struct tp_worker *w = LIST_FIRST(&Pool.idle);
+
+	if (w == NULL)
+		return false;
+	LIST_REMOVE(w, next_idle);
+	atomic_fetch_sub(&Pool.nidle, 1);
+	atomic_fetch_add(&Pool.nspinning, 1);	// counted on its behalf
+	w->wanted = true;
+	ep_thr_cond_signal(&w->wakeup);
+	return true;
+}
+
+
+/*
+**  Worker thread
 **
+**	These look for work, and when found they do something.
 **	Note that when a work function returns the thread
 **	immediately looks for more work.  It's better to not
 **	sleep at all if possible to keep our cache hot.
+**
+**	While looking a worker counts as spinning.  When the last
+**	spinner finds something it wakes up another worker to take
+**	over, since there may well be more work behind it, or starts
+**	a new one if none are asleep and the pool may still grow.
+**	Otherwise a submitter that saw us spinning would have left
+**	its work queued with nobody left to look for it.
+**
+**	Before going to sleep a worker advertises itself as idle
+**	and then looks for work one more time.  Since submitters
+**	queue work before checking for spinning and idle workers,
+**	one side or the other will always notice, so no wakeup is
+**	lost.
 */
 
+static void	tp_add_thread(void);
+
 static void *
 worker_thread(void *a)
 {
-	// start searching for work
+	struct tp_worker *w = (struct tp_worker *) a;
+	bool spinning = true;		// tp_add_thread counted us
+
+	pthread_setspecific(Pool.qkey, w->queue);
 	for (;;)
 	{
-		struct twork *tw;
+		tp_func_t func;
+		void *arg;
+		bool found = false;
+		int i;
 
-		// see if there is anything to do
-		ep_thr_mutex_lock(&Pool.mutex);
-		Pool.free_threads++;
-		while ((tw = STAILQ_FIRST(&Pool.work)) == NULL)
+		if (!spinning)
 		{
-			// no, wait for something
-			ep_thr_cond_wait(&Pool.has_work, &Pool.mutex, NULL);
+			atomic_fetch_add(&Pool.nspinning, 1);
+			spinning = true;
 		}
+		for (i = 0; i < TP_SPINS && !found; i++)
+		{
+			if (i > 0)
+				ep_thr_yield();
+			found = tp_find_work(w, &func, &arg);
+		}
+		spinning = false;
+		if (found)
+		{
+			if (atomic_fetch_sub(&Pool.nspinning, 1) == 1 &&
+			    (atomic_load(&Pool.nidle) > 0 ||
+			     atomic_load(&Pool.num_threads) < Pool.max_threads))
+			{
+				ep_thr_mutex_lock(&Pool.mutex);
+				if (!tp_wake_one() &&
+				    atomic_load(&Pool.num_threads) <
+						Pool.max_threads)
+					tp_add_thread();
+				ep_thr_mutex_unlock(&Pool.mutex);
+			}
+			(*func)(arg);
+			continue;
+		}
+		atomic_fetch_sub(&Pool.nspinning, 1);
 
-		// yes, please run it! (but don't stay locked)
-		STAILQ_REMOVE_HEAD(&Pool.work, next);
-		Pool.free_threads--;
-
-		// keep stats for testing
-		if (Pool.num_threads - Pool.free_threads > Pool.max_par_threads)
-			Pool.max_par_threads = Pool.num_threads - Pool.free_threads;
+		// nothing to do: go to sleep
+		ep_thr_mutex_lock(&Pool.mutex);
+		w->wanted = false;
+		LIST_INSERT_HEAD(&Pool.idle, w, next_idle);
+		atomic_fetch_add(&Pool.nidle, 1);
+		while (!w->wanted)
+		{
+			if (tp_find_work(w, &func, &arg))
+			{
+				// never went to sleep; take ourselves off
+				LIST_REMOVE(w, next_idle);
+				atomic_fetch_sub(&Pool.nidle, 1);
+				found = true;
+				break;
+			}
+			ep_thr_cond_wait(&w->wakeup, &Pool.mutex, NULL);
+		}
 		ep_thr_mutex_unlock(&Pool.mutex);
-
-		tw->func(tw->arg);
-		twork_free(tw);
+		if (found)
+			(*func)(arg);
+		else
+			spinning = true;	// tp_wake_one counted us
 	}
 
 	// will never get here
@@ -161,20 +507,38 @@ worker_thread(void *a)
 static void
 tp_add_thread(void)
 {
+	struct tp_worker *w;
 	pthread_t thread;
 	int err;
 
 	ep_dbg_cprintf(Dbg, 18, "Adding thread to pool\n");
-	err = pthread_create(&thread, NULL, &worker_thread, NULL);
+	w = (struct tp_worker *) ep_mem_zalloc(sizeof *w);
+	w->queue = tp_add_queue();
+	if (w->queue == NULL)
+	{
+		// can't happen: there's always room for max_threads
+		ep_mem_free(w);
+		return;
+	}
+	ep_thr_cond_init(&w->wakeup);
+	w->seed = (unsigned int) atomic_load(&Pool.num_threads) * 7919 + 1;
+	atomic_fetch_add(&Pool.nspinning, 1);	// new threads start looking
+	err = pthread_create(&thread, NULL, &worker_thread, w);
 	if (err != 0)
 	{
 		fprintf(stderr,
 			"ep_thr_pool_init: pthread_create failed (%d)\n",
 			err);
+
+		// leave the queue; it's already visible to thieves
+		atomic_fetch_sub(&Pool.nspinning, 1);
+		w->queue->owned = false;
+		ep_thr_cond_destroy(&w->wakeup);
+		ep_mem_free(w);
 	}
 	else
 	{
-		Pool.num_threads++;
+		atomic_fetch_add(&Pool.num_threads, 1);
 	}
 }
 
@@ -193,11 +557,18 @@ tp_add_thread(void)
 **	The current default for max_threads is twice the number of
 **	available cores.  It isn't clear this is a good choice,
 **	particularly for I/O intensive loads.
+**
+**	Each queue holds libep.thr.pool.queue_size entries (rounded
+**	up to a power of two); work submitted beyond that goes on
+**	the (locked) overflow list.
 */
 
+static void	tp_serial_init(void);
+
 void
 ep_thr_pool_init(int min_threads, int max_threads, uint32_t flags)
 {
+	long qsize;
 	int i;
 
 	if (Pool.initialized)
@@ -217,12 +588,25 @@ ep_thr_pool_init(int min_threads, int max_threads, uint32_t flags)
 		if (max_threads < min_threads)
 			max_threads = min_threads > 0 ? min_threads : 1;
 	}
+	qsize = ep_adm_getlongparam("libep.thr.pool.queue_size", 1024);
+	Pool.queue_size = 2;
+	while (Pool.queue_size < (unsigned long) qsize)
+		Pool.queue_size <<= 1;
 
 	Pool.min_threads = min_threads;
 	Pool.max_threads = max_threads;
 	ep_thr_mutex_init(&Pool.mutex, EP_THR_MUTEX_DEFAULT);
-	ep_thr_cond_init(&Pool.has_work);
-	STAILQ_INIT(&Pool.work);
+	LIST_INIT(&Pool.idle);
+	atomic_init(&Pool.nidle, 0);
+	atomic_init(&Pool.nspinning, 0);
+	atomic_init(&Pool.num_threads, 0);
+	atomic_init(&Pool.nqueues, 0);
+	Pool.maxqueues = max_threads + TP_XQUEUES;
+	Pool.queues = (struct tp_queue **)
+			ep_mem_zalloc(Pool.maxqueues * sizeof *Pool.queues);
+	pthread_key_create(&Pool.qkey, &tp_queue_orphan);
+
+	tp_serial_init();
 
 	for (i = 0; i < min_threads; i++)
 		tp_add_thread();
@@ -234,27 +618,198 @@ ep_thr_pool_init(int min_threads, int max_threads, uint32_t flags)
 **  EP_THR_POOL_RUN --- run function in worker thread
 **
 **	This basically just calls a function in a worker thread.
-**	We make it a point to run these in a FIFO order.
+**	Work from any one thread is started in FIFO order, but
+**	there is no ordering between work from different threads.
 */
 
 void
 ep_thr_pool_run(void (*func)(void *), void *arg)
 {
-	struct twork *tw = twork_new();
+	struct tp_queue *q;
 
 	// in case application doesn't initialized the pool
 	if (!Pool.initialized)
 		ep_thr_pool_init(-1, -1, 0);
 
-	ep_thr_mutex_lock(&Pool.mutex);
+	q = tp_my_queue();
+	if (q == NULL || !tp_queue_put(q, func, arg))
+		twork_put(func, arg);
+
+	// unless someone is already looking, wake up a sleeper or
+	// start up a new thread if permitted
+	if (atomic_load(&Pool.nspinning) == 0 &&
+	    (atomic_load(&Pool.nidle) > 0 ||
+	     atomic_load(&Pool.num_threads) < Pool.max_threads))
+	{
+		ep_thr_mutex_lock(&Pool.mutex);
+		if (!tp_wake_one() &&
+		    atomic_load(&Pool.num_threads) < Pool.max_threads)
+			tp_add_thread();
+		ep_thr_mutex_unlock(&Pool.mutex);
+	}
+}
+
+
+/*
+**  Serial queues
+**
+**	Work with the same key is run one at a time, in the order
+**	submitted; work with different keys runs in parallel.  Keys
+**	are hashed onto a fixed set of queues, each of which is run
+**	by at most one worker at a time.  That worker runs at most
+**	serial_batch items and then puts the queue back on the pool
+**	so that one busy key can't hold onto a worker forever.
+**
+**	This is what callers should use when the work for one key
+**	would otherwise all serialize on the same lock: instead of
+**	several workers blocking on that lock, one worker does the
+**	work and the rest are free for other keys.
+*/
+
+struct tp_serial
+{
+	EP_THR_MUTEX	mutex;
+	struct tworkq	work;			// pending work
+	struct tworkq	free;			// free twork structures
+	bool		running;		// on the pool or in a worker
+	char		pad[TP_CACHELINE];	// keep queues apart
+};
+
+static void
+tp_serial_init(void)
+{
+	long n;
+	unsigned int i;
+
+	n = ep_adm_getlongparam("libep.thr.pool.serial.queues", 256);
+	Pool.nserial = n > 0 ? n : 1;
+	Pool.serial_batch = ep_adm_getintparam("libep.thr.pool.serial.batch",
+				16);
+	if (Pool.serial_batch < 1)
+		Pool.serial_batch = 1;
+	Pool.serial = (struct tp_serial *)
+			ep_mem_zalloc(Pool.nserial * sizeof *Pool.serial);
+	pthread_key_create(&Pool.serkey, NULL);
+	for (i = 0; i < Pool.nserial; i++)
+	{
+		ep_thr_mutex_init(&Pool.serial[i].mutex, EP_THR_MUTEX_DEFAULT);
+		STAILQ_INIT(&Pool.serial[i].work);
+		STAILQ_INIT(&Pool.serial[i].free);
+	}
+}
+
+static void
+tp_serial_run(void *a)
+{
+	struct tp_serial *sq = (struct tp_serial *) a;
+	int n;
+
+	for (n = 0; ; n++)
+	{
+		struct twork *tw;
+		tp_func_t func;
+		void *arg;
+
+		ep_thr_mutex_lock(&sq->mutex);
+		if ((tw = STAILQ_FIRST(&sq->work)) == NULL)
+		{
+			sq->running = false;
+			ep_thr_mutex_unlock(&sq->mutex);
+			return;
+		}
+		if (n >= Pool.serial_batch)
+		{
+			// give others a turn; we stay "running"
+			ep_thr_mutex_unlock(&sq->mutex);
+			ep_thr_pool_run(&tp_serial_run, sq);
+			return;
+		}
+		STAILQ_REMOVE_HEAD(&sq->work, next);
+		func = tw->func;
+		arg = tw->arg;
+		STAILQ_INSERT_HEAD(&sq->free, tw, next);
+		ep_thr_mutex_unlock(&sq->mutex);
+
+		pthread_setspecific(Pool.serkey, sq);
+		(*func)(arg);
+		if (pthread_getspecific(Pool.serkey) != sq)
+		{
+			// func let the queue go on without us
+			return;
+		}
+		pthread_setspecific(Pool.serkey, NULL);
+	}
+}
+
+
+/*
+**  EP_THR_POOL_RUN_SERIAL --- run function in order with others
+**
+**	Like ep_thr_pool_run, but work with the same key is run
+**	strictly in order and never concurrently.  Different keys
+**	may share a queue, so the key should be well distributed
+**	(e.g., part of a hash).
+*/
+
+void
+ep_thr_pool_run_serial(uint32_t key, void (*func)(void *), void *arg)
+{
+	struct tp_serial *sq;
+	struct twork *tw;
+	bool start;
+
+	// in case application doesn't initialized the pool
+	if (!Pool.initialized)
+		ep_thr_pool_init(-1, -1, 0);
+
+	sq = &Pool.serial[key % Pool.nserial];
+	ep_thr_mutex_lock(&sq->mutex);
+	if ((tw = STAILQ_FIRST(&sq->free)) != NULL)
+		STAILQ_REMOVE_HEAD(&sq->free, next);
+	else
+		tw = (struct twork *) ep_mem_zalloc(sizeof *tw);
 	tw->func = func;
 	tw->arg = arg;
-	STAILQ_INSERT_TAIL(&Pool.work, tw, next);
+	STAILQ_INSERT_TAIL(&sq->work, tw, next);
+	start = !sq->running;
+	sq->running = true;
+	ep_thr_mutex_unlock(&sq->mutex);
 
-	// start up a new thread if needed and permitted
-	if (Pool.free_threads == 0 && Pool.num_threads < Pool.max_threads)
-		tp_add_thread();
-	else
-		ep_thr_cond_signal(&Pool.has_work);
-	ep_thr_mutex_unlock(&Pool.mutex);
+	if (start)
+		ep_thr_pool_run(&tp_serial_run, sq);
+}
+
+
+/*
+**  EP_THR_POOL_SERIAL_RELEASE --- let the rest of a serial queue run
+**
+**	Called from a function started by ep_thr_pool_run_serial
+**	once the work that had to be ordered is done (for example,
+**	when it has queued itself somewhere else and is about to
+**	block).  The next function with the same key may then start
+**	while the caller is still running.  Does nothing if the
+**	caller was not started by ep_thr_pool_run_serial.
+*/
+
+void
+ep_thr_pool_serial_release(void)
+{
+	struct tp_serial *sq;
+	bool more;
+
+	if (!Pool.initialized)
+		return;
+	sq = (struct tp_serial *) pthread_getspecific(Pool.serkey);
+	if (sq == NULL)
+		return;
+	pthread_setspecific(Pool.serkey, NULL);
+
+	ep_thr_mutex_lock(&sq->mutex);
+	more = !STAILQ_EMPTY(&sq->work);
+	if (!more)
+		sq->running = false;
+	ep_thr_mutex_unlock(&sq->mutex);
+
+	if (more)
+		ep_thr_pool_run(&tp_serial_run, sq);
 }
@@ -0,0 +1,459 @@
+/* vim: set ai sw=8 sts=8 ts=8 :*/
+
+/***********************************************************************
+**  ----- BEGIN LICENSE BLOCK -----
+**	LIBEP: Enhanced Portability Library (Reduced Edition)
+**
+**	Copyright (c) 2008-2019, Eric P. Allman.  All rights reserved.
+**	Copyright (c) 2015-2019, Regents of the University of California.
+**	All rights reserved.
+**
+**	Permission is hereby granted, without written agreement and without
+**	license or royalty fees, to use, copy, modify, and distribute this
+**	software and its documentation for any purpose, provided that the above
+**	copyright notice and the following two paragraphs appear in all copies
+**	of this software.
+**
+**	IN NO EVENT SHALL REGENTS BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT,
+**	SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES, INCLUDING LOST
+**	PROFITS, ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION,
+**	EVEN IF REGENTS HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**
+**	REGENTS SPECIFICALLY DISCLAIMS ANY WARRANTIES, INCLUDING, BUT NOT
+**	LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+**	FOR A PARTICULAR PURPOSE. THE SOFTWARE AND ACCOMPANYING DOCUMENTATION,
+**	IF ANY, PROVIDED HEREUNDER IS PROVIDED "AS IS". REGENTS HAS NO
+**	OBLIGATION TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS,
+**	OR MODIFICATIONS.
+**  ----- END LICENSE BLOCK -----
+***********************************************************************/
+
+/*
+**  HASH-BENCH --- compare ep_hash with the old chained hash table
+**
+**	The old implementation (a fixed size array of chains with a
+**	per-byte hash) is reproduced here so the two can be run side
+**	by side.  Keys are random 32-byte strings, like the GDP names
+**	that the GOB cache uses as keys.  For each table size the
+**	keys are inserted, searched for (both present and absent),
+**	and deleted, and the average cost of each operation is
+**	reported.
+**
+**	With -t, several threads search and update the same table at
+**	once, which shows the effect of lock striping (-S).
+*/
+
+#include "ep.h"
+#include "ep_crypto.h"
+#include "ep_dbg.h"
+#include "ep_hash.h"
+#include "ep_rpool.h"
+#include "ep_thr.h"
+#include "ep_time.h"
+
+#include <getopt.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <sysexits.h>
+
+#define KEYLEN		32
+
+
+/*
+**  The old implementation, as it was before open addressing.
+*/
+
+struct old_node
+{
+	size_t			keylen;
+	const void		*key;
+	const void		*val;
+	struct old_node		*next;
+};
+
+struct old_hash
+{
+	EP_RPOOL		*rpool;
+	EP_THR_MUTEX		mutex;
+	int			tabsize;
+	struct old_node		*tab[0];
+};
+
+static int
+old_hfunc(const struct old_hash *hp, size_t keysize, const void *_key)
+{
+	const uint8_t *key = (const uint8_t *) _key;
+	int hfunc = 0;
+	size_t i;
+
+	for (i = 0; i < keysize; i++)
+		hfunc = ((hfunc << 1) ^ (*key++ & 0xff)) % hp->tabsize;
+	return hfunc;
+}
+
+static void *
+old_new(int tabsize)
+{
+	EP_RPOOL *rp = ep_rpool_new("old_hash", (size_t) 0);
+	struct old_hash *hp;
+
+	// the old table never grew, so it defaulted to a large size
+	if (tabsize == 0)
+		tabsize = 2003;
+	hp = ep_rpool_zalloc(rp, sizeof *hp + tabsize * sizeof hp->tab[0]);
+	hp->rpool = rp;
+	hp->tabsize = tabsize;
+	ep_thr_mutex_init(&hp->mutex, EP_THR_MUTEX_DEFAULT);
+	return hp;
+}
+
+static void
+old_free(void *h)
+{
+	struct old_hash *hp = h;
+
+	ep_thr_mutex_destroy(&hp->mutex);
+	ep_rpool_free(hp->rpool);
+}
+
+static struct old_node **
+old_find(struct old_hash *hp, size_t keylen, const void *key)
+{
+	struct old_node **npp = &hp->tab[old_hfunc(hp, keylen, key)];
+	struct old_node *n;
+
+	for (n = *npp; n != NULL; npp = &n->next, n = *npp)
+		if (keylen == n->keylen && memcmp(key, n->key, keylen) == 0)
+			break;
+	return npp;
+}
+
+static const void *
+old_search(void *h, size_t keylen, const void *key)
+{
+	struct old_hash *hp = h;
+	struct old_node **npp;
+	const void *val;
+
+	ep_thr_mutex_lock(&hp->mutex);
+	npp = old_find(hp, keylen, key);
+	val = *npp == NULL ? NULL : (*npp)->val;
+	ep_thr_mutex_unlock(&hp->mutex);
+	return val;
+}
+
+static const void *
+old_insert(void *h, size_t keylen, const void *key, const void *val)
+{
+	struct old_hash *hp = h;
+	struct old_node **npp;
+	struct old_node *n;
+	const void *oldval = NULL;
+	void *kp;
+
+	ep_thr_mutex_lock(&hp->mutex);
+	npp = old_find(hp, keylen, key);
+	if ((n = *npp) != NULL)
+	{
+		oldval = n->val;
+		n->val = val;
+	}
+	else
+	{
+		n = ep_rpool_malloc(hp->rpool, sizeof *n);
+		n->keylen = keylen;
+		kp = ep_rpool_malloc(hp->rpool, keylen);
+		memcpy(kp, key, keylen);
+		n->key = kp;
+		n->val = val;
+		n->next = NULL;
+		*npp = n;
+	}
+	ep_thr_mutex_unlock(&hp->mutex);
+	return oldval;
+}
+
+static const void *
+old_delete(void *h, size_t keylen, const void *key)
+{
+	struct old_hash *hp = h;
+	struct old_node **npp;
+	const void *val = NULL;
+
+	// the old code left deleted nodes in their chains
+	ep_thr_mutex_lock(&hp->mutex);
+	npp = old_find(hp, keylen, key);
+	if (*npp != NULL)
+	{
+		val = (*npp)->val;
+		(*npp)->val = NULL;
+	}
+	ep_thr_mutex_unlock(&hp->mutex);
+	return val;
+}
+
+
+/*
+**  Thin wrappers so both implementations look the same.
+*/
+
+static int	NStripes;		// for new_new
+
+static void *
+new_new(int tabsize)
+{
+	return ep_hash_new_striped("hash-bench", EP_HASH_DEFHFUNC,
+				tabsize, NStripes);
+}
+
+static void
+new_free(void *h)
+{
+	ep_hash_free(h);
+}
+
+static const void *
+new_search(void *h, size_t keylen, const void *key)
+{
+	return ep_hash_search(h, keylen, key);
+}
+
+static const void *
+new_insert(void *h, size_t keylen, const void *key, const void *val)
+{
+	return ep_hash_insert(h, keylen, key, val);
+}
+
+static const void *
+new_delete(void *h, size_t keylen, const void *key)
+{
+	return ep_hash_delete(h, keylen, key);
+}
+
+static struct impl
+{
+	const char	*name;
+	void		*(*new)(int tabsize);
+	void		(*free)(void *h);
+	const void	*(*search)(void *h, size_t keylen, const void *key);
+	const void	*(*insert)(void *h, size_t keylen, const void *key,
+					const void *val);
+	const void	*(*delete)(void *h, size_t keylen, const void *key);
+} Impls[] =
+{
+	{ "old",	old_new,	old_free,
+			old_search,	old_insert,	old_delete,	},
+	{ "new",	new_new,	new_free,
+			new_search,	new_insert,	new_delete,	},
+	{ NULL }
+};
+
+
+static uint8_t	*Keys;			// nkeys present, then nkeys absent
+static atomic_long	NMisses;		// lookups that gave the wrong answer
+
+static const void *
+keyat(long i)
+{
+	return Keys + i * KEYLEN;
+}
+
+static double
+ns_per_op(EP_TIME_SPEC *start, long nops)
+{
+	EP_TIME_SPEC now;
+
+	ep_time_now(&now);
+	return ep_time_diff_usec(start, &now) * 1000.0 / nops;
+}
+
+
+/*
+**  Single threaded: time each kind of operation separately.
+*/
+
+static void
+run_serial(struct impl *ip, long nkeys, int tabsize)
+{
+	EP_TIME_SPEC start;
+	double ins, hit, miss, del;
+	void *h;
+	long i;
+
+	h = ip->new(tabsize);
+
+	ep_time_now(&start);
+	for (i = 0; i < nkeys; i++)
+		ip->insert(h, KEYLEN, keyat(i), (void *) (i + 1));
+	ins = ns_per_op(&start, nkeys);
+
+	ep_time_now(&start);
+	for (i = 0; i < nkeys; i++)
+		if (ip->search(h, KEYLEN, keyat(i)) != (void *) (i + 1))
+			NMisses++;
+	hit = ns_per_op(&start, nkeys);
+
+	ep_time_now(&start);
+	for (i = 0; i < nkeys; i++)
+		if (ip->search(h, KEYLEN, keyat(nkeys + i)) != NULL)
+			NMisses++;
+	miss = ns_per_op(&start, nkeys);
+
+	ep_time_now(&start);
+	for (i = 0; i < nkeys; i++)
+		ip->delete(h, KEYLEN, keyat(i));
+	del = ns_per_op(&start, nkeys);
+
+	ip->free(h);
+	printf("%-4s %9ld %10.1f %10.1f %10.1f %10.1f\n",
+			ip->name, nkeys, ins, hit, miss, del);
+}
+
+
+/*
+**  Multithreaded: each thread does a mix of searches (90%) and
+**  re-inserts of existing keys on a shared, preloaded table.
+*/
+
+struct thr_arg
+{
+	struct impl	*ip;
+	void		*h;
+	long		nkeys;
+	long		nops;
+	unsigned	seed;
+};
+
+static void *
+thr_run(void *_a)
+{
+	struct thr_arg *a = _a;
+	long i;
+
+	for (i = 0; i < a->nops; i++)
+	{
+		long k = rand_r(&a->seed) % a->nkeys;
+
+		if (i % 10 == 0)
+			a->ip->insert(a->h, KEYLEN, keyat(k), (void *) (k + 1));
+		else if (a->ip->search(a->h, KEYLEN, keyat(k)) != (void *) (k + 1))
+			NMisses++;
+	}
+	return NULL;
+}
+
+static void
+run_threaded(struct impl *ip, long nkeys, int tabsize, int nthreads)
+{
+	struct thr_arg args[nthreads];
+	EP_THR tids[nthreads];
+	EP_TIME_SPEC start;
+	long nops = 1000000;
+	void *h;
+	long i;
+	int t;
+
+	h = ip->new(tabsize);
+	for (i = 0; i < nkeys; i++)
+		ip->insert(h, KEYLEN, keyat(i), (void *) (i + 1));
+
+	ep_time_now(&start);
+	for (t = 0; t < nthreads; t++)
+	{
+		args[t].ip = ip;
+		args[t].h = h;
+		args[t].nkeys = nkeys;
+		args[t].nops = nops / nthreads;
+		args[t].seed = t + 1;
+		ep_thr_spawn(&tids[t], thr_run, &args[t]);
+	}
+	for (t = 0; t < nthreads; t++)
+		pthread_join(tids[t], NULL);
+	printf("%-4s %9ld %10d %10.1f\n",
+			ip->name, nkeys, nthreads, ns_per_op(&start, nops));
+	ip->free(h);
+}
+
+
+static void
+usage(const char *prog)
+{
+	fprintf(stderr,
+		"Usage: %s [-D dbgspec] [-n maxkeys] [-S nstripes] [-s tabsize]\n"
+		"\t[-t nthreads]\n"
+		"    -D  set debugging flags\n"
+		"    -n  largest number of keys (default 1000000)\n"
+		"    -S  lock stripes for the new table (default 1)\n"
+		"    -s  initial table size (old table default 2003)\n"
+		"    -t  run this many threads against one table\n",
+		prog);
+	exit(EX_USAGE);
+}
+
+int
+main(int argc, char **argv)
+{
+	long maxkeys = 1000000;
+	int tabsize = 0;
+	int nthreads = 0;
+	struct impl *ip;
+	long nkeys;
+	int opt;
+
+	NStripes = 1;
+	while ((opt = getopt(argc, argv, "D:n:S:s:t:")) > 0)
+	{
+		switch (opt)
+		{
+		case 'D':
+			ep_dbg_set(optarg);
+			break;
+
+		case 'n':
+			maxkeys = atol(optarg);
+			break;
+
+		case 'S':
+			NStripes = atoi(optarg);
+			break;
+
+		case 's':
+			tabsize = atoi(optarg);
+			break;
+
+		case 't':
+			nthreads = atoi(optarg);
+			break;
+
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (optind != argc || maxkeys < 1 || NStripes < 1 || nthreads < 0)
+		usage(argv[0]);
+
+	ep_lib_init(EP_LIB_USEPTHREADS);
+	ep_crypto_init(0);
+
+	Keys = ep_mem_malloc(2 * maxkeys * KEYLEN);
+	ep_crypto_random_buf(Keys, 2 * maxkeys * KEYLEN);
+
+	if (nthreads == 0)
+		printf("impl      keys  insert ns     hit ns    miss ns  delete ns\n");
+	else
+		printf("impl      keys    threads      ns/op\n");
+	for (nkeys = 1000; nkeys <= maxkeys; nkeys *= 10)
+	{
+		for (ip = Impls; ip->name != NULL; ip++)
+		{
+			if (nthreads == 0)
+				run_serial(ip, nkeys, tabsize);
+			else
+				run_threaded(ip, nkeys, tabsize, nthreads);
+		}
+	}
+	if (NMisses != 0)
+		printf("*** %ld lookups returned the wrong value\n",
+				(long) NMisses);
+	return NMisses != 0;
+}
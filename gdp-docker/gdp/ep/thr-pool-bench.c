@@ -0,0 +1,559 @@
+/* vim: set ai sw=8 sts=8 ts=8 :*/
+
+/***********************************************************************
+**  ----- BEGIN LICENSE BLOCK -----
+**	LIBEP: Enhanced Portability Library (Reduced Edition)
+**
+**	Copyright (c) 2008-2019, Eric P. Allman.  All rights reserved.
+**	Copyright (c) 2015-2019, Regents of the University of California.
+**	All rights reserved.
+**
+**	Permission is hereby granted, without written agreement and without
+**	license or royalty fees, to use, copy, modify, and distribute this
+**	software and its documentation for any purpose, provided that the above
+**	copyright notice and the following two paragraphs appear in all copies
+**	of this software.
+**
+**	IN NO EVENT SHALL REGENTS BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT,
+**	SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES, INCLUDING LOST
+**	PROFITS, ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION,
+**	EVEN IF REGENTS HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**
+**	REGENTS SPECIFICALLY DISCLAIMS ANY WARRANTIES, INCLUDING, BUT NOT
+**	LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+**	FOR A PARTICULAR PURPOSE. THE SOFTWARE AND ACCOMPANYING DOCUMENTATION,
+**	IF ANY, PROVIDED HEREUNDER IS PROVIDED "AS IS". REGENTS HAS NO
+**	OBLIGATION TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS,
+**	OR MODIFICATIONS.
+**  ----- END LICENSE BLOCK -----
+***********************************************************************/
+
+/*
+**  THR-POOL-BENCH --- measure thread pool throughput
+**
+**	Runs a stream of small tasks through ep_thr_pool_run and
+**	reports tasks per second for a range of pool sizes.  The
+**	pool is a per-process singleton, so each pool size is run
+**	in its own child process.
+**
+**	Tasks can optionally spawn further tasks (-f), which is what
+**	happens when a command handler hands work back to the pool.
+**
+**	With -k, each task instead belongs to one of several keys
+**	("logs") and holds that key's lock while it works, the way
+**	command processing holds the GOB lock (optionally waiting
+**	for "I/O" with it held, -u).  A fraction of the
+**	tasks (-z) go to a single hot key.  Tasks are either handed
+**	straight to the pool or, with -o, queued by key using
+**	ep_thr_pool_run_serial.  Latency from submission to
+**	completion is reported separately for the hot key and for
+**	the rest, along with how fairly the cold keys were served.
+**
+**	With -g, keyed tasks mimic appends under group commit: each
+**	queues itself on its key's commit queue and the first one in
+**	line does one "I/O" (-u) for everything queued, up to the
+**	given batch size.  Queued tasks release their serial queue
+**	while they wait, as gdplogd does, unless -H is given.
+*/
+
+#include "ep.h"
+#include "ep_dbg.h"
+#include "ep_thr.h"
+#include "ep_time.h"
+
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <sysexits.h>
+#include <sys/wait.h>
+
+static EP_THR_MUTEX	DoneMutex	EP_THR_MUTEX_INITIALIZER;
+static EP_THR_COND	DoneCond	EP_THR_COND_INITIALIZER;
+static atomic_long	NRemaining;		// tasks not yet finished
+static atomic_long	NRun;			// tasks actually run
+static int		Spin;			// work per task
+static int		Fanout;			// children per top level task
+static int		NKeys;			// number of keys (logs)
+static double		Skew;			// fraction of work to key 0
+static bool		Ordered;		// use ep_thr_pool_run_serial
+static long		Rate;			// submissions/sec (0 = no limit)
+static long		IoWait;			// usec "I/O" with key locked
+static int		GroupMax;		// group commit batch (0 = none)
+static bool		Hold;			// keep serial queue while waiting
+
+static void
+burn(int n)
+{
+	volatile int i;
+
+	for (i = 0; i < n; i++)
+		continue;
+}
+
+// counted without a lock so that the pool is all that's measured
+static void
+task_done(void)
+{
+	atomic_fetch_add(&NRun, 1);
+	if (atomic_fetch_sub(&NRemaining, 1) == 1)
+	{
+		ep_thr_mutex_lock(&DoneMutex);
+		ep_thr_cond_signal(&DoneCond);
+		ep_thr_mutex_unlock(&DoneMutex);
+	}
+}
+
+static void
+leaf_task(void *arg)
+{
+	burn(Spin);
+	task_done();
+}
+
+static void
+top_task(void *arg)
+{
+	int i;
+
+	burn(Spin);
+	for (i = 0; i < Fanout; i++)
+		ep_thr_pool_run(&leaf_task, NULL);
+	task_done();
+}
+
+
+/*
+**  Submitter threads, standing in for the I/O thread.
+*/
+
+struct submitter
+{
+	pthread_t	thread;
+	long		ntasks;
+};
+
+static void *
+submit_thread(void *a)
+{
+	struct submitter *s = (struct submitter *) a;
+	long i;
+
+	for (i = 0; i < s->ntasks; i++)
+		ep_thr_pool_run(&top_task, NULL);
+	return NULL;
+}
+
+
+/*
+**  Keyed tasks
+*/
+
+struct job
+{
+	int		key;			// which "log"
+	EP_TIME_SPEC	submitted;		// when handed to the pool
+	double		latency;		// seconds until done
+};
+
+static EP_THR_MUTEX	*KeyMutex;		// one per key
+
+// a key's group commit queue
+struct commitq
+{
+	EP_THR_MUTEX	mutex;
+	EP_THR_COND	cond;
+	uint64_t	next_seq;		// next place in line
+	uint64_t	committed;		// everything before this is done
+	bool		leader;			// a commit is in progress
+	long		ncommits;		// number of "I/Os"
+};
+
+static struct commitq	*CommitQ;		// one per key
+
+static void
+group_commit(struct commitq *cq, int key)
+{
+	uint64_t seq;
+
+	ep_thr_mutex_lock(&cq->mutex);
+	seq = cq->next_seq++;
+	ep_thr_mutex_unlock(&KeyMutex[key]);
+	if (!Hold)
+	{
+		ep_thr_mutex_unlock(&cq->mutex);
+		ep_thr_pool_serial_release();
+		ep_thr_mutex_lock(&cq->mutex);
+	}
+	while (cq->committed <= seq)
+	{
+		uint64_t upto;
+
+		if (cq->leader)
+		{
+			ep_thr_cond_wait(&cq->cond, &cq->mutex, NULL);
+			continue;
+		}
+		cq->leader = true;
+		upto = cq->next_seq;
+		if (upto - cq->committed > (uint64_t) GroupMax)
+			upto = cq->committed + GroupMax;
+		ep_thr_mutex_unlock(&cq->mutex);
+		if (IoWait > 0)
+			usleep(IoWait);
+		ep_thr_mutex_lock(&cq->mutex);
+		cq->committed = upto;
+		cq->ncommits++;
+		cq->leader = false;
+		ep_thr_cond_broadcast(&cq->cond);
+	}
+	ep_thr_mutex_unlock(&cq->mutex);
+}
+
+static void
+keyed_task(void *arg)
+{
+	struct job *j = (struct job *) arg;
+	EP_TIME_SPEC now;
+
+	ep_thr_mutex_lock(&KeyMutex[j->key]);
+	burn(Spin);
+	if (GroupMax > 0)
+	{
+		// unlocks KeyMutex once queued
+		group_commit(&CommitQ[j->key], j->key);
+	}
+	else
+	{
+		if (IoWait > 0)
+			usleep(IoWait);
+		ep_thr_mutex_unlock(&KeyMutex[j->key]);
+	}
+	ep_time_now(&now);
+	j->latency = ep_time_diff_usec(&j->submitted, &now) / 1e6;
+	task_done();
+}
+
+static int
+dblcmp(const void *a, const void *b)
+{
+	double x = *(const double *) a;
+	double y = *(const double *) b;
+
+	return x < y ? -1 : x > y ? 1 : 0;
+}
+
+static void
+report_latency(const char *what, double *lat, long n)
+{
+	if (n <= 0)
+		return;
+	qsort(lat, n, sizeof *lat, dblcmp);
+	printf("%14s %9ld %9.3f %9.3f %9.3f\n", what, n,
+		lat[n / 2] * 1e3,
+		lat[(long) (n * 0.99)] * 1e3,
+		lat[n - 1] * 1e3);
+}
+
+
+/*
+**  RUN_KEYED --- time keyed work for one pool size (in a child process)
+**
+**	Fairness is Jain's index over the mean latency seen by each
+**	cold key: 1.0 means they were all served equally.
+*/
+
+static void
+run_keyed(int nthreads, long ntasks)
+{
+	struct job *jobs;
+	EP_TIME_SPEC start, end;
+	double *hot, *cold;
+	double *keysum;
+	long *keyn;
+	long nhot = 0, ncold = 0;
+	double sum = 0.0, sumsq = 0.0;
+	int nk = 0;
+	unsigned int seed = 1;
+	long i;
+
+	ep_thr_pool_init(nthreads, nthreads, 0);
+	KeyMutex = (EP_THR_MUTEX *) ep_mem_zalloc(NKeys * sizeof *KeyMutex);
+	CommitQ = (struct commitq *) ep_mem_zalloc(NKeys * sizeof *CommitQ);
+	for (i = 0; i < NKeys; i++)
+	{
+		ep_thr_mutex_init(&KeyMutex[i], EP_THR_MUTEX_DEFAULT);
+		ep_thr_mutex_init(&CommitQ[i].mutex, EP_THR_MUTEX_DEFAULT);
+		ep_thr_cond_init(&CommitQ[i].cond);
+	}
+	jobs = (struct job *) ep_mem_zalloc(ntasks * sizeof *jobs);
+	for (i = 0; i < ntasks; i++)
+	{
+		if (NKeys == 1 || rand_r(&seed) < Skew * RAND_MAX)
+			jobs[i].key = 0;
+		else
+			jobs[i].key = 1 + rand_r(&seed) % (NKeys - 1);
+	}
+	atomic_store(&NRemaining, ntasks);
+
+	ep_time_now(&start);
+	for (i = 0; i < ntasks; i++)
+	{
+		if (Rate > 0)
+		{
+			// pace ourselves against the start time
+			EP_TIME_SPEC now;
+			long ahead;
+
+			ep_time_now(&now);
+			ahead = i * 1000000 / Rate -
+					ep_time_diff_usec(&start, &now);
+			if (ahead > 0)
+				usleep(ahead);
+		}
+		ep_time_now(&jobs[i].submitted);
+		if (Ordered)
+			ep_thr_pool_run_serial(jobs[i].key, &keyed_task,
+					&jobs[i]);
+		else
+			ep_thr_pool_run(&keyed_task, &jobs[i]);
+	}
+
+	ep_thr_mutex_lock(&DoneMutex);
+	while (atomic_load(&NRemaining) > 0)
+		ep_thr_cond_wait(&DoneCond, &DoneMutex, NULL);
+	ep_thr_mutex_unlock(&DoneMutex);
+	ep_time_now(&end);
+
+	hot = (double *) ep_mem_zalloc(ntasks * sizeof *hot);
+	cold = (double *) ep_mem_zalloc(ntasks * sizeof *cold);
+	keysum = (double *) ep_mem_zalloc(NKeys * sizeof *keysum);
+	keyn = (long *) ep_mem_zalloc(NKeys * sizeof *keyn);
+	for (i = 0; i < ntasks; i++)
+	{
+		if (jobs[i].key == 0)
+			hot[nhot++] = jobs[i].latency;
+		else
+			cold[ncold++] = jobs[i].latency;
+		keysum[jobs[i].key] += jobs[i].latency;
+		keyn[jobs[i].key]++;
+	}
+	for (i = 1; i < NKeys; i++)
+	{
+		double mean;
+
+		if (keyn[i] == 0)
+			continue;
+		mean = keysum[i] / keyn[i];
+		sum += mean;
+		sumsq += mean * mean;
+		nk++;
+	}
+
+	printf("%d threads: %.3f seconds, %.0f tasks/sec\n", nthreads,
+		ep_time_diff_usec(&start, &end) / 1e6,
+		ntasks / (ep_time_diff_usec(&start, &end) / 1e6));
+	printf("%14s %9s %9s %9s %9s\n", "", "tasks", "p50 ms", "p99 ms",
+		"max ms");
+	report_latency("hot key", hot, nhot);
+	report_latency("cold keys", cold, ncold);
+	if (nk > 0 && sumsq > 0)
+		printf("%14s %9.3f\n", "cold fairness", sum * sum / (nk * sumsq));
+	if (GroupMax > 0 && CommitQ[0].ncommits > 0)
+		printf("%14s %9.1f\n", "hot batch", (double) keyn[0] /
+				CommitQ[0].ncommits);
+	fflush(stdout);
+}
+
+
+/*
+**  RUN_ONE --- time one pool size (in a child process)
+*/
+
+static double
+run_one(int nthreads, int nsubmitters, long ntasks)
+{
+	struct submitter *subs;
+	EP_TIME_SPEC start, end;
+	long ntotal;
+	int i;
+
+	ep_thr_pool_init(nthreads, nthreads, 0);
+	ntotal = (ntasks / nsubmitters) * nsubmitters;
+	atomic_store(&NRemaining, ntotal * (1 + Fanout));
+
+	subs = (struct submitter *) ep_mem_zalloc(nsubmitters * sizeof *subs);
+	ep_time_now(&start);
+	for (i = 0; i < nsubmitters; i++)
+	{
+		subs[i].ntasks = ntasks / nsubmitters;
+		pthread_create(&subs[i].thread, NULL, &submit_thread, &subs[i]);
+	}
+	for (i = 0; i < nsubmitters; i++)
+		pthread_join(subs[i].thread, NULL);
+
+	ep_thr_mutex_lock(&DoneMutex);
+	while (atomic_load(&NRemaining) > 0)
+		ep_thr_cond_wait(&DoneCond, &DoneMutex, NULL);
+	ep_thr_mutex_unlock(&DoneMutex);
+	ep_time_now(&end);
+
+	if (atomic_load(&NRun) != ntotal * (1 + Fanout))
+		fprintf(stderr, "%d threads: ran %ld tasks, expected %ld\n",
+			nthreads, atomic_load(&NRun), ntotal * (1 + Fanout));
+	return ep_time_diff_usec(&start, &end) / 1e6;
+}
+
+
+static void
+usage(const char *prog)
+{
+	fprintf(stderr,
+		"Usage: %s [-D dbgspec] [-f fanout] [-k nkeys [-g batch [-H]] [-o]\n"
+		"\t[-r rate] [-z skew]] [-n ntasks] [-s submitters]\n"
+		"\t[-t maxthreads] [-u usec] [-w spin]\n"
+		"    -D  set debugging flags\n"
+		"    -f  tasks spawned by each top level task (default 0)\n"
+		"    -g  group keyed tasks into commits of up to batch tasks\n"
+		"    -H  hold the serial queue while waiting for a commit\n"
+		"    -k  run keyed tasks spread over nkeys keys\n"
+		"    -n  number of top level tasks (default 1000000)\n"
+		"    -o  run keyed tasks in order by key\n"
+		"    -r  keyed tasks submitted per second (default no limit)\n"
+		"    -s  number of submitting threads (default 1)\n"
+		"    -t  largest pool size to try (default 2 x cores)\n"
+		"    -u  microseconds each keyed task sleeps holding its lock\n"
+		"    -w  busy loop iterations per task (default 100)\n"
+		"    -z  fraction of keyed tasks for the hot key (default 0.5)\n",
+		prog);
+	exit(EX_USAGE);
+}
+
+
+int
+main(int argc, char **argv)
+{
+	long ntasks = 1000000;
+	int nsubmitters = 1;
+	int maxthreads = sysconf(_SC_NPROCESSORS_ONLN) * 2;
+	int nthreads;
+	int opt;
+
+	Spin = 100;
+	Skew = 0.5;
+	while ((opt = getopt(argc, argv, "D:f:g:Hk:n:or:s:t:u:w:z:")) > 0)
+	{
+		switch (opt)
+		{
+		  case 'D':
+			ep_dbg_set(optarg);
+			break;
+
+		  case 'f':
+			Fanout = atoi(optarg);
+			break;
+
+		  case 'g':
+			GroupMax = atoi(optarg);
+			break;
+
+		  case 'H':
+			Hold = true;
+			break;
+
+		  case 'k':
+			NKeys = atoi(optarg);
+			break;
+
+		  case 'n':
+			ntasks = atol(optarg);
+			break;
+
+		  case 'o':
+			Ordered = true;
+			break;
+
+		  case 'r':
+			Rate = atol(optarg);
+			break;
+
+		  case 's':
+			nsubmitters = atoi(optarg);
+			break;
+
+		  case 't':
+			maxthreads = atoi(optarg);
+			break;
+
+		  case 'u':
+			IoWait = atol(optarg);
+			break;
+
+		  case 'w':
+			Spin = atoi(optarg);
+			break;
+
+		  case 'z':
+			Skew = atof(optarg);
+			break;
+
+		  default:
+			usage(argv[0]);
+		}
+	}
+	if (optind != argc || ntasks <= 0 || nsubmitters <= 0 ||
+	    maxthreads <= 0 || Fanout < 0 || Spin < 0 || NKeys < 0 ||
+	    Rate < 0 || IoWait < 0 || GroupMax < 0 || Skew < 0 || Skew > 1)
+		usage(argv[0]);
+
+	ep_lib_init(EP_LIB_USEPTHREADS);
+	if (NKeys > 0)
+	{
+		printf("%ld tasks over %d keys (%.0f%% to one), spin %d, %s\n",
+			ntasks, NKeys, Skew * 100, Spin,
+			Ordered ? "ordered by key" : "unordered");
+		if (GroupMax > 0)
+			printf("group commit up to %d, %s serial queue\n",
+				GroupMax, Hold ? "holding" : "releasing");
+	}
+	else
+	{
+		printf("%ld tasks, fanout %d, spin %d, %d submitter(s)\n",
+			ntasks, Fanout, Spin, nsubmitters);
+		printf("%8s %12s %14s\n", "threads", "seconds", "tasks/sec");
+	}
+	fflush(stdout);
+
+	for (nthreads = 1; nthreads <= maxthreads; nthreads *= 2)
+	{
+		pid_t pid = fork();
+		int wstat;
+
+		if (pid < 0)
+		{
+			perror("fork");
+			exit(EX_OSERR);
+		}
+		if (pid == 0)
+		{
+			double secs;
+
+			if (NKeys > 0)
+			{
+				run_keyed(nthreads, ntasks);
+				_exit(EX_OK);
+			}
+			secs = run_one(nthreads, nsubmitters, ntasks);
+			printf("%8d %12.3f %14.0f\n", nthreads, secs,
+				secs > 0 ? atomic_load(&NRun) / secs : 0.0);
+			fflush(stdout);
+			_exit(EX_OK);
+		}
+		waitpid(pid, &wstat, 0);
+		if (!WIFEXITED(wstat) || WEXITSTATUS(wstat) != EX_OK)
+		{
+			fprintf(stderr, "%d threads: child failed\n", nthreads);
+			exit(EX_SOFTWARE);
+		}
+	}
+	exit(EX_OK);
+}
@@ -162,6 +162,12 @@ extern gdp_event_t		*gdp_event_next(		// get event (caller must free!)
 							gdp_gin_t *gin,			// if set wait for this GIN only
 							EP_TIME_SPEC *timeout);
 
+extern int				gdp_event_next_batch(	// get up to ngevs events (free each!)
+							gdp_gin_t *gin,			// if set wait for this GIN only
+							EP_TIME_SPEC *timeout,	// max wait for the first event
+							gdp_event_t **gevs,		// filled in with events
+							int ngevs);				// size of gevs
+
 extern EP_STAT			gdp_event_free(			// free event from gdp_event_next
 							gdp_event_t *gev);		// event to free
 
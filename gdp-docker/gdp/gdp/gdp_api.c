@@ -284,6 +284,8 @@ _gdp_gin_new(gdp_gob_t *gob)
 		gin = (gdp_gin_t *) ep_mem_zalloc(sizeof *gin);
 		ep_thr_mutex_init(&gin->mutex, EP_THR_MUTEX_DEFAULT);
 		ep_thr_mutex_setorder(&gin->mutex, GDP_MUTEX_LORDER_GIN);
+		TAILQ_INIT(&gin->events);
+		ep_thr_cond_init(&gin->evsig);
 	}
 
 	gin->flags = GINF_INUSE;
@@ -929,6 +929,39 @@ _gdp_chan_close(gdp_chan_t *chan)
 **  _GDP_CHAN_SEND --- send a message to a channel
 */
 
+/*
+**  Build a PDU header into pb (which must have room for at least
+**  MIN_HEADER_LENGTH octets).  Returns the header length.
+*/
+
+static size_t
+build_header(char *pb,
+			gdp_name_t src,
+			gdp_name_t dst,
+			size_t payload_len,
+			uint16_t seqno,
+			int tos)
+{
+	char *pbp = pb;
+
+	PUT8(GDP_CHAN_PROTO_VERSION);		// version number
+	PUT8(MIN_HEADER_LENGTH / 4);		// header length (= 72 / 4)
+	PUT8(tos);							// flags / type of service
+	PUT8(GDP_TTL_DEFAULT);				// time to live
+	uint32_t seq_mf_foff = (seqno & GDP_PKT_SEQNO_MASK) << GDP_PKT_SEQNO_SHIFT;
+	PUT32(seq_mf_foff);					// more frag bit, seqno, frag offset
+	uint16_t frag_len = 0;
+	PUT16(frag_len);					// length of this fragment
+	PUT16(payload_len);					// length of opaque payload
+	memcpy(pbp, dst, sizeof (gdp_name_t));	// destination address
+	pbp += sizeof (gdp_name_t);
+	memcpy(pbp, src, sizeof (gdp_name_t));	// source address
+	pbp += sizeof (gdp_name_t);
+
+	EP_ASSERT((pbp - pb) == MIN_HEADER_LENGTH);
+	return pbp - pb;
+}
+
 static EP_STAT
 send_helper(gdp_chan_t *chan,
 			gdp_target_t *target,
@@ -979,25 +1012,10 @@ send_helper(gdp_chan_t *chan,
 
 	// build the header in memory
 	char pb[MAX_HEADER_LENGTH];
-	char *pbp = pb;
-
-	PUT8(GDP_CHAN_PROTO_VERSION);		// version number
-	PUT8(MIN_HEADER_LENGTH / 4);		// header length (= 72 / 4)
-	PUT8(tos);							// flags / type of service
-	PUT8(GDP_TTL_DEFAULT);				// time to live
-	uint32_t seq_mf_foff = (seqno & GDP_PKT_SEQNO_MASK) << GDP_PKT_SEQNO_SHIFT;
-	PUT32(seq_mf_foff);					// more frag bit, seqno, frag offset
-	uint16_t frag_len = 0;
-	PUT16(frag_len);					// length of this fragment
-	PUT16(payload_len);					// length of opaque payload
-	memcpy(pbp, dst, sizeof (gdp_name_t));	// destination address
-	pbp += sizeof (gdp_name_t);
-	memcpy(pbp, src, sizeof (gdp_name_t));	// source address
-	pbp += sizeof (gdp_name_t);
+	char *pbp = pb + build_header(pb, src, dst, payload_len, seqno, tos);
 
 	// now write header to the socket
 	bufferevent_lock(chan->bev);
-	EP_ASSERT((pbp - pb) == MIN_HEADER_LENGTH);
 	if (ep_dbg_test(Dbg, 42))
 	{
 		ep_dbg_printf("send_helper: sending %zd octets:\n",
@@ -1058,6 +1076,103 @@ _gdp_chan_send(gdp_chan_t *chan,
 }
 
 
+/*
+**  _GDP_CHAN_SEND_PACKED --- send a message, serializing it in place
+**
+**		Rather than having the caller build the payload in a
+**		buffer of its own that then gets copied to the channel,
+**		this reserves space for the header and payload directly
+**		in the channel output buffer and calls packfunc to fill
+**		in the payload.  packfunc must write exactly payload_len
+**		octets and return the number written.
+*/
+
+EP_STAT
+_gdp_chan_send_packed(gdp_chan_t *chan,
+			gdp_target_t *target,
+			gdp_name_t src,
+			gdp_name_t dst,
+			size_t payload_len,
+			size_t (*packfunc)(void *arg, uint8_t *buf),
+			void *arg,
+			int tos)
+{
+	EP_STAT estat = EP_STAT_OK;
+	struct evbuffer *obuf;
+	struct evbuffer_iovec v[1];
+	uint16_t seqno = 0;			//FIXME: should be useful
+	size_t hdr_len;
+	size_t l;
+
+	if (chan->bev == NULL)
+	{
+		ep_dbg_cprintf(Dbg, 1, "_gdp_chan_send_packed: no channel\n");
+		return GDP_STAT_DEAD_DAEMON;
+	}
+
+	if (payload_len > UINT16_MAX)
+	{
+		ep_dbg_cprintf(Dbg, 1,
+				"_gdp_chan_send_packed: payload_len = %zd, max %d\n",
+				payload_len, UINT16_MAX);
+		return GDP_STAT_PDU_TOO_LONG;
+	}
+
+	bufferevent_lock(chan->bev);
+	obuf = bufferevent_get_output(chan->bev);
+
+	// with only one vector the reserved space is contiguous
+	if (evbuffer_reserve_space(obuf, MIN_HEADER_LENGTH + payload_len,
+				v, 1) != 1)
+	{
+		estat = GDP_STAT_PDU_WRITE_FAIL;
+		goto fail0;
+	}
+
+	hdr_len = build_header(v[0].iov_base, src, dst, payload_len, seqno, tos);
+	l = (*packfunc)(arg, (uint8_t *) v[0].iov_base + hdr_len);
+	if (l != payload_len)
+	{
+		// nothing is committed, so the reservation just goes away
+		ep_dbg_cprintf(Dbg, 1,
+				"_gdp_chan_send_packed: packed %zd octets, expected %zd\n",
+				l, payload_len);
+		estat = GDP_STAT_PDU_WRITE_FAIL;
+		goto fail0;
+	}
+	v[0].iov_len = hdr_len + payload_len;
+
+	if (ep_dbg_test(Dbg, 42))
+	{
+		gdp_pname_t src_printable;
+		gdp_pname_t dst_printable;
+
+		ep_dbg_printf("_gdp_chan_send_packed: sending %zd octets:\n"
+					"\tsrc %s\n\tdst %s\n",
+				v[0].iov_len,
+				gdp_printable_name(src, src_printable),
+				gdp_printable_name(dst, dst_printable));
+		ep_hexdump(v[0].iov_base, hdr_len, ep_dbg_getfile(), 0, 0);
+		ep_hexdump((uint8_t *) v[0].iov_base + hdr_len, payload_len,
+				ep_dbg_getfile(), EP_HEXDUMP_ASCII, hdr_len);
+	}
+
+	// this makes the data visible and kicks off the write
+	if (evbuffer_commit_space(obuf, v, 1) < 0)
+		estat = GDP_STAT_PDU_WRITE_FAIL;
+
+fail0:
+	if (!EP_STAT_ISOK(estat) && ep_dbg_test(Dbg, 4))
+	{
+		char ebuf[100];
+		ep_dbg_printf("_gdp_chan_send_packed failure: %s\n",
+				ep_stat_tostr(estat, ebuf, sizeof ebuf));
+	}
+	bufferevent_unlock(chan->bev);
+	return estat;
+}
+
+
 EP_STAT
 _gdp_chan_flush(gdp_chan_t *chan)
 {
@@ -285,6 +285,16 @@ EP_STAT			_gdp_chan_send(				// send data to channel
 						gdp_buf_t *payload,
 						int tos);
 
+EP_STAT			_gdp_chan_send_packed(		// serialize data into channel
+						gdp_chan_t *chan,
+						gdp_target_t *target,
+						gdp_name_t src,
+						gdp_name_t dst,
+						size_t payload_len,
+						size_t (*packfunc)(void *arg, uint8_t *buf),
+						void *arg,
+						int tos);
+
 gdp_chan_x_t	*_gdp_chan_get_cdata(		// get user data from channel
 						gdp_chan_t *chan);
 
@@ -513,7 +513,8 @@ _gdp_datum_hash_equal(gdp_datum_t *datum,
 
 /*
 **  Convert internal datum structure to protobuf-encoded datum.
-**  Assumes the protobuf version is empty on entry.
+**  Assumes the protobuf version is empty on entry.  Any memory
+**  needed comes from (and is freed with) msg.
 */
 
 void
@@ -529,7 +530,7 @@ _gdp_datum_to_pb(const gdp_datum_t *datum,
 	{
 		if (pbd->ts == NULL)
 		{
-			pbd->ts = (GdpTimestamp *) ep_mem_zalloc(sizeof *pbd->ts);
+			pbd->ts = (GdpTimestamp *) _gdp_msg_alloc(msg, sizeof *pbd->ts);
 			gdp_timestamp__init(pbd->ts);
 		}
 		pbd->ts->sec = datum->ts.tv_sec;
@@ -542,7 +543,7 @@ _gdp_datum_to_pb(const gdp_datum_t *datum,
 	else if (pbd->ts != NULL)
 	{
 		ep_dbg_cprintf(Dbg, 3, "_gdp_datum_to_pb: freeing ts\n");
-		gdp_timestamp__free_unpacked(pbd->ts, NULL);
+		_gdp_msg_mfree(msg, pbd->ts);
 		pbd->ts = NULL;
 	}
 
@@ -551,7 +552,7 @@ _gdp_datum_to_pb(const gdp_datum_t *datum,
 	{
 		size_t l = gdp_buf_getlength(datum->dbuf);
 		pbd->data.len = l;
-		pbd->data.data = (uint8_t *) ep_mem_malloc(l);
+		pbd->data.data = (uint8_t *) _gdp_msg_alloc(msg, l);
 		memcpy(pbd->data.data, gdp_buf_getptr(datum->dbuf, l), l);
 	}
 
@@ -564,8 +565,8 @@ _gdp_datum_to_pb(const gdp_datum_t *datum,
 		pbd->has_prevhash = true;
 		pbd->prevhash.len = l;
 		if (pbd->prevhash.data != NULL)
-			ep_mem_free(pbd->prevhash.data);
-		pbd->prevhash.data = (uint8_t *) ep_mem_malloc(l);
+			_gdp_msg_mfree(msg, pbd->prevhash.data);
+		pbd->prevhash.data = (uint8_t *) _gdp_msg_alloc(msg, l);
 		memcpy(pbd->prevhash.data, gdp_hash_getptr(datum->prevhash, NULL), l);
 	}
 
@@ -574,21 +575,22 @@ _gdp_datum_to_pb(const gdp_datum_t *datum,
 	{
 		if (pbd->sig == NULL)
 		{
-			pbd->sig = (GdpSignature *) ep_mem_malloc(sizeof *pbd->sig);
+			pbd->sig = (GdpSignature *) _gdp_msg_alloc(msg, sizeof *pbd->sig);
 			gdp_signature__init(pbd->sig);
 		}
 		size_t l;
 		void *sigdata = gdp_sig_getptr(datum->sig, &l);
 		pbd->sig->sig.len = l;
 		if (pbd->sig->sig.data != NULL)
-			ep_mem_free(pbd->sig->sig.data);
-		pbd->sig->sig.data = ep_mem_malloc(l);
+			_gdp_msg_mfree(msg, pbd->sig->sig.data);
+		pbd->sig->sig.data = _gdp_msg_alloc(msg, l);
 		memcpy(pbd->sig->sig.data, sigdata, l);
 	}
 	else if (pbd->sig != NULL)
 	{
 		ep_dbg_cprintf(Dbg, 3, "_gdp_datum_to_pb: freeing sig\n");
-		gdp_signature__free_unpacked(pbd->sig, NULL);
+		_gdp_msg_mfree(msg, pbd->sig->sig.data);
+		_gdp_msg_mfree(msg, pbd->sig);
 		pbd->sig = NULL;
 	}
 }
@@ -55,9 +55,15 @@ static EP_THR_MUTEX		FreeListMutex	EP_THR_MUTEX_INITIALIZER2(GDP_MUTEX_LORDER_LE
 static struct gev_list	FreeList		= TAILQ_HEAD_INITIALIZER(FreeList);
 
 // active events (synchronous, ready for gdp_event_next)
+//		Every active event is on ActiveList in arrival order (for
+//		callers that will take any event) and also on its GIN's own
+//		list (for callers waiting for that GIN), so neither kind of
+//		caller ever has to search.  Both lists, and the GIN's
+//		condition variable, are protected by ActiveListMutex.
 static EP_THR_MUTEX		ActiveListMutex	EP_THR_MUTEX_INITIALIZER2(GDP_MUTEX_LORDER_LEAF);
 static EP_THR_COND		ActiveListSig	EP_THR_COND_INITIALIZER;
 static struct gev_list	ActiveList		= TAILQ_HEAD_INITIALIZER(ActiveList);
+static int				ActiveListWaiters;	// waiting on ActiveListSig
 
 // callback events (asynchronous, ready for delivery in callback thread)
 static EP_THR_MUTEX		CallbackListMutex	EP_THR_MUTEX_INITIALIZER2(GDP_MUTEX_LORDER_LEAF);
@@ -135,19 +141,64 @@ gdp_event_free(gdp_event_t *gev)
 
 
 /*
-**  Return next event.
+**  Add/remove events on the active lists.
+**		ActiveListMutex must be held.
+**
+**		Each new event wakes at most one thread waiting for its GIN
+**		and one waiting for any GIN.  If both wake up only one will
+**		get the event, but that's better than waking everyone.
+*/
+
+static void
+active_insert(gdp_event_t *gev)
+{
+	TAILQ_INSERT_TAIL(&ActiveList, gev, queue);
+	if (gev->gin != NULL)
+	{
+		TAILQ_INSERT_TAIL(&gev->gin->events, gev, ginq);
+		if (gev->gin->evwaiters > 0)
+			ep_thr_cond_signal(&gev->gin->evsig);
+	}
+	if (ActiveListWaiters > 0)
+		ep_thr_cond_signal(&ActiveListSig);
+}
+
+static void
+active_remove(gdp_event_t *gev)
+{
+	TAILQ_REMOVE(&ActiveList, gev, queue);
+	if (gev->gin != NULL)
+		TAILQ_REMOVE(&gev->gin->events, gev, ginq);
+}
+
+
+/*
+**  Return next event(s).
 **		Optionally, specify a GCL that must match and/or a timeout.
 **		If the timeout is zero this acts like a poll.
+**
+**		gdp_event_next_batch waits (up to the timeout) for at least
+**		one event and then returns as many as are ready, up to ngevs,
+**		without dropping the lock in between.  It returns the number
+**		of events stored into gevs, which is zero on timeout.
 */
 
-gdp_event_t *
-gdp_event_next(gdp_gin_t *gin, EP_TIME_SPEC *timeout)
+int
+gdp_event_next_batch(gdp_gin_t *gin,
+			EP_TIME_SPEC *timeout,
+			gdp_event_t **gevs,
+			int ngevs)
 {
-	gdp_event_t *gev = NULL;
+	struct gev_list *list;
+	EP_THR_COND *sig;
+	int *nwaiters;
 	EP_TIME_SPEC *abs_to = NULL;
 	EP_TIME_SPEC tv;
+	int n = 0;
 
-	ep_dbg_cprintf(Dbg, 59, "gdp_event_next: gin %p\n", gin);
+	ep_dbg_cprintf(Dbg, 59, "gdp_event_next_batch: gin %p\n", gin);
+	if (ngevs <= 0)
+		return 0;
 
 	if (timeout != NULL)
 	{
@@ -155,25 +206,28 @@ gdp_event_next(gdp_gin_t *gin, EP_TIME_SPEC *timeout)
 		abs_to = &tv;
 	}
 
-	ep_thr_mutex_lock(&ActiveListMutex);
-restart:
-	for (;;)
+	if (gin == NULL)
 	{
-		// scan the in-memory list to see if we can go with no delay
-		for (gev = TAILQ_FIRST(&ActiveList); gev != NULL;
-									gev = TAILQ_NEXT(gev, queue))
-		{
-			// if this is the GCL we want, return it
-			if (gin == NULL || gev->gin == gin)
-				break;
-		}
-		if (gev != NULL)
-			break;
+		list = &ActiveList;
+		sig = &ActiveListSig;
+		nwaiters = &ActiveListWaiters;
+	}
+	else
+	{
+		list = &gin->events;
+		sig = &gin->evsig;
+		nwaiters = &gin->evwaiters;
+	}
 
-		// no match yet --- wait for new active event and try again
+	ep_thr_mutex_lock(&ActiveListMutex);
+	while (TAILQ_EMPTY(list))
+	{
+		// nothing yet --- wait for new active event and try again
 		int err;
-		ep_dbg_cprintf(Dbg, 58, "gdp_event_next: empty ActiveList; waiting\n");
-		err = ep_thr_cond_wait(&ActiveListSig, &ActiveListMutex, abs_to);
+		ep_dbg_cprintf(Dbg, 58, "gdp_event_next: no events; waiting\n");
+		(*nwaiters)++;
+		err = ep_thr_cond_wait(sig, &ActiveListMutex, abs_to);
+		(*nwaiters)--;
 		ep_dbg_cprintf(Dbg, 58, "gdp_event_next: ep_thr_cond_wait => %d\n",
 				err);
 		if (err != 0)
@@ -190,17 +244,39 @@ restart:
 		}
 	}
 
-	if (gev != NULL)
+	while (n < ngevs)
 	{
-		TAILQ_REMOVE(&ActiveList, gev, queue);
+		gdp_event_t *gev = TAILQ_FIRST(list);
+
+		if (gev == NULL)
+			break;
+		active_remove(gev);
 		if (!EP_ASSERT(gev->type != _GDP_EVENT_FREE))
 		{
 			// bad news, this event is on two lists (Active and Free)
-			goto restart;
+			continue;
 		}
+		gevs[n++] = gev;
 	}
+
+	// if there's more left, make sure another waiter knows
+	if (!TAILQ_EMPTY(list) && *nwaiters > 0)
+		ep_thr_cond_signal(sig);
 	ep_thr_mutex_unlock(&ActiveListMutex);
 
+	// the caller must call gdp_event_free(gev) on each
+	ep_dbg_cprintf(Dbg, 52, "gdp_event_next_batch => %d\n", n);
+	return n;
+}
+
+gdp_event_t *
+gdp_event_next(gdp_gin_t *gin, EP_TIME_SPEC *timeout)
+{
+	gdp_event_t *gev = NULL;
+
+	if (gdp_event_next_batch(gin, timeout, &gev, 1) == 0)
+		gev = NULL;
+
 	// the callback must call gdp_event_free(gev)
 	ep_dbg_cprintf(Dbg, 52, "gdp_event_next => %p\n", gev);
 	return gev;
@@ -218,6 +294,7 @@ EP_STAT
 _gdp_event_free_all(gdp_gin_t *gin)
 {
 	gdp_event_t *gev, *next_gev;
+	struct gev_list dead = TAILQ_HEAD_INITIALIZER(dead);
 
 	GDP_GIN_CHECK_RETURN_STAT(gin);
 
@@ -234,18 +311,20 @@ _gdp_event_free_all(gdp_gin_t *gin)
 	}
 	ep_thr_mutex_unlock(&CallbackListMutex);
 
+	// unlink under the lock, but free after (freeing relinks them)
 	ep_thr_mutex_lock(&ActiveListMutex);
-	for (gev = TAILQ_FIRST(&ActiveList); gev != NULL; gev = next_gev)
+	while ((gev = TAILQ_FIRST(&gin->events)) != NULL)
 	{
-		next_gev = TAILQ_NEXT(gev, queue);
-		if (gev->gin != gin)
-			continue;
-		else if (gev->type == _GDP_EVENT_FREE)
-			TAILQ_REMOVE(&ActiveList, gev, queue);
-		else
-			gdp_event_free(gev);
+		active_remove(gev);
+		if (gev->type != _GDP_EVENT_FREE)
+			TAILQ_INSERT_TAIL(&dead, gev, queue);
 	}
 	ep_thr_mutex_unlock(&ActiveListMutex);
+	while ((gev = TAILQ_FIRST(&dead)) != NULL)
+	{
+		TAILQ_REMOVE(&dead, gev, queue);
+		gdp_event_free(gev);
+	}
 
 	return EP_STAT_OK;
 }
@@ -489,8 +568,7 @@ _gdp_event_trigger(gdp_event_t *gev, gdp_req_t *req)
 	if (gev->cb == NULL)
 	{
 		ep_thr_mutex_lock(&ActiveListMutex);
-		TAILQ_INSERT_TAIL(&ActiveList, gev, queue);
-		ep_thr_cond_broadcast(&ActiveListSig);
+		active_insert(gev);
 		ep_thr_mutex_unlock(&ActiveListMutex);
 	}
 	else
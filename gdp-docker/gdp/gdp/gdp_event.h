@@ -41,6 +41,7 @@
 struct gdp_event
 {
 	TAILQ_ENTRY(gdp_event)	queue;		// free/active queue link
+	TAILQ_ENTRY(gdp_event)	ginq;		// link on gin->events (if active)
 	unsigned int			type;		// event type
 	gdp_gin_t				*gin;		// GCL instance for event
 	gdp_datum_t				*datum;		// datum for event
@@ -42,7 +42,6 @@
 #include "gdp_priv.h"
 
 #include <event2/event.h>
-#include <openssl/md4.h>
 
 #include <errno.h>
 #include <string.h>
@@ -58,14 +57,33 @@ static EP_DBG	Dbg = EP_DBG_INIT("gdp.gob.cache", "GOB cache");
 **		the name.  These are not really intended for public use,
 **		but they are shared with gdplogd.
 **
-**		Getting lock ordering right here is a pain.
+**		The cache is split into shards chosen by the first byte of
+**		the GOB name (names are hashes, so this spreads evenly).
+**		Each shard has its own lock, its own name => GOB hash, and
+**		a "clock": an unordered array of every GOB in the shard
+**		that the reclaimer sweeps with a moving hand.  A GOB's use
+**		time serves as its reference mark, so touching a GOB is
+**		just a store into the (locked) GOB; nothing is relinked.
+**
+**		A shard lock must be taken before any GOB lock.  Getting
+**		lock ordering right here is still a pain.
 **
 ***********************************************************************/
 
-static EP_THR_MUTEX		GobCacheMutex;		// locks _OpenGOBCache and GobsByUse
-EP_HASH					*_OpenGOBCache;		// associative cache
-LIST_HEAD(gob_use_head, gdp_gob)			// LRU cache
-						GobsByUse		= LIST_HEAD_INITIALIZER(GobByUse);
+struct gob_shard
+{
+	EP_THR_MUTEX		mutex;			// locks the rest of this shard
+	EP_HASH				*hash;			// name => GOB
+	gdp_gob_t			**clock;		// every GOB in this shard
+	int					nclock;			// number in clock
+	int					aclock;			// number of slots allocated
+	int					hand;			// next slot for reclaim to look at
+};
+
+static struct gob_shard	*Shards;		// the cache itself
+static int				NShards;		// number of shards (power of 2)
+
+#define GOB_SHARD(name)		(&Shards[(name)[0] & (NShards - 1)])
 
 
 /*
@@ -77,25 +95,39 @@ _gdp_gob_cache_init(void)
 {
 	EP_STAT estat = EP_STAT_OK;
 	int istat;
+	int i;
 	const char *err;
 
-	if (_OpenGOBCache == NULL)
+	if (Shards == NULL)
 	{
-		istat = ep_thr_mutex_init(&GobCacheMutex, EP_THR_MUTEX_DEFAULT);
-		if (istat != 0)
-		{
-			estat = ep_stat_from_errno(istat);
-			err = "could not initialize GobCacheMutex";
-			goto fail0;
-		}
-		ep_thr_mutex_setorder(&GobCacheMutex, GDP_MUTEX_LORDER_GOBCACHE);
+		// round up to a power of two; the first name byte picks one
+		int n = ep_adm_getintparam("swarm.gdp.cache.shards", 16);
+		if (n > 256)
+			n = 256;
+		for (NShards = 1; NShards < n; NShards <<= 1)
+			continue;
 
-		_OpenGOBCache = ep_hash_new("_OpenGOBCache", NULL, 0);
-		if (_OpenGOBCache == NULL)
+		Shards = (struct gob_shard *) ep_mem_zalloc(NShards * sizeof *Shards);
+		for (i = 0; i < NShards; i++)
 		{
-			estat = ep_stat_from_errno(errno);
-			err = "could not create OpenGOBCache";
-			goto fail0;
+			struct gob_shard *s = &Shards[i];
+
+			istat = ep_thr_mutex_init(&s->mutex, EP_THR_MUTEX_DEFAULT);
+			if (istat != 0)
+			{
+				estat = ep_stat_from_errno(istat);
+				err = "could not initialize GOB cache shard mutex";
+				goto fail0;
+			}
+			ep_thr_mutex_setorder(&s->mutex, GDP_MUTEX_LORDER_GOBCACHE);
+
+			s->hash = ep_hash_new("_OpenGOBCache", NULL, 0);
+			if (s->hash == NULL)
+			{
+				estat = ep_stat_from_errno(errno);
+				err = "could not create OpenGOBCache";
+				goto fail0;
+			}
 		}
 	}
 
@@ -104,19 +136,17 @@ _gdp_gob_cache_init(void)
 		gdp_gob_t *gob;
 
 		// establish lock ordering for valgrind
-		ep_thr_mutex_lock(&GobCacheMutex);
+		ep_thr_mutex_lock(&Shards[0].mutex);
 		estat = _gdp_gob_new(NULL, &gob);
 		if (EP_STAT_ISOK(estat))
 		{
 			_gdp_gob_lock(gob);
 			_gdp_gob_free(&gob);
 		}
-		ep_thr_mutex_unlock(&GobCacheMutex);
+		ep_thr_mutex_unlock(&Shards[0].mutex);
 	}
 #endif
 
-	// Nothing to do for LRU cache
-
 	if (false)
 	{
 fail0:
@@ -129,157 +159,47 @@ fail0:
 	return estat;
 }
 
-#define LOG2_BLOOM_SIZE		10			// log base 2 of bloom filter size
-
 
 /*
-**  Helper routine checking that associative cache matches the LRU cache.
-**
-**		Unfortunately, this is O(n^2).  The bloom filter is less
-**		useful here.
-**		This is a helper routine called from ep_hash_forall.
+**  Add and remove GOBs from a shard's clock.  Both are O(1): the
+**  clock is unordered, so removal just moves the last entry into
+**  the hole.  The shard must be locked.
 */
 
 static void
-check_cache_helper(size_t klen, const void *key, const void *val, va_list av)
+clock_add(struct gob_shard *s, gdp_gob_t *gob)
 {
-	const gdp_gob_t *gob;
-	const gdp_gob_t *g2;
-
-	if (val == NULL)
-		return;
-
-	gob = (const gdp_gob_t *) val;
-	LIST_FOREACH(g2, &GobsByUse, ulist)
+	if (s->nclock >= s->aclock)
 	{
-		if (g2 == gob)
-			return;
+		s->aclock = s->aclock == 0 ? 64 : s->aclock * 2;
+		s->clock = (gdp_gob_t **) ep_mem_realloc(s->clock,
+								s->aclock * sizeof s->clock[0]);
 	}
-
-	FILE *fp = va_arg(av, FILE *);
-	fprintf(fp, "    ===> WARNING: %s not in usage list\n", gob->pname);
+	gob->cslot = s->nclock;
+	s->clock[s->nclock++] = gob;
 }
 
-
-/*
-** Check cache consistency.
-**		Returns true if is OK, false if is not.
-*/
-
-static bool
-check_cache_consistency(const char *where)
-{
-	bool rval = true;
-	gdp_gob_t *gob;
-	uint32_t bloom[1 << (LOG2_BLOOM_SIZE - 1)];		// bloom filter
-	union
-	{
-		uint8_t		md4out[MD4_DIGEST_LENGTH];		// output md4
-		uint32_t	md4eq[MD4_DIGEST_LENGTH / 4];
-	} md4buf;
-
-	memset(&md4buf, 0, sizeof md4buf);
-	memset(&bloom, 0, sizeof bloom);
-
-	EP_THR_MUTEX_ASSERT_ISLOCKED(&GobCacheMutex);
-	LIST_FOREACH(gob, &GobsByUse, ulist)
-	{
-		// check for loops, starting with quick bloom filter on address
-		uint32_t bmask;
-		int bindex;
-
-		VALGRIND_HG_DISABLE_CHECKING(gob, sizeof *gob);
-
-		MD4((unsigned char *) &gob, sizeof gob, md4buf.md4out);
-		bindex = md4buf.md4eq[0];			// just use first 32-bit word
-		bmask = 1 << (bindex & 0x1f);		// mask on single word
-		bindex = (bindex >> 4) & ((1 << (LOG2_BLOOM_SIZE - 1)) - 1);
-		if (EP_UT_BITSET(bmask, bloom[bindex]))
-		{
-			// may have a conflict --- do explicit check
-			gdp_gob_t *g2 = LIST_NEXT(gob, ulist);
-			while (g2 != NULL && g2 != gob)
-				g2 = LIST_NEXT(g2, ulist);
-			if (g2 != NULL)
-			{
-				EP_ASSERT_PRINT("Loop in GobsByUse on %p at %s",
-						gob, where);
-				_gdp_gob_dump(gob, ep_dbg_getfile(), GDP_PR_DETAILED, 0);
-				rval = false;
-				VALGRIND_HG_ENABLE_CHECKING(gob, sizeof *gob);
-				break;
-			}
-		}
-		bloom[bindex] |= bmask;
-		VALGRIND_HG_ENABLE_CHECKING(gob, sizeof *gob);
-	}
-
-	ep_hash_forall(_OpenGOBCache, check_cache_helper, ep_dbg_getfile());
-	return rval;
-}
-
-
-/*
-**  Rebuild GOB LRU list from the associative hash table.
-**		Which one is the definitive version?
-**
-**		Should "never happen", but if it does all hell breaks loose.
-**		Yes, I know, this is O(n^2).  But it should never happen.
-**		So sue me.
-*/
-
-// helper routine
 static void
-sorted_insert(size_t klen, const void *key, const void *gob_, va_list av)
+clock_remove(struct gob_shard *s, gdp_gob_t *gob)
 {
-	gdp_gob_t *gob = (gdp_gob_t *) gob_;
+	int i = gob->cslot;
 
-	// if this is being dropped, just skip this GOB
-	if (EP_UT_BITSET(GOBF_DROPPING, gob->flags))
-		return;
-
-	gdp_gob_t *g2 = LIST_FIRST(&GobsByUse);
-	if (g2 == NULL || gob->utime > g2->utime)
-	{
-		// new entry is younger than first entry
-		LIST_INSERT_HEAD(&GobsByUse, gob, ulist);
+	if (!EP_ASSERT(i >= 0 && i < s->nclock && s->clock[i] == gob))
 		return;
-	}
-	LIST_FOREACH(g2, &GobsByUse, ulist)
-	{
-		gdp_gob_t *g3 = LIST_NEXT(g2, ulist);
-		if (g3 == NULL || gob->utime > g3->utime)
-		{
-			LIST_INSERT_AFTER(g2, gob, ulist);
-			return;
-		}
-	}
-
-	// shouldn't happen
-	EP_ASSERT_PRINT("sorted_insert: ran off end of GobsByUse, gob = %p", gob);
-}
-
-static void
-rebuild_lru_list(void)
-{
-	ep_dbg_cprintf(Dbg, 2, "rebuild_lru_list: rebuilding\n");
-	ep_thr_mutex_lock(&GobCacheMutex);
-	LIST_INIT(&GobsByUse);
-	ep_hash_forall(_OpenGOBCache, sorted_insert);
-	ep_thr_mutex_unlock(&GobCacheMutex);
+	s->clock[i] = s->clock[--s->nclock];
+	s->clock[i]->cslot = i;
+	gob->cslot = -1;
 }
 
 
-
-
 /*
-**  Add a GOB to both the associative and the LRU caches.
-**  The "unlocked" refers to GobCacheMutex, which should already
+**  Add a GOB to both the associative cache and the clock.
+**  The "unlocked" refers to the shard, which should already
 **  be locked on entry.  The GOB is also expected to be locked.
 */
 
 static void
-add_cache_unlocked(gdp_gob_t *gob)
+add_cache_unlocked(struct gob_shard *s, gdp_gob_t *gob)
 {
 	ep_dbg_cprintf(Dbg, 49, "_gdp_gob_cache_add(%p): adding\n", gob);
 
@@ -287,9 +207,7 @@ add_cache_unlocked(gdp_gob_t *gob)
 	EP_ASSERT_ELSE(GDP_GOB_ISGOOD(gob), return);
 	if (!GDP_GOB_ASSERT_ISLOCKED(gob))
 		return;
-	EP_THR_MUTEX_ASSERT_ISLOCKED(&GobCacheMutex);
-
-	check_cache_consistency("add_cache_unlocked");
+	EP_THR_MUTEX_ASSERT_ISLOCKED(&s->mutex);
 
 	if (EP_UT_BITSET(GOBF_INCACHE, gob->flags))
 	{
@@ -304,7 +222,7 @@ add_cache_unlocked(gdp_gob_t *gob)
 	ep_dbg_cprintf(Dbg, 49,
 			"_gdp_gob_cache_add(%p): insert into _OpenGOBCache\n",
 			gob);
-	g2 = (gdp_gob_t *) ep_hash_insert(_OpenGOBCache,
+	g2 = (gdp_gob_t *) ep_hash_insert(s->hash,
 								sizeof (gdp_name_t), gob->name, gob);
 	if (g2 != NULL)
 	{
@@ -317,19 +235,13 @@ add_cache_unlocked(gdp_gob_t *gob)
 		// we don't free g2 in case someone else has the pointer
 	}
 
-	// ... and the LRU list
+	// ... and the clock
 	{
 		struct timeval tv;
 
 		gettimeofday(&tv, NULL);
 		gob->utime = tv.tv_sec;
-
-		ep_dbg_cprintf(Dbg, 49, "_gdp_gob_cache_add(%p): insert into LRU list\n",
-				gob);
-		IF_LIST_CHECK_OK(&GobsByUse, gob, ulist, gdp_gob_t)
-		{
-			LIST_INSERT_HEAD(&GobsByUse, gob, ulist);
-		}
+		clock_add(s, gob);
 	}
 
 	gob->flags |= GOBF_INCACHE;
@@ -340,8 +252,8 @@ add_cache_unlocked(gdp_gob_t *gob)
 
 /*
 **	Wrapper for add_cache_unlocked that takes care of locking
-**	GobCacheMutex.  Since that *must* be locked before the GOB,
-**	we have to unlock the GOB before we lock GobCache.
+**	the shard.  Since that *must* be locked before the GOB,
+**	we have to unlock the GOB before we lock the shard.
 **	This should be OK since presumably the GOB is not in the
 **	cache and hence not accessible to other threads.
 */
@@ -349,12 +261,14 @@ add_cache_unlocked(gdp_gob_t *gob)
 void
 _gdp_gob_cache_add(gdp_gob_t *gob)
 {
+	struct gob_shard *s = GOB_SHARD(gob->name);
+
 	EP_THR_MUTEX_ASSERT_ISLOCKED(&gob->mutex);
 	_gdp_gob_unlock(gob);
-	ep_thr_mutex_lock(&GobCacheMutex);
+	ep_thr_mutex_lock(&s->mutex);
 	_gdp_gob_lock(gob);
-	add_cache_unlocked(gob);
-	ep_thr_mutex_unlock(&GobCacheMutex);
+	add_cache_unlocked(s, gob);
+	ep_thr_mutex_unlock(&s->mutex);
 }
 
 
@@ -364,23 +278,39 @@ _gdp_gob_cache_add(gdp_gob_t *gob)
 **		is a dummy that uses the name of the log server.  After
 **		the log actually exists it has to be updated with the
 **		real name.
+**
+**		The new name may belong to another shard, in which case
+**		both are locked (lowest first) so the GOB is never missing.
 */
 
 void
 _gdp_gob_cache_changename(gdp_gob_t *gob, gdp_name_t newname)
 {
+	struct gob_shard *olds;
+	struct gob_shard *news;
+
 	// sanity checks
 	EP_ASSERT_ELSE(GDP_GOB_ISGOOD(gob), return);
 	EP_ASSERT_ELSE(gdp_name_is_valid(gob->name), return);
 	EP_ASSERT_ELSE(gdp_name_is_valid(newname), return);
 	EP_ASSERT_ELSE(EP_UT_BITSET(GOBF_INCACHE, gob->flags), return);
 
-	ep_thr_mutex_lock(&GobCacheMutex);
-	check_cache_consistency("_gdp_gob_cache_changename");
-	(void) ep_hash_delete(_OpenGOBCache, sizeof (gdp_name_t), gob->name);
+	olds = GOB_SHARD(gob->name);
+	news = GOB_SHARD(newname);
+	ep_thr_mutex_lock(olds < news ? &olds->mutex : &news->mutex);
+	if (olds != news)
+		ep_thr_mutex_lock(olds < news ? &news->mutex : &olds->mutex);
+
+	(void) ep_hash_delete(olds->hash, sizeof (gdp_name_t), gob->name);
 	(void) memcpy(gob->name, newname, sizeof (gdp_name_t));
-	(void) ep_hash_insert(_OpenGOBCache, sizeof (gdp_name_t), newname, gob);
-	ep_thr_mutex_unlock(&GobCacheMutex);
+	(void) ep_hash_insert(news->hash, sizeof (gdp_name_t), newname, gob);
+	if (olds != news)
+	{
+		clock_remove(olds, gob);
+		clock_add(news, gob);
+		ep_thr_mutex_unlock(&olds->mutex);
+	}
+	ep_thr_mutex_unlock(&news->mutex);
 
 	ep_dbg_cprintf(Dbg, 40, "_gdp_gob_cache_changename: %s => %p\n",
 					gob->pname, gob);
@@ -392,7 +322,7 @@ _gdp_gob_cache_changename(gdp_gob_t *gob, gdp_name_t newname)
 **
 **		Searches for a specific GOB.  If found it is returned; if not,
 **		it returns null unless the GGCF_CREATE flag is set, in which
-**		case it is created and returned.  This allows the Cache Mutex
+**		case it is created and returned.  This allows the shard lock
 **		to be locked before the GOB is locked.  Newly created GOBs
 **		are marked GOBF_PENDING unless the open routine clears that bit.
 **		In particular, gdp_gob_open needs to do additional opening
@@ -410,15 +340,14 @@ _gdp_gob_cache_get(
 			uint32_t flags,
 			gdp_gob_t **pgob)
 {
+	struct gob_shard *s = GOB_SHARD(gob_name);
 	gdp_gob_t *gob;
 	EP_STAT estat = EP_STAT_OK;
 
-	ep_thr_mutex_lock(&GobCacheMutex);
-	if (!check_cache_consistency("_gdp_gob_cache_get"))
-		rebuild_lru_list();
+	ep_thr_mutex_lock(&s->mutex);
 
 	// see if we have a pointer to this GOB in the cache
-	gob = (gdp_gob_t *) ep_hash_search(_OpenGOBCache,
+	gob = (gdp_gob_t *) ep_hash_search(s->hash,
 							sizeof (gdp_name_t), (void *) gob_name);
 	if (gob != NULL)
 	{
@@ -453,7 +382,7 @@ _gdp_gob_cache_get(
 		estat = _gdp_gob_new(gob_name, &gob);
 		EP_STAT_CHECK(estat, goto fail0);
 		_gdp_gob_lock(gob);
-		add_cache_unlocked(gob);
+		add_cache_unlocked(s, gob);
 	}
 
 	if (ep_dbg_test(Dbg, 42))
@@ -470,19 +399,22 @@ _gdp_gob_cache_get(
 fail0:
 	if (EP_STAT_ISOK(estat))
 		*pgob = gob;
-	ep_thr_mutex_unlock(&GobCacheMutex);
+	ep_thr_mutex_unlock(&s->mutex);
 	return estat;
 }
 
 
 /*
-** Drop a GOB from both the associative and the LRU caches
+** Drop a GOB from both the associative cache and the clock
 **
+**		If cleanup is set the caller already holds the shard lock.
 */
 
 void
 _gdp_gob_cache_drop(gdp_gob_t *gob, bool cleanup)
 {
+	struct gob_shard *s;
+
 	EP_ASSERT_ELSE(gob != NULL, return);
 	if (!EP_ASSERT(GDP_GOB_ISGOOD(gob)))
 	{
@@ -490,15 +422,13 @@ _gdp_gob_cache_drop(gdp_gob_t *gob, bool cleanup)
 		// (this may crash)
 		EP_ASSERT_ELSE(gdp_name_is_valid(gob->name), return);
 	}
+	s = GOB_SHARD(gob->name);
 
 	GDP_GOB_ASSERT_ISLOCKED(gob);
 	if (!EP_ASSERT(EP_UT_BITSET(GOBF_INCACHE, gob->flags)))
 		return;
 	if (cleanup)
-	{
-		EP_THR_MUTEX_ASSERT_ISLOCKED(&GobCacheMutex);
-		check_cache_consistency("_gdp_gob_cache_drop");
-	}
+		EP_THR_MUTEX_ASSERT_ISLOCKED(&s->mutex);
 
 	// error if we're dropping something that's referenced from the cache
 	if (gob->refcnt != 0)
@@ -512,14 +442,13 @@ _gdp_gob_cache_drop(gdp_gob_t *gob, bool cleanup)
 	// mark it as being dropped to detect race condition
 	gob->flags |= GOBF_DROPPING;
 
-	// if we're not cleanup up (GobCacheMutex unlocked) we have to
+	// if we're not cleanup up (shard unlocked) we have to
 	// get the lock ordering right
 	if (!cleanup)
 	{
-		// now lock the cache and then re-lock the GOB
+		// now lock the shard and then re-lock the GOB
 		_gdp_gob_unlock(gob);
-		ep_thr_mutex_lock(&GobCacheMutex);
-		check_cache_consistency("_gdp_gob_cache_drop");
+		ep_thr_mutex_lock(&s->mutex);
 		_gdp_gob_lock(gob);
 
 		// sanity checks (XXX should these be assertions? XXX)
@@ -528,16 +457,16 @@ _gdp_gob_cache_drop(gdp_gob_t *gob, bool cleanup)
 	}
 
 	// remove it from the associative cache
-	(void) ep_hash_delete(_OpenGOBCache, sizeof (gdp_name_t), gob->name);
+	(void) ep_hash_delete(s->hash, sizeof (gdp_name_t), gob->name);
 
-	// ... and the LRU list
-	LIST_REMOVE(gob, ulist);
+	// ... and the clock
+	clock_remove(s, gob);
 	gob->flags &= ~GOBF_INCACHE;
 
 	if (!cleanup)
 	{
-		// now we can unlock the cache, but leave the GOB locked
-		ep_thr_mutex_unlock(&GobCacheMutex);
+		// now we can unlock the shard, but leave the GOB locked
+		ep_thr_mutex_unlock(&s->mutex);
 	}
 
 	ep_dbg_cprintf(Dbg, 40, "_gdp_gob_cache_drop: %s => %p\n",
@@ -546,8 +475,10 @@ _gdp_gob_cache_drop(gdp_gob_t *gob, bool cleanup)
 
 
 /*
-**  _GDP_GOB_TOUCH --- move GOB to the front of the LRU list
+**  _GDP_GOB_TOUCH --- mark GOB as recently used
 **
+**		This only updates the use time, which the reclaimer checks
+**		as it sweeps, so the shard need not be locked.
 **		GOB must be locked when we enter.
 */
 
@@ -560,32 +491,96 @@ _gdp_gob_touch(gdp_gob_t *gob)
 
 	ep_dbg_cprintf(Dbg, 46, "_gdp_gob_touch(%p)\n", gob);
 
-	gettimeofday(&tv, NULL);
-	gob->utime = tv.tv_sec;
-
-	if (!GDP_GOB_ASSERT_ISLOCKED(gob))
-	{
-		// GOB isn't locked: do nothing
-	}
-	else if (!EP_UT_BITSET(GOBF_INCACHE, gob->flags))
+	if (GDP_GOB_ASSERT_ISLOCKED(gob))
 	{
-		// GOB isn't in cache: do nothing
+		gettimeofday(&tv, NULL);
+		gob->utime = tv.tv_sec;
 	}
-	else
+}
+
+
+/*
+**  Sweep part of one shard's clock
+**
+**		Looks at up to batch slots starting at the hand.  GOBs that
+**		are old enough and unreferenced are taken out of the cache
+**		and returned in victims for the caller to free once the
+**		shard is unlocked.  GOBs that are locked by
+**		someone else are obviously in use, so they are skipped.
+**		Returns the number of slots looked at.
+*/
+
+static int
+shard_sweep(struct gob_shard *s,
+		time_t mintime,
+		int batch,
+		gdp_gob_t **victims,
+		int *nvictims)
+{
+	int nlooked;
+
+	EP_THR_MUTEX_ASSERT_ISLOCKED(&s->mutex);
+	*nvictims = 0;
+	for (nlooked = 0; nlooked < batch && s->nclock > 0; nlooked++)
 	{
-		// both locked and in cache
-		EP_THR_MUTEX_ASSERT_ISLOCKED(&GobCacheMutex);
-		check_cache_consistency("_gdp_gob_touch");
-		LIST_REMOVE(gob, ulist);
-		IF_LIST_CHECK_OK(&GobsByUse, gob, ulist, gdp_gob_t)
-			LIST_INSERT_HEAD(&GobsByUse, gob, ulist);
+		gdp_gob_t *g1;
+
+		if (s->hand >= s->nclock)
+			s->hand = 0;
+		g1 = s->clock[s->hand];
+
+		if (ep_thr_mutex_trylock(&g1->mutex) != 0)
+		{
+			s->hand++;
+			continue;
+		}
+		g1->flags |= GOBF_ISLOCKED;
+		if (g1->utime > mintime)
+		{
+			_gdp_gob_unlock(g1);
+			s->hand++;
+			continue;
+		}
+		if (EP_UT_BITSET(GOBF_DROPPING, g1->flags) || g1->refcnt > 0)
+		{
+			if (ep_dbg_test(Dbg, 19))
+			{
+				ep_dbg_printf("_gdp_gob_cache_reclaim: skipping %s:\n   ",
+						EP_UT_BITSET(GOBF_DROPPING, g1->flags) ?
+							"dropping" : "referenced");
+				_gdp_gob_dump(g1, ep_dbg_getfile(), GDP_PR_DETAILED, 0);
+			}
+			_gdp_gob_unlock(g1);
+			s->hand++;
+			continue;
+		}
+
+		// OK, we really want to drop this GOB
+		if (ep_dbg_test(Dbg, 32))
+		{
+			ep_dbg_printf("_gdp_gob_cache_reclaim: reclaiming:\n   ");
+			_gdp_gob_dump(g1, ep_dbg_getfile(), GDP_PR_DETAILED, 0);
+		}
+
+		// the last GOB moves into this slot, so the hand stays put.
+		// Once out of the cache nobody can find it, so it can be
+		// unlocked rather than holding a batch of GOB locks at once.
+		_gdp_gob_cache_drop(g1, true);
+		_gdp_gob_unlock(g1);
+		victims[(*nvictims)++] = g1;
 	}
+	return nlooked;
 }
 
 
 /*
 **  Reclaim cache entries older than a specified age
 **
+**		Each shard is swept a batch at a time, and the shard lock
+**		is dropped between batches and while the reclaimed GOBs
+**		are being freed (which can mean closing files), so opens
+**		are never held up for long.
+**
 **		If we can't get the number of file descriptors down far enough
 **		we keep trying with increasingly stringent constraints, so maxage
 **		is really more advice than a requirement.
@@ -596,12 +591,12 @@ _gdp_gob_touch(gdp_gob_t *gob)
 **		XXX	reclaimed, especially since they are a scarce resource.
 */
 
-#define CACHE_BLOOM_SIZE		(16 * 1024)
 void
 _gdp_gob_cache_reclaim(time_t maxage)
 {
 	static int headroom = 0;
-	static long maxgobs;				// maximum number of GOBs in one pass
+	static long maxgobs;				// maximum GOBs per shard in one pass
+	static int batch;					// GOBs looked at per shard lock
 
 	ep_dbg_cprintf(Dbg, 68, "_gdp_gob_cache_reclaim(maxage = %ld)\n", maxage);
 
@@ -623,70 +618,55 @@ _gdp_gob_cache_reclaim(time_t maxage)
 	{
 		maxgobs = ep_adm_getlongparam("swarm.gdp.cache.reclaim.maxgobs", 100000);
 	}
+	if (batch <= 0)
+	{
+		batch = ep_adm_getintparam("swarm.gdp.cache.reclaim.batch", 64);
+		if (batch <= 0)
+			batch = 64;
+	}
 
 	for (;;)
 	{
 		struct timeval tv;
-		gdp_gob_t *g1, *g2;
+		gdp_gob_t *victims[batch];
 		time_t mintime;
-		long loopcount = 0;
+		int i;
 
 		gettimeofday(&tv, NULL);
 		mintime = tv.tv_sec - maxage;
 
-		ep_thr_mutex_lock(&GobCacheMutex);
-		if (!check_cache_consistency("_gdp_gob_cache_reclaim"))
-			rebuild_lru_list();
-		for (g1 = LIST_FIRST(&GobsByUse); g1 != NULL; g1 = g2)
+		for (i = 0; i < NShards; i++)
 		{
-			if (loopcount++ > maxgobs)
-			{
-				EP_ASSERT_PRINT("_gdp_gob_cache_reclaim: processed %ld "
-								"GOBS (giving up)",
-							maxgobs);
-				break;
-			}
-			g2 = LIST_NEXT(g1, ulist);		// do as early as possible
+			struct gob_shard *s = &Shards[i];
+			long nleft;
 
-			if (ep_thr_mutex_trylock(&g1->mutex) != 0)
-			{
-				// couldn't get the lock: previous g2 setting may be wrong
-				continue;
-			}
-			g1->flags |= GOBF_ISLOCKED;
-			g2 = LIST_NEXT(g1, ulist);		// get g2 again with the lock
-			if (g1->utime > mintime)
+			// one trip around this shard's clock (as it is now)
+			ep_thr_mutex_lock(&s->mutex);
+			nleft = s->nclock < maxgobs ? s->nclock : maxgobs;
+			while (nleft > 0)
 			{
-				_gdp_gob_unlock(g1);
-				continue;
-			}
-			if (EP_UT_BITSET(GOBF_DROPPING, g1->flags) || g1->refcnt > 0)
-			{
-				if (ep_dbg_test(Dbg, 19))
+				int nvictims;
+
+				nleft -= shard_sweep(s, mintime,
+								nleft < batch ? nleft : batch,
+								victims, &nvictims);
+				ep_thr_mutex_unlock(&s->mutex);
+
+				// release memory (this will also unlock the corpses)
+				while (nvictims > 0)
 				{
-					ep_dbg_printf("_gdp_gob_cache_reclaim: skipping %s:\n   ",
-							EP_UT_BITSET(GOBF_DROPPING, g1->flags) ?
-								"dropping" : "referenced");
-					_gdp_gob_dump(g1, ep_dbg_getfile(), GDP_PR_DETAILED, 0);
+					gdp_gob_t *g1 = victims[--nvictims];
+
+					_gdp_gob_lock(g1);
+					_gdp_gob_free(&g1);
 				}
-				_gdp_gob_unlock(g1);
-				continue;
-			}
 
-			// OK, we really want to drop this GOB
-			if (ep_dbg_test(Dbg, 32))
-			{
-				ep_dbg_printf("_gdp_gob_cache_reclaim: reclaiming:\n   ");
-				_gdp_gob_dump(g1, ep_dbg_getfile(), GDP_PR_DETAILED, 0);
+				ep_thr_mutex_lock(&s->mutex);
+				if (s->nclock == 0)
+					break;
 			}
-
-			// remove from the LRU list and the name->handle cache
-			_gdp_gob_cache_drop(g1, true);
-
-			// release memory (this will also unlock the corpse)
-			_gdp_gob_free(&g1);
+			ep_thr_mutex_unlock(&s->mutex);
 		}
-		ep_thr_mutex_unlock(&GobCacheMutex);
 
 		// check to see if we have enough headroom
 		int maxfds;
@@ -718,19 +698,28 @@ _gdp_gob_cache_reclaim(time_t maxage)
 void
 _gdp_gob_cache_shutdown(void (*shutdownfunc)(gdp_req_t *))
 {
-	gdp_gob_t *g1, *g2;
+	int i;
 
 	ep_dbg_cprintf(Dbg, 30, "\n_gdp_gob_cache_shutdown\n");
 
 	// free all GOBs and all reqs linked to them
 	// can give locking errors in some circumstances
-	for (g1 = LIST_FIRST(&GobsByUse); g1 != NULL; g1 = g2)
+	for (i = 0; i < NShards; i++)
 	{
-		ep_thr_mutex_trylock(&g1->mutex);
-		g1->flags |= GOBF_ISLOCKED;
-		g2 = LIST_NEXT(g1, ulist);
-		_gdp_req_freeall(g1, NULL, shutdownfunc);
-		_gdp_gob_free(&g1);	// also removes from cache and usage list
+		struct gob_shard *s = &Shards[i];
+
+		while (s->nclock > 0)
+		{
+			int n = s->nclock;
+			gdp_gob_t *g1 = s->clock[n - 1];
+
+			ep_thr_mutex_trylock(&g1->mutex);
+			g1->flags |= GOBF_ISLOCKED;
+			_gdp_req_freeall(g1, NULL, shutdownfunc);
+			_gdp_gob_free(&g1);	// also removes from cache
+			if (s->nclock >= n)
+				break;			// wasn't removed; don't spin
+		}
 	}
 }
 
@@ -741,39 +730,45 @@ _gdp_gob_cache_dump(int plev, FILE *fp)
 	gdp_gob_t *gob;
 	int ngobs = 0;			// actual number of GOBs in cache
 	int maxprint = 30;		//XXX should be a parameter
-	int maxgobs = 200;		//XXX ditto (this parameter is a loop breaker)
+	int i, j;
 
 	if (fp == NULL)
 		fp = ep_dbg_getfile();
 
-	fprintf(fp, "\n<<< Showing cached GOBs by usage >>>\n");
-	LIST_FOREACH(gob, &GobsByUse, ulist)
+	fprintf(fp, "\n<<< Showing cached GOBs (%d shards) >>>\n", NShards);
+	for (i = 0; i < NShards; i++)
 	{
-		if (++ngobs > maxgobs)
-			break;
-		if (ngobs > maxprint)
-			continue;
-		VALGRIND_HG_DISABLE_CHECKING(gob, sizeof *gob);
+		struct gob_shard *s = &Shards[i];
 
-		if (plev > GDP_PR_PRETTY)
+		ep_thr_mutex_lock(&s->mutex);
+		for (j = 0; j < s->nclock; j++)
 		{
-			_gdp_gob_dump(gob, fp, plev, 0);
-		}
-		else
-		{
-			struct tm *tm;
-			char tbuf[40];
+			if (++ngobs > maxprint)
+				continue;
+			gob = s->clock[j];
+			VALGRIND_HG_DISABLE_CHECKING(gob, sizeof *gob);
 
-			if ((tm = localtime(&gob->utime)) != NULL)
-				strftime(tbuf, sizeof tbuf, "%Y%m%d-%H%M%S", tm);
+			if (plev > GDP_PR_PRETTY)
+			{
+				_gdp_gob_dump(gob, fp, plev, 0);
+			}
 			else
-				snprintf(tbuf, sizeof tbuf, "%"PRIu64, (int64_t) gob->utime);
-			fprintf(fp, "%s %p %s %d\n", tbuf, gob, gob->pname, gob->refcnt);
+			{
+				struct tm *tm;
+				char tbuf[40];
+
+				if ((tm = localtime(&gob->utime)) != NULL)
+					strftime(tbuf, sizeof tbuf, "%Y%m%d-%H%M%S", tm);
+				else
+					snprintf(tbuf, sizeof tbuf, "%"PRIu64, (int64_t) gob->utime);
+				fprintf(fp, "%s %p %s %d\n", tbuf, gob, gob->pname, gob->refcnt);
+			}
+			if (ep_hash_search(s->hash, sizeof gob->name, (void *) gob->name) == NULL)
+				fprintf(fp, "    ===> WARNING: %s not in primary cache\n",
+						gob->pname);
+			VALGRIND_HG_ENABLE_CHECKING(gob, sizeof *gob);
 		}
-		if (ep_hash_search(_OpenGOBCache, sizeof gob->name, (void *) gob->name) == NULL)
-			fprintf(fp, "    ===> WARNING: %s not in primary cache\n",
-					gob->pname);
-		VALGRIND_HG_ENABLE_CHECKING(gob, sizeof *gob);
+		ep_thr_mutex_unlock(&s->mutex);
 	}
 	if (ngobs <= maxprint)
 		fprintf(fp, "\n<<< End of cached GOB list >>>\n");
@@ -785,19 +780,28 @@ _gdp_gob_cache_dump(int plev, FILE *fp)
 
 /*
 **  Do a pass over all known GOBs.  Used for reclamation.
+**
+**		Only one shard is locked at a time.  The clock is walked
+**		from the end so that if f drops the GOB (moving the last
+**		one into its slot) nothing is skipped.
 */
 
 void
 _gdp_gob_cache_foreach(void (*f)(gdp_gob_t *))
 {
-	gdp_gob_t *g1;
-	gdp_gob_t *g2;
+	int i, j;
 
-	ep_thr_mutex_lock(&GobCacheMutex);
-	for (g1 = LIST_FIRST(&GobsByUse); g1 != NULL; g1 = g2)
+	for (i = 0; i < NShards; i++)
 	{
-		g2 = LIST_NEXT(g1, ulist);
-		(*f)(g1);
+		struct gob_shard *s = &Shards[i];
+
+		ep_thr_mutex_lock(&s->mutex);
+		for (j = s->nclock - 1; j >= 0; j--)
+		{
+			if (j >= s->nclock)
+				continue;
+			(*f)(s->clock[j]);
+		}
+		ep_thr_mutex_unlock(&s->mutex);
 	}
-	ep_thr_mutex_unlock(&GobCacheMutex);
 }
@@ -110,6 +110,7 @@ _gdp_gob_new(gdp_name_t gob_name, gdp_gob_t **pgob)
 	VALGRIND_HG_CLEAN_MEMORY(gob, sizeof *gob);
 
 	LIST_INIT(&gob->reqs);
+	gob->subs.n = 0;
 	gob->refcnt = 1;
 	gob->nrecs = 0;
 	NGobsAllocated++;
@@ -180,6 +181,11 @@ _gdp_gob_free(gdp_gob_t **pgob)
 
 	// release any remaining requests
 	_gdp_req_freeall(gob, NULL, NULL);
+	EP_ASSERT(gob->subs.n == 0);
+	if (gob->subs.heap != NULL)
+		ep_mem_free(gob->subs.heap);
+	gob->subs.heap = NULL;
+	gob->subs.n = gob->subs.alloc = 0;
 
 	// free any additional per-GOB resources
 	if (gob->freefunc != NULL)
@@ -286,8 +292,8 @@ _gdp_gob_dump(
 						_gdp_pr_indent(indent), gob->sign_ctx, gob->vrfy_ctx);
 				gmtime_r(&gob->utime, &tm);
 				strftime(tbuf, sizeof tbuf, "%Y-%m-%d %H:%M:%S", &tm);
-				fprintf(fp, "%sutime = %s, x = %p\n",
-						_gdp_pr_indent(indent), tbuf, gob->x);
+				fprintf(fp, "%sutime = %s, x = %p, subs = %d\n",
+						_gdp_pr_indent(indent), tbuf, gob->x, gob->subs.n);
 			}
 		}
 	}
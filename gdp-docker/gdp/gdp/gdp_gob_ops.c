@@ -777,7 +777,8 @@ append_common(
 		EP_ASSERT_ELSE(payload != NULL, return EP_STAT_ASSERT_ABORT);
 
 		payload->dl->n_d = n_datums;
-		payload->dl->d = (GdpDatum **) ep_mem_zalloc(n_datums * sizeof *datums);
+		payload->dl->d = (GdpDatum **)
+					_gdp_msg_alloc(msg, n_datums * sizeof *datums);
 		for (dno = 0; dno < n_datums; dno++)
 		{
 			datum = datums[dno];
@@ -786,7 +787,8 @@ append_common(
 				ep_dbg_printf("append_common: _gdp_datum_to_pb: ");
 				_gdp_datum_dump(datum, NULL);
 			}
-			payload->dl->d[dno] = (GdpDatum *) ep_mem_zalloc(sizeof (GdpDatum));
+			payload->dl->d[dno] = (GdpDatum *)
+					_gdp_msg_alloc(msg, sizeof (GdpDatum));
 			gdp_datum__init(payload->dl->d[dno]);
 			_gdp_datum_to_pb(datum, msg, payload->dl->d[dno]);
 		}
@@ -62,6 +62,7 @@ gdp_name_t			_GdpMyRoutingName;	// source name for PDUs
 gdp_chan_t			*_GdpChannel;		// our primary app-level protocol port
 static bool			_GdpRunCmdInThread = true;		// run commands in threads
 static bool			_GdpRunRespInThread = false;	// run responses in threads
+static bool			_GdpSerializeCmds = true;	// one log at a time per thread
 bool				_GdpLibInitialized;	// are we initialized?
 
 
@@ -641,6 +642,16 @@ process_resp(void *rpdu_)
 **		in the I/O thread, such as matching an ack/nak PDU with the
 **		corresponding req.  It should never block.  The heavy lifting
 **		is done in the routine above.
+**
+**		Commands for the same GOB would all serialize on the GOB
+**		lock anyway, so rather than having several workers blocked
+**		on one busy log they are queued by destination name and run
+**		one at a time, in order, leaving the other workers free for
+**		other logs.  Names are SHA-256 hashes, so any four bytes of
+**		the name make a fine key.  A command that is going to wait
+**		for something that later commands might help with (e.g., an
+**		append waiting for a group commit in gdplogd) can let the
+**		queue go on using ep_thr_pool_serial_release.
 */
 
 void
@@ -651,7 +662,14 @@ _gdp_pdu_process(gdp_pdu_t *pdu, gdp_chan_t *chan)
 
 	if (GDP_CMD_IS_COMMAND(pdu->msg->cmd))
 	{
-		if (_GdpRunCmdInThread)
+		if (_GdpRunCmdInThread && _GdpSerializeCmds)
+		{
+			uint32_t key;
+
+			memcpy(&key, pdu->dst, sizeof key);
+			ep_thr_pool_run_serial(key, &process_cmd, pdu);
+		}
+		else if (_GdpRunCmdInThread)
 			ep_thr_pool_run(&process_cmd, pdu);
 		else
 			process_cmd(pdu);
@@ -672,8 +690,8 @@ _gdp_pdu_process(gdp_pdu_t *pdu, gdp_chan_t *chan)
 **		This should really also have a maximum number of GOBs to leave
 **		open so we don't run out of file descriptors under high load.
 **
-**		This implementation locks the GclsByUse list during the
-**		entire operation.  That's probably not the best idea.
+**		The GOB cache is swept a shard and a batch at a time, so
+**		this doesn't hold up opens for long.
 */
 
 void
@@ -1118,6 +1136,8 @@ gdp_lib_init(const char *progname, const char *myname, uint32_t flags)
 									true);
 	_GdpRunRespInThread = ep_adm_getboolparam("swarm.gdp.response.runinthread",
 									false);
+	_GdpSerializeCmds = ep_adm_getboolparam("swarm.gdp.command.serialize",
+									true);
 
 	// figure out or generate our name (for routing)
 	if (myname == NULL && progname != NULL)
@@ -48,6 +48,201 @@
 
 static EP_DBG	Dbg = EP_DBG_INIT("gdp.msg", "GDP message manipulation");
 
+
+/*
+**  Message arenas.
+**
+**		Every message (whether built here or unpacked off the wire)
+**		lives in an arena, and the arena is the protobuf-c allocator
+**		for that message.  The many small pieces of a message are
+**		carved out of one block and released all at once, and the
+**		blocks themselves are kept on a free list.
+**
+**		The message itself is always the first allocation, so the
+**		arena can be found from the message.  Large allocations
+**		(record data, mostly) are passed on to ep_mem_malloc, and
+**		freeing anything the arena doesn't own goes to ep_mem_free.
+**		This means code that builds messages may still fill them
+**		in with ep_mem_* memory, and protobuf-c will free it when
+**		the message is freed, just as before.
+*/
+
+#define MSG_ARENA_SIZE		4096			// size of each block
+#define MSG_ARENA_BIGALLOC	1024			// larger goes to ep_mem_malloc
+#define MSG_ARENA_MAXFREE	256				// max blocks kept on free list
+#define MSG_ARENA_MAGIC		0x6d736761		// 'msga'
+#define MSG_ARENA_ALIGN		16
+
+struct msg_arena_blk
+{
+	struct msg_arena_blk	*next;			// next (older) block
+	uint8_t					*end;			// end of this block
+};
+
+struct msg_arena
+{
+	struct msg_arena_blk	blk;			// must be first
+	uint32_t				magic;
+	uint8_t					*next;			// next free byte
+	uint8_t					*end;			// end of current block
+	struct msg_arena_blk	*extra;			// overflow blocks
+	ProtobufCAllocator		allocator;		// points back to us
+};
+
+#define MSG_ARENA_HDRSIZE		\
+			((sizeof (struct msg_arena) + MSG_ARENA_ALIGN - 1) & \
+					~(MSG_ARENA_ALIGN - 1))
+#define MSG_ARENA_OF(msg)		\
+			((struct msg_arena *) ((uint8_t *) (msg) - MSG_ARENA_HDRSIZE))
+
+static EP_THR_MUTEX		ArenaFreeListMutex
+							EP_THR_MUTEX_INITIALIZER2(GDP_MUTEX_LORDER_LEAF);
+static struct msg_arena	*ArenaFreeList;		// linked through blk.next
+static int				NArenaFree;
+
+static void	*arena_pb_alloc(void *a, size_t size);
+static void	arena_pb_free(void *a, void *p);
+
+static struct msg_arena *
+arena_new(void)
+{
+	struct msg_arena *arena;
+
+	ep_thr_mutex_lock(&ArenaFreeListMutex);
+	if ((arena = ArenaFreeList) != NULL)
+	{
+		ArenaFreeList = (struct msg_arena *) arena->blk.next;
+		NArenaFree--;
+	}
+	ep_thr_mutex_unlock(&ArenaFreeListMutex);
+
+	if (arena == NULL)
+		arena = (struct msg_arena *) ep_mem_malloc(MSG_ARENA_SIZE);
+	arena->blk.next = NULL;
+	arena->blk.end = (uint8_t *) arena + MSG_ARENA_SIZE;
+	arena->magic = MSG_ARENA_MAGIC;
+	arena->next = (uint8_t *) arena + MSG_ARENA_HDRSIZE;
+	arena->end = arena->blk.end;
+	arena->extra = NULL;
+	arena->allocator.alloc = arena_pb_alloc;
+	arena->allocator.free = arena_pb_free;
+	arena->allocator.allocator_data = arena;
+	return arena;
+}
+
+static void
+arena_release(struct msg_arena *arena)
+{
+	struct msg_arena_blk *b;
+
+	EP_ASSERT_ELSE(arena->magic == MSG_ARENA_MAGIC, return);
+	arena->magic = 0;
+	while ((b = arena->extra) != NULL)
+	{
+		arena->extra = b->next;
+		ep_mem_free(b);
+	}
+
+#if !GDP_DEBUG_NO_FREE_LISTS		// avoid helgrind complaints
+	ep_thr_mutex_lock(&ArenaFreeListMutex);
+	if (NArenaFree < MSG_ARENA_MAXFREE)
+	{
+		arena->blk.next = (struct msg_arena_blk *) ArenaFreeList;
+		ArenaFreeList = arena;
+		NArenaFree++;
+		arena = NULL;
+	}
+	ep_thr_mutex_unlock(&ArenaFreeListMutex);
+#endif
+	if (arena != NULL)
+		ep_mem_free(arena);
+}
+
+static void *
+arena_alloc(struct msg_arena *arena, size_t size)
+{
+	void *p;
+
+	size = (size + MSG_ARENA_ALIGN - 1) & ~(MSG_ARENA_ALIGN - 1);
+	if (size > MSG_ARENA_BIGALLOC)
+		return ep_mem_malloc(size);
+	if (size > (size_t) (arena->end - arena->next))
+	{
+		// start another block
+		struct msg_arena_blk *b;
+
+		b = (struct msg_arena_blk *) ep_mem_malloc(MSG_ARENA_SIZE);
+		b->end = (uint8_t *) b + MSG_ARENA_SIZE;
+		b->next = arena->extra;
+		arena->extra = b;
+		arena->next = (uint8_t *) b +
+				((sizeof *b + MSG_ARENA_ALIGN - 1) & ~(MSG_ARENA_ALIGN - 1));
+		arena->end = b->end;
+	}
+	p = arena->next;
+	arena->next += size;
+	return p;
+}
+
+// true if p was allocated from this arena (rather than ep_mem_malloc)
+static bool
+arena_owns(struct msg_arena *arena, const void *p)
+{
+	const struct msg_arena_blk *b = &arena->blk;
+	const uint8_t *cp = (const uint8_t *) p;
+
+	if (cp >= (uint8_t *) b && cp < b->end)
+		return true;
+	for (b = arena->extra; b != NULL; b = b->next)
+	{
+		if (cp >= (uint8_t *) b && cp < b->end)
+			return true;
+	}
+	return false;
+}
+
+static void *
+arena_pb_alloc(void *a, size_t size)
+{
+	return arena_alloc((struct msg_arena *) a, size);
+}
+
+static void
+arena_pb_free(void *a, void *p)
+{
+	if (p != NULL && !arena_owns((struct msg_arena *) a, p))
+		ep_mem_free(p);
+}
+
+
+/*
+**  _GDP_MSG_ALLOC --- allocate (zeroed) memory that belongs to a message
+**  _GDP_MSG_MFREE --- free part of a message
+**
+**		Use these when filling in a message so the pieces come
+**		from (and go back to) the message's arena.  Anything
+**		allocated with _gdp_msg_alloc is freed with the message.
+*/
+
+void *
+_gdp_msg_alloc(gdp_msg_t *msg, size_t size)
+{
+	struct msg_arena *arena = MSG_ARENA_OF(msg);
+	void *p;
+
+	EP_ASSERT(arena->magic == MSG_ARENA_MAGIC);
+	p = arena_alloc(arena, size);
+	memset(p, 0, size);
+	return p;
+}
+
+void
+_gdp_msg_mfree(gdp_msg_t *msg, void *p)
+{
+	arena_pb_free(MSG_ARENA_OF(msg), p);
+}
+
+
 /*
 **  Create a new GDP message.
 **		The gdp_msg_t type is really a synonym for GdpMessage.
@@ -57,6 +252,7 @@ static EP_DBG	Dbg = EP_DBG_INIT("gdp.msg", "GDP message manipulation");
 gdp_msg_t *
 _gdp_msg_new(gdp_cmd_t cmd, gdp_rid_t rid, gdp_l5seqno_t l5seqno)
 {
+	struct msg_arena *arena;
 	gdp_msg_t *msg;
 
 	ep_dbg_cprintf(Dbg, 24,
@@ -65,7 +261,9 @@ _gdp_msg_new(gdp_cmd_t cmd, gdp_rid_t rid, gdp_l5seqno_t l5seqno)
 				_gdp_proto_cmd_name(cmd), cmd, rid, l5seqno);
 
 	EP_ASSERT(cmd >= 0 && cmd <= 255);
-	msg = (gdp_msg_t *) ep_mem_zalloc(sizeof *msg);
+	arena = arena_new();
+	msg = (gdp_msg_t *) arena_alloc(arena, sizeof *msg);
+	EP_ASSERT(msg == (gdp_msg_t *) ((uint8_t *) arena + MSG_ARENA_HDRSIZE));
 	gdp_message__init(msg);
 	msg->cmd = cmd;
 	if (rid != GDP_PDU_NO_RID)
@@ -85,10 +283,10 @@ _gdp_msg_new(gdp_cmd_t cmd, gdp_rid_t rid, gdp_l5seqno_t l5seqno)
 	case GDP_CMD_CREATE:
 		msg->body_case = GDP_MESSAGE__BODY_CMD_CREATE;
 		msg->cmd_create = (GdpMessage__CmdCreate *)
-					ep_mem_zalloc(sizeof *msg->cmd_create);
+					_gdp_msg_alloc(msg, sizeof *msg->cmd_create);
 		gdp_message__cmd_create__init(msg->cmd_create);
 		msg->cmd_create->metadata = (GdpMetadata *)
-					ep_mem_zalloc(sizeof *msg->cmd_create->metadata);
+					_gdp_msg_alloc(msg, sizeof *msg->cmd_create->metadata);
 		gdp_metadata__init(msg->cmd_create->metadata);
 		break;
 
@@ -97,45 +295,45 @@ _gdp_msg_new(gdp_cmd_t cmd, gdp_rid_t rid, gdp_l5seqno_t l5seqno)
 	case GDP_CMD_OPEN_RA:
 		msg->body_case = GDP_MESSAGE__BODY_CMD_OPEN;
 		msg->cmd_open = (GdpMessage__CmdOpen *)
-					ep_mem_zalloc(sizeof *msg->cmd_open);
+					_gdp_msg_alloc(msg, sizeof *msg->cmd_open);
 		gdp_message__cmd_open__init(msg->cmd_open);
 		break;
 
 	case GDP_CMD_APPEND:
 		msg->body_case = GDP_MESSAGE__BODY_CMD_APPEND;
 		msg->cmd_append = (GdpMessage__CmdAppend *)
-					ep_mem_zalloc(sizeof *msg->cmd_append);
+					_gdp_msg_alloc(msg, sizeof *msg->cmd_append);
 		gdp_message__cmd_append__init(msg->cmd_append);
 		msg->cmd_append->dl = (GdpDatumList *)
-					ep_mem_zalloc(sizeof (GdpDatumList));
+					_gdp_msg_alloc(msg, sizeof (GdpDatumList));
 		gdp_datum_list__init(msg->cmd_append->dl);
 		break;
 
 	case GDP_CMD_READ_BY_RECNO:
 		msg->body_case = GDP_MESSAGE__BODY_CMD_READ_BY_RECNO;
 		msg->cmd_read_by_recno = (GdpMessage__CmdReadByRecno *)
-					ep_mem_zalloc(sizeof *msg->cmd_read_by_recno);
+					_gdp_msg_alloc(msg, sizeof *msg->cmd_read_by_recno);
 		gdp_message__cmd_read_by_recno__init(msg->cmd_read_by_recno);
 		break;
 
 	case GDP_CMD_READ_BY_TS:
 		msg->body_case = GDP_MESSAGE__BODY_CMD_READ_BY_TS;
 		msg->cmd_read_by_ts = (GdpMessage__CmdReadByTs *)
-					ep_mem_zalloc(sizeof *msg->cmd_read_by_ts);
+					_gdp_msg_alloc(msg, sizeof *msg->cmd_read_by_ts);
 		gdp_message__cmd_read_by_ts__init(msg->cmd_read_by_ts);
 		break;
 
 	case GDP_CMD_READ_BY_HASH:
 		msg->body_case = GDP_MESSAGE__BODY_CMD_READ_BY_HASH;
 		msg->cmd_read_by_hash = (GdpMessage__CmdReadByHash *)
-					ep_mem_zalloc(sizeof *msg->cmd_read_by_hash);
+					_gdp_msg_alloc(msg, sizeof *msg->cmd_read_by_hash);
 		gdp_message__cmd_read_by_hash__init(msg->cmd_read_by_hash);
 		break;
 
 	case GDP_CMD_SUBSCRIBE_BY_RECNO:
 		msg->body_case = GDP_MESSAGE__BODY_CMD_SUBSCRIBE_BY_RECNO;
 		msg->cmd_subscribe_by_recno = (GdpMessage__CmdSubscribeByRecno *)
-						ep_mem_zalloc(sizeof *msg->cmd_subscribe_by_recno);
+						_gdp_msg_alloc(msg, sizeof *msg->cmd_subscribe_by_recno);
 		gdp_message__cmd_subscribe_by_recno__init(
 						msg->cmd_subscribe_by_recno);
 		break;
@@ -143,7 +341,7 @@ _gdp_msg_new(gdp_cmd_t cmd, gdp_rid_t rid, gdp_l5seqno_t l5seqno)
 	case GDP_CMD_SUBSCRIBE_BY_TS:
 		msg->body_case = GDP_MESSAGE__BODY_CMD_SUBSCRIBE_BY_TS;
 		msg->cmd_subscribe_by_ts = (GdpMessage__CmdSubscribeByTs *)
-						ep_mem_zalloc(sizeof *msg->cmd_subscribe_by_ts);
+						_gdp_msg_alloc(msg, sizeof *msg->cmd_subscribe_by_ts);
 		gdp_message__cmd_subscribe_by_ts__init(
 						msg->cmd_subscribe_by_ts);
 		break;
@@ -151,7 +349,7 @@ _gdp_msg_new(gdp_cmd_t cmd, gdp_rid_t rid, gdp_l5seqno_t l5seqno)
 	case GDP_CMD_SUBSCRIBE_BY_HASH:
 		msg->body_case = GDP_MESSAGE__BODY_CMD_SUBSCRIBE_BY_HASH;
 		msg->cmd_subscribe_by_hash = (GdpMessage__CmdSubscribeByHash *)
-						ep_mem_zalloc(sizeof *msg->cmd_subscribe_by_hash);
+						_gdp_msg_alloc(msg, sizeof *msg->cmd_subscribe_by_hash);
 		gdp_message__cmd_subscribe_by_hash__init(
 						msg->cmd_subscribe_by_hash);
 		break;
@@ -159,28 +357,28 @@ _gdp_msg_new(gdp_cmd_t cmd, gdp_rid_t rid, gdp_l5seqno_t l5seqno)
 	case GDP_ACK_CHANGED:
 		msg->body_case = GDP_MESSAGE__BODY_ACK_CHANGED;
 		msg->ack_changed = (GdpMessage__AckChanged *)
-					ep_mem_zalloc(sizeof *msg->ack_changed);
+					_gdp_msg_alloc(msg, sizeof *msg->ack_changed);
 		gdp_message__ack_changed__init(msg->ack_changed);
 		break;
 
 	case GDP_ACK_CONTENT:
 		msg->body_case = GDP_MESSAGE__BODY_ACK_CONTENT;
 		msg->ack_content = (GdpMessage__AckContent *)
-					ep_mem_zalloc(sizeof *msg->ack_content);
+					_gdp_msg_alloc(msg, sizeof *msg->ack_content);
 		gdp_message__ack_content__init(msg->ack_content);
 		msg->ack_content->dl = (GdpDatumList *)
-					ep_mem_zalloc(sizeof (GdpDatumList));
+					_gdp_msg_alloc(msg, sizeof (GdpDatumList));
 		gdp_datum_list__init(msg->ack_content->dl);
 		// individual datums need to be allocated and initialized when set
 //		msg->ack_content->datum = (GdpDatum *)
-//					ep_mem_zalloc(sizeof *msg->ack_content->datum);
+//					_gdp_msg_alloc(msg, sizeof *msg->ack_content->datum);
 //		gdp_datum__init(msg->ack_content->datum);
 		break;
 
 	case GDP_ACK_END_OF_RESULTS:
 		msg->body_case = GDP_MESSAGE__BODY_ACK_END_OF_RESULTS;
 		msg->ack_end_of_results = (GdpMessage__AckEndOfResults *)
-					ep_mem_zalloc(sizeof *msg->ack_end_of_results);
+					_gdp_msg_alloc(msg, sizeof *msg->ack_end_of_results);
 		gdp_message__ack_end_of_results__init(msg->ack_end_of_results);
 		break;
 
@@ -190,7 +388,7 @@ _gdp_msg_new(gdp_cmd_t cmd, gdp_rid_t rid, gdp_l5seqno_t l5seqno)
 			// other negative acknowledgement
 			msg->body_case = GDP_MESSAGE__BODY_NAK;
 			msg->nak = (GdpMessage__NakGeneric *)
-						ep_mem_zalloc(sizeof *msg->nak);
+						_gdp_msg_alloc(msg, sizeof *msg->nak);
 			gdp_message__nak_generic__init(msg->nak);
 		}
 		else if (cmd >= GDP_ACK_MIN && cmd <= GDP_ACK_MAX)
@@ -198,7 +396,7 @@ _gdp_msg_new(gdp_cmd_t cmd, gdp_rid_t rid, gdp_l5seqno_t l5seqno)
 			// other positive acknowledgement
 			msg->body_case = GDP_MESSAGE__BODY_ACK_SUCCESS;
 			msg->ack_success = (GdpMessage__AckSuccess *)
-						ep_mem_zalloc(sizeof *msg->ack_success);
+						_gdp_msg_alloc(msg, sizeof *msg->ack_success);
 			gdp_message__ack_success__init(msg->ack_success);
 			break;
 		}
@@ -214,12 +412,45 @@ _gdp_msg_new(gdp_cmd_t cmd, gdp_rid_t rid, gdp_l5seqno_t l5seqno)
 }
 
 
+/*
+**  Unpack a serialized message into a new arena.
+*/
+
+gdp_msg_t *
+_gdp_msg_unpack(size_t len, const uint8_t *data)
+{
+	struct msg_arena *arena = arena_new();
+	gdp_msg_t *msg;
+
+	msg = gdp_message__unpack(&arena->allocator, len, data);
+	if (msg == NULL)
+	{
+		arena_release(arena);
+		return NULL;
+	}
+
+	// protobuf-c allocates the message itself before any fields
+	EP_ASSERT(msg == (gdp_msg_t *) ((uint8_t *) arena + MSG_ARENA_HDRSIZE));
+	return msg;
+}
+
+
 void
 _gdp_msg_free(gdp_msg_t **pmsg)
 {
-	ep_dbg_cprintf(Dbg, 24, "_gdp_msg_free(%p)\n", *pmsg);
-	gdp_message__free_unpacked(*pmsg, NULL);
+	gdp_msg_t *msg = *pmsg;
+	struct msg_arena *arena;
+
+	ep_dbg_cprintf(Dbg, 24, "_gdp_msg_free(%p)\n", msg);
 	*pmsg = NULL;
+	if (msg == NULL)
+		return;
+	arena = MSG_ARENA_OF(msg);
+	EP_ASSERT_ELSE(arena->magic == MSG_ARENA_MAGIC, return);
+
+	// frees whatever didn't come from the arena, then the arena
+	gdp_message__free_unpacked(msg, &arena->allocator);
+	arena_release(arena);
 }
 
 
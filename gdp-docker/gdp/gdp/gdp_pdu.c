@@ -91,11 +91,17 @@ done:
 **		Outputs PDU, including all the data in the dbuf.
 */
 
+static size_t
+pack_msg(void *msg, uint8_t *buf)
+{
+	return gdp_message__pack((gdp_msg_t *) msg, buf);
+}
+
 EP_STAT
 _gdp_pdu_out(gdp_pdu_t *pdu, gdp_chan_t *chan)
 {
 	EP_STAT estat = EP_STAT_OK;
-	gdp_buf_t *obuf = NULL;
+	size_t pb_len;
 	int cmd = 0;
 
 	EP_ASSERT_ELSE(pdu != NULL, return EP_STAT_ASSERT_ABORT);
@@ -116,62 +122,23 @@ _gdp_pdu_out(gdp_pdu_t *pdu, gdp_chan_t *chan)
 	}
 
 	pdu->chan = chan;
-	obuf = gdp_buf_new();
 
 	/*
-	**  Protobuf should be ready to go now --- serialize it.
-	**
-	**		Currently uses evbuffer_reserve_space to avoid another
-	**		copy.  Alternative: use evbuffer_add_reference.
+	**  Protobuf should be ready to go now.  It gets serialized
+	**  directly into the channel output buffer (after the header),
+	**  so there is no intermediate buffer to allocate or copy.
 	*/
 
-	if (ep_dbg_test(DbgOut, 1))
-		flockfile(ep_dbg_getfile());
+	pdu->msg->has_rid = (pdu->msg->rid != GDP_PDU_NO_RID);
+	pdu->msg->has_l5seqno = (pdu->msg->l5seqno != GDP_PDU_NO_L5SEQNO);
 
-	{
-		size_t pb_len;
-		int istat;
-		struct evbuffer_iovec v[1];
-
-		pdu->msg->has_rid = (pdu->msg->rid != GDP_PDU_NO_RID);
-		pdu->msg->has_l5seqno = (pdu->msg->l5seqno != GDP_PDU_NO_L5SEQNO);
-
-		// *__get_packed_size has no error returns
-		pb_len = gdp_message__get_packed_size(pdu->msg);
-		ep_dbg_cprintf(Dbg, 24,
-				"_gdp_pdu_out: serialized length %zd, obuf len %zd\n",
-				pb_len, gdp_buf_getlength(obuf));
-		istat =  evbuffer_reserve_space(obuf, pb_len, v, 1);
-		if (istat <= 0)
-		{
-			ep_dbg_cprintf(Dbg, 1,
-					"_gdp_pdu_out: evbuffer_reserve_space(%zd) => %d\n",
-					pb_len, istat);
-			estat = GDP_STAT_PDU_WRITE_FAIL;
-			goto fail1;
-		}
-		if (v[0].iov_len < pb_len)
-		{
-			ep_dbg_cprintf(Dbg, 1,
-					"_gdp_pdu_out: cannot reserve space, need %zd, got %zd\n",
-					pb_len, v[0].iov_len);
-			estat = GDP_STAT_PDU_WRITE_FAIL;
-			goto fail1;
-		}
+	// *__get_packed_size has no error returns
+	pb_len = gdp_message__get_packed_size(pdu->msg);
+	ep_dbg_cprintf(Dbg, 24,
+			"_gdp_pdu_out: serialized length %zd\n", pb_len);
 
-		pb_len = gdp_message__pack(pdu->msg, (uint8_t*) v[0].iov_base);
-		v[0].iov_len = pb_len;
-		istat = evbuffer_commit_space(obuf, v, 1);
-		if (istat < 0)
-		{
-			ep_dbg_cprintf(Dbg, 1,
-					"_gdp_pdu_out: cannot commit space\n");
-			estat = GDP_STAT_PDU_WRITE_FAIL;
-			goto fail1;
-		}
-		ep_dbg_cprintf(Dbg, 24,
-				"_gdp_pdu_out: new obuf len %zd\n", gdp_buf_getlength(obuf));
-	}
+	if (ep_dbg_test(DbgOut, 1))
+		flockfile(ep_dbg_getfile());
 
 	if (ep_dbg_test(DbgOut, 18))
 	{
@@ -193,20 +160,179 @@ _gdp_pdu_out(gdp_pdu_t *pdu, gdp_chan_t *chan)
 		_gdp_pdu_dump(pdu, ep_dbg_getfile(), 1);
 	}
 
-fail1:
 	if (ep_dbg_test(DbgOut, 1))
 		funlockfile(ep_dbg_getfile());
-	if (EP_STAT_ISOK(estat))
+
+	// actually send this all to the channel
+	_gdp_chan_send_packed(chan, NULL, pdu->src, pdu->dst, pb_len,
+				pack_msg, pdu->msg, GDP_PKT_TYPE_REGULAR);
+
+	return estat;
+}
+
+
+/*
+**  _GDP_PDU_SHARED_NEW --- serialize a message body for fan-out
+**  _GDP_PDU_SHARED_FREE --- release a reference to a shared body
+**  _GDP_PDU_SHARED_OUT --- send a shared body to one destination
+**
+**		The message is packed without its rid and l5seqno.  Each send
+**		packs a tiny header message holding just cmd, rid, and l5seqno
+**		and follows it with a reference to the shared body, so the
+**		record itself is neither re-serialized nor copied.  This works
+**		because protobuf parsers merge concatenated messages; the cmd
+**		appears in both parts with the same value.
+**
+**		Each buffer that references the body holds a reference count,
+**		so the body outlives the caller's reference until the last
+**		send has been written to the socket.
+*/
+
+struct gdp_pdu_shared
+{
+	EP_THR_MUTEX		mutex;
+	int					refcnt;
+	GdpMsgCode			cmd;			// for the per-destination header
+	size_t				len;			// length of serialized body
+	uint8_t				*data;			// the serialized body
+};
+
+gdp_pdu_shared_t *
+_gdp_pdu_shared_new(GdpMessage *msg)
+{
+	gdp_pdu_shared_t *sp;
+	protobuf_c_boolean has_rid = msg->has_rid;
+	protobuf_c_boolean has_l5seqno = msg->has_l5seqno;
+
+	sp = (gdp_pdu_shared_t *) ep_mem_zalloc(sizeof *sp);
+	ep_thr_mutex_init(&sp->mutex, EP_THR_MUTEX_DEFAULT);
+	ep_thr_mutex_setorder(&sp->mutex, GDP_MUTEX_LORDER_LEAF);
+	sp->refcnt = 1;
+	sp->cmd = msg->cmd;
+
+	// these go in the per-destination header instead
+	msg->has_rid = msg->has_l5seqno = false;
+	sp->len = gdp_message__get_packed_size(msg);
+	sp->data = (uint8_t *) ep_mem_malloc(sp->len);
+	sp->len = gdp_message__pack(msg, sp->data);
+	msg->has_rid = has_rid;
+	msg->has_l5seqno = has_l5seqno;
+
+	ep_dbg_cprintf(Dbg, 24, "_gdp_pdu_shared_new(%s) => %p, len %zd\n",
+			_gdp_proto_cmd_name(sp->cmd), sp, sp->len);
+	return sp;
+}
+
+// drop one reference, freeing on the last
+static void
+pdu_shared_release(gdp_pdu_shared_t *sp)
+{
+	int refcnt;
+
+	ep_thr_mutex_lock(&sp->mutex);
+	refcnt = --sp->refcnt;
+	ep_thr_mutex_unlock(&sp->mutex);
+	EP_ASSERT(refcnt >= 0);
+	if (refcnt > 0)
+		return;
+
+	ep_dbg_cprintf(Dbg, 48, "pdu_shared_release(%p): freeing\n", sp);
+	ep_thr_mutex_destroy(&sp->mutex);
+	ep_mem_free(sp->data);
+	ep_mem_free(sp);
+}
+
+// called by libevent when a buffer is done with the body
+static void
+pdu_shared_cleanup(const void *data, size_t len, void *arg)
+{
+	pdu_shared_release((gdp_pdu_shared_t *) arg);
+}
+
+void
+_gdp_pdu_shared_free(gdp_pdu_shared_t **psp)
+{
+	gdp_pdu_shared_t *sp = *psp;
+
+	*psp = NULL;
+	if (sp != NULL)
+		pdu_shared_release(sp);
+}
+
+EP_STAT
+_gdp_pdu_shared_out(gdp_pdu_shared_t *sp,
+		gdp_name_t src,
+		gdp_name_t dst,
+		gdp_rid_t rid,
+		gdp_l5seqno_t l5seqno,
+		gdp_chan_t *chan)
+{
+	EP_STAT estat = EP_STAT_OK;
+	GdpMessage hdr;
+	uint8_t hbuf[32];			// cmd, rid, and l5seqno at most
+	size_t hlen;
+	gdp_buf_t *obuf;
+
+	EP_ASSERT_ELSE(sp != NULL, return EP_STAT_ASSERT_ABORT);
+	if (chan == NULL)
 	{
-		// actually send this all to the channel
-		_gdp_chan_send(chan, NULL, pdu->src, pdu->dst, obuf,
-					GDP_PKT_TYPE_REGULAR);
+		ep_dbg_cprintf(Dbg, 1, "_gdp_pdu_shared_out: no channel\n");
+		return GDP_STAT_DEAD_DAEMON;
 	}
+	if (!gdp_name_is_valid(src))
+		src = _GdpMyRoutingName;
+
+	gdp_message__init(&hdr);
+	hdr.cmd = sp->cmd;
+	hdr.rid = rid;
+	hdr.has_rid = (rid != GDP_PDU_NO_RID);
+	hdr.l5seqno = l5seqno;
+	hdr.has_l5seqno = (l5seqno != GDP_PDU_NO_L5SEQNO);
+	EP_ASSERT_ELSE(gdp_message__get_packed_size(&hdr) <= sizeof hbuf,
+			return EP_STAT_ASSERT_ABORT);
+	hlen = gdp_message__pack(&hdr, hbuf);
 
-//fail0:
-	if (obuf != NULL)
-		gdp_buf_free(obuf);
+	obuf = gdp_buf_new();
+	if (evbuffer_add(obuf, hbuf, hlen) < 0)
+	{
+		estat = GDP_STAT_PDU_WRITE_FAIL;
+		goto fail0;
+	}
+
+	// the buffer holds its own reference, dropped by pdu_shared_cleanup
+	ep_thr_mutex_lock(&sp->mutex);
+	sp->refcnt++;
+	ep_thr_mutex_unlock(&sp->mutex);
+	if (evbuffer_add_reference(obuf, sp->data, sp->len,
+				pdu_shared_cleanup, sp) < 0)
+	{
+		pdu_shared_release(sp);
+		estat = GDP_STAT_PDU_WRITE_FAIL;
+		goto fail0;
+	}
+
+	if (ep_dbg_test(DbgOut, 18))
+	{
+		gdp_pname_t dst_p;
+
+		ep_dbg_printf("_gdp_pdu_shared_out, chan = %p: %s rid %" PRIgdp_rid
+				" => %s\n",
+				chan, _gdp_proto_cmd_name(sp->cmd), rid,
+				gdp_printable_name(dst, dst_p));
+	}
+
+	estat = _gdp_chan_send(chan, NULL, src, dst, obuf, GDP_PKT_TYPE_REGULAR);
 
+fail0:
+	// frees the body reference too if the channel didn't take it
+	gdp_buf_free(obuf);
+	if (!EP_STAT_ISOK(estat) && ep_dbg_test(Dbg, 1))
+	{
+		char ebuf[100];
+
+		ep_dbg_printf("_gdp_pdu_shared_out: %s\n",
+				ep_stat_tostr(estat, ebuf, sizeof ebuf));
+	}
 	return estat;
 }
 
@@ -241,7 +367,7 @@ _gdp_pdu_in(
 
 	// unpack Protobuf into local data structure
 	mbuf = gdp_buf_getptr(pbuf, plen);
-	msg = gdp_message__unpack(NULL, plen, mbuf);
+	msg = _gdp_msg_unpack(plen, mbuf);
 	if (msg == NULL)
 	{
 		ep_dbg_cprintf(DbgIn, 1,
@@ -286,7 +412,7 @@ fail1:
 	if (EP_STAT_ISOK(estat))
 		pdu->msg = msg;
 	else if (msg != NULL)
-		gdp_message__free_unpacked(msg, NULL);
+		_gdp_msg_free(&msg);
 	return estat;
 }
 
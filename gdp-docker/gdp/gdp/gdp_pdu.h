@@ -247,6 +247,29 @@ EP_STAT		_gdp_pdu_out(			// send a PDU to a network buffer
 				gdp_pdu_t *,			// the PDU information
 				gdp_chan_t *);			// the network channel
 
+/*
+**  Shared PDU bodies.  A message going to many destinations (e.g.,
+**  subscription fan-out) is serialized once; each send then adds only
+**  its own rid and l5seqno in front of a reference to the shared body.
+*/
+
+typedef struct gdp_pdu_shared	gdp_pdu_shared_t;
+
+gdp_pdu_shared_t
+			*_gdp_pdu_shared_new(	// serialize a message for fan-out
+				GdpMessage *msg);		// the message (rid etc. ignored)
+
+void		_gdp_pdu_shared_free(	// release a shared body
+				gdp_pdu_shared_t **);
+
+EP_STAT		_gdp_pdu_shared_out(	// send a shared body
+				gdp_pdu_shared_t *,		// the serialized body
+				gdp_name_t src,			// source address
+				gdp_name_t dst,			// destination address
+				gdp_rid_t rid,			// request id for this destination
+				gdp_l5seqno_t l5seqno,	// L5 sequence number
+				gdp_chan_t *);			// the network channel
+
 EP_STAT		_gdp_pdu_in(			// read a PDU from a network buffer
 				gdp_pdu_t *,			// the buffer to store the result
 				gdp_buf_t *pbuf,		// the payload (input) buffer
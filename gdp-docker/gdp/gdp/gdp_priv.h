@@ -276,6 +276,11 @@ struct gdp_gin
 							gdp_datum_t *,
 							void *);
 	void				*readfpriv;		// private data for readfilter
+
+	// active events for this GIN; protected by the event module's lock
+	struct gev_list		events;			// ready for gdp_event_next
+	EP_THR_COND			evsig;			// signaled when events arrive
+	int					evwaiters;		// threads waiting on evsig
 };
 
 #define GINF_INUSE			0x0001		// GIN is allocated
@@ -288,8 +293,15 @@ struct gdp_gob
 {
 	EP_THR_MUTEX		mutex;			// lock on this data structure
 	time_t				utime;			// last time used (seconds only)
-	LIST_ENTRY(gdp_gob)	ulist;			// list sorted by use time
+	int					cslot;			// index in cache shard's clock
+	LIST_ENTRY(gdp_gob)	ulist;			// free list
 	struct req_head		reqs;			// list of outstanding requests
+	struct gob_subs
+	{
+		gdp_req_t			**heap;		// min-heap on sub_ts
+		int					n;			// number in use
+		int					alloc;		// number allocated
+	}					subs;			// server-side subscriptions
 	gdp_name_t			name;			// the internal name
 	gdp_pname_t			pname;			// printable name (for debugging)
 	uint16_t			flags;			// flag bits, see below
@@ -573,7 +585,7 @@ void			_gdp_gob_cache_reclaim(		// flush old entries
 void			_gdp_gob_cache_shutdown(	// immediately shut down cache
 						void (*shutdownfunc)(gdp_req_t *));
 
-void			_gdp_gob_touch(				// move to front of LRU list
+void			_gdp_gob_touch(				// mark as recently used
 						gdp_gob_t *gob);
 
 void			_gdp_gob_cache_foreach(		// run over all cached GOBs
@@ -718,6 +730,7 @@ struct gdp_req
 									// do post processing after ack sent
 	EP_TIME_SPEC		act_ts;		// timestamp of last successful activity
 	EP_TIME_SPEC		sub_ts;		// time of current subscription lease start
+	int					sub_heapx;	// index in gob->subs.heap, -1 if none
 	gdp_event_cbfunc_t	sub_cbfunc;	// callback function (subscribe & async I/O)
 	void				*sub_cbarg;	// user-supplied opaque data to cb
 
@@ -768,6 +781,15 @@ void			_gdp_req_unlock(			// unlock a request mutex
 gdp_req_t		*_gdp_req_find(				// find a request in a GOB
 						gdp_gob_t *gob, gdp_rid_t rid);
 
+void			_gdp_req_sub_link(			// add to GOB subscription index
+						gdp_req_t *req);
+
+void			_gdp_req_sub_unlink(		// remove from subscription index
+						gdp_req_t *req);
+
+gdp_req_t		*_gdp_gob_sub_oldest(		// subscription with oldest lease
+						gdp_gob_t *gob);
+
 gdp_rid_t		_gdp_rid_new(				// create new request id
 						gdp_gob_t *gob, gdp_chan_t *chan);
 
@@ -850,6 +872,8 @@ struct event_loop_info
 	const char		*where;
 };
 
+EP_STAT			_gdp_evloop_init(void);		// start event loop thread
+
 void			*_gdp_run_event_loop(
 						void *eli_);
 
@@ -884,6 +908,18 @@ gdp_msg_t		*_gdp_msg_new(				// create new message
 void			_gdp_msg_free(				// free a message
 					gdp_msg_t **pmsg);
 
+gdp_msg_t		*_gdp_msg_unpack(			// deserialize a message
+					size_t len,
+					const uint8_t *data);
+
+void			*_gdp_msg_alloc(			// allocate memory within message
+					gdp_msg_t *msg,
+					size_t size);
+
+void			_gdp_msg_mfree(				// free memory within message
+					gdp_msg_t *msg,
+					void *p);
+
 void			_gdp_msg_dump(				// print a message for debugging
 					const gdp_msg_t *msg,
 					FILE *fp,
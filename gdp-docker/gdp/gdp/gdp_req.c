@@ -168,6 +168,7 @@ _gdp_req_new(gdp_cmd_t cmd,
 	(void) _gdp_req_lock(req);
 	req->stat = EP_STAT_OK;
 	req->flags = flags;
+	req->sub_heapx = -1;
 	req->chan = chan;
 	req->gob = gob;
 	if (gob != NULL)
@@ -305,7 +306,8 @@ _gdp_req_free(gdp_req_t **reqp)
 		_gdp_chan_unlock(req->chan);
 	}
 
-	// remove the request from the GOB list
+	// remove the request from the GOB list and subscription index
+	_gdp_req_sub_unlink(req);
 	if (EP_UT_BITSET(GDP_REQ_ON_GOB_LIST, req->flags))
 	{
 		EP_ASSERT_ELSE(req->gob != NULL, return);
@@ -379,6 +381,7 @@ _gdp_req_freeall(gdp_gob_t *gob,
 		{
 			// couldn't lock the request, so skip it
 			ep_log(estat, "_gdp_req_freeall: couldn't acquire req lock");
+			_gdp_req_sub_unlink(req);
 			LIST_REMOVE(req, goblist);
 			req->flags &= ~GDP_REQ_ON_GOB_LIST;
 			rstat = estat;
@@ -525,6 +528,7 @@ _gdp_req_unsend(gdp_req_t *req)
 				req);
 	}
 	GDP_GOB_ASSERT_ISLOCKED(gob);
+	_gdp_req_sub_unlink(req);
 	LIST_REMOVE(req, goblist);
 	req->flags &= ~GDP_REQ_ON_GOB_LIST;
 
@@ -532,6 +536,126 @@ _gdp_req_unsend(gdp_req_t *req)
 }
 
 
+/*
+**  _GDP_REQ_SUB_LINK --- add a subscription to the GOB index
+**  _GDP_REQ_SUB_UNLINK --- remove a subscription from the GOB index
+**  _GDP_GOB_SUB_OLDEST --- return the subscription with the oldest lease
+**
+**		Server-side subscriptions are kept in a binary min-heap on
+**		sub_ts as well as on the GOB request list.  The heap array
+**		doubles as the set of live subscriptions, so publishing only
+**		walks subscriptions, and since every lease has the same
+**		length the top of the heap is always the next one to expire.
+**
+**		The GOB must be locked.  Leases are never extended in place
+**		(a refresh replaces the request), so the key of an entry does
+**		not change while it is in the heap.
+*/
+
+#define SUB_BEFORE(a, b)	ep_time_before(&(a)->sub_ts, &(b)->sub_ts)
+
+static void
+sub_heap_set(struct gob_subs *subs, int i, gdp_req_t *req)
+{
+	subs->heap[i] = req;
+	req->sub_heapx = i;
+}
+
+static void
+sub_heap_up(struct gob_subs *subs, int i)
+{
+	gdp_req_t *req = subs->heap[i];
+
+	while (i > 0)
+	{
+		int parent = (i - 1) / 2;
+
+		if (!SUB_BEFORE(req, subs->heap[parent]))
+			break;
+		sub_heap_set(subs, i, subs->heap[parent]);
+		i = parent;
+	}
+	sub_heap_set(subs, i, req);
+}
+
+static void
+sub_heap_down(struct gob_subs *subs, int i)
+{
+	gdp_req_t *req = subs->heap[i];
+
+	for (;;)
+	{
+		int child = 2 * i + 1;
+
+		if (child >= subs->n)
+			break;
+		if (child + 1 < subs->n &&
+				SUB_BEFORE(subs->heap[child + 1], subs->heap[child]))
+			child++;
+		if (!SUB_BEFORE(subs->heap[child], req))
+			break;
+		sub_heap_set(subs, i, subs->heap[child]);
+		i = child;
+	}
+	sub_heap_set(subs, i, req);
+}
+
+void
+_gdp_req_sub_link(gdp_req_t *req)
+{
+	struct gob_subs *subs;
+
+	EP_ASSERT_ELSE(req->gob != NULL, return);
+	GDP_GOB_ASSERT_ISLOCKED(req->gob);
+	if (req->sub_heapx >= 0)
+		return;
+
+	subs = &req->gob->subs;
+	if (subs->n >= subs->alloc)
+	{
+		subs->alloc = subs->alloc == 0 ? 16 : subs->alloc * 2;
+		subs->heap = (gdp_req_t **) ep_mem_realloc(subs->heap,
+								subs->alloc * sizeof *subs->heap);
+	}
+	sub_heap_set(subs, subs->n++, req);
+	sub_heap_up(subs, req->sub_heapx);
+}
+
+void
+_gdp_req_sub_unlink(gdp_req_t *req)
+{
+	struct gob_subs *subs;
+	int i = req->sub_heapx;
+
+	if (i < 0)
+		return;
+	EP_ASSERT_ELSE(req->gob != NULL, return);
+	GDP_GOB_ASSERT_ISLOCKED(req->gob);
+
+	subs = &req->gob->subs;
+	EP_ASSERT_ELSE(i < subs->n && subs->heap[i] == req, return);
+	req->sub_heapx = -1;
+	if (i == --subs->n)
+		return;
+
+	// move the last entry into the hole and restore heap order
+	sub_heap_set(subs, i, subs->heap[subs->n]);
+	if (i > 0 && SUB_BEFORE(subs->heap[i], subs->heap[(i - 1) / 2]))
+		sub_heap_up(subs, i);
+	else
+		sub_heap_down(subs, i);
+}
+
+gdp_req_t *
+_gdp_gob_sub_oldest(gdp_gob_t *gob)
+{
+	GDP_GOB_ASSERT_ISLOCKED(gob);
+	if (gob->subs.n == 0)
+		return NULL;
+	return gob->subs.heap[0];
+}
+
+
 /*
 **  _GDP_REQ_FIND --- find a request in a GOB
 **
@@ -99,8 +99,7 @@ subscr_resub(gdp_req_t *req)
 	// req->rpdu might be NULL if _gdp_invoke failed
 	if (req->rpdu != NULL)
 	{
-		gdp_message__free_unpacked(req->rpdu->msg, NULL);
-		req->rpdu->msg = NULL;
+		_gdp_msg_free(&req->rpdu->msg);
 	}
 	if (EP_STAT_ISOK(estat))
 		ep_time_now(&req->sub_ts);
@@ -56,6 +56,7 @@ __BEGIN_DECLS
 uint32_t		GdplogdForgive = 0;			// treatment of gaps and dups
 uint32_t		GdpSignatureStrictness = 0;	// how strongly we enforce signatures
 int				LogdExitStat = EX_SOFTWARE;	// exit status
+struct gob_phys_impl	*GdpLogImpl = &GdpSqliteImpl;	// physical log format
 
 extern const char	GdplogdVersion[];
 __END_DECLS
@@ -377,9 +378,25 @@ main(int argc, char **argv)
 	estat = gdp_lib_init("gdplogd", myname, 0);
 	EP_STAT_CHECK(estat, goto fail0);
 
-	// initialize physical logs (expand this if multiple log implementations)
+	// initialize physical logs; all logs in a deployment use one format
 	phase = "gcl physlog";
-	estat = GdpSqliteImpl.init(NULL);
+	{
+		const char *impl = ep_adm_getstrparam("swarm.gdplogd.log.impl",
+										"sqlite");
+
+		if (strcasecmp(impl, "sqlite") == 0)
+			GdpLogImpl = &GdpSqliteImpl;
+		else if (strcasecmp(impl, "seglog") == 0)
+			GdpLogImpl = &GdpSeglogImpl;
+		else
+		{
+			ep_app_error("unknown swarm.gdplogd.log.impl %s", impl);
+			estat = EP_STAT_ERROR;
+			goto fail0;
+		}
+		ep_dbg_cprintf(Dbg, 1, "Using %s physical log format\n", impl);
+	}
+	estat = GdpLogImpl->init(NULL);
 	EP_STAT_CHECK(estat, goto fail0);
 
 	// initialize the protocol module
@@ -430,6 +447,9 @@ main(int argc, char **argv)
 		GdplogdForgive |= FORGIVE_LOG_DUPS;
 #endif
 
+	// batching of appends into shared transactions
+	logd_commit_init();
+
 	// go into background mode (before creating any threads!)
 	if (!run_in_foreground)
 	{
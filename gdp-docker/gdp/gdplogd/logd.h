@@ -82,6 +82,34 @@ extern uint32_t		GdpSignatureStrictness;		// how strongly we enforce signatures
 */
 
 typedef struct physinfo	gob_physinfo_t;
+
+// queue of appends waiting for a group commit (see logd_commit.c)
+struct gob_commitq
+{
+	EP_THR_MUTEX			mutex;			// protects everything but npending
+	EP_THR_COND				cond;			// signaled when a commit finishes
+	STAILQ_HEAD(, gob_commit_waiter)
+							waiters;		// appends not yet taken by a leader
+	int						nwaiting;		// length of waiters
+	int						nactive;		// threads in gob_commit_append
+	bool					leader;			// a commit is in progress
+	bool					closing;		// gob_commit_free has been called
+	int						nunsettled;		// failed, still counted in npending
+	uint64_t				next_seq;		// next place in line to hand out
+	uint64_t				settled;		// place in line now finishing
+	gdp_req_t				*settling;		// request that is finishing
+	gdp_recno_t				npending;		// queued records (GOB lock)
+};
+
+// notifications are written to subscribers in turn (see logd_pubsub.c)
+struct gob_fanout
+{
+	EP_THR_MUTEX			mutex;
+	EP_THR_COND				cond;			// signaled when a turn ends
+	uint64_t				next_ticket;	// next turn to hand out (GOB lock)
+	uint64_t				serving;		// turn now allowed to send
+};
+
 struct gdp_gob_xtra
 {
 	// declarations relating to semantics
@@ -92,6 +120,12 @@ struct gdp_gob_xtra
 	// physical implementation declarations
 	struct gob_phys_impl	*physimpl;		// physical implementation
 	gob_physinfo_t			*physinfo;		// info needed by physical module
+
+	// group commit of appends
+	struct gob_commitq		commitq;		// appends waiting to be written
+
+	// subscription notifications
+	struct gob_fanout		fanout;			// orders writes to subscribers
 };
 
 
@@ -138,6 +172,26 @@ extern EP_STAT	dispatch_cmd(			// dispatch a request
 					gdp_req_t *req);
 
 
+/*
+**  Group commit of appends
+*/
+
+extern void		logd_commit_init(void);	// read group commit parameters
+
+extern void		gob_commit_init(		// set up commit queue for a GOB
+					gdp_gob_t *gob);
+
+extern void		gob_commit_free(		// drain and free the commit queue
+					gdp_gob_t *gob);
+
+extern EP_STAT	gob_commit_append(		// append records via group commit
+					gdp_req_t *req,
+					GdpDatumList *dl);
+
+extern void		gob_commit_done(		// let the next append finish
+					gdp_req_t *req);
+
+
 /*
 **  Advertisements
 */
@@ -235,6 +289,10 @@ struct gob_phys_impl
 
 // known implementations
 extern struct gob_phys_impl		GdpSqliteImpl;
+extern struct gob_phys_impl		GdpSeglogImpl;
+
+// the one in use (swarm.gdplogd.log.impl)
+extern struct gob_phys_impl		*GdpLogImpl;
 
 
 __END_DECLS
@@ -359,7 +359,7 @@ admin_probe_thread(void *ctx)
 		ep_dbg_cprintf(Dbg, 7, "admin_probe_thread: locked\n");
 		return;
 	}
-	GdpSqliteImpl.foreach(post_one_log, ctx);
+	GdpLogImpl->foreach(post_one_log, ctx);
 	ep_thr_mutex_unlock(&AdminProbeMutex);
 }
 
@@ -172,14 +172,14 @@ logd_advertise_all(gdp_chan_t *chan, int cmd, void *adata_unused)
 									challenge_cb, &advert);
 
 		// ... and all of my logs
-		tstat = GdpSqliteImpl.foreach(advertise_one, &advert);
+		tstat = GdpLogImpl->foreach(advertise_one, &advert);
 	}
 	else
 	{
 		ep_dbg_cprintf(Dbg, 24, "logd_advertise_all(WITHDRAW)\n");
 
 		// withdraw log advertisements ...
-		estat = GdpSqliteImpl.foreach(withdraw_one, &advert);
+		estat = GdpLogImpl->foreach(withdraw_one, &advert);
 
 		// ... and finally myself
 		tstat = _gdp_chan_withdraw(chan, _GdpMyRoutingName, &advert);
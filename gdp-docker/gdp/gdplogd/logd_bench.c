@@ -0,0 +1,338 @@
+/* vim: set ai sw=4 sts=4 ts=4 : */
+
+/*
+**  GDPLOGD-BENCH --- compare physical log implementations
+**
+**		Drives the physical log layer directly (no router, no
+**		protocol) so that only the storage formats are measured.
+**		For each implementation it creates a scratch log, appends
+**		records in transactions the way group commit does, closes
+**		and reopens the log, and then reads it back in ranges, both
+**		by record number and by timestamp.
+**
+**	----- BEGIN LICENSE BLOCK -----
+**	GDPLOGD: Log Daemon for the Global Data Plane
+**	From the Ubiquitous Swarm Lab, 490 Cory Hall, U.C. Berkeley.
+**
+**	Copyright (c) 2015-2019, Regents of the University of California.
+**	All rights reserved.
+**
+**	Permission is hereby granted, without written agreement and without
+**	license or royalty fees, to use, copy, modify, and distribute this
+**	software and its documentation for any purpose, provided that the above
+**	copyright notice and the following two paragraphs appear in all copies
+**	of this software.
+**
+**	IN NO EVENT SHALL REGENTS BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT,
+**	SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES, INCLUDING LOST
+**	PROFITS, ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION,
+**	EVEN IF REGENTS HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**
+**	REGENTS SPECIFICALLY DISCLAIMS ANY WARRANTIES, INCLUDING, BUT NOT
+**	LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+**	FOR A PARTICULAR PURPOSE. THE SOFTWARE AND ACCOMPANYING DOCUMENTATION,
+**	IF ANY, PROVIDED HEREUNDER IS PROVIDED "AS IS". REGENTS HAS NO
+**	OBLIGATION TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS,
+**	OR MODIFICATIONS.
+**	----- END LICENSE BLOCK -----
+*/
+
+#include "logd.h"
+
+#include <gdp/gdp_md.h>
+
+#include <ep/ep_app.h>
+#include <ep/ep_crypto.h>
+#include <ep/ep_dbg.h>
+#include <ep/ep_time.h>
+
+#include <getopt.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sysexits.h>
+
+// counts what the read callbacks see
+struct gdp_result_ctx
+{
+	uint64_t		nrecs;
+	uint64_t		nbytes;
+	gdp_recno_t		last_recno;
+};
+
+static struct
+{
+	const char				*name;
+	struct gob_phys_impl	*impl;
+} Impls[] =
+{
+	{ "sqlite",		&GdpSqliteImpl		},
+	{ "seglog",		&GdpSeglogImpl		},
+	{ NULL,			NULL				},
+};
+
+
+static EP_STAT
+count_result(EP_STAT estat, gdp_datum_t *datum, gdp_result_ctx_t *ctx)
+{
+	ctx->nrecs++;
+	ctx->nbytes += gdp_buf_getlength(datum->dbuf);
+	ctx->last_recno = datum->recno;
+	return EP_STAT_OK;
+}
+
+
+static double
+elapsed(EP_TIME_SPEC *start)
+{
+	EP_TIME_SPEC now;
+
+	ep_time_now(&now);
+	return ep_time_diff_usec(start, &now) / 1e6;
+}
+
+
+static void
+rate(const char *what, uint64_t n, uint64_t nbytes, double secs)
+{
+	printf("    %-16s %10" PRIu64 " recs %8.3f s %12.1f recs/s %8.1f MB/s\n",
+			what, n, secs,
+			secs > 0 ? n / secs : 0.0,
+			secs > 0 ? nbytes / secs / (1024 * 1024) : 0.0);
+}
+
+
+/*
+**  NEW_GOB --- create an in-memory GOB with fresh metadata and name
+*/
+
+static EP_STAT
+new_gob(struct gob_phys_impl *impl, gdp_gob_t **pgob)
+{
+	EP_STAT estat;
+	gdp_md_t *gmd;
+	gdp_name_t gname;
+	gdp_gob_t *gob;
+	uint8_t nonce[16];
+
+	gmd = gdp_md_new(0);
+	ep_crypto_random_buf(nonce, sizeof nonce);
+	gdp_md_add(gmd, GDP_MD_NONCE, sizeof nonce, nonce);
+	gdp_md_add(gmd, GDP_MD_XID, 12, "logd-bench");
+	estat = _gdp_md_to_gdpname(gmd, &gname, NULL);
+	EP_STAT_CHECK(estat, return estat);
+
+	estat = _gdp_gob_new(gname, &gob);
+	EP_STAT_CHECK(estat, return estat);
+	gob->gob_md = gmd;
+	gob->x = ep_mem_zalloc(sizeof *gob->x);
+	gob->x->gob = gob;
+	gob->x->physimpl = impl;
+	*pgob = gob;
+	return EP_STAT_OK;
+}
+
+
+/*
+**  RUN_ONE --- benchmark one implementation
+*/
+
+static EP_STAT
+run_one(const char *name,
+		struct gob_phys_impl *impl,
+		int nrecs,
+		int recsize,
+		int xactsize,
+		int readsize,
+		bool keep)
+{
+	EP_STAT estat;
+	gdp_gob_t *gob;
+	EP_TIME_SPEC start;
+	EP_TIME_SPEC mid_ts;
+	struct gdp_result_ctx ctx;
+	int i;
+
+	printf("%s:\n", name);
+	estat = new_gob(impl, &gob);
+	EP_STAT_CHECK(estat, return estat);
+	estat = impl->create(gob, gob->gob_md);
+	EP_STAT_CHECK(estat, return estat);
+
+	// appends, in transactions of xactsize records
+	char *rec = ep_mem_malloc(recsize + 1);
+	memset(rec, 'x', recsize);
+	gdp_datum_t *datum = gdp_datum_new();
+	ep_time_now(&start);
+	for (i = 0; i < nrecs && EP_STAT_ISOK(estat); )
+	{
+		int j;
+
+		if (impl->xact_begin != NULL)
+			estat = impl->xact_begin(gob);
+		for (j = 0; j < xactsize && i < nrecs && EP_STAT_ISOK(estat); j++, i++)
+		{
+			gdp_datum_reset(datum);
+			datum->recno = i + 1;
+			ep_time_now(&datum->ts);
+			if (i == nrecs / 2)
+				mid_ts = datum->ts;
+			gdp_buf_write(datum->dbuf, rec, recsize);
+			estat = impl->append(gob, datum);
+		}
+		if (EP_STAT_ISOK(estat) && impl->xact_end != NULL)
+			estat = impl->xact_end(gob);
+	}
+	rate("append", i, (uint64_t) i * recsize, elapsed(&start));
+	gdp_datum_free(datum);
+	ep_mem_free(rec);
+	EP_STAT_CHECK(estat, goto fail0);
+
+	// close and reopen so reads come from the files, not from state
+	// left over from the appends
+	impl->close(gob);
+	ep_time_now(&start);
+	estat = impl->open(gob);
+	EP_STAT_CHECK(estat, goto fail0);
+	printf("    %-16s %8.3f s\n", "reopen", elapsed(&start));
+
+	// range reads by record number
+	memset(&ctx, 0, sizeof ctx);
+	ep_time_now(&start);
+	while (ctx.nrecs < (uint64_t) nrecs)
+	{
+		uint64_t before = ctx.nrecs;
+
+		(void) impl->read_by_recno(gob, ctx.nrecs + 1, readsize,
+							count_result, &ctx);
+		if (ctx.nrecs == before)
+			break;
+	}
+	rate("read by recno", ctx.nrecs, ctx.nbytes, elapsed(&start));
+	if (ctx.nrecs != (uint64_t) nrecs)
+		printf("    (expected %d records)\n", nrecs);
+
+	// one range read by timestamp covering the second half of the log
+	memset(&ctx, 0, sizeof ctx);
+	ep_time_now(&start);
+	(void) impl->read_by_timestamp(gob, &mid_ts, nrecs, count_result, &ctx);
+	rate("read by time", ctx.nrecs, ctx.nbytes, elapsed(&start));
+
+fail0:
+	if (!keep)
+	{
+		impl->close(gob);
+		impl->remove(gob);
+	}
+	else
+	{
+		printf("    kept log %s\n", gob->pname);
+		impl->close(gob);
+	}
+	return estat;
+}
+
+
+void
+usage(void)
+{
+	fprintf(stderr,
+			"Usage: %s [-D dbgspec] [-d dir] [-i impl] [-k] [-n nrecs]\n"
+			"\t[-r readsize] [-s size] [-x xactsize]\n"
+			"    -D  set debugging flags\n"
+			"    -d  directory for scratch logs (default: swarm.gdplogd.log.dir)\n"
+			"    -i  only run this implementation (sqlite or seglog)\n"
+			"    -k  keep the logs instead of removing them\n"
+			"    -n  number of records (default 100000)\n"
+			"    -r  records per range read (default 1000)\n"
+			"    -s  size of each record in bytes (default 100)\n"
+			"    -x  records per transaction (default 32)\n",
+			ep_app_getprogname());
+	exit(EX_USAGE);
+}
+
+
+int
+main(int argc, char **argv)
+{
+	EP_STAT estat = EP_STAT_OK;
+	const char *log_dir = NULL;
+	const char *only = NULL;
+	bool keep = false;
+	int nrecs = 100000;
+	int readsize = 1000;
+	int recsize = 100;
+	int xactsize = 32;
+	bool show_usage = false;
+	int opt;
+	int i;
+
+	while ((opt = getopt(argc, argv, "D:d:i:kn:r:s:x:")) > 0)
+	{
+		switch (opt)
+		{
+		 case 'D':
+			ep_dbg_set(optarg);
+			break;
+
+		 case 'd':
+			log_dir = optarg;
+			break;
+
+		 case 'i':
+			only = optarg;
+			break;
+
+		 case 'k':
+			keep = true;
+			break;
+
+		 case 'n':
+			nrecs = atoi(optarg);
+			break;
+
+		 case 'r':
+			readsize = atoi(optarg);
+			break;
+
+		 case 's':
+			recsize = atoi(optarg);
+			break;
+
+		 case 'x':
+			xactsize = atoi(optarg);
+			break;
+
+		 default:
+			show_usage = true;
+			break;
+		}
+	}
+	argc -= optind;
+	argv += optind;
+
+	if (show_usage || argc != 0 || nrecs <= 0 || recsize < 0 ||
+			readsize < 1 || xactsize < 1)
+		usage();
+
+	estat = gdp_init_phase_0(NULL, 0);
+	EP_STAT_CHECK(estat, goto fail0);
+	ep_adm_readparams("gdplogd");
+
+	printf("%d records of %d bytes, %d per transaction, reads of %d\n",
+			nrecs, recsize, xactsize, readsize);
+	for (i = 0; Impls[i].name != NULL; i++)
+	{
+		if (only != NULL && strcmp(only, Impls[i].name) != 0)
+			continue;
+		estat = Impls[i].impl->init(log_dir);
+		EP_STAT_CHECK(estat, break);
+		estat = run_one(Impls[i].name, Impls[i].impl,
+						nrecs, recsize, xactsize, readsize, keep);
+		EP_STAT_CHECK(estat, break);
+	}
+
+fail0:
+	if (!EP_STAT_ISOK(estat))
+		ep_app_message(estat, "exiting with status");
+	return !EP_STAT_ISOK(estat);
+}
@@ -0,0 +1,415 @@
+/* vim: set ai sw=4 sts=4 ts=4 : */
+
+/*
+**  Group commit of appends
+**
+**		Each append used to run in its own transaction, so every request
+**		paid for its own journal write.  Instead, appends to a GOB are
+**		queued and one thread (the "leader") writes everything queued
+**		so far in a single transaction while the others wait.  Appends
+**		that arrive while a commit is in progress pile up behind it and
+**		go out together in the next one.
+**
+**		Appends normally arrive through the per-log serial queue (see
+**		_gdp_pdu_process), which would only ever hand us one at a time.
+**		Once an append is in the commit queue its place in the log is
+**		fixed, so it releases the serial queue and the appends behind
+**		it can join the same batch.  They still finish (bump nrecs,
+**		notify subscribers) in the order they were queued.
+**
+**	----- BEGIN LICENSE BLOCK -----
+**	GDPLOGD: Log Daemon for the Global Data Plane
+**	From the Ubiquitous Swarm Lab, 490 Cory Hall, U.C. Berkeley.
+**
+**	Copyright (c) 2015-2019, Regents of the University of California.
+**	All rights reserved.
+**
+**	Permission is hereby granted, without written agreement and without
+**	license or royalty fees, to use, copy, modify, and distribute this
+**	software and its documentation for any purpose, provided that the above
+**	copyright notice and the following two paragraphs appear in all copies
+**	of this software.
+**
+**	IN NO EVENT SHALL REGENTS BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT,
+**	SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES, INCLUDING LOST
+**	PROFITS, ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION,
+**	EVEN IF REGENTS HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**
+**	REGENTS SPECIFICALLY DISCLAIMS ANY WARRANTIES, INCLUDING, BUT NOT
+**	LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+**	FOR A PARTICULAR PURPOSE. THE SOFTWARE AND ACCOMPANYING DOCUMENTATION,
+**	IF ANY, PROVIDED HEREUNDER IS PROVIDED "AS IS". REGENTS HAS NO
+**	OBLIGATION TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS,
+**	OR MODIFICATIONS.
+**	----- END LICENSE BLOCK -----
+*/
+
+#include "logd.h"
+
+#include <ep/ep_dbg.h>
+#include <ep/ep_thr.h>
+#include <ep/ep_time.h>
+
+static EP_DBG	Dbg = EP_DBG_INIT("gdplogd.commit", "GDP Log Daemon group commit");
+
+
+static int		CommitMaxBatch;			// max requests per transaction
+static long		CommitMaxDelay;			// max usec to hold a batch open
+
+/*
+**  One of these lives on the stack of each thread in gob_commit_append.
+*/
+
+struct gob_commit_waiter
+{
+	STAILQ_ENTRY(gob_commit_waiter)	next;
+	GdpDatumList		*dl;			// the records to append
+	uint64_t			seq;			// place in line
+	EP_STAT				stat;			// result of the commit
+	bool				done;			// set when stat is valid
+};
+
+
+/*
+**  LOGD_COMMIT_INIT --- read group commit parameters
+*/
+
+void
+logd_commit_init(void)
+{
+	CommitMaxBatch = ep_adm_getintparam(
+							"swarm.gdplogd.append.group-commit.max-batch",
+							256);
+	if (CommitMaxBatch < 1)
+		CommitMaxBatch = 1;
+	CommitMaxDelay = ep_adm_getlongparam(
+							"swarm.gdplogd.append.group-commit.max-delay",
+							0);
+	ep_dbg_cprintf(Dbg, 8, "group commit: max-batch %d, max-delay %ld us\n",
+			CommitMaxBatch, CommitMaxDelay);
+}
+
+
+/*
+**  GOB_COMMIT_INIT --- initialize the commit queue for a GOB
+**  GOB_COMMIT_FREE --- wait for commits to drain and release the queue
+**
+**		gob_commit_free must be called with the GOB locked, which
+**		keeps any new appends out.  Appends that are already queued
+**		do not need the GOB lock to finish, but they can't wait for
+**		their turn to finish either, since that needs the GOB lock.
+*/
+
+void
+gob_commit_init(gdp_gob_t *gob)
+{
+	struct gob_commitq *cq = &gob->x->commitq;
+
+	ep_thr_mutex_init(&cq->mutex, EP_THR_MUTEX_DEFAULT);
+	ep_thr_mutex_setorder(&cq->mutex, GDP_MUTEX_LORDER_LEAF);
+	ep_thr_cond_init(&cq->cond);
+	STAILQ_INIT(&cq->waiters);
+}
+
+void
+gob_commit_free(gdp_gob_t *gob)
+{
+	struct gob_commitq *cq = &gob->x->commitq;
+
+	ep_thr_mutex_lock(&cq->mutex);
+	cq->closing = true;
+	ep_thr_cond_broadcast(&cq->cond);
+	while (cq->nactive > 0)
+		ep_thr_cond_wait(&cq->cond, &cq->mutex, NULL);
+	ep_thr_mutex_unlock(&cq->mutex);
+
+	ep_thr_cond_destroy(&cq->cond);
+	ep_thr_mutex_destroy(&cq->mutex);
+}
+
+
+/*
+**  COMMIT_XACT --- write N queued appends in one transaction
+**
+**		Returns the status of the transaction as a whole; the
+**		individual waiters are not updated.
+*/
+
+static EP_STAT
+commit_xact(gdp_gob_t *gob,
+		struct gob_commit_waiter *w,
+		int n,
+		gdp_datum_t *datum)
+{
+	struct gob_phys_impl *physimpl = gob->x->physimpl;
+	EP_STAT estat = EP_STAT_OK;
+
+	if (physimpl->xact_begin != NULL)
+		estat = physimpl->xact_begin(gob);
+	EP_STAT_CHECK(estat, return estat);
+
+	for (; n-- > 0 && EP_STAT_ISOK(estat); w = STAILQ_NEXT(w, next))
+	{
+		int rx;
+
+		for (rx = 0; rx < w->dl->n_d; rx++)
+		{
+			GdpDatum *pbd = w->dl->d[rx];
+
+			_gdp_datum_from_pb(datum, pbd, pbd->sig);
+			estat = physimpl->append(gob, datum);
+			EP_STAT_CHECK(estat, break);
+		}
+	}
+
+	if (EP_STAT_ISOK(estat))
+	{
+		if (physimpl->xact_end != NULL)
+			estat = physimpl->xact_end(gob);
+	}
+	else
+	{
+		if (physimpl->xact_abort != NULL)
+			(void) physimpl->xact_abort(gob);
+	}
+	return estat;
+}
+
+
+/*
+**  COMMIT_LEAD --- take a batch off the queue and commit it
+**
+**		Called with the queue mutex held and the GOB unlocked; returns
+**		the same way with every waiter in the batch marked done.
+**
+**		If the batch as a whole fails, the requests are retried one
+**		at a time so that one bad append doesn't take the ones ahead
+**		of it down too.  Requests behind a failure can't be written:
+**		cmd_append numbered their records as though the failed ones
+**		would be there, so they would leave a gap.  For the same
+**		reason everything still in the queue fails as well, as does
+**		anything queued until the failed records have been taken
+**		back out of npending (see gob_commit_append).
+*/
+
+static void
+commit_lead(gdp_gob_t *gob, struct gob_commitq *cq)
+{
+	STAILQ_HEAD(, gob_commit_waiter) batch = STAILQ_HEAD_INITIALIZER(batch);
+	struct gob_commit_waiter *w;
+	int n = 0;
+
+	// optionally hold the batch open to let more appends join
+	if (CommitMaxDelay > 0 && cq->nwaiting < CommitMaxBatch)
+	{
+		EP_TIME_SPEC delta, abs_to;
+
+		ep_time_from_nsec(CommitMaxDelay * INT64_C(1000), &delta);
+		ep_time_deltanow(&delta, &abs_to);
+		while (cq->nwaiting < CommitMaxBatch)
+		{
+			if (ep_thr_cond_wait(&cq->cond, &cq->mutex, &abs_to) != 0)
+				break;
+		}
+	}
+
+	while (n < CommitMaxBatch && (w = STAILQ_FIRST(&cq->waiters)) != NULL)
+	{
+		STAILQ_REMOVE_HEAD(&cq->waiters, next);
+		STAILQ_INSERT_TAIL(&batch, w, next);
+		n++;
+	}
+	cq->nwaiting -= n;
+	ep_thr_mutex_unlock(&cq->mutex);
+
+	ep_dbg_cprintf(Dbg, 20, "commit_lead(%s): %d request%s\n",
+			gob->pname, n, n == 1 ? "" : "s");
+
+	gdp_datum_t *datum = gdp_datum_new();
+	EP_STAT estat = commit_xact(gob, STAILQ_FIRST(&batch), n, datum);
+	int nfailed = 0;
+	if (EP_STAT_ISOK(estat))
+	{
+		STAILQ_FOREACH(w, &batch, next)
+			w->stat = estat;
+	}
+	else
+	{
+		if (n > 1)
+			ep_dbg_cprintf(Dbg, 5,
+					"commit_lead(%s): batch of %d failed, retrying singly\n",
+					gob->pname, n);
+		STAILQ_FOREACH(w, &batch, next)
+		{
+			if (nfailed > 0)
+				w->stat = GDP_STAT_RECNO_SEQ_ERROR;
+			else if (n == 1)
+				w->stat = estat;
+			else
+				w->stat = commit_xact(gob, w, 1, datum);
+			if (!EP_STAT_ISOK(w->stat))
+				nfailed++;
+		}
+	}
+	gdp_datum_free(datum);
+
+	ep_thr_mutex_lock(&cq->mutex);
+	STAILQ_FOREACH(w, &batch, next)
+		w->done = true;
+	if (nfailed > 0)
+	{
+		// nothing queued behind a failure can be written either
+		while ((w = STAILQ_FIRST(&cq->waiters)) != NULL)
+		{
+			STAILQ_REMOVE_HEAD(&cq->waiters, next);
+			w->stat = GDP_STAT_RECNO_SEQ_ERROR;
+			w->done = true;
+			nfailed++;
+		}
+		cq->nwaiting = 0;
+		cq->nunsettled += nfailed;
+		ep_dbg_cprintf(Dbg, 5, "commit_lead(%s): %d request%s failed\n",
+				gob->pname, nfailed, nfailed == 1 ? "" : "s");
+	}
+}
+
+
+/*
+**  GOB_COMMIT_APPEND --- append records through the group commit queue
+**
+**		Called from cmd_append with req and req->gob locked, and
+**		returns the same way.  The GOB is unlocked while waiting so
+**		that other appends can queue up behind this one.  Unless it
+**		fails before being queued, the caller must call
+**		gob_commit_done once it has notified subscribers.
+**
+**		Both the number of records still in the queue (npending)
+**		and gob->nrecs are only changed with the GOB locked, so
+**		cmd_append can use their sum to check record sequencing
+**		without looking at the queue.  That sum is too high while
+**		any failed request hasn't yet removed its records from
+**		npending (nunsettled > 0), so anything that arrives then
+**		fails at once, without being queued or counted.
+*/
+
+EP_STAT
+gob_commit_append(gdp_req_t *req, GdpDatumList *dl)
+{
+	gdp_gob_t *gob = req->gob;
+	struct gob_commitq *cq = &gob->x->commitq;
+	struct gob_commit_waiter w;
+
+	GDP_GOB_ASSERT_ISLOCKED(gob);
+	EP_THR_MUTEX_ASSERT_ISLOCKED(&req->mutex);
+
+	memset(&w, 0, sizeof w);
+	w.dl = dl;
+	w.stat = EP_STAT_OK;
+
+	ep_thr_mutex_lock(&cq->mutex);
+	if (cq->nunsettled > 0)
+	{
+		// numbered after records that are never going to be written
+		ep_thr_mutex_unlock(&cq->mutex);
+		ep_dbg_cprintf(Dbg, 30,
+				"gob_commit_append(%s): follows a failed append\n",
+				gob->pname);
+		return GDP_STAT_RECNO_SEQ_ERROR;
+	}
+	cq->npending += dl->n_d;
+	w.seq = cq->next_seq++;
+	STAILQ_INSERT_TAIL(&cq->waiters, &w, next);
+	cq->nactive++;
+	if (++cq->nwaiting >= CommitMaxBatch)
+		ep_thr_cond_broadcast(&cq->cond);	// a leader may be waiting on us
+	_gdp_gob_unlock(gob);
+
+	// our place is fixed; let the next command for this log in
+	ep_thr_mutex_unlock(&cq->mutex);
+	ep_thr_pool_serial_release();
+	ep_thr_mutex_lock(&cq->mutex);
+
+	while (!w.done)
+	{
+		if (cq->leader)
+		{
+			ep_thr_cond_wait(&cq->cond, &cq->mutex, NULL);
+			continue;
+		}
+
+		cq->leader = true;
+		commit_lead(gob, cq);
+		cq->leader = false;
+		ep_thr_cond_broadcast(&cq->cond);
+	}
+
+	// finish in the order we were queued
+	while (cq->settled != w.seq && !cq->closing)
+		ep_thr_cond_wait(&cq->cond, &cq->mutex, NULL);
+	if (!cq->closing)
+		cq->settling = req;
+
+	// past here the queue may be torn down by gob_commit_free
+	if (--cq->nactive == 0)
+		ep_thr_cond_broadcast(&cq->cond);
+	ep_thr_mutex_unlock(&cq->mutex);
+
+	// have to unlock the req so lock ordering is right
+	_gdp_req_unlock(req);
+	_gdp_gob_lock(gob);
+	_gdp_req_lock(req);
+
+	if (gob->x != NULL)
+	{
+		cq = &gob->x->commitq;
+		cq->npending -= dl->n_d;
+		if (!EP_STAT_ISOK(w.stat))
+		{
+			// npending is right again as far as we're concerned
+			ep_thr_mutex_lock(&cq->mutex);
+			cq->nunsettled--;
+			ep_thr_mutex_unlock(&cq->mutex);
+		}
+	}
+	if (EP_STAT_ISOK(w.stat))
+		gob->nrecs += dl->n_d;
+
+	if (ep_dbg_test(Dbg, 30))
+	{
+		char ebuf[100];
+		ep_dbg_printf("gob_commit_append(%s): %d record%s, %s\n",
+				gob->pname, (int) dl->n_d, dl->n_d == 1 ? "" : "s",
+				ep_stat_tostr(w.stat, ebuf, sizeof ebuf));
+	}
+	return w.stat;
+}
+
+
+/*
+**  GOB_COMMIT_DONE --- let the next append finish
+**
+**		Called from cmd_append with req and req->gob locked once
+**		subscribers have been told about the new records, so that
+**		they hear about them in record number order.  Does nothing
+**		if this request doesn't hold the turn.
+*/
+
+void
+gob_commit_done(gdp_req_t *req)
+{
+	gdp_gob_t *gob = req->gob;
+	struct gob_commitq *cq;
+
+	GDP_GOB_ASSERT_ISLOCKED(gob);
+	if (gob->x == NULL)
+		return;				// queue is gone
+	cq = &gob->x->commitq;
+	ep_thr_mutex_lock(&cq->mutex);
+	if (cq->settling == req)
+	{
+		cq->settling = NULL;
+		cq->settled++;
+		ep_thr_cond_broadcast(&cq->cond);
+	}
+	ep_thr_mutex_unlock(&cq->mutex);
+}
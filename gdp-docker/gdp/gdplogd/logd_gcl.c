@@ -59,9 +59,11 @@ gob_alloc(gdp_name_t gob_name, gdp_iomode_t iomode, gdp_gob_t **pgob)
 		goto fail0;
 	}
 	gob->x->gob = gob;
+	gob_commit_init(gob);
+	sub_fanout_init(gob);
 
 	//XXX for now, assume all GOBs are on disk
-	gob->x->physimpl = &GdpSqliteImpl;
+	gob->x->physimpl = GdpLogImpl;
 
 	// make sure that if this is freed it gets removed from GclsByUse
 	gob->freefunc = gob_close;
@@ -87,6 +89,10 @@ gob_close(gdp_gob_t *gob)
 	if (gob->x == NULL)
 		return;
 
+	// let any appends in progress finish writing
+	gob_commit_free(gob);
+	sub_fanout_free(gob);
+
 	// close the underlying files and free memory as needed
 	if (gob->x->physimpl->close != NULL)
 		gob->x->physimpl->close(gob);
@@ -110,6 +116,10 @@ gob_delete(gdp_gob_t *gob)
 	if (gob->x == NULL)
 		return;
 
+	// let any appends in progress finish writing
+	gob_commit_free(gob);
+	sub_fanout_free(gob);
+
 	// close the underlying files and free memory as needed
 	if (gob->x->physimpl->close != NULL)
 		gob->x->physimpl->close(gob);
@@ -145,9 +155,11 @@ do_physical_open(gdp_gob_t *gob, void *open_info_)
 
 	gob->x = (struct gdp_gob_xtra *) ep_mem_zalloc(sizeof *gob->x);
 	gob->x->gob = gob;
+	gob_commit_init(gob);
+	sub_fanout_init(gob);
 
 	//XXX for now, assume all GOBs are on disk
-	gob->x->physimpl = &GdpSqliteImpl;
+	gob->x->physimpl = GdpLogImpl;
 
 	// make sure that if this is freed it gets removed from GclsByUse
 	gob->freefunc = gob_close;
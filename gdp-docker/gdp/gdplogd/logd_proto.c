@@ -487,8 +487,9 @@ make_read_acknak_pdu(gdp_req_t *req, EP_STAT estat)
 		resp->dl->n_d = 1;		//FIXME: should handle multiples
 		EP_ASSERT(resp->dl->d == NULL);
 		GdpDatum *pbd;
-		resp->dl->d = ep_mem_malloc(resp->dl->n_d * sizeof pbd);
-		resp->dl->d[0] = pbd = ep_mem_malloc(sizeof *pbd);
+		resp->dl->d = _gdp_msg_alloc(req->rpdu->msg,
+								resp->dl->n_d * sizeof pbd);
+		resp->dl->d[0] = pbd = _gdp_msg_alloc(req->rpdu->msg, sizeof *pbd);
 		gdp_datum__init(pbd);
 	}
 	else if (EP_STAT_IS_SAME(estat, GDP_STAT_NAK_NOTFOUND))
@@ -645,12 +646,15 @@ cmd_append(gdp_req_t *req)
 							"cmd_append: no data", GDP_STAT_NAK_BADREQ);
 	}
 
+	// records still waiting for a group commit count as written
+	gdp_recno_t nrecs = req->gob->nrecs + req->gob->x->commitq.npending;
+
 	// verify that the records in this payload link to each other
 	int rx;
 	GdpDatum *pbd;
-	for (rx = 0; rx < payload->dl->n_d; rx++)
+	for (rx = 0; rx < payload->dl->n_d; rx++, nrecs++)
 	{
-		pbd = payload->dl->d[rx++];
+		pbd = payload->dl->d[rx];
 
 		// FIXME: check hash of previous record matches prevhash in this record
 
@@ -666,7 +670,7 @@ cmd_append(gdp_req_t *req)
 			goto fail0;
 		}
 
-		if (pbd->recno != (gdp_recno_t) (req->gob->nrecs + 1))
+		if (pbd->recno != nrecs + 1)
 		{
 			bool random_order_ok = EP_UT_BITSET(FORGIVE_LOG_GAPS, GdplogdForgive) &&
 								EP_UT_BITSET(FORGIVE_LOG_DUPS, GdplogdForgive);
@@ -676,10 +680,10 @@ cmd_append(gdp_req_t *req)
 							"cmd_append: record out of sequence: got %"
 							PRIgdp_recno ", expected %" PRIgdp_recno "\n"
 							"\ton log %s\n",
-							pbd->recno, req->gob->nrecs + 1,
+							pbd->recno, nrecs + 1,
 							req->gob->pname);
 
-			if (pbd->recno <= (gdp_recno_t) req->gob->nrecs)
+			if (pbd->recno <= nrecs)
 			{
 				// may be a duplicate append, or just filling in a gap
 				// (should probably see if duplicates are the same data)
@@ -697,7 +701,7 @@ cmd_append(gdp_req_t *req)
 					goto fail0;
 				}
 			}
-			else if (pbd->recno > (gdp_recno_t) (req->gob->nrecs + 1) &&
+			else if (pbd->recno > nrecs + 1 &&
 					!EP_UT_BITSET(FORGIVE_LOG_GAPS, GdplogdForgive))
 			{
 				// gap in record numbers
@@ -757,54 +761,32 @@ cmd_append(gdp_req_t *req)
 		estat = EP_STAT_OK;
 	}
 
-	// append records to long term storage
-	if (req->gob->x->physimpl->xact_begin != NULL)
-		req->gob->x->physimpl->xact_begin(req->gob);
-	for (rx = 0; rx < payload->dl->n_d; rx++)
-	{
-		pbd = payload->dl->d[rx++];
-		if (payload->dl->n_d != 1)
-			_gdp_datum_from_pb(datum, pbd, pbd->sig);
-		// else it is already set from above
-
-		// do the physical append to disk
-		estat = req->gob->x->physimpl->append(req->gob, datum);
-		if (!EP_STAT_ISOK(estat))
-			break;
-	}
-	if (EP_STAT_ISOK(estat))
-	{
-		if (req->gob->x->physimpl->xact_end != NULL)
-			req->gob->x->physimpl->xact_end(req->gob);
-	}
-	else
-	{
-		if (req->gob->x->physimpl->xact_abort != NULL)
-			req->gob->x->physimpl->xact_abort(req->gob);
-	}
+	// append records to long term storage (may release the GOB lock)
+	estat = gob_commit_append(req, payload->dl);
 
 	// if physical appends succeeded, notify subscribers
 	if (EP_STAT_ISOK(estat))
 	{
 		for (rx = 0; rx < payload->dl->n_d; rx++)
 		{
-			pbd = payload->dl->d[rx++];
+			pbd = payload->dl->d[rx];
 			if (payload->dl->n_d != 1)
 				_gdp_datum_from_pb(datum, pbd, pbd->sig);
 			// else it is already set from above
 
 			// send the new datum to any and all subscribers
-			GdpDatum *pbd = ep_mem_malloc(sizeof *pbd);
-			gdp_datum__init(pbd);
+			// (may release the GOB lock)
 			gdp_msg_t *msg = _gdp_msg_new(GDP_ACK_CONTENT,
 										req->cpdu->msg->rid,
 										req->cpdu->msg->l5seqno);
+			GdpDatum *pbd = _gdp_msg_alloc(msg, sizeof *pbd);
+			gdp_datum__init(pbd);
 
 			_gdp_datum_to_pb(datum, msg, pbd);
 
 			//FIXME: does dl ever get used or freed?
 			GdpDatumList *dl = msg->ack_content->dl;
-			dl->d = ep_mem_malloc(payload->dl->n_d * sizeof pbd);
+			dl->d = _gdp_msg_alloc(msg, payload->dl->n_d * sizeof pbd);
 			dl->n_d = 1;
 			dl->d[0] = pbd;
 
@@ -815,18 +797,27 @@ cmd_append(gdp_req_t *req)
 			_gdp_pdu_free(&req->rpdu);
 		}
 	}
+	gob_commit_done(req);
 	gdp_datum_free(datum);
 
 	if (EP_STAT_ISOK(estat))
 	{
-		// update the server's view of the number of records
-		req->gob->nrecs++;
-
+		// gob->nrecs has already been updated by gob_commit_append
 		_gdp_req_ack_resp(req, GDP_ACK_SUCCESS);
 		GdpMessage__AckSuccess *resp = req->rpdu->msg->ack_success;
-		resp->recno = req->gob->nrecs;
-		resp->ts = pbd->ts;
-		pbd->ts = NULL;		// avoid double free
+		resp->recno = pbd->recno;
+		if (pbd->ts != NULL)
+		{
+			// copy: the command and response are in different arenas
+			resp->ts = _gdp_msg_alloc(req->rpdu->msg, sizeof *resp->ts);
+			gdp_timestamp__init(resp->ts);
+			resp->ts->has_sec = pbd->ts->has_sec;
+			resp->ts->sec = pbd->ts->sec;
+			resp->ts->has_nsec = pbd->ts->has_nsec;
+			resp->ts->nsec = pbd->ts->nsec;
+			resp->ts->has_accuracy = pbd->ts->has_accuracy;
+			resp->ts->accuracy = pbd->ts->accuracy;
+		}
 	}
 	else
 	{
@@ -934,6 +925,8 @@ post_subscribe(gdp_req_t *req)
 				req->flags |= GDP_REQ_ON_GOB_LIST;
 			}
 		}
+		if (EP_UT_BITSET(GDP_REQ_ON_GOB_LIST, req->flags))
+			_gdp_req_sub_link(req);
 	}
 }
 
@@ -1067,6 +1060,7 @@ cmd_subscribe_by_recno(gdp_req_t *req)
 			// abandon old request, we'll overwrite it with new request
 			// (but keep the GOB around)
 			ep_dbg_cprintf(Dbg, 20, "cmd_subscribe: removing old request\n");
+			_gdp_req_sub_unlink(r1);
 			LIST_REMOVE(r1, goblist);
 			r1->flags &= ~GDP_REQ_ON_GOB_LIST;
 			_gdp_req_lock(r1);
@@ -1109,6 +1103,8 @@ cmd_subscribe_by_recno(gdp_req_t *req)
 				estat = EP_STAT_ASSERT_ABORT;
 			}
 		}
+		if (EP_UT_BITSET(GDP_REQ_ON_GOB_LIST, req->flags))
+			_gdp_req_sub_link(req);
 	}
 
 	// we don't drop the GOB reference until the subscription is satisified
@@ -44,8 +44,6 @@
 static EP_DBG	Dbg = EP_DBG_INIT("gdplogd.pubsub",
 								"GDP Log Daemon pub/sub handling");
 
-extern EP_HASH	*_OpenGOBCache;		// associative cache
-
 
 /*
 **  SUB_SEND_MESSAGE_NOTIFICATION --- inform a subscriber of a new message
@@ -84,36 +82,173 @@ sub_send_message_notification(gdp_req_t *req)
 }
 
 
+/*
+**  SUB_TIMEOUT_CUTOFF --- subscriptions started before this have expired
+*/
+
+static long
+sub_timeout_cutoff(EP_TIME_SPEC *sub_timeout)
+{
+	EP_TIME_SPEC sub_delta;
+	long timeout;
+
+	timeout = ep_adm_getlongparam("swarm.gdplogd.subscr.timeout", 0);
+	if (timeout == 0)
+		timeout = ep_adm_getlongparam("swarm.gdp.subscr.timeout",
+								GDP_SUBSCR_TIMEOUT_DEF);
+	ep_time_from_nsec(-timeout SECONDS, &sub_delta);
+	ep_time_deltanow(&sub_delta, sub_timeout);
+	return timeout;
+}
+
+
+/*
+**  SUB_EXPIRE --- drop subscriptions whose lease has run out
+**
+**		The GOB subscription index is ordered by lease start, so this
+**		only looks at the ones that have actually expired.  The GOB
+**		must be locked (and marked GOBF_KEEPLOCKED, since freeing a
+**		request drops a GOB reference).
+*/
+
+static void
+sub_expire(gdp_gob_t *gob, EP_TIME_SPEC *sub_timeout)
+{
+	gdp_req_t *req;
+
+	while ((req = _gdp_gob_sub_oldest(gob)) != NULL &&
+			ep_time_before(&req->sub_ts, sub_timeout))
+	{
+		_gdp_req_lock(req);
+		if (ep_dbg_test(Dbg, 18))
+		{
+			char tbuf[100];
+			ep_time_format(sub_timeout, tbuf, sizeof tbuf,
+						EP_TIME_FMT_HUMAN);
+			ep_dbg_printf("sub_expire: subscription timeout (%s):\n%s",
+					tbuf, _gdp_pr_indent(1));
+			_gdp_req_dump(req, ep_dbg_getfile(), GDP_PR_BASIC, 1);
+		}
+
+		// removes it from the subscription index and the GOB list
+		EP_ASSERT(EP_UT_BITSET(GDP_REQ_ON_GOB_LIST, req->flags));
+		_gdp_req_free(&req);
+	}
+}
+
+
 /*
 **  SUB_NOTIFY_ALL_SUBSCRIBERS --- send something to all interested parties
 **
-**		pubreq should be locked when this is called.
+**		pubreq and pubreq->gob should be locked when this is called,
+**		and will be on return, but the GOB is unlocked while the
+**		notifications are actually written.
+**
+**		The message in pubreq->rpdu is serialized once.  While the GOB
+**		is locked we expire dead subscriptions and then take a snapshot
+**		of where each live subscription wants its copy (channel,
+**		destination, rid, l5seqno) and do the per-subscription
+**		bookkeeping; the sends themselves only need the snapshot, so
+**		other appends and subscribes to this GOB are not held up
+**		behind the network.  Only subscriptions are looked at, never
+**		other requests on the GOB.
+**
+**		A subscription that ends with this record is sent its copy
+**		before the GOB is unlocked so that the end-of-results message
+**		cannot overtake it.
+**
+**		Several appends can be in here at once, so each takes a
+**		ticket while the GOB is locked and writes only when its turn
+**		comes up.  That keeps every subscriber's copies in the order
+**		the records were taken, including the copy sent just ahead
+**		of an end-of-results.  No one holding a turn waits for the
+**		GOB lock, so it is safe to wait for a turn with it held.
 */
 
+void
+sub_fanout_init(gdp_gob_t *gob)
+{
+	struct gob_fanout *fo = &gob->x->fanout;
+
+	ep_thr_mutex_init(&fo->mutex, EP_THR_MUTEX_DEFAULT);
+	ep_thr_mutex_setorder(&fo->mutex, GDP_MUTEX_LORDER_LEAF);
+	ep_thr_cond_init(&fo->cond);
+	fo->next_ticket = fo->serving = 0;
+}
+
+void
+sub_fanout_free(gdp_gob_t *gob)
+{
+	struct gob_fanout *fo = &gob->x->fanout;
+
+	ep_thr_cond_destroy(&fo->cond);
+	ep_thr_mutex_destroy(&fo->mutex);
+}
+
+static void
+fanout_wait(struct gob_fanout *fo, uint64_t ticket)
+{
+	ep_thr_mutex_lock(&fo->mutex);
+	while (fo->serving != ticket)
+		ep_thr_cond_wait(&fo->cond, &fo->mutex, NULL);
+	ep_thr_mutex_unlock(&fo->mutex);
+}
+
+static void
+fanout_done(struct gob_fanout *fo)
+{
+	ep_thr_mutex_lock(&fo->mutex);
+	fo->serving++;
+	ep_thr_cond_broadcast(&fo->cond);
+	ep_thr_mutex_unlock(&fo->mutex);
+}
+
+/*
+**  Wait for every fan-out that has already taken a turn to finish
+**  writing.  Those may still be sending to subscriptions that have
+**  since been removed from the index.  The GOB must be locked.
+*/
+
+static void
+fanout_drain(gdp_gob_t *gob)
+{
+	struct gob_fanout *fo = &gob->x->fanout;
+
+	GDP_GOB_ASSERT_ISLOCKED(gob);
+	fanout_wait(fo, fo->next_ticket++);
+	fanout_done(fo);
+}
+
+struct sub_target
+{
+	gdp_chan_t			*chan;
+	gdp_name_t			dst;
+	gdp_rid_t			rid;
+	gdp_l5seqno_t		l5seqno;
+};
+
 void
 sub_notify_all_subscribers(gdp_req_t *pubreq)
 {
 	gdp_req_t *req;
-	gdp_req_t *nextreq;
+	gdp_gob_t *gob = pubreq->gob;
 	long timeout;
 	EP_TIME_SPEC sub_timeout;
+	gdp_pdu_shared_t *body;
+	struct sub_target *targets = NULL;
+	gdp_req_t **ending = NULL;
+	struct gob_fanout *fo = &gob->x->fanout;
+	uint64_t ticket;
+	int ntargets = 0;
+	int nending = 0;
+	int i;
 
 	EP_THR_MUTEX_ASSERT_ISLOCKED(&pubreq->mutex);
-	GDP_GOB_ASSERT_ISLOCKED(pubreq->gob);
+	GDP_GOB_ASSERT_ISLOCKED(gob);
 	EP_ASSERT_ELSE(pubreq->rpdu != NULL, return);
 	EP_ASSERT_ELSE(pubreq->rpdu->msg != NULL, return);
 
-	// set up for subscription timeout
-	{
-		EP_TIME_SPEC sub_delta;
-		timeout = ep_adm_getlongparam("swarm.gdplogd.subscr.timeout", 0);
-
-		if (timeout == 0)
-			timeout = ep_adm_getlongparam("swarm.gdp.subscr.timeout",
-									GDP_SUBSCR_TIMEOUT_DEF);
-		ep_time_from_nsec(-timeout SECONDS, &sub_delta);
-		ep_time_deltanow(&sub_delta, &sub_timeout);
-	}
+	timeout = sub_timeout_cutoff(&sub_timeout);
 
 	if (ep_dbg_test(Dbg, 32))
 	{
@@ -128,79 +263,116 @@ sub_notify_all_subscribers(gdp_req_t *pubreq)
 		_gdp_req_dump(pubreq, ep_dbg_getfile(), GDP_PR_BASIC, 1);
 	}
 
-	pubreq->gob->flags |= GOBF_KEEPLOCKED;
-	for (req = LIST_FIRST(&pubreq->gob->reqs); req != NULL; req = nextreq)
+	gob->flags |= GOBF_KEEPLOCKED;
+	sub_expire(gob, &sub_timeout);
+	if (gob->subs.n == 0)
 	{
-		_gdp_req_lock(req);
-		nextreq = LIST_NEXT(req, goblist);
-		EP_ASSERT_ELSE(req != nextreq, break);
+		gob->flags &= ~GOBF_KEEPLOCKED;
+		return;
+	}
+
+	// serialize the message once for everyone
+	body = _gdp_pdu_shared_new(pubreq->rpdu->msg);
+	targets = (struct sub_target *) ep_mem_malloc(
+							gob->subs.n * sizeof *targets);
+	ticket = fo->next_ticket++;
+
+	// the index can't change under us while we hold the GOB lock
+	for (i = 0; i < gob->subs.n; i++)
+	{
+		req = gob->subs.heap[i];
 
 		// make sure we don't tell ourselves
 		if (req == pubreq)
-		{
-			_gdp_req_unlock(req);
 			continue;
-		}
 
+		_gdp_req_lock(req);
 		if (ep_dbg_test(Dbg, 59))
 		{
-			ep_dbg_printf("sub_notify_all_subscribers: checking ");
+			ep_dbg_printf("sub_notify_all_subscribers: sending to ");
 			_gdp_req_dump(req, ep_dbg_getfile(), GDP_PR_BASIC, 0);
 		}
+		EP_ASSERT(EP_UT_BITSET(GDP_REQ_SRV_SUBSCR, req->flags));
+		EP_ASSERT_ELSE(req->cpdu != NULL, goto next);
+		EP_ASSERT_ELSE(req->cpdu->msg != NULL, goto next);
 
-		// notify subscribers
-		if (!EP_UT_BITSET(GDP_REQ_SRV_SUBSCR, req->flags))
+		// XXX: This won't really work in case of holes.
+		req->nextrec++;
+
+		if (req->numrecs > 0 && --req->numrecs <= 0)
 		{
-			ep_dbg_cprintf(Dbg, 59,
-					"   ... not a subscription (flags = 0x%x)\n",
-					req->flags);
+			// last one: must go out before the end of results (but
+			// after earlier records), and ending it changes the
+			// index, so do that after the loop
+			if (nending == 0)
+				fanout_wait(fo, ticket);
+			(void) _gdp_pdu_shared_out(body, pubreq->rpdu->src,
+							req->cpdu->src, req->cpdu->msg->rid,
+							req->cpdu->msg->l5seqno, req->chan);
+			if (ending == NULL)
+				ending = (gdp_req_t **) ep_mem_malloc(
+							gob->subs.n * sizeof *ending);
+			ending[nending++] = req;
+			goto next;
 		}
-		else if (!ep_time_before(&req->sub_ts, &sub_timeout))
-		{
-			EP_STAT estat;
-			EP_ASSERT_ELSE(req->cpdu != NULL, continue);
-			EP_ASSERT_ELSE(req->cpdu->msg != NULL, continue);
-			gdp_pdu_t *save_pdu = req->rpdu;
-			req->rpdu = pubreq->rpdu;
-			estat = sub_send_message_notification(req);
-			req->rpdu = save_pdu;
-			if (EP_STAT_ISOK(estat))
-			{
-				// XXX: This won't really work in case of holes.
-				req->nextrec++;
 
-				if (req->numrecs > 0 && --req->numrecs <= 0)
-					sub_end_subscription(req);
-			}
-		}
-		else
-		{
-			// this subscription seems to be dead
-			if (ep_dbg_test(Dbg, 18))
-			{
-				char tbuf[100];
-				ep_time_format(&sub_timeout, tbuf, sizeof tbuf,
-							EP_TIME_FMT_HUMAN);
-				ep_dbg_printf("sub_notify_all_subscribers: "
-						"subscription timeout (%s):\n%s",
-						tbuf, _gdp_pr_indent(1));
-				_gdp_req_dump(req, ep_dbg_getfile(), GDP_PR_BASIC, 1);
-				ep_dbg_printf("%s", _gdp_pr_indent(1));
-				_gdp_gob_dump(req->gob, ep_dbg_getfile(), GDP_PR_BASIC, 1);
-			}
+		targets[ntargets].chan = req->chan;
+		memcpy(targets[ntargets].dst, req->cpdu->src,
+				sizeof targets[ntargets].dst);
+		targets[ntargets].rid = req->cpdu->msg->rid;
+		targets[ntargets].l5seqno = req->cpdu->msg->l5seqno;
+		ntargets++;
+next:
+		_gdp_req_unlock(req);
+	}
 
-			// actually remove the subscription
-			//XXX isn't this done by _gdp_req_free???
-			//LIST_REMOVE(req, goblist);
+	for (i = 0; i < nending; i++)
+	{
+		_gdp_req_lock(ending[i]);
+		sub_end_subscription(ending[i]);
+		_gdp_req_unlock(ending[i]);
+	}
+	gob->flags &= ~GOBF_KEEPLOCKED;
 
-			EP_ASSERT(req->gob != NULL);
-			EP_ASSERT(EP_UT_BITSET(GDP_REQ_ON_GOB_LIST, req->flags));
-			_gdp_req_free(&req);
+	if (ntargets == 0)
+	{
+		if (nending == 0)
+			fanout_wait(fo, ticket);
+		fanout_done(fo);
+		goto done;
+	}
+
+	// fan out with the GOB unlocked
+	ep_dbg_cprintf(Dbg, 32, "sub_notify_all_subscribers: %d subscriber%s\n",
+			ntargets, ntargets == 1 ? "" : "s");
+	_gdp_gob_unlock(gob);
+	if (nending == 0)
+		fanout_wait(fo, ticket);
+	for (i = 0; i < ntargets; i++)
+	{
+		EP_STAT estat;
+
+		estat = _gdp_pdu_shared_out(body, pubreq->rpdu->src,
+						targets[i].dst, targets[i].rid,
+						targets[i].l5seqno, targets[i].chan);
+		if (!EP_STAT_ISOK(estat))
+		{
+			ep_dbg_cprintf(Dbg, 1,
+					"sub_notify_all_subscribers: couldn't write PDU!\n");
 		}
-		if (req != NULL)
-			_gdp_req_unlock(req);
 	}
-	pubreq->gob->flags &= ~GOBF_KEEPLOCKED;
+	fanout_done(fo);
+
+	// have to unlock the req so lock ordering is right
+	_gdp_req_unlock(pubreq);
+	_gdp_gob_lock(gob);
+	_gdp_req_lock(pubreq);
+
+done:
+	if (ending != NULL)
+		ep_mem_free(ending);
+	ep_mem_free(targets);
+	_gdp_pdu_shared_free(&body);
 }
 
 
@@ -219,6 +391,7 @@ sub_end_subscription(gdp_req_t *req)
 
 	// make it not persistent and not a subscription
 	req->flags &= ~(GDP_REQ_PERSIST | GDP_REQ_SRV_SUBSCR);
+	_gdp_req_sub_unlink(req);
 
 	// remove the request from the work list
 	if (EP_UT_BITSET(GDP_REQ_ON_GOB_LIST, req->flags))
@@ -233,8 +406,8 @@ sub_end_subscription(gdp_req_t *req)
 	// make sure we have a response message available
 	if (req->rpdu == NULL || req->rpdu->msg == NULL)
 	{
-		GdpMessage *msg = ep_mem_malloc(sizeof *msg);
-		gdp_message__init(msg);
+		GdpMessage *msg = _gdp_msg_new(0, GDP_PDU_NO_RID,
+									GDP_PDU_NO_L5SEQNO);
 		if (req->rpdu == NULL)
 			req->rpdu = _gdp_pdu_new(msg, req->cpdu->dst, req->cpdu->src,
 									GDP_SEQNO_NONE);
@@ -258,6 +431,10 @@ sub_end_subscription(gdp_req_t *req)
 /*
 **  Unsubscribe all requests for a given gob and destination.
 **  Can also optionally select a particular request id.
+**
+**  Doesn't return until any notification already being fanned out to
+**  those subscriptions has been written, so whatever the caller sends
+**  next (e.g., the ack to an unsubscribe) comes after it.
 */
 
 EP_STAT
@@ -305,12 +482,14 @@ sub_end_all_subscriptions(
 				ep_dbg_printf("sub_end_all_subscriptions removing ");
 				_gdp_req_dump(req, ep_dbg_getfile(), GDP_PR_BASIC, 0);
 			}
+			_gdp_req_sub_unlink(req);
 			LIST_REMOVE(req, goblist);
 			req->flags &= ~GDP_REQ_ON_GOB_LIST;
 			_gdp_gob_decref(&req->gob, false);
 			_gdp_req_free(&req);
 		}
 	} while (!EP_STAT_ISOK(estat));
+	fanout_drain(gob);
 	gob->flags &= ~GOBF_KEEPLOCKED;
 	return estat;
 }
@@ -333,7 +512,6 @@ gob_reclaim_subscriptions(gdp_gob_t *gob)
 {
 	int istat;
 	gdp_req_t *req;
-	gdp_req_t *nextreq;
 	EP_TIME_SPEC sub_timeout;
 
 	// just in case
@@ -341,12 +519,8 @@ gob_reclaim_subscriptions(gdp_gob_t *gob)
 		return;
 
 	{
-		EP_TIME_SPEC sub_delta;
-		long timeout = ep_adm_getlongparam("swarm.gdp.subscr.timeout",
-								GDP_SUBSCR_TIMEOUT_DEF);
+		long timeout = sub_timeout_cutoff(&sub_timeout);
 
-		ep_time_from_nsec(-timeout SECONDS, &sub_delta);
-		ep_time_deltanow(&sub_delta, &sub_timeout);
 		ep_dbg_cprintf(Dbg, 39,
 				"gob_reclaim_subscriptions: GOB = %p, refcnt = %d, timeout = %ld\n",
 				gob, gob->refcnt, timeout);
@@ -371,8 +545,9 @@ gob_reclaim_subscriptions(gdp_gob_t *gob)
 	}
 	gob->flags |= GOBF_ISLOCKED;	// if trylock succeeded
 
-	nextreq = LIST_FIRST(&gob->reqs);
-	while ((req = nextreq) != NULL)
+	// the oldest leases are at the top of the index
+	while ((req = _gdp_gob_sub_oldest(gob)) != NULL &&
+			ep_time_before(&req->sub_ts, &sub_timeout))
 	{
 		if (ep_dbg_test(Dbg, 59))
 		{
@@ -384,60 +559,41 @@ gob_reclaim_subscriptions(gdp_gob_t *gob)
 		istat = ep_thr_mutex_trylock(&req->mutex);
 		if (istat != 0)		// checking on status of req lock attempt
 		{
-			// already locked
+			// already locked; try again next time around
 			if (ep_dbg_test(Dbg, 41))
 			{
 				ep_dbg_printf("gob_reclaim_subscriptions: req already locked:\n    ");
 				_gdp_req_dump(req, ep_dbg_getfile(), GDP_PR_BASIC, 0);
 			}
-			_gdp_gob_unlock(req->gob);
-			continue;
+			break;
 		}
-
-		// get next request while locked and do sanity checks
-		nextreq = LIST_NEXT(req, goblist);
-		if (!EP_ASSERT(req != nextreq) || !EP_ASSERT(req->gob == gob))
+		if (!EP_ASSERT(req->gob == gob))
 		{
-			_gdp_gob_unlock(req->gob);
+			_gdp_req_unlock(req);
 			break;
 		}
 
-
-		if (!EP_UT_BITSET(GDP_REQ_SRV_SUBSCR, req->flags))
+		// this subscription seems to be dead
+		if (ep_dbg_test(Dbg, 18))
 		{
-			ep_dbg_cprintf(Dbg, 59, "   ... not a subscription (flags = 0x%x)\n",
-					req->flags);
+			ep_dbg_printf("    ...  subscription timeout: ");
+			_gdp_gob_dump(req->gob, ep_dbg_getfile(), GDP_PR_BASIC, 0);
 		}
-		else if (ep_time_before(&req->sub_ts, &sub_timeout))
-		{
-			// this subscription seems to be dead
-			if (ep_dbg_test(Dbg, 18))
-			{
-				ep_dbg_printf("    ...  subscription timeout: ");
-				_gdp_gob_dump(req->gob, ep_dbg_getfile(), GDP_PR_BASIC, 0);
-			}
 
-			// have to manually remove req from lists to avoid lock inversion
-			if (EP_UT_BITSET(GDP_REQ_ON_GOB_LIST, req->flags))
-			{
-				// gob is already locked
-				LIST_REMOVE(req, goblist);
-			}
-			if (EP_UT_BITSET(GDP_REQ_ON_CHAN_LIST, req->flags))
-			{
-				LIST_REMOVE(req, chanlist);			// chan already locked
-			}
-			req->flags &= ~(GDP_REQ_ON_GOB_LIST | GDP_REQ_ON_CHAN_LIST);
-			_gdp_gob_decref(&req->gob, true);
-			_gdp_req_free(&req);
+		// have to manually remove req from lists to avoid lock inversion
+		_gdp_req_sub_unlink(req);
+		if (EP_UT_BITSET(GDP_REQ_ON_GOB_LIST, req->flags))
+		{
+			// gob is already locked
+			LIST_REMOVE(req, goblist);
 		}
-		else if (ep_dbg_test(Dbg, 59))
+		if (EP_UT_BITSET(GDP_REQ_ON_CHAN_LIST, req->flags))
 		{
-			ep_dbg_printf("    ... not yet time\n");
+			LIST_REMOVE(req, chanlist);			// chan already locked
 		}
-
-		if (req != NULL)
-			_gdp_req_unlock(req);
+		req->flags &= ~(GDP_REQ_ON_GOB_LIST | GDP_REQ_ON_CHAN_LIST);
+		_gdp_gob_decref(&req->gob, true);
+		_gdp_req_free(&req);
 	}
 
 	if (gob != NULL)
@@ -33,7 +33,11 @@
 #ifndef _GDPD_PUBSUB_H_
 #define _GDPD_PUBSUB_H_
 
-// notify all subscribers of a new message
+// set up and tear down per-GOB notification state
+void			sub_fanout_init(gdp_gob_t *gob);
+void			sub_fanout_free(gdp_gob_t *gob);
+
+// notify all subscribers of a new message (may release the GOB lock)
 void			sub_notify_all_subscribers(
 						gdp_req_t *pubreq);
 
@@ -0,0 +1,2488 @@
+/* vim: set ai sw=4 sts=4 ts=4 : */
+
+/*
+**	----- BEGIN LICENSE BLOCK -----
+**	GDPLOGD: Log Daemon for the Global Data Plane
+**	From the Ubiquitous Swarm Lab, 490 Cory Hall, U.C. Berkeley.
+**
+**	Copyright (c) 2015-2019, Regents of the University of California.
+**	All rights reserved.
+**
+**	Permission is hereby granted, without written agreement and without
+**	license or royalty fees, to use, copy, modify, and distribute this
+**	software and its documentation for any purpose, provided that the above
+**	copyright notice and the following two paragraphs appear in all copies
+**	of this software.
+**
+**	IN NO EVENT SHALL REGENTS BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT,
+**	SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES, INCLUDING LOST
+**	PROFITS, ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION,
+**	EVEN IF REGENTS HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**
+**	REGENTS SPECIFICALLY DISCLAIMS ANY WARRANTIES, INCLUDING, BUT NOT
+**	LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+**	FOR A PARTICULAR PURPOSE. THE SOFTWARE AND ACCOMPANYING DOCUMENTATION,
+**	IF ANY, PROVIDED HEREUNDER IS PROVIDED "AS IS". REGENTS HAS NO
+**	OBLIGATION TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS,
+**	OR MODIFICATIONS.
+**	----- END LICENSE BLOCK -----
+*/
+
+
+/*
+**  Implement GDP logs as append-only segment files.
+**
+**		See logd_seglog.h for the on-disk layout.  Appends go to the
+**		end of the last segment; a new segment is started when that
+**		one reaches swarm.gdplogd.seglog.segment-size.  Data is
+**		synced at the end of each transaction (i.e., once per group
+**		commit), and the indices are checkpointed every so often.
+**
+**		Recovery after a crash starts at the last checkpoint and scans
+**		forward, putting each record back into the indices, until it
+**		finds the end of the data or a record with a bad CRC; the last
+**		segment is truncated there.  The cost of recovery is therefore
+**		bounded by the checkpoint interval rather than the log size.
+**
+**		Records are located by number through the recno index and by
+**		time through the timestamp index.  Timestamp reads return
+**		records in the order they were appended starting with the
+**		first one at or after the requested time; for logs whose
+**		timestamps never go backwards this is the same as timestamp
+**		order.  Hash lookups use a hash table per segment that is
+**		built the first time it is needed.
+*/
+
+#include "logd.h"
+#include "logd_seglog.h"
+
+#include <gdp/gdp_buf.h>
+#include <gdp/gdp_md.h>
+
+#include <ep/ep_hexdump.h>
+#include <ep/ep_string.h>
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+static EP_DBG	Dbg = EP_DBG_INIT("gdplogd.seglog", "GDP Log Daemon Segmented Physical Log");
+
+#define GOB_PATH_MAX		260			// max length of pathname
+
+static bool			SeglogInitialized = false;
+static int			GOBfilemode;		// the file mode on create
+static uint32_t		DefaultLogFlags;	// as indicated
+static char			LogDir[GOB_PATH_MAX];	// the gob data directory
+static uint64_t		SegMaxSize;			// start new segment at this size
+static uint32_t		TsInterval;			// records per timestamp index entry
+static uint64_t		CkptInterval;		// records between index checkpoints
+static bool			SyncOnCommit;		// fdatasync at end of transaction
+
+#define GETPHYS(gob)	((gob)->x->physinfo)
+
+#define ROUNDUP(x, n)	(((x) + ((n) - 1)) & ~((uint64_t) (n) - 1))
+
+
+/*
+**  POSIX_ERROR --- flag error caused by a Posix (Unix) syscall
+*/
+
+static EP_STAT EP_TYPE_PRINTFLIKE(2, 3)
+posix_error(int _errno, const char *fmt, ...)
+{
+	va_list ap;
+	EP_STAT estat = ep_stat_from_errno(_errno);
+
+	va_start(ap, fmt);
+	if (EP_UT_BITSET(LOG_POSIX_ERRORS, DefaultLogFlags))
+		ep_logv(estat, fmt, ap);
+	else if (!SeglogInitialized || ep_dbg_test(Dbg, 1))
+		ep_app_messagev(estat, fmt, ap);
+	va_end(ap);
+
+	return estat;
+}
+
+
+/*
+**  CRC32C --- compute a CRC-32C (Castagnoli) over a buffer
+**
+**		Table driven, one byte at a time.  The table is built by
+**		seglog_init before any threads are running.
+*/
+
+static uint32_t		Crc32cTable[256];
+
+static void
+crc32c_init(void)
+{
+	uint32_t i;
+
+	for (i = 0; i < 256; i++)
+	{
+		uint32_t c = i;
+		int k;
+
+		for (k = 0; k < 8; k++)
+			c = (c & 1) ? (c >> 1) ^ UINT32_C(0x82F63B78) : c >> 1;
+		Crc32cTable[i] = c;
+	}
+}
+
+static uint32_t
+crc32c(const uint8_t *p, size_t len)
+{
+	uint32_t crc = ~UINT32_C(0);
+
+	while (len-- > 0)
+		crc = Crc32cTable[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+	return ~crc;
+}
+
+
+/*
+**  SEGLOG_INIT --- initialize the physical I/O module
+**
+**		Note this is always called before threads have been spawned.
+*/
+
+static EP_STAT
+seglog_init(const char *logroot)
+{
+	EP_STAT estat = EP_STAT_OK;
+
+	// find physical location of GOB directory
+	if (logroot != NULL)
+		strlcpy(LogDir, logroot, sizeof LogDir);
+	else
+	{
+		estat = _gdp_adm_path_find("swarm.gdp.data.root", GDP_DEFAULT_DATA_ROOT,
+							"swarm.gdplogd.log.dir", GDP_DEFAULT_LOG_DIR,
+							LogDir, sizeof LogDir);
+		if (!EP_STAT_ISOK(estat))
+		{
+			char ebuf[100];
+			ep_dbg_cprintf(Dbg, 1, "seglog_init: _gdp_adm_path_find => %s\n",
+					ep_stat_tostr(estat, ebuf, sizeof ebuf));
+			return estat;
+		}
+	}
+
+	// we will run out of that directory
+	if (chdir(LogDir) != 0)
+	{
+		estat = ep_stat_from_errno(errno);
+		ep_app_message(estat, "seglog_init: chdir(%s)", LogDir);
+		return estat;
+	}
+
+	// find the file creation mode
+	GOBfilemode = ep_adm_getintparam("swarm.gdplogd.gob.mode", 0600);
+
+	if (ep_adm_getboolparam("swarm.gdplogd.seglog.log-posix-errors", false))
+		DefaultLogFlags |= LOG_POSIX_ERRORS;
+
+	SegMaxSize = ep_adm_getlongparam("swarm.gdplogd.seglog.segment-size",
+							64 * 1024 * 1024);
+	TsInterval = ep_adm_getintparam("swarm.gdplogd.seglog.timestamp-interval",
+							64);
+	if (TsInterval < 1)
+		TsInterval = 1;
+	CkptInterval = ep_adm_getlongparam("swarm.gdplogd.seglog.checkpoint-interval",
+							10000);
+	if (CkptInterval < 1)
+		CkptInterval = 1;
+	SyncOnCommit = ep_adm_getboolparam("swarm.gdplogd.seglog.sync", true);
+
+	crc32c_init();
+
+	SeglogInitialized = true;
+	ep_dbg_cprintf(Dbg, 8,
+			"seglog_init: log dir = %s, mode = 0%o, segment size %" PRIu64
+			", ts interval %" PRIu32 ", checkpoint %" PRIu64 ", sync %d\n",
+			LogDir, GOBfilemode, SegMaxSize, TsInterval, CkptInterval,
+			SyncOnCommit);
+
+	return estat;
+}
+
+
+/*
+**	GET_LOG_PATH --- get the pathname to an on-disk version of the gob
+*/
+
+static EP_STAT
+get_log_path(gdp_gob_t *gob,
+		const char *sfx,
+		char *pbuf,
+		int pbufsiz)
+{
+	EP_STAT estat = EP_STAT_OK;
+	gdp_pname_t pname;
+	int i;
+	struct stat st;
+
+	EP_ASSERT_POINTER_VALID(gob);
+
+	errno = 0;
+	gdp_printable_name(gob->name, pname);
+
+	// find the subdirectory based on the first part of the name
+	i = snprintf(pbuf, pbufsiz, "%s/_%02x", LogDir, gob->name[0]);
+	if (i >= pbufsiz)
+		goto fail1;
+	if (stat(pbuf, &st) < 0)
+	{
+		// doesn't exist; we need to create it
+		ep_dbg_cprintf(Dbg, 11, "get_log_path: creating %s\n", pbuf);
+		i = mkdir(pbuf, 0775);
+		if (i < 0)
+			goto fail0;
+	}
+	else if ((st.st_mode & S_IFMT) != S_IFDIR)
+	{
+		errno = ENOTDIR;
+		goto fail0;
+	}
+
+	// now return the final complete name
+	i = snprintf(pbuf, pbufsiz, "%s/_%02x/%s%s",
+				LogDir, gob->name[0], pname, sfx);
+	if (i < pbufsiz)
+		return EP_STAT_OK;
+
+fail1:
+	estat = EP_STAT_BUF_OVERFLOW;
+
+fail0:
+	{
+		char ebuf[100];
+
+		if (EP_STAT_ISOK(estat))
+		{
+			if (errno == 0)
+				estat = EP_STAT_ERROR;
+			else
+				estat = ep_stat_from_errno(errno);
+		}
+
+		ep_dbg_cprintf(Dbg, 1, "get_log_path(%s):\n\t%s\n",
+				pbuf, ep_stat_tostr(estat, ebuf, sizeof ebuf));
+	}
+	return estat;
+}
+
+static EP_STAT
+get_seg_path(gdp_gob_t *gob, uint32_t segno, char *pbuf, int pbufsiz)
+{
+	char sfx[40];
+
+	snprintf(sfx, sizeof sfx, ".%06" PRIu32 "%s", segno, SEGLOG_SEG_SUFFIX);
+	return get_log_path(gob, sfx, pbuf, pbufsiz);
+}
+
+
+/*
+**  Record encoding and decoding.
+**
+**		Uses the PUT and GET macros from gdp_priv.h, which operate
+**		on a local "pbp".
+*/
+
+struct rec_info
+{
+	uint32_t			reclen;
+	uint32_t			datalen;
+	uint16_t			hashlen;
+	uint16_t			prevhashlen;
+	uint16_t			siglen;
+	gdp_recno_t			recno;
+	EP_TIME_SPEC		ts;
+	const uint8_t		*hash;
+	const uint8_t		*prevhash;
+	const uint8_t		*sig;
+	const uint8_t		*data;
+};
+
+static uint32_t
+float_to_bits(float f)
+{
+	union { float f; uint32_t u; } x;
+
+	x.f = f;
+	return x.u;
+}
+
+static float
+bits_to_float(uint32_t u)
+{
+	union { float f; uint32_t u; } x;
+
+	x.u = u;
+	return x.f;
+}
+
+/*
+**  REC_ENCODE --- lay out a datum as a record in phys->wbuf
+**
+**		Returns the length of the record.
+*/
+
+static size_t
+rec_encode(gob_physinfo_t *phys,
+		gdp_datum_t *datum,
+		gdp_hash_t *hash)
+{
+	size_t hashlen = 0, prevhashlen = 0, siglen = 0;
+	size_t datalen = gdp_buf_getlength(datum->dbuf);
+	const void *hashp = NULL, *prevhashp = NULL, *sigp = NULL;
+
+	if (hash != NULL)
+		hashp = gdp_hash_getptr(hash, &hashlen);
+	if (datum->prevhash != NULL)
+		prevhashp = gdp_hash_getptr(datum->prevhash, &prevhashlen);
+	if (datum->sig != NULL)
+		sigp = gdp_sig_getptr(datum->sig, &siglen);
+
+	size_t reclen = ROUNDUP(SEGLOG_REC_HDRSIZE + hashlen + prevhashlen +
+							siglen + datalen, SEGLOG_REC_ALIGN);
+	if (reclen > phys->wbufsize)
+	{
+		phys->wbufsize = ROUNDUP(reclen, 4096);
+		phys->wbuf = ep_mem_realloc(phys->wbuf, phys->wbufsize);
+	}
+
+	uint8_t *pbp = phys->wbuf;
+	PUT32(SEGLOG_REC_MAGIC);
+	PUT32(0);							// CRC filled in below
+	PUT32(reclen);
+	PUT32(datalen);
+	PUT16(hashlen);
+	PUT16(prevhashlen);
+	PUT16(siglen);
+	PUT16(0);
+	PUT64((uint64_t) datum->recno);
+	PUT64((uint64_t) datum->ts.tv_sec);
+	PUT32((uint32_t) datum->ts.tv_nsec);
+	PUT32(float_to_bits(datum->ts.tv_accuracy));
+	if (hashlen > 0)
+		memcpy(pbp, hashp, hashlen);
+	pbp += hashlen;
+	if (prevhashlen > 0)
+		memcpy(pbp, prevhashp, prevhashlen);
+	pbp += prevhashlen;
+	if (siglen > 0)
+		memcpy(pbp, sigp, siglen);
+	pbp += siglen;
+	if (datalen > 0)
+		memcpy(pbp, gdp_buf_getptr(datum->dbuf, datalen), datalen);
+	pbp += datalen;
+	memset(pbp, 0, phys->wbuf + reclen - pbp);
+
+	uint32_t crc = crc32c(phys->wbuf + 8, reclen - 8);
+	pbp = phys->wbuf + 4;
+	PUT32(crc);
+
+	return reclen;
+}
+
+/*
+**  REC_DECODE_HDR --- crack the fixed part of a record
+**
+**		Does sanity checks but doesn't look at the CRC; avail is the
+**		number of bytes of the segment from the start of the record
+**		to the end of the data.
+*/
+
+static bool
+rec_decode_hdr(const uint8_t *rec, uint64_t avail, struct rec_info *ri)
+{
+	const uint8_t *pbp = rec;
+	uint32_t magic, crc;
+	uint32_t u32;
+	uint64_t u64;
+
+	if (avail < SEGLOG_REC_HDRSIZE)
+		return false;
+	GET32(magic);
+	GET32(crc);
+	GET32(ri->reclen);
+	GET32(ri->datalen);
+	GET16(ri->hashlen);
+	GET16(ri->prevhashlen);
+	GET16(ri->siglen);
+	pbp += 2;
+	GET64(u64);
+	ri->recno = (gdp_recno_t) u64;
+	GET64(u64);
+	ri->ts.tv_sec = (int64_t) u64;
+	GET32(u32);
+	ri->ts.tv_nsec = (int32_t) u32;
+	GET32(u32);
+	ri->ts.tv_accuracy = bits_to_float(u32);
+	(void) crc;
+
+	if (magic != SEGLOG_REC_MAGIC ||
+			ri->reclen < SEGLOG_REC_HDRSIZE ||
+			ri->reclen % SEGLOG_REC_ALIGN != 0 ||
+			ri->reclen > avail ||
+			(uint64_t) SEGLOG_REC_HDRSIZE + ri->hashlen + ri->prevhashlen +
+				ri->siglen + ri->datalen > ri->reclen)
+		return false;
+
+	ri->hash = pbp;
+	ri->prevhash = ri->hash + ri->hashlen;
+	ri->sig = ri->prevhash + ri->prevhashlen;
+	ri->data = ri->sig + ri->siglen;
+	return true;
+}
+
+/*
+**  REC_CHECK_CRC --- verify the CRC of a complete record
+*/
+
+static bool
+rec_check_crc(const uint8_t *rec, uint32_t reclen)
+{
+	const uint8_t *pbp = rec + 4;
+	uint32_t crc;
+
+	GET32(crc);
+	return crc == crc32c(rec + 8, reclen - 8);
+}
+
+
+/*
+**  Buffered reader.
+**
+**		Reading a range of records usually walks forward through
+**		one segment, so read big chunks and hand out pointers into
+**		the buffer.  Each read operation has its own reader; the
+**		file descriptors are shared (pread doesn't need a lock).
+*/
+
+#define SEGLOG_READ_BUFFER_SIZE		(64 * 1024)
+
+struct seglog_reader
+{
+	uint8_t				*buf;
+	size_t				bufsize;
+	uint32_t			segno;					// what's in the buffer
+	uint64_t			off;
+	size_t				len;
+};
+
+static void
+reader_init(struct seglog_reader *rd)
+{
+	memset(rd, 0, sizeof *rd);
+	rd->segno = UINT32_MAX;
+}
+
+static void
+reader_free(struct seglog_reader *rd)
+{
+	if (rd->buf != NULL)
+		ep_mem_free(rd->buf);
+	rd->buf = NULL;
+}
+
+/*
+**  READER_GET --- return a pointer to len bytes at (segno, off)
+**
+**		Returns NULL if those bytes are not in the segment.
+*/
+
+static const uint8_t *
+reader_get(gob_physinfo_t *phys,
+		struct seglog_reader *rd,
+		uint32_t segno,
+		uint64_t off,
+		size_t len)
+{
+	struct seglog_seg *seg;
+
+	if (segno >= (uint32_t) phys->nsegs)
+		return NULL;
+	seg = &phys->segs[segno];
+	if (off + len > seg->size)
+		return NULL;
+
+	if (rd->segno == segno && off >= rd->off && off + len <= rd->off + rd->len)
+		return rd->buf + (off - rd->off);
+
+	// refill, reading ahead as far as the buffer allows
+	size_t want = len > SEGLOG_READ_BUFFER_SIZE ? len : SEGLOG_READ_BUFFER_SIZE;
+	if (want > seg->size - off)
+		want = seg->size - off;
+	if (want > rd->bufsize)
+	{
+		if (rd->buf != NULL)
+			ep_mem_free(rd->buf);
+		rd->bufsize = want;
+		rd->buf = ep_mem_malloc(rd->bufsize);
+	}
+	ssize_t n = pread(seg->fd, rd->buf, want, off);
+	if (n < (ssize_t) len)
+	{
+		if (n < 0)
+			(void) posix_error(errno, "seglog: pread segment %" PRIu32, segno);
+		rd->segno = UINT32_MAX;
+		return NULL;
+	}
+	rd->segno = segno;
+	rd->off = off;
+	rd->len = n;
+	return rd->buf;
+}
+
+/*
+**  READER_GET_REC --- read and crack the record at (segno, off)
+*/
+
+static const uint8_t *
+reader_get_rec(gob_physinfo_t *phys,
+		struct seglog_reader *rd,
+		uint32_t segno,
+		uint64_t off,
+		struct rec_info *ri)
+{
+	const uint8_t *rec;
+	uint64_t avail;
+
+	if (segno >= (uint32_t) phys->nsegs || off >= phys->segs[segno].size)
+		return NULL;
+	avail = phys->segs[segno].size - off;
+	rec = reader_get(phys, rd, segno, off, SEGLOG_REC_HDRSIZE);
+	if (rec == NULL || !rec_decode_hdr(rec, avail, ri))
+		return NULL;
+	rec = reader_get(phys, rd, segno, off, ri->reclen);
+	if (rec == NULL || !rec_check_crc(rec, ri->reclen))
+		return NULL;
+
+	// pointers have to be relative to the (possibly refilled) buffer
+	(void) rec_decode_hdr(rec, avail, ri);
+	return rec;
+}
+
+
+/*
+**  Per-segment hash indices.
+**
+**		Open addressing on the first eight bytes of the record hash,
+**		mapping to the offset of the record in the segment.  The
+**		full hash is compared when the record is read.  Built by
+**		scanning the segment the first time a hash lookup needs it,
+**		and caught up the same way on later lookups, so appends
+**		never have to touch it.
+*/
+
+struct hidx_ent
+{
+	uint64_t			key;					// 0 == empty
+	uint64_t			off;					// offset in segment
+};
+
+struct seglog_hashidx
+{
+	uint64_t			scanned;				// segment indexed to here
+	uint32_t			mask;					// table size - 1
+	uint32_t			n;						// entries in use
+	struct hidx_ent		*ents;
+};
+
+static uint64_t
+hash_key(const uint8_t *hash, size_t hashlen)
+{
+	uint64_t key = 0;
+	size_t i;
+
+	for (i = 0; i < hashlen && i < sizeof key; i++)
+		key = (key << 8) | hash[i];
+	return key == 0 ? 1 : key;
+}
+
+static void
+hidx_insert(struct seglog_hashidx *hx, uint64_t key, uint64_t off)
+{
+	uint32_t i;
+
+	if (hx->ents == NULL || (hx->n + 1) * 2 > hx->mask + 1)
+	{
+		// grow (or create) the table and rehash
+		uint32_t oldsize = hx->ents == NULL ? 0 : hx->mask + 1;
+		struct hidx_ent *oldents = hx->ents;
+
+		hx->mask = (oldsize == 0 ? 1024 : oldsize * 2) - 1;
+		hx->ents = ep_mem_zalloc((hx->mask + 1) * sizeof *hx->ents);
+		hx->n = 0;
+		for (i = 0; i < oldsize; i++)
+		{
+			if (oldents[i].key != 0)
+				hidx_insert(hx, oldents[i].key, oldents[i].off);
+		}
+		if (oldents != NULL)
+			ep_mem_free(oldents);
+	}
+
+	for (i = key & hx->mask; hx->ents[i].key != 0; i = (i + 1) & hx->mask)
+		continue;
+	hx->ents[i].key = key;
+	hx->ents[i].off = off;
+	hx->n++;
+}
+
+static void
+hidx_free(struct seglog_hashidx *hx)
+{
+	if (hx == NULL)
+		return;
+	if (hx->ents != NULL)
+		ep_mem_free(hx->ents);
+	ep_mem_free(hx);
+}
+
+/*
+**  HIDX_CATCH_UP --- index anything appended to segment since last time
+**
+**		Called with hidx_mutex locked and the log read locked.
+*/
+
+static struct seglog_hashidx *
+hidx_catch_up(gob_physinfo_t *phys, struct seglog_seg *seg)
+{
+	struct seglog_hashidx *hx = seg->hidx;
+	struct seglog_reader rd;
+	struct rec_info ri;
+
+	if (hx == NULL)
+	{
+		hx = seg->hidx = ep_mem_zalloc(sizeof *hx);
+		hx->scanned = seg->hdrlen;
+	}
+	if (hx->scanned >= seg->size)
+		return hx;
+
+	reader_init(&rd);
+	while (hx->scanned < seg->size &&
+			reader_get_rec(phys, &rd, seg->segno, hx->scanned, &ri) != NULL)
+	{
+		if (ri.hashlen > 0)
+			hidx_insert(hx, hash_key(ri.hash, ri.hashlen), hx->scanned);
+		hx->scanned += ri.reclen;
+	}
+	reader_free(&rd);
+	return hx;
+}
+
+
+/*
+**  Memory mapped indices.
+**
+**		The file is always at least as big as the mapping, and the
+**		mapping only grows (by doubling), so entries past nent are
+**		zero unless left over from before a crash.
+*/
+
+#define IX_INITIAL_ENTRIES		1024
+
+static EP_STAT
+ix_map(struct seglog_index *ix, size_t size)
+{
+	void *p;
+
+	if (ix->base != NULL)
+		munmap(ix->base, ix->mapsize);
+	ix->base = NULL;
+	ix->hdr = NULL;
+	ix->mapsize = 0;
+
+	if (ftruncate(ix->fd, size) < 0)
+		return posix_error(errno, "seglog: cannot extend index to %zd", size);
+	p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, ix->fd, 0);
+	if (p == MAP_FAILED)
+		return posix_error(errno, "seglog: cannot map index (%zd bytes)", size);
+	ix->base = p;
+	ix->hdr = p;
+	ix->mapsize = size;
+	return EP_STAT_OK;
+}
+
+/*
+**  IX_RESERVE --- make sure there is room for nent entries
+*/
+
+static EP_STAT
+ix_reserve(struct seglog_index *ix, uint64_t nent)
+{
+	size_t need = SEGLOG_IX_HDRSIZE + nent * ix->hdr->entsize;
+
+	if (need <= ix->mapsize)
+		return EP_STAT_OK;
+	size_t newsize = ix->mapsize * 2;
+	if (newsize < need)
+		newsize = ROUNDUP(need, 1024 * 1024);
+	ep_dbg_cprintf(Dbg, 32, "ix_reserve: %zd => %zd bytes\n",
+			ix->mapsize, newsize);
+	return ix_map(ix, newsize);
+}
+
+/*
+**  IX_RESET --- throw away the contents of an index
+*/
+
+static EP_STAT
+ix_reset(struct seglog_index *ix, uint32_t entsize, uint32_t interval)
+{
+	EP_STAT estat;
+
+	if (ix->base != NULL)
+		munmap(ix->base, ix->mapsize);
+	ix->base = NULL;
+	ix->mapsize = 0;
+	if (ftruncate(ix->fd, 0) < 0)
+		return posix_error(errno, "seglog: cannot truncate index");
+	estat = ix_map(ix, SEGLOG_IX_HDRSIZE + IX_INITIAL_ENTRIES * entsize);
+	EP_STAT_CHECK(estat, return estat);
+
+	ix->hdr->magic = SEGLOG_IDX_MAGIC;
+	ix->hdr->version = SEGLOG_VERSION;
+	ix->hdr->entsize = entsize;
+	ix->hdr->interval = interval;
+	return EP_STAT_OK;
+}
+
+/*
+**  IX_OPEN --- open (or create) an index file
+**
+**		Sets *validp if the index has a header we understand; if not
+**		it has been reset and needs to be rebuilt.
+*/
+
+static EP_STAT
+ix_open(gdp_gob_t *gob,
+		struct seglog_index *ix,
+		const char *sfx,
+		uint32_t entsize,
+		uint32_t interval,
+		bool *validp)
+{
+	EP_STAT estat;
+	char ix_path[GOB_PATH_MAX];
+	struct stat st;
+
+	*validp = false;
+	estat = get_log_path(gob, sfx, ix_path, sizeof ix_path);
+	EP_STAT_CHECK(estat, return estat);
+	ix->fd = open(ix_path, O_RDWR | O_CREAT, GOBfilemode);
+	if (ix->fd < 0)
+		return posix_error(errno, "seglog: cannot open index %s", ix_path);
+	if (fstat(ix->fd, &st) < 0)
+		return posix_error(errno, "seglog: cannot stat index %s", ix_path);
+
+	if (st.st_size >= SEGLOG_IX_HDRSIZE)
+	{
+		size_t size = st.st_size;
+
+		if (size < SEGLOG_IX_HDRSIZE + IX_INITIAL_ENTRIES * entsize)
+			size = SEGLOG_IX_HDRSIZE + IX_INITIAL_ENTRIES * entsize;
+		estat = ix_map(ix, ROUNDUP(size, 4096));
+		EP_STAT_CHECK(estat, return estat);
+		if (ix->hdr->magic == SEGLOG_IDX_MAGIC &&
+				ix->hdr->version == SEGLOG_VERSION &&
+				ix->hdr->entsize == entsize &&
+				(ix->hdr->interval == 0) == (interval == 0) &&
+				SEGLOG_IX_HDRSIZE + ix->hdr->nent * entsize <=
+						(uint64_t) st.st_size)
+		{
+			*validp = true;
+			return EP_STAT_OK;
+		}
+		ep_dbg_cprintf(Dbg, 3, "ix_open(%s): unusable header, rebuilding\n",
+				ix_path);
+	}
+	return ix_reset(ix, entsize, interval);
+}
+
+static void
+ix_close(struct seglog_index *ix)
+{
+	if (ix->base != NULL)
+		munmap(ix->base, ix->mapsize);
+	ix->base = NULL;
+	ix->hdr = NULL;
+	if (ix->fd >= 0)
+		close(ix->fd);
+	ix->fd = -1;
+}
+
+static EP_STAT
+ix_sync(struct seglog_index *ix, bool hdr_only)
+{
+	size_t len = SEGLOG_IX_HDRSIZE;
+
+	if (!hdr_only)
+		len += ix->hdr->nent * ix->hdr->entsize;
+	if (msync(ix->base, len, MS_SYNC) < 0)
+		return posix_error(errno, "seglog: cannot sync index");
+	return EP_STAT_OK;
+}
+
+
+/*
+**  Segments.
+*/
+
+#ifdef __APPLE__
+# define fdatasync(fd)	fsync(fd)
+#endif
+
+static struct seglog_seg *
+seg_add(gob_physinfo_t *phys)
+{
+	if (phys->nsegs >= phys->nsegalloc)
+	{
+		phys->nsegalloc = phys->nsegalloc == 0 ? 4 : phys->nsegalloc * 2;
+		phys->segs = ep_mem_realloc(phys->segs,
+							phys->nsegalloc * sizeof *phys->segs);
+	}
+	struct seglog_seg *seg = &phys->segs[phys->nsegs++];
+	memset(seg, 0, sizeof *seg);
+	seg->fd = -1;
+	return seg;
+}
+
+static void
+seg_close(struct seglog_seg *seg)
+{
+	hidx_free(seg->hidx);
+	seg->hidx = NULL;
+	if (seg->fd >= 0)
+		close(seg->fd);
+	seg->fd = -1;
+}
+
+/*
+**  SYNC_DIR --- make a newly created file in the log directory durable
+*/
+
+static void
+sync_dir(gdp_gob_t *gob)
+{
+	char dbuf[GOB_PATH_MAX];
+	int fd;
+
+	snprintf(dbuf, sizeof dbuf, "%s/_%02x", LogDir, gob->name[0]);
+	fd = open(dbuf, O_RDONLY);
+	if (fd < 0)
+		return;
+	if (fsync(fd) < 0)
+		(void) posix_error(errno, "seglog: fsync(%s)", dbuf);
+	close(fd);
+}
+
+/*
+**  SEG_CREATE --- create a new segment and make it the last one
+**
+**		Only segment zero has metadata.
+*/
+
+static EP_STAT
+seg_create(gdp_gob_t *gob,
+		gob_physinfo_t *phys,
+		uint32_t segno,
+		const uint8_t *md,
+		size_t mdlen)
+{
+	EP_STAT estat;
+	char seg_path[GOB_PATH_MAX];
+	uint32_t hdrlen = ROUNDUP(SEGLOG_SEG_HDRSIZE + mdlen, SEGLOG_REC_ALIGN);
+	uint8_t *hbuf;
+	EP_TIME_SPEC now;
+	int fd;
+
+	estat = get_seg_path(gob, segno, seg_path, sizeof seg_path);
+	EP_STAT_CHECK(estat, return estat);
+
+	ep_dbg_cprintf(Dbg, 20, "seg_create: creating %s\n", seg_path);
+	fd = open(seg_path, O_RDWR | O_CREAT | O_EXCL, GOBfilemode);
+	if (fd < 0)
+		return posix_error(errno, "seg_create(%s)", seg_path);
+
+	hbuf = ep_mem_zalloc(hdrlen);
+	ep_time_now(&now);
+	{
+		uint8_t *pbp = hbuf;
+
+		PUT32(SEGLOG_SEG_MAGIC);
+		PUT32(SEGLOG_VERSION);
+		PUT32(hdrlen);
+		PUT32(mdlen);
+		PUT32(segno);
+		PUT32(0);
+		PUT64((uint64_t) ep_time_to_nsec(&now));
+		if (mdlen > 0)
+			memcpy(pbp, md, mdlen);
+	}
+	if (pwrite(fd, hbuf, hdrlen, 0) != hdrlen || fsync(fd) < 0)
+	{
+		estat = posix_error(errno, "seg_create(%s): cannot write header",
+					seg_path);
+		ep_mem_free(hbuf);
+		close(fd);
+		unlink(seg_path);
+		return estat;
+	}
+	ep_mem_free(hbuf);
+	sync_dir(gob);
+
+	struct seglog_seg *seg = seg_add(phys);
+	seg->fd = fd;
+	seg->segno = segno;
+	seg->hdrlen = hdrlen;
+	seg->size = seg->synced = hdrlen;
+	return EP_STAT_OK;
+}
+
+/*
+**  SEG_OPEN --- open an existing segment and add it to the list
+**
+**		Returns GDP_STAT_NAK_NOTFOUND if there is no such segment.
+*/
+
+static EP_STAT
+seg_open(gdp_gob_t *gob, gob_physinfo_t *phys, uint32_t segno)
+{
+	EP_STAT estat;
+	char seg_path[GOB_PATH_MAX];
+	uint8_t hbuf[SEGLOG_SEG_HDRSIZE];
+	uint32_t magic, version, hdrlen, mdlen, hsegno;
+	struct stat st;
+	int fd;
+
+	estat = get_seg_path(gob, segno, seg_path, sizeof seg_path);
+	EP_STAT_CHECK(estat, return estat);
+
+	fd = open(seg_path, O_RDWR);
+	if (fd < 0)
+	{
+		if (errno == ENOENT)
+			return GDP_STAT_NAK_NOTFOUND;
+		return posix_error(errno, "seg_open(%s)", seg_path);
+	}
+	if (fstat(fd, &st) < 0)
+	{
+		estat = posix_error(errno, "seg_open(%s): fstat", seg_path);
+		close(fd);
+		return estat;
+	}
+	if (pread(fd, hbuf, sizeof hbuf, 0) != sizeof hbuf)
+		goto corrupt;
+	{
+		const uint8_t *pbp = hbuf;
+
+		GET32(magic);
+		GET32(version);
+		GET32(hdrlen);
+		GET32(mdlen);
+		GET32(hsegno);
+	}
+	if (magic != SEGLOG_SEG_MAGIC)
+		goto corrupt;
+	if (version != SEGLOG_VERSION)
+	{
+		ep_log(GDP_STAT_LOG_VERSION_MISMATCH,
+				"seg_open(%s): version %" PRIu32 ", expected %" PRIu32,
+				seg_path, version, SEGLOG_VERSION);
+		close(fd);
+		return GDP_STAT_LOG_VERSION_MISMATCH;
+	}
+	if (hsegno != segno || hdrlen < SEGLOG_SEG_HDRSIZE + mdlen ||
+			(uint64_t) st.st_size < hdrlen)
+		goto corrupt;
+
+	struct seglog_seg *seg = seg_add(phys);
+	seg->fd = fd;
+	seg->segno = segno;
+	seg->hdrlen = hdrlen;
+	seg->size = seg->synced = st.st_size;
+	ep_dbg_cprintf(Dbg, 20, "seg_open(%s): %" PRIu64 " bytes\n",
+			seg_path, seg->size);
+	return EP_STAT_OK;
+
+corrupt:
+	ep_log(GDP_STAT_CORRUPT_LOG, "seg_open(%s): bad segment header", seg_path);
+	close(fd);
+	return GDP_STAT_CORRUPT_LOG;
+}
+
+/*
+**  SEG_READ_METADATA --- read the metadata out of segment zero
+*/
+
+static EP_STAT
+seg_read_metadata(gob_physinfo_t *phys, gdp_md_t **gmdp)
+{
+	uint8_t hbuf[SEGLOG_SEG_HDRSIZE];
+	uint32_t mdlen;
+	uint8_t *md;
+
+	*gmdp = NULL;
+	if (phys->nsegs < 1 ||
+			pread(phys->segs[0].fd, hbuf, sizeof hbuf, 0) != sizeof hbuf)
+		return GDP_STAT_CORRUPT_LOG;
+	{
+		const uint8_t *pbp = hbuf + 12;
+
+		GET32(mdlen);
+	}
+	if (mdlen == 0)
+		return GDP_STAT_METADATA_REQUIRED;
+	if (SEGLOG_SEG_HDRSIZE + mdlen > phys->segs[0].hdrlen)
+		return GDP_STAT_CORRUPT_LOG;
+
+	md = ep_mem_malloc(mdlen);
+	if (pread(phys->segs[0].fd, md, mdlen, SEGLOG_SEG_HDRSIZE) != mdlen)
+	{
+		ep_mem_free(md);
+		return posix_error(errno, "seg_read_metadata: pread");
+	}
+	*gmdp = _gdp_md_deserialize(md, mdlen);
+	ep_mem_free(md);
+	return *gmdp == NULL ? GDP_STAT_CORRUPT_LOG : EP_STAT_OK;
+}
+
+/*
+**  SEG_SYNC --- push appended data to disk
+**
+**		If force is false this only does anything if syncing on
+**		commit is enabled.
+*/
+
+static EP_STAT
+seg_sync(gob_physinfo_t *phys, bool force)
+{
+	int i;
+
+	if (!force && !SyncOnCommit)
+		return EP_STAT_OK;
+	for (i = phys->nsegs - 1; i >= 0; i--)
+	{
+		struct seglog_seg *seg = &phys->segs[i];
+
+		if (seg->synced >= seg->size)
+			break;
+		if (fdatasync(seg->fd) < 0)
+			return posix_error(errno, "seglog: fdatasync segment %" PRIu32,
+						seg->segno);
+		seg->synced = seg->size;
+	}
+	return EP_STAT_OK;
+}
+
+
+/*
+**  NOTE_RECORD --- add a record to the indices
+**
+**		Used both when appending and when recovering.  If a record
+**		number is already present the first one wins.
+*/
+
+static EP_STAT
+note_record(gob_physinfo_t *phys,
+		gdp_recno_t recno,
+		EP_TIME_SPEC *ts,
+		uint32_t segno,
+		uint64_t offset,
+		uint32_t reclen)
+{
+	EP_STAT estat;
+	struct seglog_ixhdr *rh;
+	struct seglog_ixhdr *th;
+
+	if (recno > 0)
+	{
+		struct seglog_rix_ent *re;
+		uint64_t slot = recno - 1;
+
+		estat = ix_reserve(&phys->rix, slot + 1);
+		EP_STAT_CHECK(estat, return estat);
+		rh = phys->rix.hdr;
+		re = SEGLOG_IX_ENT(&phys->rix, struct seglog_rix_ent, slot);
+		if (re->reclen == 0)
+		{
+			re->offset = offset;
+			re->segno = segno;
+			re->reclen = reclen;
+		}
+		if (slot >= rh->nent)
+			rh->nent = slot + 1;
+		if (recno > phys->max_recno)
+			phys->max_recno = recno;
+		if (recno < phys->min_recno)
+			phys->min_recno = recno;
+	}
+
+	{
+		struct seglog_tix_ent *te;
+		int64_t ts_ns = ep_time_to_nsec(ts);
+		uint64_t blk = phys->nappended / phys->tix.hdr->interval;
+
+		estat = ix_reserve(&phys->tix, blk + 1);
+		EP_STAT_CHECK(estat, return estat);
+		th = phys->tix.hdr;
+		te = SEGLOG_IX_ENT(&phys->tix, struct seglog_tix_ent, blk);
+		if (blk >= th->nent)
+		{
+			// first record of a new block
+			te->max_ts = ts_ns;
+			if (blk > 0 && te[-1].max_ts > ts_ns)
+				te->max_ts = te[-1].max_ts;
+			te->segno = segno;
+			te->offset = offset;
+			th->nent = blk + 1;
+		}
+		else if (ts_ns > te->max_ts)
+		{
+			te->max_ts = ts_ns;
+		}
+	}
+
+	phys->nappended++;
+	phys->nsinceckpt++;
+	return EP_STAT_OK;
+}
+
+/*
+**  RIX_BOUNDS --- compute the minimum and maximum record numbers
+**
+**		Trailing empty entries are dropped.
+*/
+
+static void
+rix_bounds(gob_physinfo_t *phys)
+{
+	struct seglog_ixhdr *rh = phys->rix.hdr;
+	uint64_t slot;
+
+	while (rh->nent > 0 &&
+			SEGLOG_IX_ENT(&phys->rix, struct seglog_rix_ent,
+						rh->nent - 1)->reclen == 0)
+		rh->nent--;
+	phys->max_recno = rh->nent;
+
+	phys->min_recno = 1;
+	for (slot = 0; slot < rh->nent; slot++)
+	{
+		if (SEGLOG_IX_ENT(&phys->rix, struct seglog_rix_ent,
+						slot)->reclen != 0)
+		{
+			phys->min_recno = slot + 1;
+			break;
+		}
+	}
+}
+
+/*
+**  RIX_SWEEP --- drop recno index entries that point past the data
+**
+**		After a crash some index pages may have been written even
+**		though the data they describe was not, and after an aborted
+**		transaction the data has been cut off.  This looks at the
+**		whole index, so it is only used in those two cases.
+*/
+
+static void
+rix_sweep(gob_physinfo_t *phys)
+{
+	struct seglog_ixhdr *rh = phys->rix.hdr;
+	uint64_t slot;
+
+	for (slot = 0; slot < rh->nent; slot++)
+	{
+		struct seglog_rix_ent *re;
+
+		re = SEGLOG_IX_ENT(&phys->rix, struct seglog_rix_ent, slot);
+		if (re->reclen != 0 &&
+				(re->segno >= (uint32_t) phys->nsegs ||
+				 re->offset + re->reclen > phys->segs[re->segno].size))
+			memset(re, 0, sizeof *re);
+	}
+	rix_bounds(phys);
+}
+
+/*
+**  SEGLOG_CHECKPOINT --- make the indices durable up to this point
+**
+**		Data first, then the index entries describing it, and only
+**		then the checkpoint saying the index entries are good.
+*/
+
+static EP_STAT
+seglog_checkpoint(gob_physinfo_t *phys)
+{
+	EP_STAT estat;
+	struct seglog_ixhdr *rh = phys->rix.hdr;
+	struct seglog_seg *seg = &phys->segs[phys->nsegs - 1];
+
+	estat = seg_sync(phys, true);
+	EP_STAT_CHECK(estat, return estat);
+	estat = ix_sync(&phys->tix, false);
+	EP_STAT_CHECK(estat, return estat);
+	estat = ix_sync(&phys->rix, false);
+	EP_STAT_CHECK(estat, return estat);
+
+	rh->ckpt_segno = seg->segno;
+	rh->ckpt_offset = seg->size;
+	rh->ckpt_nappended = phys->nappended;
+	estat = ix_sync(&phys->rix, true);
+	EP_STAT_CHECK(estat, return estat);
+
+	ep_dbg_cprintf(Dbg, 21, "seglog_checkpoint: seg %" PRIu32
+			" offset %" PRIu64 " nappended %" PRIu64 "\n",
+			rh->ckpt_segno, rh->ckpt_offset, rh->ckpt_nappended);
+	phys->nsinceckpt = 0;
+	return EP_STAT_OK;
+}
+
+/*
+**  SEGLOG_RECOVER --- bring the indices up to date with the segments
+**
+**		If the log was closed cleanly the indices can be used as is.
+**		Otherwise scan forward from the last checkpoint (or from the
+**		beginning if there isn't a usable one), stopping at the first
+**		record that is incomplete or has a bad CRC.  Anything after
+**		that in the last segment is a partial write and is cut off;
+**		a bad record anywhere else means real corruption.
+*/
+
+static EP_STAT
+seglog_recover(gdp_gob_t *gob, gob_physinfo_t *phys, bool ix_valid)
+{
+	EP_STAT estat = EP_STAT_OK;
+	struct seglog_ixhdr *rh = phys->rix.hdr;
+	struct seglog_ixhdr *th = phys->tix.hdr;
+	struct seglog_seg *last = &phys->segs[phys->nsegs - 1];
+	struct seglog_reader rd;
+	struct rec_info ri;
+	uint32_t segno = rh->ckpt_segno;
+	uint64_t off = rh->ckpt_offset;
+	uint64_t nrecovered = 0;
+
+	if (ix_valid && EP_UT_BITSET(SEGLOG_IXF_CLEAN, rh->flags) &&
+			segno == last->segno && off == last->size)
+	{
+		// closed cleanly and nothing has changed since
+		phys->nappended = rh->ckpt_nappended;
+		rix_bounds(phys);
+		return EP_STAT_OK;
+	}
+
+	if (!ix_valid || segno >= (uint32_t) phys->nsegs ||
+			off < phys->segs[segno].hdrlen || off > phys->segs[segno].size ||
+			rh->ckpt_nappended > (th->nent * (uint64_t) th->interval))
+	{
+		// no usable checkpoint: start over
+		ep_dbg_cprintf(Dbg, 3, "seglog_recover(%s): rebuilding indices\n",
+				gob->pname);
+		estat = ix_reset(&phys->rix, sizeof (struct seglog_rix_ent), 0);
+		EP_STAT_CHECK(estat, return estat);
+		estat = ix_reset(&phys->tix, sizeof (struct seglog_tix_ent),
+						TsInterval);
+		EP_STAT_CHECK(estat, return estat);
+		rh = phys->rix.hdr;
+		th = phys->tix.hdr;
+		segno = 0;
+		off = phys->segs[0].hdrlen;
+		phys->nappended = 0;
+	}
+	else
+	{
+		// the timestamp index is good through the checkpoint
+		phys->nappended = rh->ckpt_nappended;
+		th->nent = (phys->nappended + th->interval - 1) / th->interval;
+		ep_dbg_cprintf(Dbg, 3, "seglog_recover(%s): scanning from segment %"
+				PRIu32 " offset %" PRIu64 "\n",
+				gob->pname, segno, off);
+	}
+
+	reader_init(&rd);
+	for (; segno < (uint32_t) phys->nsegs; segno++)
+	{
+		struct seglog_seg *seg = &phys->segs[segno];
+
+		if (off < seg->hdrlen)
+			off = seg->hdrlen;
+		while (off < seg->size &&
+				reader_get_rec(phys, &rd, segno, off, &ri) != NULL)
+		{
+			estat = note_record(phys, ri.recno, &ri.ts, segno, off,
+							ri.reclen);
+			EP_STAT_CHECK(estat, goto done);
+			off += ri.reclen;
+			nrecovered++;
+		}
+		if (off < seg->size)
+		{
+			if (seg != last)
+			{
+				estat = GDP_STAT_CORRUPT_LOG;
+				ep_log(estat, "seglog_recover(%s): bad record in segment %"
+						PRIu32 " at offset %" PRIu64,
+						gob->pname, segno, off);
+				goto done;
+			}
+			ep_log(GDP_STAT_CORRUPT_LOG,
+					"seglog_recover(%s): truncating segment %" PRIu32
+					" from %" PRIu64 " to %" PRIu64,
+					gob->pname, segno, seg->size, off);
+			if (ftruncate(seg->fd, off) < 0)
+			{
+				estat = posix_error(errno, "seglog_recover: ftruncate");
+				goto done;
+			}
+			seg->size = seg->synced = off;
+		}
+		off = 0;
+	}
+
+	// anything pointing into what was just cut off has to go
+	rix_sweep(phys);
+	estat = seglog_checkpoint(phys);
+	if (EP_STAT_ISOK(estat))
+	{
+		rh->flags |= SEGLOG_IXF_CLEAN;
+		estat = ix_sync(&phys->rix, true);
+	}
+	ep_dbg_cprintf(Dbg, 3, "seglog_recover(%s): %" PRIu64 " records recovered, "
+			"max_recno %" PRIgdp_recno "\n",
+			gob->pname, nrecovered, phys->max_recno);
+
+done:
+	reader_free(&rd);
+	return estat;
+}
+
+
+/*
+**  Allocate/Free the in-memory version of the physical representation
+**		of a GOB.
+*/
+
+static gob_physinfo_t *
+physinfo_alloc(gdp_gob_t *gob)
+{
+	gob_physinfo_t *phys = (gob_physinfo_t *) ep_mem_zalloc(sizeof *phys);
+
+	if (ep_thr_rwlock_init(&phys->lock) != 0)
+		goto fail1;
+	ep_thr_mutex_init(&phys->hidx_mutex, EP_THR_MUTEX_DEFAULT);
+	ep_thr_mutex_setorder(&phys->hidx_mutex, GDP_MUTEX_LORDER_LEAF);
+	phys->rix.fd = phys->tix.fd = -1;
+	phys->min_recno = 1;
+
+	return phys;
+
+fail1:
+	ep_dbg_cprintf(Dbg, 1, "physinfo_alloc: cannot create rwlock: %s\n",
+			strerror(errno));
+	ep_mem_free(phys);
+	return NULL;
+}
+
+
+static void
+physinfo_free(gob_physinfo_t *phys)
+{
+	int i;
+
+	if (phys == NULL)
+		return;
+
+	for (i = 0; i < phys->nsegs; i++)
+		seg_close(&phys->segs[i]);
+	if (phys->segs != NULL)
+		ep_mem_free(phys->segs);
+	ix_close(&phys->rix);
+	ix_close(&phys->tix);
+	if (phys->wbuf != NULL)
+		ep_mem_free(phys->wbuf);
+
+	ep_thr_mutex_destroy(&phys->hidx_mutex);
+	if (ep_thr_rwlock_destroy(&phys->lock) != 0)
+		(void) posix_error(errno, "physinfo_free: cannot destroy rwlock");
+
+	ep_mem_free(phys);
+}
+
+
+static void
+physinfo_dump(gob_physinfo_t *phys, FILE *fp)
+{
+	fprintf(fp, "physinfo @ %p: min_recno %" PRIgdp_recno
+			", max_recno %" PRIgdp_recno "\n",
+			phys, phys->min_recno, phys->max_recno);
+	fprintf(fp, "\tnsegs %d, nappended %" PRIu64 ", ver %d\n",
+			phys->nsegs, phys->nappended, phys->ver);
+}
+
+
+/*
+**  SEGLOG_CREATE --- create a brand new GOB on disk
+*/
+
+static EP_STAT
+seglog_create(gdp_gob_t *gob, gdp_md_t *gmd)
+{
+	EP_STAT estat = EP_STAT_OK;
+	gob_physinfo_t *phys;
+	const char *phase = "init";
+	uint8_t *obuf = NULL;
+	size_t mdsize = 0;
+	bool valid;
+
+	EP_ASSERT_POINTER_VALID(gob);
+
+	// allocate space for the physical information
+	phys = physinfo_alloc(gob);
+	if (phys == NULL)
+		goto fail0;
+	gob->x->physinfo = phys;
+
+	// allocate a name
+	if (!gdp_name_is_valid(gob->name))
+	{
+		estat = _gdp_gob_newname(gob);
+		EP_STAT_CHECK(estat, goto fail0);
+	}
+
+	phase = "metadata";
+	if (gmd != NULL)
+		mdsize = _gdp_md_serialize(gmd, &obuf);
+	if (gmd == NULL || mdsize == 0)
+	{
+		ep_dbg_cprintf(Dbg, 1, "seglog_create: no metadata (gmd %p)\n", gmd);
+		estat = GDP_STAT_METADATA_REQUIRED;
+		goto fail0;
+	}
+
+	phase = "segment";
+	estat = seg_create(gob, phys, 0, obuf, mdsize);
+	EP_STAT_CHECK(estat, goto fail0);
+
+	phase = "indices";
+	estat = ix_open(gob, &phys->rix, SEGLOG_RIX_SUFFIX,
+					sizeof (struct seglog_rix_ent), 0, &valid);
+	EP_STAT_CHECK(estat, goto fail0);
+	estat = ix_reset(&phys->rix, sizeof (struct seglog_rix_ent), 0);
+	EP_STAT_CHECK(estat, goto fail0);
+	estat = ix_open(gob, &phys->tix, SEGLOG_TIX_SUFFIX,
+					sizeof (struct seglog_tix_ent), TsInterval, &valid);
+	EP_STAT_CHECK(estat, goto fail0);
+	estat = ix_reset(&phys->tix, sizeof (struct seglog_tix_ent), TsInterval);
+	EP_STAT_CHECK(estat, goto fail0);
+	estat = seglog_checkpoint(phys);
+	EP_STAT_CHECK(estat, goto fail0);
+
+	ep_mem_free(obuf);
+	phys->ver = SEGLOG_VERSION;
+	phys->min_recno = 1;
+	phys->max_recno = 0;
+	phys->flags |= DefaultLogFlags;
+	ep_dbg_cprintf(Dbg, 11, "Created new GDP Log %s\n", gob->pname);
+	return estat;
+
+fail0:
+	if (obuf != NULL)
+		ep_mem_free(obuf);
+
+	// turn OK into an errno-based code
+	if (EP_STAT_ISOK(estat))
+		estat = ep_stat_from_errno(errno);
+	if (EP_STAT_ISOK(estat))
+		estat = GDP_STAT_NAK_INTERNAL;
+
+	// turn "file exists" into a meaningful response code
+	if (EP_STAT_IS_SAME(estat, ep_stat_from_errno(EEXIST)))
+			estat = GDP_STAT_NAK_CONFLICT;
+
+	// free up resources
+	if (phys != NULL)
+	{
+		physinfo_free(phys);
+		gob->x->physinfo = phys = NULL;
+	}
+
+	if (ep_dbg_test(Dbg, 1))
+	{
+		char ebuf[100];
+
+		ep_dbg_printf("Could not create GOB during %s: %s\n",
+				phase, ep_stat_tostr(estat, ebuf, sizeof ebuf));
+	}
+	return estat;
+}
+
+
+/*
+**	SEGLOG_OPEN --- do physical open of a GOB
+*/
+
+static EP_STAT
+seglog_open(gdp_gob_t *gob)
+{
+	EP_STAT estat = EP_STAT_OK;
+	gob_physinfo_t *phys;
+	const char *phase;
+	uint32_t segno;
+	bool rix_valid, tix_valid;
+
+	ep_dbg_cprintf(Dbg, 20, "seglog_open(%s)\n", gob->pname);
+
+	// allocate space for physical data
+	EP_ASSERT(gob->x != NULL);
+	EP_ASSERT(GETPHYS(gob) == NULL);
+	phase = "physinfo_alloc";
+	errno = 0;
+	gob->x->physinfo = phys = physinfo_alloc(gob);
+	if (phys == NULL)
+	{
+		estat = EP_STAT_OUT_OF_MEMORY;
+		goto fail0;
+	}
+	phys->flags |= DefaultLogFlags;
+	phys->ver = SEGLOG_VERSION;
+
+	// segments are numbered consecutively from zero
+	phase = "segments";
+	for (segno = 0; ; segno++)
+	{
+		estat = seg_open(gob, phys, segno);
+		if (segno > 0 && EP_STAT_IS_SAME(estat, GDP_STAT_NAK_NOTFOUND))
+			break;
+		EP_STAT_CHECK(estat, goto fail1);
+	}
+
+	// read metadata
+	phase = "metadata read";
+	if (gob->gob_md == NULL)
+	{
+		estat = seg_read_metadata(phys, &gob->gob_md);
+		EP_STAT_CHECK(estat, goto fail1);
+	}
+
+	phase = "indices";
+	estat = ix_open(gob, &phys->rix, SEGLOG_RIX_SUFFIX,
+					sizeof (struct seglog_rix_ent), 0, &rix_valid);
+	EP_STAT_CHECK(estat, goto fail1);
+	estat = ix_open(gob, &phys->tix, SEGLOG_TIX_SUFFIX,
+					sizeof (struct seglog_tix_ent), TsInterval, &tix_valid);
+	EP_STAT_CHECK(estat, goto fail1);
+
+	phase = "recovery";
+	estat = seglog_recover(gob, phys, rix_valid && tix_valid);
+	EP_STAT_CHECK(estat, goto fail1);
+	gob->nrecs = phys->max_recno;
+
+	if (ep_dbg_test(Dbg, 20))
+	{
+		ep_dbg_printf("seglog_open => ");
+		physinfo_dump(phys, ep_dbg_getfile());
+	}
+	return EP_STAT_OK;
+
+fail1:
+	physinfo_free(phys);
+	gob->x->physinfo = phys = NULL;
+
+fail0:
+	if (ep_dbg_test(Dbg, 9))
+	{
+		char ebuf[100];
+
+		ep_dbg_printf("seglog_open(%s): couldn't open GOB %s:\n\t%s\n",
+				phase, gob->pname, ep_stat_tostr(estat, ebuf, sizeof ebuf));
+	}
+	return estat;
+}
+
+
+/*
+**	SEGLOG_CLOSE --- physically close an open GOB
+**
+**		If anything was appended, checkpoint and mark the indices
+**		clean so the next open doesn't have to scan.
+*/
+
+static EP_STAT
+seglog_close(gdp_gob_t *gob)
+{
+	EP_STAT estat = EP_STAT_OK;
+	gob_physinfo_t *phys;
+
+	EP_ASSERT_POINTER_VALID(gob);
+	ep_dbg_cprintf(Dbg, 20, "seglog_close(%s)\n", gob->pname);
+
+	if (gob->x == NULL || GETPHYS(gob) == NULL)
+	{
+		// close as a result of incomplete open; just ignore it
+		return EP_STAT_OK;
+	}
+	phys = GETPHYS(gob);
+
+	if (EP_UT_BITSET(LOG_DIRTY, phys->flags))
+	{
+		estat = seglog_checkpoint(phys);
+		if (EP_STAT_ISOK(estat))
+		{
+			phys->rix.hdr->flags |= SEGLOG_IXF_CLEAN;
+			estat = ix_sync(&phys->rix, true);
+		}
+	}
+	physinfo_free(phys);
+	gob->x->physinfo = NULL;
+
+	return estat;
+}
+
+
+/*
+**  SEGLOG_REMOVE --- remove a disk-based log
+**
+**		It is assume that permission has already been granted.
+*/
+
+static EP_STAT
+seglog_remove(gdp_gob_t *gob)
+{
+	EP_STAT estat = EP_STAT_OK;
+
+	if (!EP_ASSERT_POINTER_VALID(gob) || !EP_ASSERT_POINTER_VALID(gob->x))
+		return EP_STAT_ASSERT_ABORT;
+
+	ep_dbg_cprintf(Dbg, 18, "seglog_remove(%s)\n", gob->pname);
+
+	DIR *dir;
+	char dbuf[GOB_PATH_MAX];
+
+	snprintf(dbuf, sizeof dbuf, "%s/_%02x", LogDir, gob->name[0]);
+	dir = opendir(dbuf);
+	if (dir == NULL)
+	{
+		estat = ep_stat_from_errno(errno);
+		goto fail0;
+	}
+
+	for (;;)
+	{
+		struct dirent *dent;
+
+		// read the next directory entry
+		dent = readdir(dir);
+		if (dent == NULL)
+			break;
+
+		if (strncmp(gob->pname, dent->d_name, GDP_GOB_PNAME_LEN) == 0)
+		{
+			char filenamebuf[GOB_PATH_MAX];
+
+			ep_dbg_cprintf(Dbg, 50, "  unlinking %s\n", dent->d_name);
+			snprintf(filenamebuf, sizeof filenamebuf, "_%02x/%s",
+					gob->name[0], dent->d_name);
+			if (unlink(filenamebuf) < 0)
+				estat = posix_error(errno, "unlink(%s)", filenamebuf);
+		}
+	}
+	closedir(dir);
+
+fail0:
+	physinfo_free(GETPHYS(gob));
+	gob->x->physinfo = NULL;
+
+	return estat;
+}
+
+
+/*
+**  Produce a datum from a record and hand it to the caller.
+*/
+
+static void
+deliver_rec(struct rec_info *ri,
+		gdp_result_cb_t *cb,
+		gdp_result_ctx_t *cb_ctx)
+{
+	gdp_datum_t *datum = gdp_datum_new();
+	int hashalg = EP_CRYPTO_MD_NULL;		//FIXME: should come from GOB
+
+	datum->recno = ri->recno;
+	datum->ts = ri->ts;
+
+	if (datum->prevhash == NULL)
+		datum->prevhash = gdp_hash_new(hashalg,
+								(void *) ri->prevhash, ri->prevhashlen);
+	else
+		gdp_hash_set(datum->prevhash, (void *) ri->prevhash, ri->prevhashlen);
+
+	if (datum->dbuf == NULL)
+		datum->dbuf = gdp_buf_new();
+	else
+		gdp_buf_reset(datum->dbuf);
+	if (ri->datalen > 0)
+		gdp_buf_write(datum->dbuf, ri->data, ri->datalen);
+
+	if (datum->sig == NULL)
+		datum->sig = gdp_sig_new(hashalg, (void *) ri->sig, ri->siglen);
+	else
+		gdp_sig_set(datum->sig, (void *) ri->sig, ri->siglen);
+
+	(void) (*cb)(GDP_STAT_ACK_CONTENT, datum, cb_ctx);
+
+	gdp_datum_free(datum);
+}
+
+/*
+**  Final status of a read; matches process_select_results in
+**  logd_sqlite.c.
+*/
+
+static EP_STAT
+read_result_stat(int nresults, bool one_only)
+{
+	if (nresults <= 0)
+		return GDP_STAT_NAK_NOTFOUND;
+	if (one_only)
+		return GDP_STAT_RESPONSE_SENT;
+	return GDP_STAT_ACK_END_OF_RESULTS;
+}
+
+static EP_STAT
+bad_record(gdp_gob_t *gob, uint32_t segno, uint64_t offset)
+{
+	ep_log(GDP_STAT_CORRUPT_LOG,
+			"seglog(%s): unreadable record in segment %" PRIu32
+			" at offset %" PRIu64,
+			gob->pname, segno, offset);
+	return GDP_STAT_CORRUPT_LOG;
+}
+
+
+/*
+**  Appends in an open transaction are already in the segments and
+**  indices, but the GOB is not locked while a group commit runs (see
+**  logd_commit.c), so readers have to skip them: they may yet be
+**  rolled back.  Everything before the end of the log as of
+**  xact_begin is committed.  Must be called with phys->lock held.
+*/
+
+static bool
+rec_committed(gob_physinfo_t *phys, uint32_t segno, uint64_t off)
+{
+	uint32_t lastseg;
+
+	if (!phys->xact.active)
+		return true;
+	lastseg = (uint32_t) phys->xact.nsegs - 1;
+	return segno < lastseg || (segno == lastseg && off < phys->xact.segsize);
+}
+
+
+/*
+**  SEGLOG_READ_BY_HASH --- read record indexed by record hash
+*/
+
+#define MAX_HASH_CANDIDATES		8
+
+static EP_STAT
+seglog_read_by_hash(gdp_gob_t *gob,
+		gdp_hash_t *hash,
+		gdp_result_cb_t *cb,
+		void *cb_ctx)
+{
+	EP_STAT estat = EP_STAT_OK;
+	gob_physinfo_t *phys = GETPHYS(gob);
+	size_t hashlen;
+	const uint8_t *hashptr = gdp_hash_getptr(hash, &hashlen);
+	struct seglog_reader rd;
+	int nresults = 0;
+	int i;
+
+	EP_ASSERT_POINTER_VALID(gob);
+
+	if (ep_dbg_test(Dbg, 44))
+	{
+		ep_dbg_printf("seglog_read_by_hash(%s\n    ", gob->pname);
+		ep_hexdump(hashptr, hashlen, ep_dbg_getfile(), EP_HEXDUMP_TERSE, 0);
+		ep_dbg_printf("\n");
+	}
+	if (hashptr == NULL || hashlen == 0)
+		return GDP_STAT_NAK_NOTFOUND;
+
+	uint64_t key = hash_key(hashptr, hashlen);
+	reader_init(&rd);
+	ep_thr_rwlock_rdlock(&phys->lock);
+
+	// newest segments first: recent records are the likely targets
+	for (i = phys->nsegs - 1; i >= 0 && nresults == 0; i--)
+	{
+		struct seglog_seg *seg = &phys->segs[i];
+		struct seglog_hashidx *hx;
+		uint64_t cand[MAX_HASH_CANDIDATES];
+		int ncand = 0;
+		int c;
+		uint32_t h;
+
+		ep_thr_mutex_lock(&phys->hidx_mutex);
+		hx = hidx_catch_up(phys, seg);
+		if (hx->ents != NULL)
+		{
+			for (h = key & hx->mask; hx->ents[h].key != 0;
+					h = (h + 1) & hx->mask)
+			{
+				if (hx->ents[h].key == key && ncand < MAX_HASH_CANDIDATES)
+					cand[ncand++] = hx->ents[h].off;
+			}
+		}
+		ep_thr_mutex_unlock(&phys->hidx_mutex);
+
+		for (c = 0; c < ncand; c++)
+		{
+			struct rec_info ri;
+
+			if (!rec_committed(phys, seg->segno, cand[c]))
+				continue;
+			if (reader_get_rec(phys, &rd, seg->segno, cand[c], &ri) == NULL)
+				continue;
+			if (ri.hashlen != hashlen || memcmp(ri.hash, hashptr, hashlen) != 0)
+				continue;
+			deliver_rec(&ri, cb, cb_ctx);
+			nresults++;
+			break;
+		}
+	}
+
+	ep_thr_rwlock_unlock(&phys->lock);
+	reader_free(&rd);
+
+	estat = read_result_stat(nresults, true);
+	char ebuf[100];
+	ep_dbg_cprintf(Dbg, 44, "seglog_read_by_hash => %s\n",
+				ep_stat_tostr(estat, ebuf, sizeof ebuf));
+	return estat;
+}
+
+
+/*
+**  SEGLOG_READ_BY_RECNO --- read record indexed by record number
+**
+**		Missing record numbers are skipped, as in the SQLite version.
+*/
+
+static EP_STAT
+seglog_read_by_recno(gdp_gob_t *gob,
+		gdp_recno_t startrec,
+		uint32_t maxrecs,
+		gdp_result_cb_t *cb,
+		void *cb_ctx)
+{
+	EP_STAT estat = EP_STAT_OK;
+	gob_physinfo_t *phys = GETPHYS(gob);
+	bool one_only = maxrecs == 0;
+	struct seglog_reader rd;
+	uint32_t nresults = 0;
+	gdp_recno_t recno = startrec;
+
+	if (!EP_ASSERT_POINTER_VALID(gob))
+		return EP_STAT_ASSERT_ABORT;
+
+	ep_dbg_cprintf(Dbg, 44, "seglog_read_by_recno(%s) rec %" PRIgdp_recno ", n %d\n",
+			gob->pname, startrec, maxrecs);
+	if (one_only)
+		maxrecs = 1;
+	else if (recno < 1)
+		recno = 1;
+
+	reader_init(&rd);
+	ep_thr_rwlock_rdlock(&phys->lock);
+
+	for (; nresults < maxrecs && recno >= 1 &&
+				(uint64_t) recno <= phys->rix.hdr->nent; recno++)
+	{
+		struct seglog_rix_ent *re;
+		struct rec_info ri;
+
+		re = SEGLOG_IX_ENT(&phys->rix, struct seglog_rix_ent, recno - 1);
+		if (re->reclen == 0 || !rec_committed(phys, re->segno, re->offset))
+		{
+			if (one_only)
+				break;
+			continue;
+		}
+		if (reader_get_rec(phys, &rd, re->segno, re->offset, &ri) == NULL)
+		{
+			estat = bad_record(gob, re->segno, re->offset);
+			break;
+		}
+		deliver_rec(&ri, cb, cb_ctx);
+		nresults++;
+	}
+
+	ep_thr_rwlock_unlock(&phys->lock);
+	reader_free(&rd);
+
+	if (EP_STAT_ISOK(estat))
+		estat = read_result_stat(nresults, one_only);
+	char ebuf[100];
+	ep_dbg_cprintf(Dbg, 44, "seglog_read_by_recno => %s\n",
+				ep_stat_tostr(estat, ebuf, sizeof ebuf));
+	return estat;
+}
+
+
+/*
+**  Candidates for seglog_read_by_timestamp.  Records need not be
+**  appended in timestamp order, so the scan keeps the maxrecs
+**  earliest in a max-heap (latest at the root) and sorts them before
+**  delivery.  Ties go to the earlier append.
+*/
+
+struct ts_cand
+{
+	int64_t				ts;					// timestamp (ns)
+	uint32_t			segno;
+	uint64_t			offset;
+};
+
+static int
+ts_cand_cmp(const void *a, const void *b)
+{
+	const struct ts_cand *x = (const struct ts_cand *) a;
+	const struct ts_cand *y = (const struct ts_cand *) b;
+
+	if (x->ts != y->ts)
+		return x->ts < y->ts ? -1 : 1;
+	if (x->segno != y->segno)
+		return x->segno < y->segno ? -1 : 1;
+	if (x->offset != y->offset)
+		return x->offset < y->offset ? -1 : 1;
+	return 0;
+}
+
+static void
+ts_heap_up(struct ts_cand *h, size_t i)
+{
+	while (i > 0)
+	{
+		size_t parent = (i - 1) / 2;
+		struct ts_cand t;
+
+		if (ts_cand_cmp(&h[parent], &h[i]) >= 0)
+			break;
+		t = h[parent];
+		h[parent] = h[i];
+		h[i] = t;
+		i = parent;
+	}
+}
+
+static void
+ts_heap_down(struct ts_cand *h, size_t n, size_t i)
+{
+	for (;;)
+	{
+		size_t big = i;
+		size_t c = 2 * i + 1;
+		struct ts_cand t;
+
+		if (c < n && ts_cand_cmp(&h[c], &h[big]) > 0)
+			big = c;
+		if (c + 1 < n && ts_cand_cmp(&h[c + 1], &h[big]) > 0)
+			big = c + 1;
+		if (big == i)
+			break;
+		t = h[big];
+		h[big] = h[i];
+		h[i] = t;
+		i = big;
+	}
+}
+
+
+/*
+**  SEGLOG_READ_BY_TIMESTAMP --- read record indexed by timestamp
+**
+**		Binary search the timestamp index for the first block that
+**		could contain a record at or after start_time, then read
+**		forward from there to the end of the committed log.  Results
+**		are in timestamp order, as in the SQLite version.
+*/
+
+static EP_STAT
+seglog_read_by_timestamp(gdp_gob_t *gob,
+		EP_TIME_SPEC *start_time,
+		uint32_t maxrecs,
+		gdp_result_cb_t *cb,
+		void *cb_ctx)
+{
+	EP_STAT estat = EP_STAT_OK;
+	gob_physinfo_t *phys = GETPHYS(gob);
+	bool one_only = maxrecs == 0;
+	struct seglog_reader rd;
+	uint32_t nresults = 0;
+	int64_t start_ns = ep_time_to_nsec(start_time);
+	struct ts_cand *cand = NULL;
+	size_t ncand = 0;
+	size_t candsize = 0;
+	size_t c;
+
+	EP_ASSERT_POINTER_VALID(gob);
+
+	if (ep_dbg_test(Dbg, 44))
+	{
+		char time_buf[100];
+		ep_time_format(start_time, time_buf, sizeof time_buf,
+					EP_TIME_FMT_HUMAN);
+		ep_dbg_cprintf(Dbg, 44, "seglog_read_by_timestamp(%s, %s, %d)\n",
+					gob->pname, time_buf, maxrecs);
+	}
+	if (one_only)
+		maxrecs = 1;
+
+	reader_init(&rd);
+	ep_thr_rwlock_rdlock(&phys->lock);
+
+	uint64_t lo = 0;
+	uint64_t hi = phys->tix.hdr->nent;
+	while (lo < hi)
+	{
+		uint64_t mid = lo + (hi - lo) / 2;
+
+		if (SEGLOG_IX_ENT(&phys->tix, struct seglog_tix_ent, mid)->max_ts <
+				start_ns)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	if (lo < phys->tix.hdr->nent)
+	{
+		struct seglog_tix_ent *te;
+		uint32_t segno;
+		uint64_t off;
+
+		te = SEGLOG_IX_ENT(&phys->tix, struct seglog_tix_ent, lo);
+		segno = te->segno;
+		off = te->offset;
+		for (; segno < (uint32_t) phys->nsegs; segno++)
+		{
+			struct seglog_seg *seg = &phys->segs[segno];
+
+			if (off < seg->hdrlen)
+				off = seg->hdrlen;
+			while (off < seg->size)
+			{
+				struct rec_info ri;
+				struct ts_cand tc;
+
+				// the rest of the log is still being committed
+				if (!rec_committed(phys, segno, off))
+					goto scanned;
+				if (reader_get_rec(phys, &rd, segno, off, &ri) == NULL)
+				{
+					estat = bad_record(gob, segno, off);
+					goto done;
+				}
+				tc.ts = ep_time_to_nsec(&ri.ts);
+				tc.segno = segno;
+				tc.offset = off;
+				off += ri.reclen;
+				if (tc.ts < start_ns)
+					continue;
+				if (ncand < maxrecs)
+				{
+					if (ncand >= candsize)
+					{
+						candsize = candsize == 0 ? 64 : candsize * 2;
+						if (candsize > maxrecs)
+							candsize = maxrecs;
+						cand = (struct ts_cand *) ep_mem_realloc(cand,
+										candsize * sizeof *cand);
+					}
+					cand[ncand] = tc;
+					ts_heap_up(cand, ncand++);
+				}
+				else if (ts_cand_cmp(&tc, &cand[0]) < 0)
+				{
+					cand[0] = tc;
+					ts_heap_down(cand, ncand, 0);
+				}
+			}
+			off = 0;
+		}
+	}
+
+scanned:
+	if (ncand > 0)
+		qsort(cand, ncand, sizeof *cand, ts_cand_cmp);
+	for (c = 0; c < ncand; c++)
+	{
+		struct rec_info ri;
+
+		if (reader_get_rec(phys, &rd, cand[c].segno, cand[c].offset,
+					&ri) == NULL)
+		{
+			estat = bad_record(gob, cand[c].segno, cand[c].offset);
+			break;
+		}
+		deliver_rec(&ri, cb, cb_ctx);
+		nresults++;
+	}
+
+done:
+	ep_thr_rwlock_unlock(&phys->lock);
+	reader_free(&rd);
+	if (cand != NULL)
+		ep_mem_free(cand);
+
+	if (EP_STAT_ISOK(estat))
+		estat = read_result_stat(nresults, one_only);
+	char ebuf[100];
+	ep_dbg_cprintf(Dbg, 44, "seglog_read_by_timestamp => %s\n",
+				ep_stat_tostr(estat, ebuf, sizeof ebuf));
+	return estat;
+}
+
+
+/*
+**  SEGLOG_RECNO_EXISTS --- determine if a record number already exists
+*/
+
+static bool
+seglog_recno_exists(gdp_gob_t *gob, gdp_recno_t recno)
+{
+	gob_physinfo_t *phys = GETPHYS(gob);
+	bool rval = false;
+
+	ep_thr_rwlock_rdlock(&phys->lock);
+	if (recno >= 1 && (uint64_t) recno <= phys->rix.hdr->nent)
+	{
+		struct seglog_rix_ent *re;
+
+		re = SEGLOG_IX_ENT(&phys->rix, struct seglog_rix_ent, recno - 1);
+		rval = re->reclen != 0;
+	}
+	ep_thr_rwlock_unlock(&phys->lock);
+	return rval;
+}
+
+
+/*
+**	SEGLOG_APPEND --- append a message to a writable gob
+**
+**		Outside of a transaction the append is committed immediately.
+*/
+
+static EP_STAT
+seglog_append(gdp_gob_t *gob,
+			gdp_datum_t *datum)
+{
+	EP_STAT estat = EP_STAT_OK;
+	gob_physinfo_t *phys;
+	struct seglog_seg *seg;
+	gdp_hash_t *hash;
+	size_t reclen;
+
+	if (ep_dbg_test(Dbg, 44))
+	{
+		ep_dbg_printf("seglog_append(%s):\n    ", gob->pname);
+		gdp_datum_print(datum, ep_dbg_getfile(),
+					GDP_DATUM_PRDEBUG |
+						(ep_dbg_test(Dbg, 24) ? 0 : GDP_DATUM_PRMETAONLY));
+	}
+
+	phys = GETPHYS(gob);
+	EP_ASSERT_POINTER_VALID(phys);
+	EP_ASSERT_POINTER_VALID(datum);
+
+	ep_thr_rwlock_wrlock(&phys->lock);
+
+	// the first append means the indices are no longer clean
+	if (!EP_UT_BITSET(LOG_DIRTY, phys->flags))
+	{
+		phys->rix.hdr->flags &= ~SEGLOG_IXF_CLEAN;
+		estat = ix_sync(&phys->rix, true);
+		EP_STAT_CHECK(estat, goto fail0);
+		phys->flags |= LOG_DIRTY;
+	}
+
+	hash = _gdp_datum_hash(datum, gob);
+	reclen = rec_encode(phys, datum, hash);
+	if (hash != NULL)
+		gdp_hash_free(hash);
+
+	// start a new segment if this one is full
+	seg = &phys->segs[phys->nsegs - 1];
+	if (seg->size > seg->hdrlen && seg->size + reclen > SegMaxSize)
+	{
+		estat = seg_sync(phys, true);
+		EP_STAT_CHECK(estat, goto fail0);
+		estat = seg_create(gob, phys, seg->segno + 1, NULL, 0);
+		EP_STAT_CHECK(estat, goto fail0);
+		seg = &phys->segs[phys->nsegs - 1];
+	}
+
+	if (pwrite(seg->fd, phys->wbuf, reclen, seg->size) != (ssize_t) reclen)
+	{
+		estat = posix_error(errno, "seglog_append(%s): write segment %" PRIu32,
+						gob->pname, seg->segno);
+		// don't leave a partial record behind
+		if (ftruncate(seg->fd, seg->size) < 0)
+			(void) posix_error(errno, "seglog_append: ftruncate");
+		goto fail0;
+	}
+	estat = note_record(phys, datum->recno, &datum->ts, seg->segno,
+						seg->size, reclen);
+	seg->size += reclen;
+	EP_STAT_CHECK(estat, goto fail0);
+
+	if (!phys->xact.active)
+	{
+		estat = seg_sync(phys, false);
+		if (EP_STAT_ISOK(estat) && phys->nsinceckpt >= CkptInterval)
+			estat = seglog_checkpoint(phys);
+	}
+
+fail0:
+	ep_thr_rwlock_unlock(&phys->lock);
+	return estat;
+}
+
+
+/*
+**  SEGLOG_GETMETADATA --- read metadata from disk
+*/
+
+static EP_STAT
+seglog_getmetadata(gdp_gob_t *gob,
+		gdp_md_t **gmdp)
+{
+	EP_STAT estat;
+	gob_physinfo_t *phys = GETPHYS(gob);
+
+	ep_thr_rwlock_rdlock(&phys->lock);
+	estat = seg_read_metadata(phys, gmdp);
+	ep_thr_rwlock_unlock(&phys->lock);
+	return estat;
+}
+
+
+/*
+**  SEGLOG_FOREACH --- call function for each GOB in directory
+**
+**		Return the highest severity error code found
+*/
+
+static EP_STAT
+seglog_foreach(EP_STAT (*func)(gdp_name_t, void *), void *ctx)
+{
+	int subdir;
+	EP_STAT estat = EP_STAT_OK;
+	const char *seg0sfx = ".000000" SEGLOG_SEG_SUFFIX;
+	size_t sfxlen = strlen(seg0sfx);
+
+	for (subdir = 0; subdir < 0x100; subdir++)
+	{
+		DIR *dir;
+		char dbuf[400];
+
+		snprintf(dbuf, sizeof dbuf, "%s/_%02x", LogDir, subdir);
+		dir = opendir(dbuf);
+		if (dir == NULL)
+			continue;
+
+		for (;;)
+		{
+			struct dirent *dent;
+
+			// read the next directory entry
+			dent = readdir(dir);
+			if (dent == NULL)
+				break;
+
+			// every log has a segment zero; use that to find them
+			size_t len = strlen(dent->d_name);
+			if (len <= sfxlen ||
+					strcmp(&dent->d_name[len - sfxlen], seg0sfx) != 0)
+				continue;
+
+			// strip off the file extension
+			dent->d_name[len - sfxlen] = '\0';
+
+			// convert the base64-encoded name to internal form
+			gdp_name_t gname;
+			EP_STAT estat = gdp_internal_name(dent->d_name, gname);
+			EP_STAT_CHECK(estat, continue);
+
+			// now call the function
+			EP_STAT tstat = (*func)((uint8_t *) gname, ctx);
+
+			// adjust return status only if new one more severe than existing
+			if (EP_STAT_SEVERITY(tstat) > EP_STAT_SEVERITY(estat))
+				estat = tstat;
+		}
+		closedir(dir);
+	}
+	return estat;
+}
+
+
+/*
+**  Deliver statistics for management visualization
+*/
+
+static void
+seglog_getstats(
+		gdp_gob_t *gob,
+		struct gob_phys_stats *st)
+{
+	gob_physinfo_t *phys = GETPHYS(gob);
+	int i;
+
+	st->nrecs = gob->nrecs;
+	st->size = 0;
+	ep_thr_rwlock_rdlock(&phys->lock);
+	for (i = 0; i < phys->nsegs; i++)
+		st->size += phys->segs[i].size;
+	ep_thr_rwlock_unlock(&phys->lock);
+}
+
+
+/*
+**  Transactions.
+**
+**		Appends inside a transaction are written as they come but not
+**		synced until the end, so a group commit costs one fdatasync.
+**		Abort cuts the segments back to where they were and undoes
+**		the index changes.
+*/
+
+static EP_STAT
+seglog_xact_begin(gdp_gob_t *gob)
+{
+	gob_physinfo_t *phys = GETPHYS(gob);
+
+	ep_thr_rwlock_wrlock(&phys->lock);
+	EP_ASSERT(!phys->xact.active);
+	phys->xact.active = true;
+	phys->xact.nsegs = phys->nsegs;
+	phys->xact.segsize = phys->segs[phys->nsegs - 1].size;
+	phys->xact.nappended = phys->nappended;
+	phys->xact.min_recno = phys->min_recno;
+	phys->xact.max_recno = phys->max_recno;
+	phys->xact.tix_nent = phys->tix.hdr->nent;
+	if (phys->xact.tix_nent > 0)
+		phys->xact.tix_last = *SEGLOG_IX_ENT(&phys->tix,
+						struct seglog_tix_ent, phys->xact.tix_nent - 1);
+	ep_thr_rwlock_unlock(&phys->lock);
+	return EP_STAT_OK;
+}
+
+
+static EP_STAT
+seglog_xact_end(gdp_gob_t *gob)
+{
+	EP_STAT estat;
+	gob_physinfo_t *phys = GETPHYS(gob);
+
+	ep_thr_rwlock_wrlock(&phys->lock);
+	phys->xact.active = false;
+	estat = seg_sync(phys, false);
+	if (EP_STAT_ISOK(estat) && phys->nsinceckpt >= CkptInterval)
+		estat = seglog_checkpoint(phys);
+	ep_thr_rwlock_unlock(&phys->lock);
+	return estat;
+}
+
+
+static EP_STAT
+seglog_xact_abort(gdp_gob_t *gob)
+{
+	EP_STAT estat = EP_STAT_OK;
+	gob_physinfo_t *phys = GETPHYS(gob);
+	struct seglog_seg *seg;
+
+	ep_thr_rwlock_wrlock(&phys->lock);
+	phys->xact.active = false;
+
+	// drop any segments started during the transaction
+	while (phys->nsegs > phys->xact.nsegs)
+	{
+		char seg_path[GOB_PATH_MAX];
+
+		seg = &phys->segs[phys->nsegs - 1];
+		seg_close(seg);
+		if (EP_STAT_ISOK(get_seg_path(gob, seg->segno,
+								seg_path, sizeof seg_path)) &&
+				unlink(seg_path) < 0)
+			estat = posix_error(errno, "seglog_xact_abort: unlink(%s)",
+						seg_path);
+		phys->nsegs--;
+	}
+
+	// and cut the last one back
+	seg = &phys->segs[phys->nsegs - 1];
+	if (seg->size > phys->xact.segsize)
+	{
+		if (ftruncate(seg->fd, phys->xact.segsize) < 0)
+			estat = posix_error(errno, "seglog_xact_abort: ftruncate");
+		seg->size = phys->xact.segsize;
+		if (seg->synced > seg->size)
+			seg->synced = seg->size;
+		if (seg->hidx != NULL && seg->hidx->scanned > seg->size)
+		{
+			hidx_free(seg->hidx);
+			seg->hidx = NULL;
+		}
+	}
+
+	// put the indices back
+	rix_sweep(phys);
+	phys->min_recno = phys->xact.min_recno;
+	phys->max_recno = phys->xact.max_recno;
+	phys->tix.hdr->nent = phys->xact.tix_nent;
+	if (phys->xact.tix_nent > 0)
+		*SEGLOG_IX_ENT(&phys->tix, struct seglog_tix_ent,
+						phys->xact.tix_nent - 1) = phys->xact.tix_last;
+	phys->nsinceckpt -= phys->nappended - phys->xact.nappended;
+	phys->nappended = phys->xact.nappended;
+
+	ep_thr_rwlock_unlock(&phys->lock);
+	return estat;
+}
+
+
+__BEGIN_DECLS
+struct gob_phys_impl	GdpSeglogImpl =
+{
+	.init				= seglog_init,
+	.read_by_hash		= seglog_read_by_hash,
+	.read_by_recno		= seglog_read_by_recno,
+	.read_by_timestamp	= seglog_read_by_timestamp,
+	.create				= seglog_create,
+	.open				= seglog_open,
+	.close				= seglog_close,
+	.append				= seglog_append,
+	.getmetadata		= seglog_getmetadata,
+	.remove				= seglog_remove,
+	.foreach			= seglog_foreach,
+	.getstats			= seglog_getstats,
+	.recno_exists		= seglog_recno_exists,
+	.xact_begin			= seglog_xact_begin,
+	.xact_end			= seglog_xact_end,
+	.xact_abort			= seglog_xact_abort,
+};
+__END_DECLS
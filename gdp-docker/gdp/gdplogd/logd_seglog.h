@@ -0,0 +1,226 @@
+/* vim: set ai sw=4 sts=4 ts=4 : */
+
+/*
+**	----- BEGIN LICENSE BLOCK -----
+**	GDPLOGD: Log Daemon for the Global Data Plane
+**	From the Ubiquitous Swarm Lab, 490 Cory Hall, U.C. Berkeley.
+**
+**	Copyright (c) 2015-2019, Regents of the University of California.
+**	All rights reserved.
+**
+**	Permission is hereby granted, without written agreement and without
+**	license or royalty fees, to use, copy, modify, and distribute this
+**	software and its documentation for any purpose, provided that the above
+**	copyright notice and the following two paragraphs appear in all copies
+**	of this software.
+**
+**	IN NO EVENT SHALL REGENTS BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT,
+**	SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES, INCLUDING LOST
+**	PROFITS, ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION,
+**	EVEN IF REGENTS HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**
+**	REGENTS SPECIFICALLY DISCLAIMS ANY WARRANTIES, INCLUDING, BUT NOT
+**	LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+**	FOR A PARTICULAR PURPOSE. THE SOFTWARE AND ACCOMPANYING DOCUMENTATION,
+**	IF ANY, PROVIDED HEREUNDER IS PROVIDED "AS IS". REGENTS HAS NO
+**	OBLIGATION TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS,
+**	OR MODIFICATIONS.
+**	----- END LICENSE BLOCK -----
+*/
+
+#ifndef _GDPLOGD_SEGLOG_H_
+#define _GDPLOGD_SEGLOG_H_		1
+
+#include "logd.h"
+
+/*
+**	Headers for the segmented log implementation.
+**
+**		A log is a series of append-only segment files named
+**		<pname>.NNNNNN.gseg, plus two index files.  Segment zero
+**		holds the log metadata in its header.  Everything in the
+**		segments is in network byte order and every record carries
+**		a CRC, so the segments alone are the truth: the indices can
+**		always be rebuilt from them.
+**
+**		The recno index (<pname>.grix) is an array of fixed-width
+**		entries, one per record number, giving the segment and
+**		offset of that record.  The timestamp index (<pname>.gtix)
+**		has one entry for every "interval" records appended giving
+**		the highest timestamp seen so far and where that block of
+**		records starts.  Both are mmapped and kept in host byte
+**		order; a foreign or damaged index is simply rebuilt.
+*/
+
+// default directory for GDP Log storage (relative to GDP_DEFAULT_DATA_ROOT)
+#ifndef GDP_DEFAULT_LOG_DIR
+# define GDP_DEFAULT_LOG_DIR	"glogs"
+#endif
+
+// magic numbers and versions for on-disk files
+#define SEGLOG_SEG_MAGIC	UINT32_C(0x47534730)	// 'GSG0'
+#define SEGLOG_REC_MAGIC	UINT32_C(0x47524330)	// 'GRC0'
+#define SEGLOG_IDX_MAGIC	UINT32_C(0x47495830)	// 'GIX0'
+#define SEGLOG_VERSION		UINT32_C(20190601)		// current version
+
+#define SEGLOG_SEG_SUFFIX	".gseg"					// segment files
+#define SEGLOG_RIX_SUFFIX	".grix"					// recno index
+#define SEGLOG_TIX_SUFFIX	".gtix"					// timestamp index
+
+/*
+**  Segment header (fixed part; segment zero is followed by metadata)
+**
+**		uint32_t	magic
+**		uint32_t	version
+**		uint32_t	hdrlen			// offset of first record
+**		uint32_t	mdlen			// length of serialized metadata
+**		uint32_t	segno
+**		uint32_t	reserved
+**		int64_t		ctime			// creation time in ns
+*/
+
+#define SEGLOG_SEG_HDRSIZE	32
+
+/*
+**  Record header; the CRC covers everything from reclen to the end
+**		of the record, including the padding.
+**
+**		uint32_t	magic
+**		uint32_t	crc				// CRC-32C
+**		uint32_t	reclen			// total length, multiple of 8
+**		uint32_t	datalen
+**		uint16_t	hashlen			// hash of this record
+**		uint16_t	prevhashlen
+**		uint16_t	siglen
+**		uint16_t	reserved
+**		int64_t		recno
+**		int64_t		ts_sec
+**		uint32_t	ts_nsec
+**		uint32_t	ts_accuracy		// IEEE float bits
+**
+**		... followed by hash, prevhash, signature, and data.
+*/
+
+#define SEGLOG_REC_HDRSIZE	48
+#define SEGLOG_REC_ALIGN	8
+
+/*
+**  Index files.  The header occupies the first page and the fixed
+**  width entries follow it.
+*/
+
+struct seglog_ixhdr
+{
+	uint32_t			magic;
+	uint32_t			version;
+	uint32_t			entsize;				// size of each entry
+	uint32_t			flags;					// see below
+	uint64_t			nent;					// entries in use
+	uint32_t			interval;				// tix: records per entry
+
+	// everything up to here is on disk (rix only)
+	uint32_t			ckpt_segno;
+	uint64_t			ckpt_offset;
+	uint64_t			ckpt_nappended;
+};
+
+#define SEGLOG_IXF_CLEAN		0x00000001	// closed cleanly
+
+#define SEGLOG_IX_HDRSIZE		4096
+
+struct seglog_rix_ent
+{
+	uint64_t			offset;					// offset in segment
+	uint32_t			segno;					// segment number
+	uint32_t			reclen;					// zero if no such record
+};
+
+struct seglog_tix_ent
+{
+	int64_t				max_ts;					// highest ts so far (ns)
+	uint64_t			offset;					// start of this block
+	uint32_t			segno;
+	uint32_t			reserved;
+};
+
+struct seglog_index
+{
+	int					fd;
+	uint8_t				*base;					// mmapped file
+	size_t				mapsize;				// size of mapping
+	struct seglog_ixhdr	*hdr;					// == base
+};
+
+#define SEGLOG_IX_ENT(ix, type, n)	\
+			((type *) ((ix)->base + SEGLOG_IX_HDRSIZE) + (n))
+
+
+/*
+**  In-memory state for each segment.
+*/
+
+struct seglog_hashidx;
+
+struct seglog_seg
+{
+	int					fd;
+	uint32_t			segno;
+	uint32_t			hdrlen;					// offset of first record
+	uint64_t			size;					// current end of data
+	uint64_t			synced;					// size at last sync
+	struct seglog_hashidx	*hidx;				// built on first use
+};
+
+
+/*
+**  Per-log info.
+*/
+
+struct physinfo
+{
+	// reading and writing to the log requires holding this lock
+	EP_THR_RWLOCK		lock;
+
+	// info regarding the entire log (not segment)
+	gdp_recno_t			min_recno;				// first recno in log
+	gdp_recno_t			max_recno;				// last recno in log (dynamic)
+	uint32_t			flags;					// see below
+	int32_t				ver;					// on-disk version
+	uint64_t			nappended;				// records in all segments
+	uint64_t			nsinceckpt;				// appended since checkpoint
+
+	// the segments; the last one is the one being appended to
+	struct seglog_seg	*segs;
+	int					nsegs;
+	int					nsegalloc;
+
+	// indices
+	struct seglog_index	rix;					// recno index
+	struct seglog_index	tix;					// timestamp index
+
+	// hash indices are built lazily, so need their own lock
+	EP_THR_MUTEX		hidx_mutex;
+
+	// state saved at xact_begin so xact_abort can undo it
+	struct
+	{
+		bool				active;
+		int					nsegs;
+		uint64_t			segsize;
+		uint64_t			nappended;
+		gdp_recno_t			min_recno;
+		gdp_recno_t			max_recno;
+		uint64_t			tix_nent;
+		struct seglog_tix_ent	tix_last;
+	}					xact;
+
+	// buffer used to assemble records for writing
+	uint8_t				*wbuf;
+	size_t				wbufsize;
+};
+
+// values for physinfo:flags
+#define LOG_POSIX_ERRORS		0x00000002	// send posix errors to syslog
+#define LOG_DIRTY				0x00000004	// appended since open
+
+#endif //_GDPLOGD_SEGLOG_H_
@@ -275,6 +275,7 @@ static struct pragma_name
 						{ "cache_size",				NULL,				},
 						{ "page_size",				NULL,				},
 						{ "journal_size_limit",		NULL,				},
+						{ "wal_autocheckpoint",		NULL,				},
 						{ "busy_timeout",			"20",				},
 						{ NULL,						NULL				},
 					};
@@ -286,13 +287,20 @@ sqlite_init_pragmas(void)
 	gdp_buf_t *sqlbuf = gdp_buf_new();
 	struct pragma_name *pp = SqlitePragmaNames;
 
+	// write-ahead logging changes the default journal mode; an
+	// explicit journal_mode pragma still takes precedence
+	bool use_wal = ep_adm_getboolparam("swarm.gdplogd.sqlite.wal", false);
+
 	for (; pp->pname != NULL; pp++)
 	{
 		char pnamebuf[100];
+		const char *pdefault = pp->pdefault;
 
+		if (use_wal && strcmp(pp->pname, "journal_mode") == 0)
+			pdefault = "WAL";
 		snprintf(pnamebuf, sizeof pnamebuf,
 				"swarm.gdplogd.sqlite.pragma.%s", pp->pname);
-		const char *pv = ep_adm_getstrparam(pnamebuf, pp->pdefault);
+		const char *pv = ep_adm_getstrparam(pnamebuf, pdefault);
 		if (pv != NULL)
 			gdp_buf_printf(sqlbuf, "   PRAGMA %s = %s;\n", pp->pname, pv);
 	}
@@ -559,6 +567,8 @@ physinfo_free(gob_physinfo_t *phys)
 			sqlite3_finalize(phys->read_by_timestamp_stmt);
 		if (phys->insert_stmt != NULL)
 			sqlite3_finalize(phys->insert_stmt);
+		if (phys->max_rowid_stmt != NULL)
+			sqlite3_finalize(phys->max_rowid_stmt);
 
 		// we can now close the database
 		rc = sqlite3_close(phys->db);
@@ -1225,6 +1235,22 @@ process_select_results(sqlite3_stmt *stmt,
 }
 
 
+/*
+**  Appends are grouped into transactions (see logd_commit.c) and the
+**  GOB is not locked while one is open, but reads use the same
+**  database handle and would see its rows before they are committed
+**  (or rolled back).  Readers only look at rows up to the last one
+**  that existed when the transaction began.  Must be called with
+**  phys->lock held.
+*/
+
+static int64_t
+visible_rowid(gob_physinfo_t *phys)
+{
+	return phys->in_xact ? phys->xact_rowid : INT64_MAX;
+}
+
+
 /*
 **  SQLITE_READ_BY_HASH --- read record indexed by record hash
 */
@@ -1259,7 +1285,7 @@ sqlite_read_by_hash(gdp_gob_t *gob,
 		rc = sqlite3_prepare_v2(phys->db,
 						"SELECT hash, recno, timestamp, accuracy, prevhash, value, sig"
 						"	FROM log_entry"
-						"	WHERE hash = ?;",
+						"	WHERE hash = ? AND rowid <= ?;",
 						-1, &phys->read_by_hash_stmt, NULL);
 		CHECK_RC(rc, goto fail2);
 	}
@@ -1267,6 +1293,8 @@ sqlite_read_by_hash(gdp_gob_t *gob,
 	phase = "bind";
 	rc = sql_bind_hash(phys->read_by_hash_stmt, 1, hash);
 	CHECK_RC(rc, goto fail2);
+	rc = sqlite3_bind_int64(phys->read_by_hash_stmt, 2, visible_rowid(phys));
+	CHECK_RC(rc, goto fail2);
 
 	phase = "process results";
 	estat = process_select_results(phys->read_by_hash_stmt, cb, cb_ctx, true);
@@ -1324,7 +1352,7 @@ sqlite_read_by_recno(gdp_gob_t *gob,
 	{
 		const char *sql = "SELECT hash, recno, timestamp, accuracy, prevhash, value, sig\n"
 						"	FROM log_entry\n"
-						"	WHERE recno = ?\n"
+						"	WHERE recno = ? AND rowid <= ?\n"
 						"   LIMIT ?;\n";
 		phase = "prepare";
 		ep_dbg_cprintf(Dbg, 55, "preparing %s", sql);
@@ -1336,7 +1364,7 @@ sqlite_read_by_recno(gdp_gob_t *gob,
 	{
 		const char *sql = "SELECT hash, recno, timestamp, accuracy, prevhash, value, sig\n"
 						"	FROM log_entry\n"
-						"	WHERE recno >= ?\n"
+						"	WHERE recno >= ? AND rowid <= ?\n"
 						"	ORDER BY recno\n"
 						"   LIMIT ?;\n";
 		phase = "prepare";
@@ -1355,7 +1383,10 @@ sqlite_read_by_recno(gdp_gob_t *gob,
 	rc = sqlite3_bind_int64(stmt, 1, startrec);
 	CHECK_RC(rc, goto fail2);
 	phase = "bind2";
-	rc = sqlite3_bind_int(stmt, 2, maxrecs);
+	rc = sqlite3_bind_int64(stmt, 2, visible_rowid(phys));
+	CHECK_RC(rc, goto fail2);
+	phase = "bind3";
+	rc = sqlite3_bind_int(stmt, 3, maxrecs);
 	CHECK_RC(rc, goto fail2);
 
 	phase = "process results";
@@ -1420,17 +1451,23 @@ sqlite_read_by_timestamp(gdp_gob_t *gob,
 		rc = sqlite3_prepare_v2(phys->db,
 						"SELECT hash, recno, timestamp, accuracy, prevhash, value, sig\n"
 						"	FROM log_entry\n"
-						"	WHERE timestamp >= ?\n"
+						"	WHERE timestamp >= ? AND rowid <= ?\n"
 						"	ORDER BY timestamp\n"
 						"	LIMIT ?;\n",
 						-1, &phys->read_by_timestamp_stmt, NULL);
 		CHECK_RC(rc, goto fail2);
 	}
 
+	// only the timestamp itself; sql_bind_timestamp also binds accuracy
 	phase = "bind1";
-	rc = sql_bind_timestamp(phys->read_by_timestamp_stmt, 1, start_time);
+	rc = sqlite3_bind_int64(phys->read_by_timestamp_stmt, 1,
+						ep_time_to_nsec(start_time));
 	CHECK_RC(rc, goto fail2);
 	phase = "bind2";
+	rc = sqlite3_bind_int64(phys->read_by_timestamp_stmt, 2,
+						visible_rowid(phys));
+	CHECK_RC(rc, goto fail2);
+	phase = "bind3";
 	rc = sqlite3_bind_int(phys->read_by_timestamp_stmt, 3, maxrecs);
 	CHECK_RC(rc, goto fail2);
 
@@ -1716,12 +1753,45 @@ sqlite_xact_begin(gdp_gob_t *gob)
 	gob_physinfo_t *phys = GETPHYS(gob);
 	char *sqerrstr = NULL;
 
+	const char *phase = "operation";
+
 	int rc = sqlite3_exec(phys->db, "BEGIN TRANSACTION;",
 						NULL, NULL, &sqerrstr);
+	CHECK_RC(rc, goto fail0);
+
+	// remember where committed rows end so readers can skip the rest
+	ep_thr_rwlock_wrlock(&phys->lock);
+	phase = "max rowid";
+	if (phys->max_rowid_stmt == NULL)
+	{
+		rc = sqlite3_prepare_v2(phys->db,
+						"SELECT max(rowid) FROM log_entry;",
+						-1, &phys->max_rowid_stmt, NULL);
+	}
+	if (rc == SQLITE_OK)
+		rc = sqlite3_step(phys->max_rowid_stmt);
+	if (rc == SQLITE_ROW)
+	{
+		phys->xact_rowid = sqlite3_column_int64(phys->max_rowid_stmt, 0);
+		phys->in_xact = true;
+		rc = SQLITE_OK;
+	}
+	if (phys->max_rowid_stmt != NULL)
+		sqlite3_reset(phys->max_rowid_stmt);
+	ep_thr_rwlock_unlock(&phys->lock);
+	if (rc != SQLITE_OK)
+	{
+		(void) sqlite3_exec(phys->db, "ROLLBACK TRANSACTION;",
+						NULL, NULL, NULL);
+		if (sqlite_rc_success(rc))
+			rc = SQLITE_ERROR;
+	}
+
+fail0:
 	if (!sqlite_rc_success(rc))
 	{
 		// failure resulted from an SQLite error
-		estat = sqlite_error(rc, sqerrstr, "sqlite_xact_begin", "operation");
+		estat = sqlite_error(rc, sqerrstr, "sqlite_xact_begin", phase);
 	}
 	if (sqerrstr != NULL)
 		sqlite3_free(sqerrstr);
@@ -1743,6 +1813,10 @@ sqlite_xact_end(gdp_gob_t *gob)
 		// failure resulted from an SQLite error
 		estat = sqlite_error(rc, sqerrstr, "sqlite_xact_end", "operation");
 	}
+
+	ep_thr_rwlock_wrlock(&phys->lock);
+	phys->in_xact = false;
+	ep_thr_rwlock_unlock(&phys->lock);
 	if (sqerrstr != NULL)
 		sqlite3_free(sqerrstr);
 	return estat;
@@ -1763,6 +1837,10 @@ sqlite_xact_abort(gdp_gob_t *gob)
 		// failure resulted from an SQLite error
 		estat = sqlite_error(rc, sqerrstr, "sqlite_xact_abort", "operation");
 	}
+
+	ep_thr_rwlock_wrlock(&phys->lock);
+	phys->in_xact = false;
+	ep_thr_rwlock_unlock(&phys->lock);
 	if (sqerrstr != NULL)
 		sqlite3_free(sqerrstr);
 	return estat;
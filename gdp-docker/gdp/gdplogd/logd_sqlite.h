@@ -74,6 +74,10 @@ struct physinfo
 	uint32_t			flags;					// see below
 	int32_t				ver;					// database version
 
+	// rows written by an open transaction are hidden from readers
+	bool				in_xact;				// transaction is open
+	int64_t				xact_rowid;				// last rowid before it
+
 	// the underlying SQLite database
 	struct sqlite3		*db;					// database handle
 
@@ -83,6 +87,7 @@ struct physinfo
 	struct sqlite3_stmt	*read_by_recno_stmt1;
 	struct sqlite3_stmt	*read_by_recno_stmt2;
 	struct sqlite3_stmt	*read_by_timestamp_stmt;
+	struct sqlite3_stmt	*max_rowid_stmt;
 };
 
 // values for physinfo:flags
@@ -0,0 +1,349 @@
+/* vim: set ai sw=4 sts=4 ts=4 : */
+
+/*
+**  GDPLOGD-SUBBENCH --- measure subscription fan-out cost on append
+**
+**		Builds an in-memory GOB carrying a number of live subscriptions
+**		and a number of idle requests (on the GOB but not subscribed),
+**		then times sub_notify_all_subscribers for each of a series of
+**		appended records, reporting the distribution of the per-append
+**		latency.  Instead of a router the subscriptions share a channel
+**		to a loopback socket whose far end throws everything away, so
+**		this measures the daemon side of publishing (finding the
+**		subscribers, expiring leases, serializing and queueing each
+**		notification) plus the cost of writing it to a socket, but
+**		not the network or the router.
+**
+**	----- BEGIN LICENSE BLOCK -----
+**	GDPLOGD: Log Daemon for the Global Data Plane
+**	From the Ubiquitous Swarm Lab, 490 Cory Hall, U.C. Berkeley.
+**
+**	Copyright (c) 2015-2019, Regents of the University of California.
+**	All rights reserved.
+**
+**	Permission is hereby granted, without written agreement and without
+**	license or royalty fees, to use, copy, modify, and distribute this
+**	software and its documentation for any purpose, provided that the above
+**	copyright notice and the following two paragraphs appear in all copies
+**	of this software.
+**
+**	IN NO EVENT SHALL REGENTS BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT,
+**	SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES, INCLUDING LOST
+**	PROFITS, ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION,
+**	EVEN IF REGENTS HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**
+**	REGENTS SPECIFICALLY DISCLAIMS ANY WARRANTIES, INCLUDING, BUT NOT
+**	LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+**	FOR A PARTICULAR PURPOSE. THE SOFTWARE AND ACCOMPANYING DOCUMENTATION,
+**	IF ANY, PROVIDED HEREUNDER IS PROVIDED "AS IS". REGENTS HAS NO
+**	OBLIGATION TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS,
+**	OR MODIFICATIONS.
+**	----- END LICENSE BLOCK -----
+*/
+
+#include "logd.h"
+#include "logd_pubsub.h"
+
+#include <gdp/gdp_chan.h>
+#include <gdp/gdp_priv.h>
+
+#include <ep/ep_app.h>
+#include <ep/ep_crypto.h>
+#include <ep/ep_dbg.h>
+#include <ep/ep_time.h>
+
+#include <errno.h>
+#include <getopt.h>
+#include <netinet/in.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sysexits.h>
+#include <sys/socket.h>
+
+
+static int
+cmp_int64(const void *a, const void *b)
+{
+	int64_t x = *(const int64_t *) a;
+	int64_t y = *(const int64_t *) b;
+
+	return (x > y) - (x < y);
+}
+
+
+static int64_t
+percentile(int64_t *sorted, int n, int pct)
+{
+	int i = (int) (((int64_t) n * pct) / 100);
+
+	if (i >= n)
+		i = n - 1;
+	return sorted[i];
+}
+
+
+/*
+**  The sink: a loopback connection that reads and discards
+**  everything the subscriptions are sent.
+*/
+
+static atomic_llong		SinkBytes;		// octets read by the sink
+
+static void *
+sink_thread(void *arg)
+{
+	int lsock = (int) (intptr_t) arg;
+	char buf[65536];
+	ssize_t n;
+	int sock;
+
+	sock = accept(lsock, NULL, NULL);
+	if (sock < 0)
+		ep_app_fatal("sink: cannot accept: %s", strerror(errno));
+	while ((n = read(sock, buf, sizeof buf)) > 0)
+		atomic_fetch_add(&SinkBytes, n);
+	close(sock);
+	return NULL;
+}
+
+static EP_STAT
+sink_advertise(gdp_chan_t *chan, int action, void *adata)
+{
+	return EP_STAT_OK;			// nobody to advertise to
+}
+
+
+/*
+**  OPEN_SINK --- open a channel that goes nowhere
+*/
+
+static EP_STAT
+open_sink(gdp_chan_t **pchan)
+{
+	struct sockaddr_in sin;
+	socklen_t sinlen = sizeof sin;
+	char addr[40];
+	EP_THR thr;
+	int lsock;
+
+	memset(&sin, 0, sizeof sin);
+	sin.sin_family = AF_INET;
+	sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	sin.sin_port = 0;				// any free port
+	lsock = socket(AF_INET, SOCK_STREAM, 0);
+	if (lsock < 0 ||
+			bind(lsock, (struct sockaddr *) &sin, sizeof sin) < 0 ||
+			listen(lsock, 1) < 0 ||
+			getsockname(lsock, (struct sockaddr *) &sin, &sinlen) < 0)
+		return ep_stat_from_errno(errno);
+	if (ep_thr_spawn(&thr, &sink_thread, (void *) (intptr_t) lsock) != 0)
+		return ep_stat_from_errno(errno);
+
+	snprintf(addr, sizeof addr, "127.0.0.1:%d", ntohs(sin.sin_port));
+	return _gdp_chan_open(addr, NULL, NULL, NULL, NULL, NULL,
+						&sink_advertise, NULL, pchan);
+}
+
+
+/*
+**  ADD_REQ --- attach a fake client request to the GOB
+**
+**		Subscriptions are linked into the subscription index the same
+**		way cmd_subscribe does it.
+*/
+
+static void
+add_req(gdp_gob_t *gob, gdp_chan_t *chan, gdp_rid_t rid, bool subscribe)
+{
+	EP_STAT estat;
+	gdp_req_t *req;
+
+	estat = _gdp_req_new(GDP_CMD_SUBSCRIBE_BY_RECNO, gob, chan, NULL,
+						0, &req);
+	if (!EP_STAT_ISOK(estat))
+	{
+		ep_app_fatal("cannot create request");
+	}
+	ep_crypto_random_buf(req->cpdu->src, sizeof req->cpdu->src);
+	req->cpdu->msg->rid = rid;
+	req->flags |= GDP_REQ_PERSIST;
+	ep_time_now(&req->sub_ts);
+	LIST_INSERT_HEAD(&gob->reqs, req, goblist);
+	req->flags |= GDP_REQ_ON_GOB_LIST;
+	if (subscribe)
+	{
+		req->flags |= GDP_REQ_SRV_SUBSCR;
+		_gdp_req_sub_link(req);
+	}
+	_gdp_req_unlock(req);
+}
+
+
+void
+usage(void)
+{
+	fprintf(stderr,
+			"Usage: %s [-D dbgspec] [-a nactive] [-i nidle] [-n nrecs]\n"
+			"\t[-s size]\n"
+			"    -D  set debugging flags\n"
+			"    -a  number of live subscriptions (default 10000)\n"
+			"    -i  number of idle requests on the log (default 10000)\n"
+			"    -n  number of records to publish (default 1000)\n"
+			"    -s  size of each record in bytes (default 100)\n",
+			ep_app_getprogname());
+	exit(EX_USAGE);
+}
+
+
+int
+main(int argc, char **argv)
+{
+	EP_STAT estat;
+	gdp_gob_t *gob;
+	gdp_chan_t *chan;
+	gdp_req_t *pubreq;
+	gdp_name_t gname;
+	int nactive = 10000;
+	int nidle = 10000;
+	int nrecs = 1000;
+	int recsize = 100;
+	bool show_usage = false;
+	int64_t *latency;
+	int opt;
+	int i;
+
+	while ((opt = getopt(argc, argv, "D:a:i:n:s:")) > 0)
+	{
+		switch (opt)
+		{
+		 case 'D':
+			ep_dbg_set(optarg);
+			break;
+
+		 case 'a':
+			nactive = atoi(optarg);
+			break;
+
+		 case 'i':
+			nidle = atoi(optarg);
+			break;
+
+		 case 'n':
+			nrecs = atoi(optarg);
+			break;
+
+		 case 's':
+			recsize = atoi(optarg);
+			break;
+
+		 default:
+			show_usage = true;
+			break;
+		}
+	}
+	argc -= optind;
+	argv += optind;
+
+	if (show_usage || argc != 0 || nactive < 0 || nidle < 0 ||
+			nrecs <= 0 || recsize < 0)
+		usage();
+
+	estat = gdp_init_phase_0(NULL, 0);
+	EP_STAT_CHECK(estat, goto fail0);
+	ep_adm_readparams("gdplogd");
+
+	// the event loop is what actually writes to the sink
+	estat = open_sink(&chan);
+	EP_STAT_CHECK(estat, goto fail0);
+	estat = _gdp_evloop_init();
+	EP_STAT_CHECK(estat, goto fail0);
+
+	ep_crypto_random_buf(gname, sizeof gname);
+	estat = _gdp_gob_new(gname, &gob);
+	EP_STAT_CHECK(estat, goto fail0);
+	gob->x = (struct gdp_gob_xtra *) ep_mem_zalloc(sizeof *gob->x);
+	gob->x->gob = gob;
+	sub_fanout_init(gob);
+	_gdp_gob_lock(gob);
+
+	// interleave them so idle requests are spread through the GOB list
+	for (i = 0; i < nactive || i < nidle; i++)
+	{
+		if (i < nidle)
+			add_req(gob, chan, 2 * i + 2, false);
+		if (i < nactive)
+			add_req(gob, chan, 2 * i + 1, true);
+	}
+
+	estat = _gdp_req_new(GDP_CMD_APPEND, gob, NULL, NULL, 0, &pubreq);
+	EP_STAT_CHECK(estat, goto fail0);
+
+	latency = ep_mem_zalloc(nrecs * sizeof *latency);
+	char *rec = ep_mem_malloc(recsize + 1);
+	memset(rec, 'x', recsize);
+	gdp_datum_t *datum = gdp_datum_new();
+
+	for (i = 0; i < nrecs; i++)
+	{
+		EP_TIME_SPEC start, end;
+
+		gdp_datum_reset(datum);
+		datum->recno = i + 1;
+		ep_time_now(&datum->ts);
+		gdp_buf_write(datum->dbuf, rec, recsize);
+
+		// build the notification the same way cmd_append does
+		GdpDatum *pbd = ep_mem_malloc(sizeof *pbd);
+		gdp_datum__init(pbd);
+		gdp_msg_t *msg = _gdp_msg_new(GDP_ACK_CONTENT,
+									pubreq->cpdu->msg->rid,
+									pubreq->cpdu->msg->l5seqno);
+		_gdp_datum_to_pb(datum, msg, pbd);
+		GdpDatumList *dl = msg->ack_content->dl;
+		dl->d = ep_mem_malloc(sizeof pbd);
+		dl->n_d = 1;
+		dl->d[0] = pbd;
+		pubreq->rpdu = _gdp_pdu_new(msg, pubreq->cpdu->dst,
+								pubreq->cpdu->src, GDP_SEQNO_NONE);
+
+		ep_time_now(&start);
+		sub_notify_all_subscribers(pubreq);
+		ep_time_now(&end);
+		latency[i] = ep_time_diff_usec(&start, &end);
+
+		_gdp_pdu_free(&pubreq->rpdu);
+	}
+
+	gdp_datum_free(datum);
+	ep_mem_free(rec);
+
+	// let the event loop finish writing before we count what arrived
+	{
+		long long last;
+
+		do
+		{
+			last = atomic_load(&SinkBytes);
+			ep_time_nanosleep(INT64_C(200000000));
+		} while (atomic_load(&SinkBytes) != last);
+	}
+
+	qsort(latency, nrecs, sizeof *latency, cmp_int64);
+	printf("%d records of %d bytes, %d subscriptions, %d idle requests\n",
+			nrecs, recsize, nactive, nidle);
+	printf("%lld octets delivered to subscribers\n",
+			(long long) atomic_load(&SinkBytes));
+	printf("publish latency (us): p50 %" PRId64 ", p90 %" PRId64
+			", p99 %" PRId64 ", max %" PRId64 "\n",
+			percentile(latency, nrecs, 50),
+			percentile(latency, nrecs, 90),
+			percentile(latency, nrecs, 99),
+			latency[nrecs - 1]);
+	ep_mem_free(latency);
+
+fail0:
+	if (!EP_STAT_ISOK(estat))
+		ep_app_message(estat, "exiting with status");
+	return !EP_STAT_ISOK(estat);
+}
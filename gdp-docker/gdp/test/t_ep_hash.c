@@ -0,0 +1,133 @@
+#include <ep/ep.h>
+#include <ep/ep_hash.h>
+#include "t_common_support.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*
+**  Exercise ep_hash against a plain array holding the expected state.
+**  Keys are small and of varying length, and the table starts tiny so
+**  that it resizes (and migrates) many times during the run.
+*/
+
+#define NKEYS		5000
+#define NOPS		200000
+
+struct ref
+{
+	char		key[12];
+	size_t		keylen;
+	const void	*val;			// NULL if not in the hash
+};
+
+static struct ref	Ref[NKEYS];
+static int			Errors;
+
+static void
+check(bool ok, const char *what, int i)
+{
+	if (ok)
+		return;
+	if (Errors++ < 20)
+		printf("FAIL: %s, key %d\n", what, i);
+}
+
+static void
+count_ent(size_t keylen, const void *key, const void *val, va_list av)
+{
+	int *np = va_arg(av, int *);
+	intptr_t i = (intptr_t) val - 1;
+
+	check(i >= 0 && i < NKEYS, "forall value", (int) i);
+	if (i >= 0 && i < NKEYS)
+	{
+		check(Ref[i].val == val, "forall stale entry", (int) i);
+		check(keylen == Ref[i].keylen &&
+				memcmp(key, Ref[i].key, keylen) == 0,
+				"forall key", (int) i);
+	}
+	(*np)++;
+}
+
+static void
+run(EP_HASH *hp, const char *name)
+{
+	int nlive = 0;
+	int nseen;
+	int op;
+	int i;
+
+	memset(Ref, 0, sizeof Ref);
+	for (i = 0; i < NKEYS; i++)
+	{
+		// index first so keys are distinct, then 0 to 8 bytes of padding
+		Ref[i].keylen = sizeof i + i % 9;
+		memcpy(Ref[i].key, &i, sizeof i);
+		memset(Ref[i].key + sizeof i, 'x', sizeof Ref[i].key - sizeof i);
+	}
+
+	for (op = 0; op < NOPS; op++)
+	{
+		const void *old;
+
+		i = random() % NKEYS;
+		switch (random() % 4)
+		{
+		  case 0:
+		  case 1:
+			old = ep_hash_insert(hp, Ref[i].keylen, Ref[i].key,
+						(const void *) (intptr_t) (i + 1));
+			check(old == Ref[i].val, "insert old value", i);
+			if (Ref[i].val == NULL)
+				nlive++;
+			Ref[i].val = (const void *) (intptr_t) (i + 1);
+			break;
+
+		  case 2:
+			old = ep_hash_delete(hp, Ref[i].keylen, Ref[i].key);
+			check(old == Ref[i].val, "delete old value", i);
+			if (Ref[i].val != NULL)
+				nlive--;
+			Ref[i].val = NULL;
+			break;
+
+		  case 3:
+			old = ep_hash_search(hp, Ref[i].keylen, Ref[i].key);
+			check(old == Ref[i].val, "search", i);
+			break;
+		}
+	}
+
+	// every key must still be found (or not found) as expected
+	for (i = 0; i < NKEYS; i++)
+		check(ep_hash_search(hp, Ref[i].keylen, Ref[i].key) == Ref[i].val,
+				"final search", i);
+
+	// forall must visit exactly the live entries
+	nseen = 0;
+	ep_hash_forall(hp, count_ent, &nseen);
+	check(nseen == nlive, "forall count", nseen);
+
+	printf("%s: %d live keys after %d operations, %d errors\n",
+			name, nlive, NOPS, Errors);
+}
+
+int
+main(int argc, char **argv)
+{
+	EP_HASH *hp;
+
+	ep_lib_init(EP_LIB_USEPTHREADS);
+	srandom(argc > 1 ? atoi(argv[1]) : 1);
+
+	hp = ep_hash_new("t_ep_hash", EP_HASH_DEFHFUNC, 4);
+	run(hp, "unstriped");
+	ep_hash_free(hp);
+
+	hp = ep_hash_new_striped("t_ep_hash", EP_HASH_DEFHFUNC, 4, 8);
+	run(hp, "striped");
+	ep_hash_free(hp);
+
+	exit(Errors != 0);
+}
@@ -4,6 +4,7 @@
 
 #include <string>
 #include <optional>
+#include <vector>
 #include <Eigen/Dense>
 #include "../packet.hpp"
 
@@ -108,6 +109,15 @@ namespace mpl::demo {
         }
     };
     
+    // A single start/goal query in a batch.  All queries in a batch
+    // share the scenario, environment and robot of the AppOptions
+    // they come from.
+    struct BatchQuery {
+        std::uint64_t problemId_;
+        std::string start_;
+        std::string goal_;
+    };
+
     class AppOptions {
     public:
         static constexpr unsigned long MAX_JOBS = 1000;
@@ -130,9 +140,20 @@ namespace mpl::demo {
         std::string min_;
         std::string max_;
 
+        // queries in the form "ID:START:GOAL", separated by ';'
+        std::string batch_;
+
         double timeLimit_{std::numeric_limits<double>::infinity()};
         double checkResolution_{0};
 
+        // epsilon of the approximate nearest neighbor search used by
+        // the planners' extend step, 0 for exact.
+        double nnEpsilon_{0};
+
+        // gamma of the r-disc rewiring neighborhood used by the
+        // asymptotically-optimal planners, 0 for k-nearest.
+        double rewireGamma_{0};
+
         bool singlePrecision_{false};
 
     private:
@@ -206,6 +227,22 @@ namespace mpl::demo {
             return parse<T>("goal", goal_);
         }
 
+        bool isBatch() const {
+            return !batch_.empty();
+        }
+
+        std::vector<BatchQuery> batch() const;
+
+        template <class T>
+        static T start(const BatchQuery& query) {
+            return parse<T>("batch start", query.start_);
+        }
+
+        template <class T>
+        static T goal(const BatchQuery& query) {
+            return parse<T>("batch goal", query.goal_);
+        }
+
         template <class T>
         T goalRadius() const {
             return parse<T>("goal-radius", goalRadius_);
@@ -228,6 +265,14 @@ namespace mpl::demo {
         double checkResolution(double defaultIfZero) const {
             return checkResolution_ <= 0 ? defaultIfZero : checkResolution_;
         }
+
+        double nnEpsilon() const {
+            return nnEpsilon_;
+        }
+
+        double rewireGamma() const {
+            return rewireGamma_;
+        }
     };
 }
 
@@ -5,6 +5,7 @@
 #include "fetch_robot.hpp"
 #include "load_mesh.hpp"
 #include <nigh/lp_space.hpp>
+#include <memory>
 
 namespace mpl::demo {
     
@@ -26,7 +27,8 @@ namespace mpl::demo {
 
         Space space_;
         
-        Mesh environment_;
+        // shared so that a batch of queries only loads the mesh once.
+        std::shared_ptr<const Mesh> environment_;
         Frame envFrame_;
 
         Frame goal_;
@@ -51,7 +53,7 @@ namespace mpl::demo {
             const Frame& goal,
             const Eigen::Matrix<S, 6, 1>& goalTol,
             S checkResolution = 0.01)
-            : environment_(MeshLoad<Mesh>::load(envMesh, false, true))
+            : environment_(std::make_shared<const Mesh>(MeshLoad<Mesh>::load(envMesh, false, true)))
             , envFrame_{envFrame}
             , goal_{goal}
             , invStepSize_(1 / checkResolution)
@@ -62,6 +64,18 @@ namespace mpl::demo {
             JI_LOG(INFO) << "goal tolerance: eps=" << goalEps_ << ", L=" << goalL_;
         }
 
+        // Creates a scenario that shares the environment of another,
+        // but with a different goal.
+        FetchScenario(const FetchScenario& other, const Frame& goal)
+            : environment_(other.environment_)
+            , envFrame_{other.envFrame_}
+            , goal_{goal}
+            , goalL_{other.goalL_}
+            , goalEps_{other.goalEps_}
+            , invStepSize_{other.invStepSize_}
+        {
+        }
+
         static constexpr bool multiGoal = true;
 
         const Space& space() const {
@@ -111,7 +125,7 @@ namespace mpl::demo {
                 return false;
             }
 
-            if (robot.inCollisionWith(&environment_, envFrame_, report))
+            if (robot.inCollisionWith(environment_.get(), envFrame_, report))
                 return false;
             
             return true;
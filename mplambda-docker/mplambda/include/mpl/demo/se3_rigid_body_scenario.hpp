@@ -9,6 +9,7 @@
 #include <jilog.hpp>
 #include <nigh/se3_space.hpp>
 #include <array>
+#include <memory>
 
 namespace mpl::demo {
     
@@ -28,8 +29,10 @@ namespace mpl::demo {
 
         Space space_;
     
-        Mesh environment_;
-        Mesh robot_;
+        // meshes are shared so that a batch of queries against the
+        // same environment and robot only loads them once.
+        std::shared_ptr<const Mesh> environment_;
+        std::shared_ptr<const Mesh> robot_;
 
         State goal_;
 
@@ -55,8 +58,8 @@ namespace mpl::demo {
             const Eigen::MatrixBase<Min>& min,
             const Eigen::MatrixBase<Max>& max,
             S checkResolution)
-            : environment_(MeshLoad<Mesh>::load(envMesh, false, false))
-            , robot_(MeshLoad<Mesh>::load(robotMesh, true, false))
+            : environment_(std::make_shared<const Mesh>(MeshLoad<Mesh>::load(envMesh, false, false)))
+            , robot_(std::make_shared<const Mesh>(MeshLoad<Mesh>::load(robotMesh, true, false)))
             , goal_(goal)
             , min_(min)
             , max_(max)
@@ -81,6 +84,19 @@ namespace mpl::demo {
             // JI_LOG(INFO) << "self collision check: " << fcl::collide(robot_.get(), a, robotTest.get(), id, req, res);
         }
 
+        // Creates a scenario that shares the environment and robot
+        // of another, but with a different goal.
+        SE3RigidBodyScenario(const SE3RigidBodyScenario& other, const State& goal)
+            : environment_(other.environment_)
+            , robot_(other.robot_)
+            , goal_(goal)
+            , min_(other.min_)
+            , max_(other.max_)
+            , goalRadius_(other.goalRadius_)
+            , invStepSize_(other.invStepSize_)
+        {
+        }
+
         ~SE3RigidBodyScenario() {
             JI_LOG(INFO) << "isValid calls: " << calls_.load();
         }
@@ -123,7 +139,7 @@ namespace mpl::demo {
 
             Transform tf = stateToTransform(q);
             
-            return !fcl::collide(&robot_, tf, &environment_, Transform::Identity(), req, res);
+            return !fcl::collide(robot_.get(), tf, environment_.get(), Transform::Identity(), req, res);
             
             // static Transform id{Transform::Identity()};
 
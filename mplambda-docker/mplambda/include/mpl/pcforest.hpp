@@ -7,6 +7,7 @@
 
 #include <atomic>
 #include <deque>
+#include <limits>
 #include <random>
 #include <thread>
 #include <type_traits>
@@ -44,6 +45,13 @@ namespace mpl {
 
         using Neighborhood = std::vector<std::tuple<Node*, Distance>>;
 
+        // only KDTreeBatch supports removal
+        static constexpr bool kCanPrune = std::is_same_v<NNStrategy, unc::robotics::nigh::KDTreeBatch<>>;
+
+        // only KDTreeBatch has a dedicated radius search, the other
+        // strategies use a k-nearest search with an unbounded k.
+        static constexpr bool kRadiusSearch = std::is_same_v<NNStrategy, unc::robotics::nigh::KDTreeBatch<>>;
+
         static constexpr Distance E = 2.71828182845904523536028747135266249775724709369995L;
         
         Scenario scenario_;
@@ -57,8 +65,26 @@ namespace mpl {
         std::atomic_int goalBiasedSamples_{0};
         std::vector<Thread> threads_;
 
+        // pruning removes nodes that cannot improve the solution
+        // from the nearest neighbor structure.  It runs whenever the
+        // solution cost drops by pruneThreshold_ relative to the
+        // cost of the last pruning pass.
+        Distance pruneThreshold_{0.05};
+        std::atomic<Distance> prunedCost_{std::numeric_limits<Distance>::infinity()};
+        std::atomic_flag pruning_ = ATOMIC_FLAG_INIT;
+        std::atomic<std::size_t> prunedNodes_{0};
+
         Distance kRRG_;
 
+        // when positive, rewiring neighborhoods are the r-disc of
+        // radius rewireGamma_ * (log(n)/n)^(1/d) (capped at the
+        // steering distance), instead of the kRRG_ * log(n) nearest.
+        Distance rewireGamma_{0};
+
+        // approximation of the nearest neighbor search in the extend
+        // step.  Rewiring neighborhoods are always exact.
+        unc::robotics::nigh::Approximate extendApprox_;
+
         // State randomSample(RNG& rng, Distance goalBias) {
         //     static std::uniform_real_distribution<Distance> unif01;
 
@@ -77,13 +103,33 @@ namespace mpl {
         //     return q;
         // }
         
-        decltype(auto) nearest(const State& q) {
-            return nn_.nearest(Scenario::scale(q));
+        decltype(auto) nearest(
+            const State& q,
+            const unc::robotics::nigh::Approximate& approx = unc::robotics::nigh::Approximate())
+        {
+            return nn_.nearest(Scenario::scale(q), approx);
         }
 
+        // the rewiring neighborhood of q, which is sorted by
+        // distance in k-nearest mode, and unordered in r-disc mode.
         void nearest(Neighborhood& nbh, const State& q) {
-            unsigned k = std::ceil(kRRG_ * std::log(Distance(nn_.size() + 1)));
-            nn_.nearest(nbh, Scenario::scale(q), k);
+            if (rewireGamma_ > 0) {
+                Distance r = rewireRadius();
+                if constexpr (kRadiusSearch) {
+                    nn_.nearest_radius(nbh, Scenario::scale(q), r);
+                } else {
+                    nn_.nearest(nbh, Scenario::scale(q), std::numeric_limits<std::size_t>::max(), r);
+                }
+            } else {
+                unsigned k = std::ceil(kRRG_ * std::log(Distance(nn_.size() + 1)));
+                nn_.nearest(nbh, Scenario::scale(q), k);
+            }
+        }
+
+        Distance rewireRadius() const {
+            Distance n = nn_.size() + 1;
+            Distance d = scenario_.space().dimensions();
+            return std::min(maxDistance_, rewireGamma_ * std::pow(std::log(n) / n, 1 / d));
         }
         
         decltype(auto) isValid(const State& q) {
@@ -107,6 +153,45 @@ namespace mpl {
             nn_.insert(node);
         }
 
+        // Removes nodes whose cost-to-come plus an admissible
+        // heuristic cost-to-go exceeds the cost of the solution.
+        // Such nodes cannot be on a better path, and would otherwise
+        // continue to appear in (and slow down) every nearest
+        // neighbor query.  The nodes remain in the tree (and in the
+        // path of their children), they just stop being candidates
+        // for new connections.
+        void prune(Edge *solution) {
+            Distance cost = solution->pathCost();
+            const State& goal = solution->node()->state();
+            std::size_t count = nn_.erase_if([&] (const Node *node) {
+                    // with multiple goals the distance to the
+                    // solution's goal is not admissible.
+                    Distance h = Scenario::multiGoal ? 0 : distance(node->state(), goal);
+                    return node->edge()->pathCost() + h > cost;
+                });
+            prunedCost_.store(cost, std::memory_order_relaxed);
+            prunedNodes_.fetch_add(count, std::memory_order_relaxed);
+            JI_LOG(INFO) << "pruned " << count << " nodes for solution cost " << cost
+                         << ", " << nn_.size() << " remain";
+        }
+
+        void maybePrune() {
+            if constexpr (kCanPrune) {
+                Edge *s = solution_.load(std::memory_order_acquire);
+                if (s == nullptr || pruneThreshold_ < 0 ||
+                    s->pathCost() >= prunedCost_.load(std::memory_order_relaxed) * (1 - pruneThreshold_))
+                    return;
+
+                // only one thread prunes at a time, the others
+                // continue sampling.
+                if (pruning_.test_and_set(std::memory_order_acquire))
+                    return;
+
+                prune(s);
+                pruning_.clear(std::memory_order_release);
+            }
+        }
+
         void updateSolution(Edge *edge, bool newSample) {
             Edge *prevSolution = solution_.load(std::memory_order_acquire);
             while (prevSolution == nullptr || edge->pathCost() < prevSolution->pathCost()) {
@@ -158,6 +243,13 @@ namespace mpl {
             threads_[0].setGoalBias(d * threads_.size());
         }
 
+        // Sets the epsilon of the approximate nearest neighbor search
+        // used to find the node to extend from (see
+        // nigh::Approximate).  0, the default, is an exact search.
+        void setNearestEpsilon(Distance eps) {
+            extendApprox_ = unc::robotics::nigh::Approximate(eps);
+        }
+
         bool isSolved() const {
             return solution_.load(std::memory_order_relaxed) != nullptr;
         }
@@ -197,6 +289,27 @@ namespace mpl {
             return goalBiasedSamples_;
         }
 
+        // Switches rewiring to r-disc neighborhoods of radius
+        // gamma * (log(n)/n)^(1/d), capped at the steering distance.
+        // RRT* is asymptotically optimal for gamma greater than
+        // 2 (1 + 1/d)^(1/d) (mu(X_free)/zeta_d)^(1/d), where mu is the
+        // measure of the free space and zeta_d that of the unit ball.
+        // 0, the default, uses k-nearest neighborhoods.
+        void setRewireGamma(Distance gamma) {
+            rewireGamma_ = gamma;
+        }
+
+        // Sets the relative improvement in solution cost that
+        // triggers a pruning pass.  A negative value disables
+        // pruning.
+        void setPruneThreshold(Distance d) {
+            pruneThreshold_ = d;
+        }
+
+        std::size_t prunedNodes() const {
+            return prunedNodes_.load(std::memory_order_relaxed);
+        }
+
     private:
         template <class T, class Fn>
         T threadAccum(T init, Fn fn) const {
@@ -485,7 +598,7 @@ namespace mpl {
         }
 
         Node* addSample(Planner& planner, State qRand, bool knownGoal) {
-            auto [nNear, dNear] = planner.nearest(qRand).value();
+            auto [nNear, dNear] = planner.nearest(qRand, planner.extendApprox_).value();
 
             if (dNear > planner.maxDistance_) {
                 qRand = interpolate(nNear->state(), qRand, planner.maxDistance_ / dNear);
@@ -514,14 +627,16 @@ namespace mpl {
             // check if any in the neighborhood would make a better
             // parent than the current one.  We check in increasing
             // order of pathCost up to the pathCost of the nearest
-            // node.
+            // node.  The neighborhood may be unordered (in r-disc
+            // mode), and in any case a farther neighbor may have a
+            // lower pathCost, thus every neighbor is considered.
             parentHeap_.clear();
             for (std::size_t nbrIndex=0 ; nbrIndex<nbh_.size() ; ++nbrIndex) {
                 auto [ nbrNode, nbrDist ] = nbh_[nbrIndex];
                 Edge *nbrEdge = nbrNode->edge(std::memory_order_acquire);
                 Distance nbrPathCost = nbrEdge->pathCost() + nbrDist;
                 if (nbrPathCost >= parentCost)
-                    break;
+                    continue;
                 parentHeap_.emplace_back(nbrPathCost, nbrEdge, nbrIndex);
             }
             std::make_heap(parentHeap_.begin(), parentHeap_.end(), ParentHeapCompare{});
@@ -678,8 +793,10 @@ namespace mpl {
 
         template <class DoneFn>
         void solve(Planner& planner, DoneFn done) {
-            while (!done())
+            while (!done()) {
                 addRandomSample(planner);
+                planner.maybePrune();
+            }
         }
 
         template <class Visitor>
@@ -48,6 +48,10 @@ namespace mpl {
         std::atomic<Node*> solution_{nullptr};
 
         std::atomic_int goalBiasedSamples_{0};
+
+        // approximation of the nearest neighbor search in the extend
+        // step.
+        unc::robotics::nigh::Approximate extendApprox_;
         
         decltype(auto) randomSample(RNG& rng) {
             return scenario_.randomSample(rng);
@@ -63,8 +67,11 @@ namespace mpl {
                 solution_.store(n, std::memory_order_release);
         }
 
-        decltype(auto) nearest(const State& q) {
-            return nn_.nearest(Scenario::scale(q));
+        decltype(auto) nearest(
+            const State& q,
+            const unc::robotics::nigh::Approximate& approx = unc::robotics::nigh::Approximate())
+        {
+            return nn_.nearest(Scenario::scale(q), approx);
         }
 
         decltype(auto) isValid(const State& q) {
@@ -101,6 +108,13 @@ namespace mpl {
             threads_[0].setGoalBias(d * threads_.size());
         }
 
+        // Sets the epsilon of the approximate nearest neighbor search
+        // used to find the node to extend from (see
+        // nigh::Approximate).  0, the default, is an exact search.
+        void setNearestEpsilon(Distance eps) {
+            extendApprox_ = unc::robotics::nigh::Approximate(eps);
+        }
+
         bool isSolved() const {
             return solution_.load(std::memory_order_relaxed) != nullptr;
         }
@@ -278,7 +292,7 @@ namespace mpl {
         }
         
         void addSample(Planner& planner, State qRand, bool knownGoal) {
-            auto [nNear, d] = planner.nearest(qRand).value();
+            auto [nNear, d] = planner.nearest(qRand, planner.extendApprox_).value();
 
             if (d == 0)
                 return;
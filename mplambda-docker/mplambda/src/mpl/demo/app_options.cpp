@@ -40,10 +40,18 @@ Options:
   -r, --robot=MESH              The robot's mesh (se3 only)
   -s, --start=W,I,J,K,X,Y,Z     The start configuration (se3 = rotation + translation, fetch = configuration)
   -g, --goal=W,I,J,K,X,Y,Z      (may be in joint space or IK frame)
+  -B, --batch=ID:START:GOAL[;ID:START:GOAL...]
+                                Solve a batch of queries against the same env/robot.
+                                Each solution is sent to the coordinator under its ID.
+                                (may be specified more than once)
   -G, --goal-radius=RADIUS      Specify the tolerances for the goal as either a scalar or twist (fetch only)
   -m, --min=X,Y,Z               Workspace minimum (se3 only)
   -M, --max=X,Y,Z               Workspace maximum (se3 only)
   -d, --check-resolution=DIST   Collision checking resolution (0 means use default)
+  -n, --nn-epsilon=EPS          Use a (1+EPS)-approximate nearest neighbor search to
+                                select the node to extend (0 means exact, the default)
+  -R, --rewire-gamma=GAMMA      Rewire over the r-disc of radius GAMMA*(log(n)/n)^(1/d)
+                                instead of the k-nearest (0 means k-nearest, the default)
   -f, --float                   Use single-precision math instead of double (not currently enabled)
 )";
 }
@@ -59,6 +67,7 @@ mpl::demo::AppOptions::AppOptions(int argc, char *argv[]) {
         { "robot", required_argument, NULL, 'r' },
         { "goal", required_argument, NULL, 'g' },
         { "goal-radius", required_argument, NULL, 'G' },
+        { "batch", required_argument, NULL, 'B' },
         { "start", required_argument, NULL, 's' },
         { "min", required_argument, NULL, 'm' },
         { "max", required_argument, NULL, 'M' },
@@ -66,12 +75,14 @@ mpl::demo::AppOptions::AppOptions(int argc, char *argv[]) {
         { "time-limit", required_argument, NULL, 't' },
         { "check-resolution", required_argument, NULL, 'd' },
         { "discretization", required_argument, NULL, 'd' }, // less-descriptive alieas
+        { "nn-epsilon", required_argument, NULL, 'n' },
+        { "rewire-gamma", required_argument, NULL, 'R' },
         { "float", no_argument, NULL, 'f' },
         
         { NULL, 0, NULL, 0 }
     };
 
-    for (int ch ; (ch = getopt_long(argc, argv, "S:a:c:j:e:E:r:g:G:s:m:M:I:t:d:f", longopts, NULL)) != -1 ; ) {
+    for (int ch ; (ch = getopt_long(argc, argv, "S:a:c:j:e:E:r:g:G:B:s:m:M:I:t:d:n:R:f", longopts, NULL)) != -1 ; ) {
         char *endp;
                 
         switch (ch) {
@@ -104,6 +115,11 @@ mpl::demo::AppOptions::AppOptions(int argc, char *argv[]) {
         case 'G':
             goalRadius_ = optarg;
             break;
+        case 'B':
+            if (!batch_.empty())
+                batch_ += ';';
+            batch_ += optarg;
+            break;
         case 's':
             start_ = optarg;
             break;
@@ -128,6 +144,16 @@ mpl::demo::AppOptions::AppOptions(int argc, char *argv[]) {
             if (endp == optarg || *endp || checkResolution_ < 0)
                 throw std::invalid_argument("bad value for --check-resolution");
             break;
+        case 'n':
+            nnEpsilon_ = std::strtod(optarg, &endp);
+            if (endp == optarg || *endp || nnEpsilon_ < 0)
+                throw std::invalid_argument("bad value for --nn-epsilon");
+            break;
+        case 'R':
+            rewireGamma_ = std::strtod(optarg, &endp);
+            if (endp == optarg || *endp || rewireGamma_ < 0)
+                throw std::invalid_argument("bad value for --rewire-gamma");
+            break;
         case 'f':
             singlePrecision_ = true;
             break;
@@ -139,6 +165,39 @@ mpl::demo::AppOptions::AppOptions(int argc, char *argv[]) {
     
 }
 
+std::vector<mpl::demo::BatchQuery> mpl::demo::AppOptions::batch() const {
+    std::vector<BatchQuery> queries;
+    std::size_t pos = 0;
+    while (pos < batch_.size()) {
+        std::size_t end = batch_.find(';', pos);
+        if (end == std::string::npos)
+            end = batch_.size();
+
+        std::string query = batch_.substr(pos, end - pos);
+        pos = end + 1;
+        if (query.empty())
+            continue;
+
+        std::size_t c0 = query.find(':');
+        std::size_t c1 = c0 == std::string::npos ? c0 : query.find(':', c0 + 1);
+        if (c1 == std::string::npos)
+            throw std::invalid_argument("bad value for --batch, expected ID:START:GOAL: " + query);
+
+        char *endp;
+        std::string id = query.substr(0, c0);
+        std::uint64_t problemId = std::strtoull(id.c_str(), &endp, 0);
+        if (id.empty() || *endp)
+            throw std::invalid_argument("bad problem id in --batch: " + id);
+
+        queries.push_back({ problemId, query.substr(c0 + 1, c1 - c0 - 1), query.substr(c1 + 1) });
+    }
+
+    if (queries.empty())
+        throw std::invalid_argument("--batch does not contain any queries");
+
+    return queries;
+}
+
 static void put(std::vector<std::string>& args, const std::string& key, const std::string& value) {
     if (!value.empty()) {
         args.push_back(key);
@@ -148,11 +207,15 @@ static void put(std::vector<std::string>& args, const std::string& key, const st
 
 mpl::packet::Problem mpl::demo::AppOptions::toProblemPacket() const {
     std::vector<std::string> args;
-    args.reserve(26);
+    args.reserve(28);
     put(args, "scenario", scenario());
     put(args, "coordinator", coordinator());
     put(args, "time-limit", std::to_string(timeLimit_));
     put(args, "check-resolution", std::to_string(checkResolution_));
+    if (nnEpsilon_ > 0)
+        put(args, "nn-epsilon", std::to_string(nnEpsilon_));
+    if (rewireGamma_ > 0)
+        put(args, "rewire-gamma", std::to_string(rewireGamma_));
     put(args, "env", env_);
     put(args, "env-frame", envFrame_);
     put(args, "robot", robot_);
@@ -7,6 +7,8 @@
 #include <mpl/option.hpp>
 #include <getopt.h>
 #include <optional>
+#include <atomic>
+#include <omp.h>
 
 namespace mpl::demo {
 
@@ -57,23 +59,29 @@ namespace mpl::demo {
     }
 
     template <class Scenario, class Algorithm, class ... Args>
-    void runPlanner(const demo::AppOptions& options, Args&& ... args) {
+    void runPlanner(
+        const demo::AppOptions& options,
+        std::uint64_t problemId,
+        const typename Scenario::State& qStart,
+        Args&& ... args)
+    {
         using State = typename Scenario::State;
         using Distance = typename Scenario::Distance;
 
-        State qStart = options.start<State>();
-
         Comm comm_;
 
         if (options.coordinator(false).empty()) {
             JI_LOG(WARN) << "no coordinator set";
         } else {
-            comm_.setProblemId(options.problemId());
+            comm_.setProblemId(problemId);
             comm_.connect(options.coordinator());
         }
 
         JI_LOG(INFO) << "setting up planner";
         Planner<Scenario, Algorithm> planner(std::forward<Args>(args)...);
+        planner.setNearestEpsilon(options.nnEpsilon());
+        if constexpr (Algorithm::asymptotically_optimal)
+            planner.setRewireGamma(options.rewireGamma());
 
         JI_LOG(INFO) << "Adding start state: " << qStart;
         planner.addStart(qStart);
@@ -180,6 +188,51 @@ namespace mpl::demo {
     }
 
 
+    // Solves each query of a batch against a scenario that is
+    // loaded once and shared by all queries.  The available threads
+    // are partitioned into teams, one query per team at a time, and
+    // teams pick up the next unsolved query when they finish.  Each
+    // query connects to the coordinator with its own problem ID, thus
+    // solutions are reported to the coordinator per query.
+    template <class Scenario, class Algorithm, class GoalFn>
+    void runBatch(const demo::AppOptions& options, const Scenario& base, GoalFn goalFn) {
+        using State = typename Scenario::State;
+
+        std::vector<BatchQuery> queries = options.batch();
+        int nThreads = std::max(1, omp_get_max_threads());
+        int nTeams = std::min(nThreads, static_cast<int>(queries.size()));
+        int teamSize = std::max(1, nThreads / nTeams);
+
+        JI_LOG(INFO) << "solving batch of " << queries.size() << " queries on "
+                     << nTeams << " team(s) of " << teamSize << " thread(s)";
+
+        // each team's planner runs its own parallel region, thus we
+        // need nested parallelism for the duration of the batch.
+        int maxActiveLevels = omp_get_max_active_levels();
+        omp_set_max_active_levels(std::max(maxActiveLevels, 2));
+
+        std::atomic<std::size_t> nextQuery{0};
+#pragma omp parallel num_threads(nTeams)
+        {
+            // sets the thread count of the planners this team creates
+            omp_set_num_threads(teamSize);
+            for (std::size_t i ; (i = nextQuery++) < queries.size() ; ) {
+                const BatchQuery& query = queries[i];
+                try {
+                    JI_LOG(INFO) << "starting batch query " << query.problemId_;
+                    runPlanner<Scenario, Algorithm>(
+                        options, query.problemId_,
+                        AppOptions::start<State>(query),
+                        base, goalFn(query));
+                } catch (const std::exception& ex) {
+                    JI_LOG(ERROR) << "batch query " << query.problemId_ << " failed: " << ex.what();
+                }
+            }
+        }
+
+        omp_set_max_active_levels(maxActiveLevels);
+    }
+
     template <class Algorithm, class S>
     void runSelectScenario(const demo::AppOptions& options) {
         JI_LOG(INFO) << "running scenario: " << options.scenario();
@@ -187,27 +240,53 @@ namespace mpl::demo {
             using Scenario = mpl::demo::SE3RigidBodyScenario<S>;
             using Bound = typename Scenario::Bound;
             using State = typename Scenario::State;
-            State goal = options.goal<State>();
             Bound min = options.min<Bound>();
             Bound max = options.max<Bound>();
-            runPlanner<Scenario, Algorithm>(
-                options, options.env(), options.robot(), goal, min, max,
-                options.checkResolution(0.1));
+            if (options.isBatch()) {
+                // the base scenario's goal is not used for planning,
+                // each query replaces it with its own.
+                std::vector<BatchQuery> queries = options.batch();
+                Scenario base(
+                    options.env(), options.robot(),
+                    AppOptions::goal<State>(queries.front()), min, max,
+                    options.checkResolution(0.1));
+                runBatch<Scenario, Algorithm>(
+                    options, base,
+                    [] (const BatchQuery& query) { return AppOptions::goal<State>(query); });
+            } else {
+                State goal = options.goal<State>();
+                runPlanner<Scenario, Algorithm>(
+                    options, options.problemId(), options.start<State>(),
+                    options.env(), options.robot(), goal, min, max,
+                    options.checkResolution(0.1));
+            }
         } else if (options.scenario() == "fetch") {
             using Scenario = mpl::demo::FetchScenario<S>;
             using State = typename Scenario::State;
             using Frame = typename Scenario::Frame;
             using GoalRadius = Eigen::Matrix<S, 6, 1>;
             Frame envFrame = options.envFrame<Frame>();
-            Frame goal = options.goal<Frame>();
             GoalRadius goalRadius = options.goalRadius<GoalRadius>();
             JI_LOG(INFO) << "Env frame: " << envFrame;
-            JI_LOG(INFO) << "Goal: " << goal;
-            goal = envFrame * goal;
-            JI_LOG(INFO) << "Goal in robot's frame: " << goal;
-            runPlanner<Scenario, Algorithm>(
-                options, envFrame, options.env(), goal, goalRadius,
-                options.checkResolution(0.1));
+            if (options.isBatch()) {
+                std::vector<BatchQuery> queries = options.batch();
+                Scenario base(
+                    envFrame, options.env(),
+                    envFrame * AppOptions::goal<Frame>(queries.front()),
+                    goalRadius, options.checkResolution(0.1));
+                runBatch<Scenario, Algorithm>(
+                    options, base,
+                    [&] (const BatchQuery& query) { return Frame(envFrame * AppOptions::goal<Frame>(query)); });
+            } else {
+                Frame goal = options.goal<Frame>();
+                JI_LOG(INFO) << "Goal: " << goal;
+                goal = envFrame * goal;
+                JI_LOG(INFO) << "Goal in robot's frame: " << goal;
+                runPlanner<Scenario, Algorithm>(
+                    options, options.problemId(), options.start<State>(),
+                    envFrame, options.env(), goal, goalRadius,
+                    options.checkResolution(0.1));
+            }
         } else {
             throw std::invalid_argument("bad scenario: " + options.scenario());
         }
@@ -49,7 +49,10 @@ invocation_response my_handler(invocation_request const& request) try {
     set(options.goalRadius_, v, "goal-radius");
     set(options.timeLimit_, v, "time-limit");
     set(options.checkResolution_, v, "check-resolution");
+    set(options.nnEpsilon_, v, "nn-epsilon");
+    set(options.rewireGamma_, v, "rewire-gamma");
     set(options.problemId_, v, "problem-id");
+    set(options.batch_, v, "batch");
 
     mpl::demo::runSelectPlanner(options);
     return invocation_response::success("Solved!", "application/json");
@@ -0,0 +1,81 @@
+// Software License Agreement (BSD-3-Clause)
+//
+// Copyright 2018 The University of North Carolina at Chapel Hill
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+// OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//! @author Jeff Ichnowski
+
+#pragma once
+#ifndef NIGH_APPROXIMATE_HPP
+#define NIGH_APPROXIMATE_HPP
+
+#include <cstddef>
+#include <limits>
+
+namespace unc::robotics::nigh {
+
+    // Approximate relaxes a nearest neighbor query of the kd-tree
+    // strategies (KDTreeBatch and KDTreeMedian).  It is passed as an
+    // additional argument to nearest().
+    //
+    // With epsilon > 0, a region is skipped unless it may contain a
+    // value closer than 1/(1+epsilon) of the current bound, thus every
+    // returned neighbor is within a factor (1+epsilon) of the
+    // distance of the true neighbor of the same rank.
+    //
+    // maxLeafVisits bounds the number of leaves scanned.  Once that
+    // many leaves have been scanned, the search stops as soon as the
+    // result set is full (k results, or 1 for the single-nearest
+    // query) even if closer values may remain, in which case there
+    // is no bound on the error.
+    //
+    // The default Approximate is an exact search.
+    struct Approximate {
+        double epsilon_{0};
+        std::size_t maxLeafVisits_{std::numeric_limits<std::size_t>::max()};
+
+        Approximate() = default;
+
+        explicit Approximate(
+            double epsilon,
+            std::size_t maxLeafVisits = std::numeric_limits<std::size_t>::max())
+            : epsilon_(epsilon)
+            , maxLeafVisits_(maxLeafVisits)
+        {
+        }
+
+        bool exact() const {
+            return epsilon_ <= 0 && maxLeafVisits_ == std::numeric_limits<std::size_t>::max();
+        }
+    };
+}
+
+#endif
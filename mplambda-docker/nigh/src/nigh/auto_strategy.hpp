@@ -60,13 +60,10 @@ namespace unc::robotics::nigh {
     //    practice, but the forced median balance of KDTreeMedian
     //    should provide better worst-case performance.
     //
-    // 3. the space is NOT a decomposible metric spance, and there is
-    //    no need for concurrent inserts, then GNAT is the best
-    //    option.
-    //
-    // 4. otherwise, Linear is selected.  Note that is this case GNAT
-    //    may perform better depending on concurrent demands placed
-    //    upon the data structure.
+    // 3. the space is NOT a decomposible metric spance, then GNAT is
+    //    the best option.  With concurrent inserts, GNAT's lock-free
+    //    variant is used, in which writers only contend on the leaf
+    //    bucket they insert into.
     template <typename Space, typename Concurrency, bool pauseless,
               bool = metric::is_space_v<Space>>
     struct auto_strategy;
@@ -112,7 +109,7 @@ namespace unc::robotics::nigh {
 
     template <typename Space, bool pauseless>
     struct auto_strategy<Space, Concurrent, pauseless, false> {
-        using type = Linear;
+        using type = GNAT<>;
     };
 }
 
@@ -82,7 +82,12 @@
 #include "impl/near_set.hpp"
 #include "impl/compare_nth.hpp"
 #include "impl/k_centers.hpp"
-#include "impl/locked_nearest.hpp"
+#include "impl/atom.hpp"
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <numeric>
+#include <optional>
 #include <queue>
 #include <random>
 #include <set>
@@ -523,8 +528,17 @@ namespace unc::robotics::nigh {
         }
     };
 
-    // Specialization for R/W concurrency.  This version is a
-    // read/write locked version of ConcurrentRead.
+    // Specialization for concurrent writes.  Readers never block and
+    // writers only contend on the leaf they insert into.  Each node
+    // stores its leaf elements inline in a fixed-size bucket whose
+    // size doubles as a lock (a negative size ~n means the bucket is
+    // locked with n elements).  Elements are published by releasing
+    // the lock with the new size.  When a full bucket receives one
+    // more element, the inserting thread keeps it locked, splits the
+    // bucket into new child nodes privately, and publishes them all
+    // at once by storing the number of children.  Splits never
+    // rebuild existing nodes, thus readers may continue to scan a
+    // stale bucket while a split is in progress.
     template <
         typename T,
         typename Space,
@@ -537,20 +551,430 @@ namespace unc::robotics::nigh {
         T, Space, KeyFn, Concurrent,
         GNAT<degree, minDegree, maxDegree, maxNumPtsPerLeaf, removedCacheSize, rebalancing>,
         Allocator>
-        : public impl::LockedNearest<
+        : public impl::NearestBase<
             Nigh<
-                T, Space, KeyFn, ConcurrentRead,
-                 GNAT<degree, minDegree, maxDegree, maxNumPtsPerLeaf, removedCacheSize, rebalancing>,
-                 Allocator>>
+                T, Space, KeyFn, Concurrent,
+                GNAT<degree, minDegree, maxDegree, maxNumPtsPerLeaf, removedCacheSize, rebalancing>,
+                Allocator>>
     {
-        using Base = impl::LockedNearest<
+        using Base = impl::NearestBase<
             Nigh<
-                T, Space, KeyFn, ConcurrentRead,
+                T, Space, KeyFn, Concurrent,
                 GNAT<degree, minDegree, maxDegree, maxNumPtsPerLeaf, removedCacheSize, rebalancing>,
                 Allocator>>;
 
     public:
-        using Base::Base;
+        using Key = typename Space::Type;
+        using Distance = typename Space::Distance;
+
+    private:
+        using RNG = std::conditional_t<sizeof(Distance) == 4, std::mt19937, std::mt19937_64>;
+
+        // child degrees are clamped to maxDegree, which may be larger
+        // than the root degree.
+        static constexpr unsigned kMaxDegree = std::max(degree, maxDegree);
+
+        // a bucket must hold a leaf's points, and be large enough to
+        // split into the node's degree.
+        static constexpr unsigned kBucketSize = std::max(maxNumPtsPerLeaf, kMaxDegree);
+
+        struct Node;
+
+        // the radii of the node are copied into the queue entry when
+        // it is queued, since concurrent inserts may change them
+        // while the entry is in the priority queue.
+        struct NodeDist {
+            const Node *node_;
+            Distance dist_;
+            Distance minRadius_;
+            Distance maxRadius_;
+
+            NodeDist(const Node *node, Distance dist)
+                : node_(node)
+                , dist_(dist)
+                , minRadius_(node->minRadius_.load(std::memory_order_relaxed))
+                , maxRadius_(node->maxRadius_.load(std::memory_order_relaxed))
+            {
+            }
+        };
+
+        struct NodeDistCompare {
+            bool operator()(const NodeDist& a, const NodeDist& b) const {
+                return (a.dist_ - a.maxRadius_) > (b.dist_ - b.maxRadius_);
+            }
+        };
+
+        using NodeQueue = std::priority_queue<NodeDist, std::vector<NodeDist>, NodeDistCompare>;
+
+        static RNG& rng() {
+            static thread_local RNG rng;
+            return rng;
+        }
+
+        static void updateMin(impl::Atom<Distance, true>& a, Distance d) {
+            Distance v = a.load(std::memory_order_relaxed);
+            while (d < v && !a.compare_exchange_weak(v, d, std::memory_order_relaxed))
+                ;
+        }
+
+        static void updateMax(impl::Atom<Distance, true>& a, Distance d) {
+            Distance v = a.load(std::memory_order_relaxed);
+            while (d > v && !a.compare_exchange_weak(v, d, std::memory_order_relaxed))
+                ;
+        }
+
+        struct Node {
+            using AlignedStorage = std::aligned_storage_t<sizeof(T), alignof(T)>;
+
+            const T pivot_;
+
+            // only accessed by the thread that holds the bucket lock,
+            // or before the node is published.
+            unsigned degree_;
+
+            impl::Atom<Distance, true> minRadius_;
+            impl::Atom<Distance, true> maxRadius_;
+
+            std::array<impl::Atom<Distance, true>, kMaxDegree> minRange_;
+            std::array<impl::Atom<Distance, true>, kMaxDegree> maxRange_;
+
+            // children are written before numChildren_ is published,
+            // and never change once published.  0 children means that
+            // this node is a leaf.
+            std::array<Node*, kMaxDegree> children_;
+            impl::Atom<unsigned, true> numChildren_{0};
+
+            alignas(impl::cache_line_size)
+            impl::Atom<int, true> size_{0};
+
+            AlignedStorage data_[kBucketSize];
+
+            Node(unsigned deg, const T& pivot)
+                : pivot_(pivot)
+                , degree_(deg)
+            {
+                minRadius_.store( std::numeric_limits<Distance>::infinity(), std::memory_order_relaxed);
+                maxRadius_.store(-std::numeric_limits<Distance>::infinity(), std::memory_order_relaxed);
+                for (unsigned i=0 ; i<kMaxDegree ; ++i) {
+                    minRange_[i].store( std::numeric_limits<Distance>::infinity(), std::memory_order_relaxed);
+                    maxRange_[i].store(-std::numeric_limits<Distance>::infinity(), std::memory_order_relaxed);
+                }
+            }
+
+            ~Node() {
+                std::destroy(data(), data() + bucketSize());
+                unsigned nc = numChildren_.load(std::memory_order_relaxed);
+                for (unsigned i=0 ; i<nc ; ++i)
+                    delete children_[i];
+            }
+
+            T* data() {
+                return reinterpret_cast<T*>(data_);
+            }
+
+            const T* data() const {
+                return reinterpret_cast<const T*>(data_);
+            }
+
+            // number of elements in the bucket, whether or not it is
+            // locked.
+            int bucketSize() const {
+                int n = size_.load(std::memory_order_acquire);
+                return n < 0 ? ~n : n;
+            }
+
+            void updateRadius(Distance d) {
+                updateMin(minRadius_, d);
+                updateMax(maxRadius_, d);
+            }
+
+            void updateRange(unsigned i, Distance d) {
+                updateMin(minRange_[i], d);
+                updateMax(maxRange_[i], d);
+            }
+
+            // appends to the bucket of a node that has not been
+            // published yet.
+            void append(const T& data) {
+                int n = size_.load(std::memory_order_relaxed);
+                new (&data_[n]) T(data);
+                size_.store(n + 1, std::memory_order_relaxed);
+            }
+
+            void add(Nigh& gnat, const T& data) {
+                const Key& key = gnat.getKey(data);
+                Node *node = this;
+                for (;;) {
+                    if (unsigned nc = node->numChildren_.load(std::memory_order_acquire)) {
+                        Distance dist[kMaxDegree];
+                        Distance minDist = dist[0] = gnat.distance(key, gnat.getKey(node->children_[0]->pivot_));
+                        unsigned minInd = 0;
+
+                        for (unsigned i=1 ; i<nc ; ++i)
+                            if ((dist[i] = gnat.distance(key, gnat.getKey(node->children_[i]->pivot_))) < minDist)
+                                minDist = dist[minInd = i];
+
+                        for (unsigned i=0 ; i<nc ; ++i)
+                            node->children_[i]->updateRange(minInd, dist[i]);
+
+                        node = node->children_[minInd];
+                        node->updateRadius(minDist);
+                        continue;
+                    }
+
+                    int n = node->size_.load(std::memory_order_acquire);
+                    if (n < 0 || !node->size_.compare_exchange_weak(
+                            n, ~n, std::memory_order_acquire, std::memory_order_relaxed)) {
+                        // either another thread is appending to the
+                        // bucket, or it is splitting it.  In the
+                        // latter case the bucket remains locked and
+                        // the loop continues into the new children
+                        // once they are published.
+                        impl::relax_cpu();
+                        continue;
+                    }
+
+                    if (n < (int)kBucketSize) {
+                        new (&node->data_[n]) T(data);
+                        node->size_.store(n + 1, std::memory_order_release);
+                    } else {
+                        node->split(gnat, data);
+                    }
+                    return;
+                }
+            }
+
+            // splits the full (and locked) bucket plus one additional
+            // element into new children.  The bucket is left locked
+            // since it is superseded by the children.
+            void split(Nigh& gnat, const T& extra) {
+                std::vector<T> all(data(), data() + kBucketSize);
+                all.push_back(extra);
+
+                impl::KCenters<T, Distance, kMaxDegree, kBucketSize+1> kCenters;
+                kCenters.compute(
+                    all, degree_, rng(),
+                    [&] (const T& a, const T& b) {
+                        return gnat.distance(gnat.getKey(a), gnat.getKey(b));
+                    });
+
+                unsigned numCenters = kCenters.numCenters();
+                for (unsigned i=0 ; i<numCenters ; ++i)
+                    children_[i] = new Node(degree_, all[kCenters.center(i)]);
+
+                for (unsigned j=0 ; j<all.size() ; ++j) {
+                    unsigned k = 0;
+                    for (unsigned i=1 ; i<numCenters ; ++i)
+                        if (kCenters.dist(j, i) < kCenters.dist(j, k))
+                            k = i;
+                    Node *child = children_[k];
+                    if (j != kCenters.center(k)) {
+                        child->append(all[j]);
+                        child->updateRadius(kCenters.dist(j, k));
+                    }
+                    for (unsigned i=0 ; i<numCenters ; ++i)
+                        children_[i]->updateRange(k, kCenters.dist(j, i));
+                }
+
+                // the children hold at most kBucketSize elements, and
+                // thus will not split until their next insert.
+                for (unsigned i=0 ; i<numCenters ; ++i) {
+                    Node *child = children_[i];
+                    child->degree_ =
+                        std::min(std::max((unsigned)((numCenters * child->bucketSize()) / all.size()),
+                                          minDegree),
+                                 maxDegree);
+                    if (child->minRadius_.load(std::memory_order_relaxed) >= std::numeric_limits<Distance>::infinity()) {
+                        child->minRadius_.store(0, std::memory_order_relaxed);
+                        child->maxRadius_.store(0, std::memory_order_relaxed);
+                    }
+                }
+
+                degree_ = numCenters;
+                numChildren_.store(numCenters, std::memory_order_release);
+            }
+
+            template <typename NearSet>
+            void nearestK(
+                const Nigh& gnat, const Key& key,
+                NearSet& nearSet,
+                NodeQueue& nodeQueue,
+                bool &isPivot) const
+            {
+                unsigned nc = numChildren_.load(std::memory_order_acquire);
+                if (nc == 0) {
+                    const T* elements = data();
+                    for (int i=0, n=bucketSize() ; i<n ; ++i)
+                        if (nearSet.insert(elements[i], gnat.distance(key, gnat.getKey(elements[i]))))
+                            isPivot = false;
+                    return;
+                }
+
+                Distance dist;
+                Distance distToPivot[kMaxDegree];
+                int permutation[kMaxDegree];
+                std::iota(permutation, permutation + nc, 0);
+                std::shuffle(permutation, permutation + nc, rng());
+
+                for (unsigned i=0 ; i<nc ; ++i) {
+                    if (permutation[i] >= 0) {
+                        const Node *child = children_[permutation[i]];
+                        distToPivot[permutation[i]] = gnat.distance(key, gnat.getKey(child->pivot_));
+                        if (nearSet.insert(child->pivot_, distToPivot[permutation[i]]))
+                            isPivot = true;
+                        if (nearSet.full()) {
+                            dist = nearSet.dist();
+                            for (unsigned j = 0 ; j<nc ; ++j)
+                                if (permutation[j] >= 0 && i != j &&
+                                    (distToPivot[permutation[i]] - dist >
+                                     child->maxRange_[permutation[j]].load(std::memory_order_relaxed) ||
+                                     distToPivot[permutation[i]] + dist <
+                                     child->minRange_[permutation[j]].load(std::memory_order_relaxed)))
+                                    permutation[j] = -1;
+                        }
+                    }
+                }
+
+                dist = nearSet.dist();
+                for (unsigned i=0 ; i<nc ; ++i) {
+                    if (permutation[i] >= 0) {
+                        NodeDist entry(children_[permutation[i]], distToPivot[permutation[i]]);
+                        if (!nearSet.full() || (entry.dist_ - dist <= entry.maxRadius_ &&
+                                                entry.dist_ + dist >= entry.minRadius_))
+                            nodeQueue.push(entry);
+                    }
+                }
+            }
+
+            template <typename Fn>
+            void visit(const Fn& fn) const {
+                fn(pivot_);
+                if (unsigned nc = numChildren_.load(std::memory_order_acquire)) {
+                    for (unsigned i=0 ; i<nc ; ++i)
+                        children_[i]->visit(fn);
+                } else {
+                    const T* elements = data();
+                    for (int i=0, n=bucketSize() ; i<n ; ++i)
+                        fn(elements[i]);
+                }
+            }
+        };
+
+        impl::Atom<Node*, true> tree_{nullptr};
+        impl::Atom<std::size_t, true> size_{0};
+
+        template <typename NearSet>
+        bool nearestKInternal(const Node *root, const Key& key, NearSet& nearSet) const {
+            NodeQueue nodeQueue;
+
+            bool isPivot = nearSet.insert(root->pivot_, Base::distToKey(root->pivot_, key));
+            root->nearestK(*this, key, nearSet, nodeQueue, isPivot);
+            while (!nodeQueue.empty()) {
+                Distance dist = nearSet.dist();
+                NodeDist nodeDist = nodeQueue.top();
+                nodeQueue.pop();
+                if (nearSet.full() && (nodeDist.dist_ > nodeDist.maxRadius_ + dist ||
+                                       nodeDist.dist_ < nodeDist.minRadius_ - dist))
+                    continue;
+                nodeDist.node_->nearestK(*this, key, nearSet, nodeQueue, isPivot);
+            }
+
+            return isPivot;
+        }
+
+    public:
+        Nigh(Nigh&& other)
+            : Base(std::move(other))
+            , tree_(other.tree_.exchange(nullptr, std::memory_order_relaxed))
+            , size_(other.size_.exchange(0, std::memory_order_relaxed))
+        {
+        }
+
+        Nigh(const Space& space = Space(), const KeyFn& getKey = KeyFn(), const Allocator& alloc = Allocator())
+            : Base(space, getKey, alloc)
+        {
+        }
+
+        ~Nigh() {
+            clear();
+        }
+
+        void insert(const T& data) {
+            Node *root = tree_.load(std::memory_order_acquire);
+            if (root == nullptr) {
+                Node *node = new Node(degree, data);
+                if (tree_.compare_exchange_strong(
+                        root, node, std::memory_order_release, std::memory_order_acquire)) {
+                    size_.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+                // another thread created the root first, root now
+                // has its value.
+                delete node;
+            }
+
+            root->add(*this, data);
+            size_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        template <typename Iter>
+        void insert(Iter begin, Iter end) {
+            for (Iter it = begin ; it != end ; ++it)
+                insert(*it);
+        }
+
+        // not safe to call concurrently with any other method.
+        void clear() {
+            delete tree_.exchange(nullptr, std::memory_order_relaxed);
+            size_.store(0, std::memory_order_relaxed);
+        }
+
+        bool remove(const T& data) {
+            // TODO: see the ConcurrentRead version
+            return false;
+        }
+
+        std::optional<std::pair<T, Distance>> nearest(const Key& key) const {
+            impl::Near1Set<T, Distance> nearSet;
+            if (const Node *root = tree_.load(std::memory_order_acquire))
+                nearestKInternal(root, key, nearSet);
+            return nearSet.result();
+        }
+
+        template <typename Tuple, typename K, typename ResultAllocator>
+        void nearest(
+            std::vector<Tuple, ResultAllocator>& nbh,
+            const K& key,
+            std::size_t k,
+            Distance maxRadius = std::numeric_limits<Distance>::infinity()) const
+        {
+            impl::NearKSet<Tuple, Distance, ResultAllocator> nearSet(nbh, k, maxRadius);
+            if (const Node *root = tree_.load(std::memory_order_acquire))
+                nearestKInternal(root, key, nearSet);
+            nearSet.sort();
+        }
+
+        std::size_t size() const {
+            return size_.load(std::memory_order_relaxed);
+        }
+
+        template <typename Fn>
+        void visit(const Fn& fn) const {
+            if (const Node *root = tree_.load(std::memory_order_acquire))
+                root->visit(fn);
+        }
+
+        void list(std::vector<T>& data) const {
+            data.clear();
+            data.reserve(size());
+            visit([&] (const T& t) { data.push_back(t); });
+        }
+
+        std::vector<T> list() const {
+            std::vector<T> result;
+            list(result);
+            return result;
+        }
     };
 }
 
@@ -0,0 +1,414 @@
+// Software License Agreement (BSD-3-Clause)
+//
+// Copyright 2018 The University of North Carolina at Chapel Hill
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+// OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//! @author Jeff Ichnowski
+
+#pragma once
+#ifndef NIGH_HUGE_PAGE_ALLOCATOR_HPP
+#define NIGH_HUGE_PAGE_ALLOCATOR_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace unc::robotics::nigh {
+
+    // How a HugePageResource backs its regions (Linux only, other
+    // POSIX systems always use regular pages).
+    //
+    //   kNone        regular pages.
+    //   kTransparent regular mappings marked with MADV_HUGEPAGE, so
+    //                that the kernel backs them with transparent huge
+    //                pages when it can.
+    //   kExplicit    MAP_HUGETLB mappings from the reserved huge page
+    //                pool (see /proc/sys/vm/nr_hugepages).  If the
+    //                pool is empty, the resource falls back to
+    //                kTransparent.
+    enum class HugePages { kNone, kTransparent, kExplicit };
+
+    struct HugePageOptions {
+        HugePages pages{HugePages::kTransparent};
+
+        // size of the regions reserved from the OS.  It is rounded
+        // up to a power of two that is at least the huge page size.
+        std::size_t regionSize{std::size_t(64) << 20};
+
+        // when set, each NUMA node allocates from its own regions,
+        // bound to that node, and threads allocate from the regions
+        // of the node they are running on.
+        bool numa{false};
+    };
+
+    // A memory resource that carves allocations out of large,
+    // huge-page backed regions so that the nodes of a tree share few
+    // TLB entries and pages.  Allocations are rounded up to cache
+    // lines and served from per-size free lists, falling back to
+    // bumping through the current region.  Freed memory is kept for
+    // reuse and only returned to the OS when the resource is
+    // destroyed, except for allocations larger than a quarter of a
+    // region, which get a mapping of their own.
+    //
+    // The resource is thread-safe, with a lock per arena (one arena,
+    // or one per NUMA node).  It must outlive the allocators that
+    // use it.  Throws std::bad_alloc if a region cannot be mapped.
+    class HugePageResource {
+        static constexpr std::size_t kHugePageSize = std::size_t(2) << 20;
+        static constexpr std::size_t kGranule = 64;
+        static constexpr std::size_t kSmallLimit = std::size_t(64) << 10;
+        static constexpr std::size_t kSmallClasses = kSmallLimit / kGranule;
+        static constexpr std::size_t kClasses = kSmallClasses + 64;
+        static constexpr unsigned kMaxNodes = 64;
+
+        struct Arena {
+            std::mutex mutex_;
+            unsigned node_;
+            char *next_{nullptr};
+            char *end_{nullptr};
+            std::array<void*, kClasses> free_{};
+
+            explicit Arena(unsigned node) : node_(node) {}
+        };
+
+        // the first granule of each region points back to its arena
+        struct RegionHeader {
+            Arena *arena_;
+        };
+
+        HugePageOptions options_;
+        std::atomic<HugePages> pages_;
+
+        std::mutex mutex_;
+        std::array<std::atomic<Arena*>, kMaxNodes> arenas_{};
+        std::vector<void*> regions_;
+        std::unordered_map<void*, std::size_t> large_;
+        std::atomic<std::size_t> mappedBytes_{0};
+
+        static std::size_t regionSizeFor(std::size_t size) {
+            std::size_t region = kHugePageSize;
+            while (region < size)
+                region *= 2;
+            return region;
+        }
+
+        std::size_t largeLimit() const {
+            return options_.regionSize / 4;
+        }
+
+        // returns the free list of an allocation of bytes, and
+        // rounds bytes up to the size of the blocks on that list.
+        static unsigned sizeClass(std::size_t& bytes) {
+            if (bytes <= kSmallLimit) {
+                bytes = std::max((bytes + kGranule - 1) & ~(kGranule - 1), kGranule);
+                return bytes / kGranule - 1;
+            }
+
+            unsigned c = kSmallClasses;
+            std::size_t size = kSmallLimit * 2;
+            for ( ; size < bytes ; size *= 2)
+                ++c;
+            bytes = size;
+            return c;
+        }
+
+        static unsigned currentNode() {
+#if defined(__linux__) && defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 29)
+            unsigned cpu, node;
+            if (::getcpu(&cpu, &node) == 0 && node < kMaxNodes)
+                return node;
+#endif
+            return 0;
+        }
+
+        // maps size bytes aligned to align, with the configured huge
+        // pages, preferring the memory of node when numa is set.
+        void* map(std::size_t size, std::size_t align, unsigned node) {
+            void *base = MAP_FAILED;
+            std::size_t span = size + align - kHugePageSize;
+#ifdef MAP_HUGETLB
+            if (pages_.load(std::memory_order_relaxed) == HugePages::kExplicit) {
+                base = ::mmap(nullptr, span, PROT_READ | PROT_WRITE,
+                              MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+                if (base == MAP_FAILED)
+                    pages_.store(HugePages::kTransparent, std::memory_order_relaxed);
+            }
+#endif
+            if (base == MAP_FAILED) {
+                // regular mappings are only page aligned, so reserve
+                // enough to trim down to an aligned region.
+                span = size + align;
+                base = ::mmap(nullptr, span, PROT_READ | PROT_WRITE,
+                              MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                if (base == MAP_FAILED)
+                    throw std::bad_alloc();
+            }
+
+            std::uintptr_t start = reinterpret_cast<std::uintptr_t>(base);
+            std::uintptr_t aligned = (start + align - 1) & ~(std::uintptr_t(align) - 1);
+            if (aligned > start)
+                ::munmap(base, aligned - start);
+            if (start + span > aligned + size)
+                ::munmap(reinterpret_cast<void*>(aligned + size), start + span - aligned - size);
+
+            void *ptr = reinterpret_cast<void*>(aligned);
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+            if (pages_.load(std::memory_order_relaxed) == HugePages::kTransparent)
+                ::madvise(ptr, size, MADV_HUGEPAGE);
+#endif
+#if defined(__linux__) && defined(SYS_mbind)
+            if (options_.numa) {
+                // MPOL_PREFERRED, without depending on libnuma.
+                // Failures (e.g. in a container without
+                // CAP_SYS_NICE) leave the default first-touch policy.
+                constexpr int kMpolPreferred = 1;
+                unsigned long mask = 1ul << node;
+                ::syscall(SYS_mbind, ptr, size, kMpolPreferred, &mask, sizeof(mask)*8, 0);
+            }
+#endif
+            mappedBytes_.fetch_add(size, std::memory_order_relaxed);
+            return ptr;
+        }
+
+        Arena& arena() {
+            unsigned node = options_.numa ? currentNode() : 0;
+            Arena *arena = arenas_[node].load(std::memory_order_acquire);
+            if (arena == nullptr) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if ((arena = arenas_[node].load(std::memory_order_relaxed)) == nullptr) {
+                    arena = new Arena(node);
+                    arenas_[node].store(arena, std::memory_order_release);
+                }
+            }
+            return *arena;
+        }
+
+        // called with the arena locked.  The tail of the previous
+        // region is abandoned.
+        void newRegion(Arena& arena) {
+            void *region = map(options_.regionSize, options_.regionSize, arena.node_);
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                regions_.push_back(region);
+            }
+            static_cast<RegionHeader*>(region)->arena_ = &arena;
+            arena.next_ = static_cast<char*>(region) + kGranule;
+            arena.end_ = static_cast<char*>(region) + options_.regionSize;
+        }
+
+        void* allocateLarge(std::size_t bytes) {
+            std::size_t size = (bytes + kHugePageSize - 1) & ~(kHugePageSize - 1);
+            void *ptr = map(size, kHugePageSize, currentNode());
+            std::lock_guard<std::mutex> lock(mutex_);
+            large_.emplace(ptr, size);
+            return ptr;
+        }
+
+        void deallocateLarge(void *ptr) {
+            std::size_t size;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto it = large_.find(ptr);
+                size = it->second;
+                large_.erase(it);
+            }
+            ::munmap(ptr, size);
+            mappedBytes_.fetch_sub(size, std::memory_order_relaxed);
+        }
+
+    public:
+        explicit HugePageResource(const HugePageOptions& options = HugePageOptions())
+            : options_(options)
+            , pages_(options.pages)
+        {
+            options_.regionSize = regionSizeFor(options.regionSize);
+        }
+
+        HugePageResource(const HugePageResource&) = delete;
+        HugePageResource& operator = (const HugePageResource&) = delete;
+
+        ~HugePageResource() {
+            for (void *region : regions_)
+                ::munmap(region, options_.regionSize);
+            for (auto [ptr, size] : large_)
+                ::munmap(ptr, size);
+            for (auto& arena : arenas_)
+                delete arena.load(std::memory_order_relaxed);
+        }
+
+        // The resource used by default-constructed HugePageAllocators.
+        // It is never destroyed.
+        static HugePageResource* defaultResource() {
+            static HugePageResource* resource = new HugePageResource();
+            return resource;
+        }
+
+        const HugePageOptions& options() const {
+            return options_;
+        }
+
+        // The huge pages in use, which is kTransparent after a
+        // kExplicit resource fails to map from the huge page pool.
+        HugePages pages() const {
+            return pages_.load(std::memory_order_relaxed);
+        }
+
+        // Bytes reserved from the OS, whether or not they have been
+        // handed out.
+        std::size_t mappedBytes() const {
+            return mappedBytes_.load(std::memory_order_relaxed);
+        }
+
+        void* allocate(std::size_t bytes, std::size_t align = alignof(std::max_align_t)) {
+            if (align > kGranule) {
+                // over-allocate and keep the original pointer just
+                // before the aligned one.
+                char *base = static_cast<char*>(allocate(bytes + align, kGranule));
+                std::uintptr_t aligned = (reinterpret_cast<std::uintptr_t>(base) + sizeof(void*) + align - 1)
+                    & ~(std::uintptr_t(align) - 1);
+                reinterpret_cast<void**>(aligned)[-1] = base;
+                return reinterpret_cast<void*>(aligned);
+            }
+
+            if (bytes > largeLimit())
+                return allocateLarge(bytes);
+
+            unsigned c = sizeClass(bytes);
+            Arena& arena = this->arena();
+            std::lock_guard<std::mutex> lock(arena.mutex_);
+            if (void *ptr = arena.free_[c]) {
+                arena.free_[c] = *static_cast<void**>(ptr);
+                return ptr;
+            }
+
+            if (static_cast<std::size_t>(arena.end_ - arena.next_) < bytes)
+                newRegion(arena);
+
+            void *ptr = arena.next_;
+            arena.next_ += bytes;
+            return ptr;
+        }
+
+        void deallocate(void *ptr, std::size_t bytes, std::size_t align = alignof(std::max_align_t)) {
+            if (align > kGranule)
+                return deallocate(static_cast<void**>(ptr)[-1], bytes + align, kGranule);
+
+            if (bytes > largeLimit())
+                return deallocateLarge(ptr);
+
+            // return the block to the arena that owns its region,
+            // which may not be the arena of this thread's node.
+            unsigned c = sizeClass(bytes);
+            std::uintptr_t region = reinterpret_cast<std::uintptr_t>(ptr) & ~(std::uintptr_t(options_.regionSize) - 1);
+            Arena& arena = *reinterpret_cast<RegionHeader*>(region)->arena_;
+            std::lock_guard<std::mutex> lock(arena.mutex_);
+            *static_cast<void**>(ptr) = arena.free_[c];
+            arena.free_[c] = ptr;
+        }
+    };
+
+    // A standard allocator over a HugePageResource, for use as the
+    // Allocator template parameter of Nigh, e.g.:
+    //
+    //   HugePageResource resource(HugePageOptions{HugePages::kTransparent});
+    //   Nigh<Node, Space, KeyFn, Concurrent, KDTreeBatch<>, HugePageAllocator<Node>>
+    //       nn(space, keyFn, HugePageAllocator<Node>(&resource));
+    //
+    // Default-constructed allocators share
+    // HugePageResource::defaultResource().
+    template <typename T>
+    class HugePageAllocator {
+        template <typename>
+        friend class HugePageAllocator;
+
+        HugePageResource *resource_;
+
+    public:
+        using value_type = T;
+        using propagate_on_container_copy_assignment = std::true_type;
+        using propagate_on_container_move_assignment = std::true_type;
+        using propagate_on_container_swap = std::true_type;
+
+        HugePageAllocator() noexcept
+            : resource_(HugePageResource::defaultResource())
+        {
+        }
+
+        explicit HugePageAllocator(HugePageResource *resource) noexcept
+            : resource_(resource)
+        {
+        }
+
+        template <typename U>
+        HugePageAllocator(const HugePageAllocator<U>& other) noexcept
+            : resource_(other.resource_)
+        {
+        }
+
+        HugePageResource* resource() const {
+            return resource_;
+        }
+
+        T* allocate(std::size_t n) {
+            if (n > std::numeric_limits<std::size_t>::max() / sizeof(T))
+                throw std::bad_array_new_length();
+            return static_cast<T*>(resource_->allocate(n * sizeof(T), alignof(T)));
+        }
+
+        void deallocate(T *ptr, std::size_t n) {
+            resource_->deallocate(ptr, n * sizeof(T), alignof(T));
+        }
+
+        template <typename U>
+        bool operator == (const HugePageAllocator<U>& other) const {
+            return resource_ == other.resource_;
+        }
+
+        template <typename U>
+        bool operator != (const HugePageAllocator<U>& other) const {
+            return resource_ != other.resource_;
+        }
+    };
+}
+
+#endif
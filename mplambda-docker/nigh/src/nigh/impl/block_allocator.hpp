@@ -40,6 +40,7 @@
 #include <array>
 #include <cassert>
 #include <forward_list>
+#include <iterator>
 #include <memory>
 
 namespace unc::robotics::nigh::impl {
@@ -110,6 +111,30 @@ namespace unc::robotics::nigh::impl {
             offset_ = marker.offset_;
         }
             
+        // Moves the blocks used by other into this allocator, after
+        // the current block, so that objects allocated from other are
+        // released (or reused after a rollback) with this allocator's
+        // blocks.  Allocation continues from other's current block.
+        // This is used to combine allocators that were filled
+        // independently, e.g., by separate threads.  other is left
+        // empty.
+        void merge(BlockAllocator&& other) {
+            if (other.currentBlock_ == other.blockList_.begin() && other.offset_ == 0)
+                return;
+
+            BlockIter last = other.currentBlock_;
+            blockList_.splice_after(
+                currentBlock_, other.blockList_,
+                other.blockList_.before_begin(), std::next(last));
+            currentBlock_ = last;
+            offset_ = other.offset_;
+
+            if (other.blockList_.empty())
+                other.blockList_.emplace_front();
+            other.currentBlock_ = other.blockList_.begin();
+            other.offset_ = 0;
+        }
+
         template <class E, class ... Args>
         E* allocate(Args&& ... args) {
             static_assert(
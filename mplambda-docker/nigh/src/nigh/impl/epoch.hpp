@@ -0,0 +1,214 @@
+// Software License Agreement (BSD-3-Clause)
+//
+// Copyright 2018 The University of North Carolina at Chapel Hill
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+// OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//! @author Jeff Ichnowski
+
+#pragma once
+#ifndef NIGH_IMPL_EPOCH_HPP
+#define NIGH_IMPL_EPOCH_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace unc::robotics::nigh::impl {
+    // Epoch-based reclamation.  A reader pins the current epoch (with
+    // an EpochGuard) while it accesses a shared structure, and a
+    // writer that unlinks an object from the structure stamps it with
+    // the epoch from retire().  The object may be freed once every
+    // pinned reader has advanced past that epoch (see
+    // EpochRetireList).
+    //
+    // Each thread pins by writing to its own cache-line-sized slot,
+    // thus concurrent readers do not write any shared memory.  The
+    // slots are claimed on a thread's first pin, and released for
+    // reuse when the thread exits.  There is a single process-wide
+    // set of slots, shared by every structure.
+    class Epoch {
+        static constexpr std::uint64_t kIdle = std::numeric_limits<std::uint64_t>::max();
+
+        struct alignas(64) Slot {
+            std::atomic<std::uint64_t> epoch_{kIdle};
+            std::atomic<bool> inUse_{true};
+            Slot *next_{nullptr};
+        };
+
+        // the slots are never freed, a thread that exits releases its
+        // slot for another thread to claim.
+        struct ThreadSlot {
+            Slot *slot_;
+            unsigned depth_{0};
+
+            ThreadSlot() : slot_(claim()) {}
+
+            ~ThreadSlot() {
+                slot_->epoch_.store(kIdle, std::memory_order_release);
+                slot_->inUse_.store(false, std::memory_order_release);
+            }
+        };
+
+        static std::atomic<std::uint64_t>& global() {
+            static std::atomic<std::uint64_t> epoch{0};
+            return epoch;
+        }
+
+        static std::atomic<Slot*>& slots() {
+            static std::atomic<Slot*> head{nullptr};
+            return head;
+        }
+
+        static Slot* claim() {
+            for (Slot *s = slots().load(std::memory_order_acquire) ; s ; s = s->next_) {
+                bool free = false;
+                if (!s->inUse_.load(std::memory_order_relaxed) &&
+                    s->inUse_.compare_exchange_strong(free, true, std::memory_order_acquire))
+                    return s;
+            }
+
+            Slot *s = new Slot;
+            Slot *head = slots().load(std::memory_order_relaxed);
+            do {
+                s->next_ = head;
+            } while (!slots().compare_exchange_weak(
+                         head, s, std::memory_order_release, std::memory_order_relaxed));
+            return s;
+        }
+
+        static ThreadSlot& threadSlot() {
+            static thread_local ThreadSlot slot;
+            return slot;
+        }
+
+        friend class EpochGuard;
+
+    public:
+        // Advances the epoch and returns the one it replaced.  Call
+        // this after unlinking objects (with a seq_cst store), the
+        // readers that may still reach them are pinned at or before
+        // the returned epoch.
+        static std::uint64_t retire() {
+            return global().fetch_add(1, std::memory_order_seq_cst);
+        }
+
+        // Returns the oldest epoch pinned by any reader, or the
+        // maximum value if there are none.  Objects retired at an
+        // earlier epoch are no longer reachable.
+        static std::uint64_t oldest() {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            std::uint64_t oldest = kIdle;
+            for (Slot *s = slots().load(std::memory_order_acquire) ; s ; s = s->next_)
+                oldest = std::min(oldest, s->epoch_.load(std::memory_order_acquire));
+            return oldest;
+        }
+    };
+
+    // Pins the calling thread to the current epoch for the lifetime
+    // of the guard.  Guards may be nested, only the outermost pins.
+    // Pointers to shared objects must be loaded (with seq_cst) after
+    // the guard is constructed, and must not be used after it is
+    // destroyed.
+    class EpochGuard {
+        Epoch::ThreadSlot& slot_;
+
+    public:
+        EpochGuard()
+            : slot_(Epoch::threadSlot())
+        {
+            if (slot_.depth_++ == 0)
+                slot_.slot_->epoch_.store(
+                    Epoch::global().load(std::memory_order_acquire),
+                    std::memory_order_seq_cst);
+        }
+
+        EpochGuard(const EpochGuard&) = delete;
+        EpochGuard& operator = (const EpochGuard&) = delete;
+
+        ~EpochGuard() {
+            if (--slot_.depth_ == 0)
+                slot_.slot_->epoch_.store(Epoch::kIdle, std::memory_order_release);
+        }
+    };
+
+    // The objects a writer has unlinked from a shared structure,
+    // waiting for the readers that may reach them to unpin.  This is
+    // owned by the (single, or externally locked) writer, and frees
+    // its remaining objects when destroyed, at which point no reader
+    // may be accessing the structure.
+    template <typename T, typename Deleter>
+    class EpochRetireList : Deleter {
+        std::vector<std::pair<std::uint64_t, T*>> retired_;
+
+    public:
+        explicit EpochRetireList(const Deleter& deleter = Deleter())
+            : Deleter(deleter)
+        {
+        }
+
+        EpochRetireList(const EpochRetireList&) = delete;
+
+        ~EpochRetireList() {
+            for (auto& r : retired_)
+                Deleter::operator() (r.second);
+        }
+
+        bool empty() const {
+            return retired_.empty();
+        }
+
+        // stamps the objects unlinked since the last call to
+        // Epoch::retire() with the epoch it returned.
+        void retire(std::uint64_t epoch, T* obj) {
+            retired_.emplace_back(epoch, obj);
+        }
+
+        // frees the objects that no reader can reach.
+        void reclaim() {
+            if (retired_.empty())
+                return;
+
+            std::uint64_t oldest = Epoch::oldest();
+            auto it = retired_.begin();
+            for (auto& r : retired_) {
+                if (r.first < oldest)
+                    Deleter::operator() (r.second);
+                else
+                    *it++ = r;
+            }
+            retired_.erase(it, retired_.end());
+        }
+    };
+}
+
+#endif // NIGH_IMPL_EPOCH_HPP
@@ -42,23 +42,30 @@
 
 namespace unc::robotics::nigh::impl::kdtree_batch {
 
-    template <typename T, typename Space, typename Concurrency, std::size_t batchSize>
+    template <typename T, typename Space, typename Concurrency, std::size_t batchSize, bool inlineKeys>
     class Branch : public Node<T, Space, Concurrency> {
         using Base = Node<T, Space, Concurrency>;
-        using Leaf = kdtree_batch::Leaf<T, Space, Concurrency, batchSize>;
+        using Leaf = kdtree_batch::Leaf<T, Space, Concurrency, batchSize, inlineKeys>;
+        using NodeRegion = typename Base::NodeRegion;
 
     public:
+        // non-concurrent trees free the leaf once the branch is
+        // created (see Nigh::allocBranch).
         Branch(Leaf* leaf, int axis) : Base(leaf->region(), axis) {
-            // non-concurrent trees can delete the leaf once the
-            // branch is created.
-            delete leaf;
+        }
+
+        // Bulk-built branch.  The region covers all elements in the
+        // subtree, and leaf (if not null) is the leaf being replaced.
+        Branch(Leaf*, const NodeRegion& region, int axis) : Base(region, axis) {
         }
     };
 
-    template <typename T, typename Space, std::size_t batchSize>
-    class Branch<T, Space, Concurrent, batchSize> : public Node<T, Space, Concurrent> {
+    template <typename T, typename Space, std::size_t batchSize, bool inlineKeys>
+    class Branch<T, Space, Concurrent, batchSize, inlineKeys> : public Node<T, Space, Concurrent> {
         using Base = Node<T, Space, Concurrent>;
-        using Leaf = kdtree_batch::Leaf<T, Space, Concurrent, batchSize>;
+        using Leaf = kdtree_batch::Leaf<T, Space, Concurrent, batchSize, inlineKeys>;
+
+        using NodeRegion = typename Base::NodeRegion;
 
         Leaf *leaf_;
 
@@ -67,11 +74,14 @@ namespace unc::robotics::nigh::impl::kdtree_batch {
             // another thread may be concurrently traversing the leaf
             // (unlike the non-concurrent version), thus we cannot
             // safely delete the leaf now.  Instead we keep a
-            // reference to it for later cleanup.
+            // reference to it for later cleanup (see Nigh::dealloc).
+        }
+
+        Branch(Leaf* leaf, const NodeRegion& region, int axis) : Base(region, axis), leaf_(leaf) {
         }
 
-        ~Branch() {
-            delete leaf_;
+        Leaf* leaf() const {
+            return leaf_;
         }
     };
 }
@@ -0,0 +1,200 @@
+// Software License Agreement (BSD-3-Clause)
+//
+// Copyright 2018 The University of North Carolina at Chapel Hill
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+// OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//! @author Jeff Ichnowski
+
+#pragma once
+#ifndef NIGH_IMPL_KDTREE_BATCH_BULK_INSERT_HPP
+#define NIGH_IMPL_KDTREE_BATCH_BULK_INSERT_HPP
+
+#include "types.hpp"
+#include "traversal.hpp"
+#include "clear.hpp"
+#include "../atom.hpp"
+#include <algorithm>
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace unc::robotics::nigh::impl::kdtree_batch {
+
+    // Traversals that can build a balanced subtree from a range of
+    // elements declare kBulkBuild.  For the others, bulk insertion
+    // falls back to one insert per element.
+    template <typename Traversal, typename = void>
+    struct has_bulk_build : std::false_type {};
+
+    template <typename Traversal>
+    struct has_bulk_build<Traversal, std::void_t<decltype(Traversal::kBulkBuild)>>
+        : std::bool_constant<Traversal::kBulkBuild> {};
+
+    // Inserts a range of elements in one pass down the tree.  The
+    // elements are partitioned at each branch among the children
+    // they follow.  Where the range reaches an empty slot, or
+    // overflows a leaf, a balanced subtree is built off to the side
+    // and published with a single store, thus concurrent readers
+    // see either the old subtree or the complete new one.  Writers
+    // follow the same leaf locking protocol as a single insert.
+    template <typename Tree>
+    class BulkInsert {
+        using T = value_t<Tree>;
+        using Key = key_t<Tree>;
+        using Node = node_t<Tree>;
+        using Leaf = leaf_t<Tree>;
+        using NodePointer = node_pointer_t<Tree>;
+
+        static constexpr std::size_t batchSize = kBatchSize<Tree>;
+        static constexpr bool concurrentWrites = Types<Tree>::kConcurrentWrites;
+
+        Tree& tree_;
+        Traversal<Tree, Key> traversal_;
+        unsigned depth_{0};
+
+        void updateDepth(unsigned depth) {
+            depth_ = std::max(depth_, depth);
+        }
+
+    public:
+        static constexpr bool kSupported = has_bulk_build<Traversal<Tree, Key>>::value;
+
+        BulkInsert(Tree& tree)
+            : tree_(tree)
+            , traversal_(tree.metricSpace())
+        {
+        }
+
+        // the maximum depth of the leaves that were created or
+        // appended to.
+        unsigned depth() const {
+            return depth_;
+        }
+
+        // Inserts the elements pointed to by [first, last) into the
+        // subtree at *p, which is at the specified depth.  The range
+        // is reordered.
+        template <typename Iter>
+        void operator() (NodePointer *p, Iter first, Iter last, unsigned depth) {
+            const auto& space = tree_.metricSpace();
+
+            for (;; ++depth) {
+                Node *node = p->load(std::memory_order_acquire);
+
+                if (node == nullptr) {
+                    unsigned height = 0;
+                    Node *subtree = traversal_.build(tree_, space, nullptr, first, last, &height);
+                    if (p->compare_exchange_strong(
+                            node, subtree,
+                            std::memory_order_release, std::memory_order_relaxed)) {
+                        updateDepth(depth + height - 1);
+                        return;
+                    }
+                    (Clear<Tree>{tree_})(subtree);
+                }
+
+                if (node->isLeaf()) {
+                    Leaf *leaf = static_cast<Leaf*>(node);
+                    int n = leaf->size();
+                    if (concurrentWrites && (n < 0 || !leaf->tryLock(n))) {
+                        impl::relax_cpu();
+                        continue;
+                    }
+
+                    if (n + std::distance(first, last) <= static_cast<std::ptrdiff_t>(batchSize)) {
+                        for ( ; first != last ; ++first) {
+                            const auto& key = tree_.getKey(**first);
+                            traversal_.grow(space, leaf->region(), key);
+                            leaf->store(n++, **first, key);
+                        }
+
+                        // linearization point
+                        leaf->setSize(n, std::memory_order_release);
+                        updateDepth(depth);
+                        return;
+                    }
+
+                    // removed elements are dropped from the rebuilt
+                    // subtree.
+                    std::vector<const T*> ptrs;
+                    ptrs.reserve(n + std::distance(first, last));
+                    for (int i=0 ; i<n ; ++i)
+                        if (!leaf->isRemoved(i))
+                            ptrs.push_back(leaf->elements() + i);
+                    ptrs.insert(ptrs.end(), first, last);
+
+                    unsigned height = 0;
+                    node = traversal_.build(tree_, space, leaf, ptrs.begin(), ptrs.end(), &height);
+
+                    // linearization point
+                    p->store(node, std::memory_order_release);
+                    updateDepth(depth + height - 1);
+                    return;
+                }
+
+                // grow the branch to contain the entire range before
+                // any of it becomes visible in the children.
+                for (Iter it = first ; it != last ; ++it)
+                    traversal_.grow(space, node->region(), tree_.getKey(**it));
+
+                std::vector<std::pair<NodePointer*, const T*>> routes;
+                routes.reserve(std::distance(first, last));
+                for (Iter it = first ; it != last ; ++it)
+                    routes.emplace_back(
+                        &traversal_.follow(space, node, node->axis(), tree_.getKey(**it)), *it);
+
+                if (std::all_of(routes.begin(), routes.end(), [&] (const auto& r) {
+                            return r.first == routes.front().first; })) {
+                    p = routes.front().first;
+                    continue;
+                }
+
+                std::sort(
+                    routes.begin(), routes.end(),
+                    [] (const auto& a, const auto& b) { return std::less<NodePointer*>{}(a.first, b.first); });
+
+                Iter it = first;
+                for (const auto& r : routes)
+                    *it++ = r.second;
+
+                for (std::size_t i = 0, j ; i < routes.size() ; i = j) {
+                    for (j = i+1 ; j < routes.size() && routes[j].first == routes[i].first ; ++j)
+                        ;
+                    (*this)(routes[i].first, first + i, first + j, depth + 1);
+                }
+                return;
+            }
+        }
+    };
+}
+
+#endif
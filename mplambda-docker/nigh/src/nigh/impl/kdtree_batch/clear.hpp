@@ -58,9 +58,11 @@ namespace unc::robotics::nigh::impl::kdtree_batch {
         {
         }
 
+        // branches copied by Relayout are released with its arena.
         template <typename T>
         void dealloc(T* ptr) {
-            tree_.dealloc(ptr);
+            if (!tree_.relayoutArena_.contains(ptr))
+                tree_.dealloc(ptr);
         }
 
         void operator() (Node *node) {
@@ -0,0 +1,132 @@
+// Software License Agreement (BSD-3-Clause)
+//
+// Copyright 2018 The University of North Carolina at Chapel Hill
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+// OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//! @author Jeff Ichnowski
+
+#pragma once
+#ifndef NIGH_IMPL_KDTREE_BATCH_ERASE_HPP
+#define NIGH_IMPL_KDTREE_BATCH_ERASE_HPP
+
+#include "types.hpp"
+#include "nearest_traversal.hpp"
+#include "nearest_traversals.hpp"
+#include <cmath>
+#include <limits>
+
+namespace unc::robotics::nigh::impl::kdtree_batch {
+
+    // Finds the leaf and index of an element equal to a value.  The
+    // search follows the same traversal as a nearest neighbor query,
+    // but only descends into regions that could contain the value's
+    // key.  Elements that are already removed are skipped.  When the
+    // traversal provides it, the search also records the pointer
+    // that references the leaf so that the leaf can be replaced with
+    // a compacted one.
+    template <typename Tree>
+    class Erase {
+        using T = value_t<Tree>;
+        using Key = key_t<Tree>;
+        using Node = node_t<Tree>;
+        using Leaf = leaf_t<Tree>;
+        using Distance = distance_t<Tree>;
+        using NodePointer = node_pointer_t<Tree>;
+
+        const Tree& tree_;
+        NearestTraversal<Tree> traversal_;
+
+        const T& value_;
+        const Key key_;
+
+        // the distance from a key to itself is not always 0 (e.g.,
+        // SO(3)) and region bounds are subject to rounding, thus we
+        // allow a small tolerance when pruning.
+        const Distance tolerance_;
+
+        const Leaf *leaf_{nullptr};
+        const NodePointer *slot_{nullptr};
+        int index_{-1};
+
+        void search(const Node* node, const NodePointer *slot) {
+            if (leaf_ || tolerance_ < traversal_.distToRegion(key_, node->region()))
+                return;
+            if (!node->isLeaf()) {
+                traversal_.traverse(*this, tree_.metricSpace(), node, node->axis(), key_);
+            } else {
+                const Leaf *leaf = static_cast<const Leaf*>(node);
+                int size = std::abs(leaf->size());
+                for (int i=0 ; i<size ; ++i) {
+                    if (!leaf->isRemoved(i) && leaf->elements()[i] == value_) {
+                        leaf_ = leaf;
+                        slot_ = slot;
+                        index_ = i;
+                        return;
+                    }
+                }
+            }
+        }
+
+    public:
+        Erase(const Tree& tree, const T& value)
+            : tree_(tree)
+            , traversal_(tree.metricSpace())
+            , value_(value)
+            , key_(tree.getKey(value))
+            , tolerance_(tree.distance(key_, key_) + std::sqrt(std::numeric_limits<Distance>::epsilon()))
+        {
+        }
+
+        Leaf *leaf() const {
+            return const_cast<Leaf*>(leaf_);
+        }
+
+        int index() const {
+            return index_;
+        }
+
+        // the pointer to leaf(), or null if unknown.
+        NodePointer *slot() const {
+            return const_cast<NodePointer*>(slot_);
+        }
+
+        void operator() (const Node* node) {
+            search(node, nullptr);
+        }
+
+        void operator() (const NodePointer& p) {
+            if (const Node *node = p.load(std::memory_order_acquire))
+                search(node, &p);
+        }
+    };
+}
+
+#endif
@@ -0,0 +1,263 @@
+// Software License Agreement (BSD-3-Clause)
+//
+// Copyright 2018 The University of North Carolina at Chapel Hill
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+// OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//! @author Jeff Ichnowski
+
+#pragma once
+#ifndef NIGH_IMPL_KDTREE_BATCH_KEY_BLOCK_HPP
+#define NIGH_IMPL_KDTREE_BATCH_KEY_BLOCK_HPP
+
+#include "../simd.hpp"
+#include "../constants.hpp"
+#include "../../metric/space.hpp"
+#include "../../metric/cartesian_state_element.hpp"
+#include <limits>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace unc::robotics::nigh::metric {
+    template <int p>
+    struct LP;
+    struct SO3;
+    template <typename M, typename W>
+    struct Scaled;
+    template <typename ... M>
+    struct Cartesian;
+}
+
+namespace unc::robotics::nigh::impl::kdtree_batch {
+    // Stand-in for the key block of leaves that do not store keys
+    // inline.
+    struct NoKeyBlock {
+        template <typename Key>
+        void put(int, const Key&) {}
+        void destroy(int) {}
+    };
+
+    // Copies of the keys of the elements in a leaf, stored alongside
+    // the elements so that scanning a leaf does not have to go
+    // through the KeyFn.  The block is selected by the space's
+    // metric.  distances(space, q, n, bound, out) computes the
+    // distances from q to the first n keys into out, which must have
+    // room for batchSize distances.  Distances greater than bound
+    // may be reported as infinity instead.
+    //
+    // The general case is an array of keys.
+    template <typename Space, std::size_t batchSize, typename Metric = typename Space::Metric, typename = void>
+    class KeyBlock {
+        using Key = typename Space::Type;
+        using Distance = typename Space::Distance;
+        using AlignedStorage = std::aligned_storage_t<sizeof(Key), alignof(Key)>;
+
+        AlignedStorage keys_[batchSize];
+
+    public:
+        const Key& key(int index) const {
+            return reinterpret_cast<const Key*>(keys_)[index];
+        }
+
+        void put(int index, const Key& key) {
+            new (reinterpret_cast<Key*>(keys_) + index) Key(key);
+        }
+
+        void destroy(int n) {
+            Key *keys = reinterpret_cast<Key*>(keys_);
+            std::destroy(keys, keys + n);
+        }
+
+        void distances(const Space& space, const Key& q, int n, Distance, Distance *out) const {
+            for (int i=0 ; i<n ; ++i)
+                out[i] = space.distance(key(i), q);
+        }
+    };
+
+    // Fixed-dimension L^p keys are stored as a structure of arrays,
+    // one row of coefficients per dimension, and the distances are
+    // computed a whole row at a time with the simd kernels.  Rows
+    // are zero-initialized and computed over the full batch, the
+    // lanes past the leaf's size are ignored.
+    template <typename Space, std::size_t batchSize, int p>
+    class KeyBlock<Space, batchSize, metric::LP<p>, std::enable_if_t<(Space::kDimensions > 0)>> {
+        using Key = typename Space::Type;
+        using Distance = typename Space::Distance;
+
+        static constexpr int kDimensions = Space::kDimensions;
+
+        alignas(64) Distance coeffs_[kDimensions][batchSize] = {};
+
+    public:
+        void put(int index, const Key& key) {
+            for (int d=0 ; d<kDimensions ; ++d)
+                coeffs_[d][index] = Space::coeff(key, d);
+        }
+
+        void destroy(int) {}
+
+        void distances(const Space&, const Key& q, int, Distance, Distance *out) const {
+            std::fill(out, out + batchSize, Distance(0));
+            for (int d=0 ; d<kDimensions ; ++d)
+                simd::lpAccumulate<p, batchSize>(out, coeffs_[d], Space::coeff(q, d));
+            simd::lpFinish<p, batchSize>(out);
+        }
+    };
+
+    // SO(3) keys are stored as 4 rows of quaternion coefficients.
+    // The dot products are vectorized, the acos is not.
+    template <typename Space, std::size_t batchSize>
+    class KeyBlock<Space, batchSize, metric::SO3> {
+        using Key = typename Space::Type;
+        using Distance = typename Space::Distance;
+
+        alignas(64) Distance coeffs_[4][batchSize] = {};
+
+    public:
+        void put(int index, const Key& key) {
+            for (int d=0 ; d<4 ; ++d)
+                coeffs_[d][index] = Space::coeff(key, d);
+        }
+
+        void destroy(int) {}
+
+        void distances(const Space&, const Key& q, int n, Distance bound, Distance *out) const {
+            std::fill(out, out + batchSize, Distance(0));
+            for (int d=0 ; d<4 ; ++d)
+                simd::dotAccumulate<batchSize>(out, coeffs_[d], Space::coeff(q, d));
+
+            // acos is decreasing, so keys with |dot| below
+            // cos(bound) are farther than bound and skip the acos.
+            const Distance minDot = bound < PI_2<Distance> ? std::cos(bound) : Distance(0);
+            for (int i=0 ; i<n ; ++i) {
+                Distance dot = std::abs(out[i]);
+                out[i] = dot >= 1 ? 0
+                    : dot < minDot ? std::numeric_limits<Distance>::infinity()
+                    : std::acos(dot);
+            }
+        }
+    };
+
+    // Scaled spaces store the keys in the block of the underlying
+    // space and scale the distances.
+    template <typename Space, std::size_t batchSize, typename M, typename W>
+    class KeyBlock<Space, batchSize, metric::Scaled<M, W>> {
+        using Key = typename Space::Type;
+        using Distance = typename Space::Distance;
+        using BaseSpace = metric::Space<Key, M>;
+
+        KeyBlock<BaseSpace, batchSize> base_;
+
+    public:
+        void put(int index, const Key& key) {
+            base_.put(index, key);
+        }
+
+        void destroy(int n) {
+            base_.destroy(n);
+        }
+
+        void distances(const Space& space, const Key& q, int n, Distance bound, Distance *out) const {
+            const Distance w = space.weight();
+            base_.distances(space.space(), q, n, bound / w, out);
+            for (int i=0 ; i<n ; ++i)
+                out[i] *= w;
+        }
+    };
+
+    // Cartesian spaces keep one block per component and sum the
+    // component distances.
+    template <typename Space, std::size_t batchSize, typename ... M>
+    class KeyBlock<Space, batchSize, metric::Cartesian<M...>> {
+        using Key = typename Space::Type;
+        using Distance = typename Space::Distance;
+        using Indices = std::index_sequence_for<M...>;
+
+        template <std::size_t I>
+        using Element = metric::cartesian_state_element<I, Key>;
+
+        template <std::size_t I>
+        using ElementSpace = metric::Space<
+            typename Element<I>::type,
+            std::tuple_element_t<I, std::tuple<M...>>>;
+
+        template <typename Indices_>
+        struct Blocks;
+
+        template <std::size_t ... I>
+        struct Blocks<std::index_sequence<I...>> {
+            using type = std::tuple<KeyBlock<ElementSpace<I>, batchSize>...>;
+        };
+
+        typename Blocks<Indices>::type blocks_;
+
+        template <std::size_t ... I>
+        void put(int index, const Key& key, std::index_sequence<I...>) {
+            (std::get<I>(blocks_).put(index, Element<I>::get(key)), ...);
+        }
+
+        template <std::size_t ... I>
+        void destroy(int n, std::index_sequence<I...>) {
+            (std::get<I>(blocks_).destroy(n), ...);
+        }
+
+        template <std::size_t I>
+        void add(const Space& space, const Key& q, int n, Distance bound, Distance *out) const {
+            // each component distance is a lower bound on the sum
+            typename ElementSpace<I>::Distance dist[batchSize];
+            std::get<I>(blocks_).distances(space.template get<I>(), Element<I>::get(q), n, bound, dist);
+            for (int i=0 ; i<n ; ++i)
+                out[i] += dist[i];
+        }
+
+        template <std::size_t ... I>
+        void distances(const Space& space, const Key& q, int n, Distance bound, Distance *out, std::index_sequence<I...>) const {
+            std::fill(out, out + n, Distance(0));
+            (add<I>(space, q, n, bound, out), ...);
+        }
+
+    public:
+        void put(int index, const Key& key) {
+            put(index, key, Indices{});
+        }
+
+        void destroy(int n) {
+            destroy(n, Indices{});
+        }
+
+        void distances(const Space& space, const Key& q, int n, Distance bound, Distance *out) const {
+            distances(space, q, n, bound, out, Indices{});
+        }
+    };
+}
+
+#endif
@@ -39,9 +39,12 @@
 
 #include "../atom.hpp"
 #include "node.hpp"
+#include "key_block.hpp"
+#include <array>
+#include <cstdint>
 
 namespace unc::robotics::nigh::impl::kdtree_batch {
-    template <typename T, typename Space, typename Concurrency, std::size_t batchSize>
+    template <typename T, typename Space, typename Concurrency, std::size_t batchSize, bool inlineKeys>
     class Leaf : public Node<T, Space, Concurrency> {
         using Base = Node<T, Space, Concurrency>;
         using Key = typename Space::Type;
@@ -49,13 +52,36 @@ namespace unc::robotics::nigh::impl::kdtree_batch {
         using AlignedStorage = std::aligned_storage_t<sizeof(T), alignof(T)>;
 
         static constexpr bool concurrentWrites = std::is_same_v<Concurrency, Concurrent>;
+        static constexpr std::size_t kRemovedWords = (batchSize + 63) / 64;
 
+    public:
+        using Keys = std::conditional_t<inlineKeys, KeyBlock<Space, batchSize>, NoKeyBlock>;
+
+    private:
         alignas(concurrentWrites ? cache_line_size : 0)
         Atom<int, concurrentWrites> size_;
 
+        // tombstones, one bit per element.  Removed elements remain
+        // in the leaf until it is compacted (see Nigh::insert).
+        std::array<Atom<std::uint64_t, concurrentWrites>, kRemovedWords> removed_;
+
+        // the leaf that this leaf replaced, kept alive until this
+        // leaf is destroyed since concurrent readers may still be
+        // traversing it.
+        Leaf *retired_{nullptr};
+
         alignas(concurrentWrites ? cache_line_size : 0)
         AlignedStorage elements_[batchSize];
 
+        // copies of the element keys when inlineKeys is set, written
+        // along with the element before the size is published.
+        Keys keys_;
+
+        void clearRemoved() {
+            for (auto& word : removed_)
+                word.store(0, std::memory_order_relaxed);
+        }
+
     public:
         //Leaf(const Metric& metric, const T& t) : Base(metric, t), size_(1) {
         template <typename Traversal>
@@ -63,18 +89,21 @@ namespace unc::robotics::nigh::impl::kdtree_batch {
             : Base(space, traversal, key)
             , size_(1)
         {
-            put(0, q);
+            clearRemoved();
+            store(0, q, key);
         }
 
         template <typename Traversal, typename GetKey, typename Iter>
         Leaf(const Space& space, Traversal& traversal, const GetKey& getKey, Iter first, Iter last)
             : Base(space, traversal, getKey(**first))
         {
+            clearRemoved();
             int i=0;
-            put(i++, **first);
+            store(i++, **first, getKey(**first));
             while (++first != last) {
-                traversal.grow(space, this->region(), getKey(**first));
-                put(i++, **first);
+                const auto& key = getKey(**first);
+                traversal.grow(space, this->region(), key);
+                store(i++, **first, key);
             }
 
             size_.store(i, std::memory_order_relaxed);
@@ -82,6 +111,7 @@ namespace unc::robotics::nigh::impl::kdtree_batch {
 
         ~Leaf() {
             std::destroy(elements(), elements() + std::abs(size()));
+            keys_.destroy(std::abs(size()));
         }
 
         T* elements() {
@@ -92,6 +122,10 @@ namespace unc::robotics::nigh::impl::kdtree_batch {
             return reinterpret_cast<const T*>(elements_);
         }
 
+        const Keys& keys() const {
+            return keys_;
+        }
+
         int size() const {
             return size_.load(std::memory_order_acquire);
         }
@@ -106,9 +140,54 @@ namespace unc::robotics::nigh::impl::kdtree_batch {
             new (elements() + index) T (std::forward<Args>(args)...);
         }
 
+        // puts the element and, with inlineKeys, its key.
+        void store(int index, const T& value, const Key& key) {
+            put(index, value);
+            keys_.put(index, key);
+        }
+
         void setSize(int n, std::memory_order order) {
             size_.store(n, order);
         }
+
+        bool isRemoved(int index) const {
+            return (removed_[index / 64].load(std::memory_order_acquire) >> (index % 64)) & 1;
+        }
+
+        int removedCount() const {
+            int count = 0;
+            for (const auto& word : removed_)
+                count += __builtin_popcountll(word.load(std::memory_order_acquire));
+            return count;
+        }
+
+        bool anyRemoved() const {
+            for (const auto& word : removed_)
+                if (word.load(std::memory_order_acquire))
+                    return true;
+            return false;
+        }
+
+        // Marks the element at index as removed.  Must be called
+        // while holding the lock.  Returns false if the element was
+        // already removed.
+        bool markRemoved(int index) {
+            std::uint64_t bit = std::uint64_t(1) << (index % 64);
+            return !(removed_[index / 64].fetch_or(bit, std::memory_order_release) & bit);
+        }
+
+        // Takes ownership of a leaf that this leaf replaces in the
+        // tree.  The retired leaf is freed along with this one (see
+        // Nigh::dealloc).  Non-concurrent trees free it right away
+        // instead.
+        void retire(Leaf *leaf) {
+            assert(retired_ == nullptr);
+            retired_ = leaf;
+        }
+
+        Leaf* retired() const {
+            return retired_;
+        }
     };
 }
 
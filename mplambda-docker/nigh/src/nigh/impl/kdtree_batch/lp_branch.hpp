@@ -40,12 +40,13 @@
 #include "branch.hpp"
 
 namespace unc::robotics::nigh::impl::kdtree_batch {
-    template <typename T, typename Space, typename Concurrency, std::size_t batchSize, int p>
-    class LPBranch : public Branch<T, Space, Concurrency, batchSize> {
-        using Base = Branch<T, Space, Concurrency, batchSize>;
+    template <typename T, typename Space, typename Concurrency, std::size_t batchSize, bool inlineKeys, int p>
+    class LPBranch : public Branch<T, Space, Concurrency, batchSize, inlineKeys> {
+        using Base = Branch<T, Space, Concurrency, batchSize, inlineKeys>;
         using Node = kdtree_batch::Node<T, Space, Concurrency>;
-        using Leaf = kdtree_batch::Leaf<T, Space, Concurrency, batchSize>;
+        using Leaf = kdtree_batch::Leaf<T, Space, Concurrency, batchSize, inlineKeys>;
         using Distance = typename Space::Distance;
+        using NodeRegion = Region<typename Space::Type, typename Space::Metric, Concurrency>;
 
         static constexpr bool concurrentWrites = std::is_same_v<Concurrency, Concurrent>;
 
@@ -60,6 +61,13 @@ namespace unc::robotics::nigh::impl::kdtree_batch {
         {
         }
 
+        LPBranch(Leaf *leaf, const NodeRegion& region, int axis, Distance split, Node *c0, Node *c1)
+            : Base(leaf, region, axis)
+            , split_(split)
+            , children_{{c0, c1}}
+        {
+        }
+
         Distance split() const { return split_; }
         auto& child(int i) { return children_[i]; }
         const auto& child(int i) const { return children_[i]; }
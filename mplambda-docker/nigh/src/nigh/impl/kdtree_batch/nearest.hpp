@@ -38,8 +38,10 @@
 #define NIGH_IMPL_KDTREE_BATCH_NEAREST_HPP
 
 #include "node.hpp"
+#include "types.hpp"
 #include "nearest_traversal.hpp"
 #include "nearest_traversals.hpp"
+#include "../../approximate.hpp"
 
 namespace unc::robotics::nigh::impl::kdtree_batch {
 
@@ -52,22 +54,29 @@ namespace unc::robotics::nigh::impl::kdtree_batch {
         typename KeyFn,
         typename Concurrency_,
         std::size_t batchSize,
+        bool inlineKeys,
         typename Allocator,
         typename NearSet>
     class Nearest<
-        Nigh<T, Space, KeyFn, Concurrency_, KDTreeBatch<batchSize>, Allocator>,
+        Nigh<T, Space, KeyFn, Concurrency_, KDTreeBatch<batchSize, inlineKeys>, Allocator>,
         NearSet> : public NearSet
     {
-        using Tree = Nigh<T, Space, KeyFn, Concurrency_, KDTreeBatch<batchSize>, Allocator>;
+        using Tree = Nigh<T, Space, KeyFn, Concurrency_, KDTreeBatch<batchSize, inlineKeys>, Allocator>;
         using Key = typename Space::Type;
+        using Distance = typename Space::Distance;
         using Node = kdtree_batch::Node<T, Space, Concurrency_>;
-        using Leaf = kdtree_batch::Leaf<T, Space, Concurrency_, batchSize>;
+        using Leaf = kdtree_batch::Leaf<T, Space, Concurrency_, batchSize, inlineKeys>;
+        using NodePointer = node_pointer_t<Tree>;
 
         const Tree& tree_;
         NearestTraversal<Tree> traversal_;
 
         const Key key_;
 
+        // see Approximate.  The defaults result in an exact search.
+        Distance pruneScale_{1};
+        std::size_t leafBudget_{std::numeric_limits<std::size_t>::max()};
+
     public:
         template <typename K, typename ... Args>
         Nearest(const Tree& tree, K&& key, Args&& ... args)
@@ -78,21 +87,63 @@ namespace unc::robotics::nigh::impl::kdtree_batch {
         {
         }
 
+        const Key& key() const {
+            return key_;
+        }
+
+        void approximate(const Approximate& approx) {
+            pruneScale_ = 1 / (1 + static_cast<Distance>(approx.epsilon_));
+            leafBudget_ = approx.maxLeafVisits_;
+        }
+
         __attribute__((always_inline))
         void operator() (const Node* node) {
-            if (NearSet::dist() < traversal_.distToRegion(key_, node->region()))
+            if (leafBudget_ == 0 && NearSet::full())
+                return;
+            if (NearSet::dist() * pruneScale_ < traversal_.distToRegion(key_, node->region()))
                 return;
             if (!node->isLeaf()) {
                 traversal_.traverse(*this, tree_.metricSpace(), node, node->axis(), key_);
             } else {
-                const Leaf *leaf = static_cast<const Leaf*>(node);
-                int size = std::abs(leaf->size());
+                if (leafBudget_)
+                    --leafBudget_;
+                scan(static_cast<const Leaf*>(node));
+            }
+        }
+
+        // inserts the elements of leaf into the NearSet, without
+        // checking the leaf's region against the current bound.
+        void scan(const Leaf *leaf) {
+            int size = std::abs(leaf->size());
+            if constexpr (inlineKeys) {
+                // distances come from the keys stored in the
+                // leaf, and are looked up by element index.
+                Distance dists[batchSize];
+                leaf->keys().distances(tree_.metricSpace(), key_, size, NearSet::dist(), dists);
+                const T *elements = leaf->elements();
+                if (!leaf->anyRemoved()) {
+                    NearSet::insert(
+                        elements, elements + size,
+                        [&] (const T& t) { return dists[&t - elements]; });
+                } else {
+                    for (int i=0 ; i<size ; ++i)
+                        if (!leaf->isRemoved(i))
+                            NearSet::insert(elements[i], dists[i]);
+                }
+            } else if (!leaf->anyRemoved()) {
                 NearSet::insert(
                     leaf->elements(), leaf->elements() + size,
                     [&] (const T& t) { return tree_.distToKey(t, key_); });
+            } else {
+                for (int i=0 ; i<size ; ++i)
+                    if (!leaf->isRemoved(i))
+                        NearSet::insert(leaf->elements()[i], tree_.distToKey(leaf->elements()[i], key_));
             }
         }
 
+        void operator() (const NodePointer& p) {
+            (*this)(p.load(std::memory_order_acquire));
+        }
     };
 }
 
@@ -0,0 +1,158 @@
+// Software License Agreement (BSD-3-Clause)
+//
+// Copyright 2018 The University of North Carolina at Chapel Hill
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+// OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//! @author Jeff Ichnowski
+
+#pragma once
+#ifndef NIGH_IMPL_KDTREE_BATCH_NEAREST_GROUP_HPP
+#define NIGH_IMPL_KDTREE_BATCH_NEAREST_GROUP_HPP
+
+#include "types.hpp"
+#include "nearest.hpp"
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <numeric>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace unc::robotics::nigh::impl::kdtree_batch {
+
+    // Traversals whose distance to a region depends only on the key
+    // and the region, and whose branches a key follows without
+    // traversal state, declare kGroupNearest.  For the others,
+    // nearest_batch searches each query on its own.
+    template <typename Traversal, typename = void>
+    struct has_group_nearest : std::false_type {};
+
+    template <typename Traversal>
+    struct has_group_nearest<Traversal, std::void_t<decltype(Traversal::kGroupNearest)>>
+        : std::bool_constant<Traversal::kGroupNearest> {};
+
+    // Searches for the nearest neighbors of a group of queries in a
+    // single traversal of the tree.  Each query keeps its own NearSet
+    // (in its own Nearest, which also scans the leaves), and visits
+    // the same nodes in the same order as its own search would: at a
+    // branch, the group splits by the child each query follows, and
+    // each part visits its own side before the other.  Queries that
+    // reach a node at the same point of their searches visit it
+    // together, sharing the load of the node.  Once a single query
+    // remains, it continues on its own.
+    template <typename Tree, typename NearSet>
+    class NearestGroup {
+        using Key = key_t<Tree>;
+        using Node = node_t<Tree>;
+        using Leaf = leaf_t<Tree>;
+        using NodePointer = node_pointer_t<Tree>;
+        using Search = Nearest<Tree, NearSet>;
+
+        const Tree& tree_;
+        NearestTraversal<Tree> traversal_;
+        std::vector<Search> searches_;
+        std::vector<std::size_t> active_;
+
+        void visit(const Node *node, std::size_t *first, std::size_t *last) {
+            if (last - first == 1) {
+                // nothing left to share.
+                searches_[*first](node);
+                return;
+            }
+
+            const auto& region = node->region();
+            last = std::partition(first, last, [&] (std::size_t i) {
+                return !(searches_[i].dist() < traversal_.distToRegion(searches_[i].key(), region));
+            });
+            if (first == last)
+                return;
+
+            if (node->isLeaf()) {
+                for (std::size_t *it = first ; it != last ; ++it)
+                    searches_[*it].scan(static_cast<const Leaf*>(node));
+                return;
+            }
+
+            const auto& space = tree_.metricSpace();
+            std::array<const NodePointer*, 2> children;
+            std::size_t nChildren = 0;
+            auto collect = [&] (const NodePointer& p) { children[nChildren++] = &p; };
+            traversal_.visit(collect, space, node, node->axis());
+            assert(nChildren == 2);
+
+            // Each query visits first the child it would follow, then
+            // the other child, as in its own search.  follow() only
+            // reads the node, it is non-const for the benefit of
+            // insert.
+            std::size_t *mid = std::partition(first, last, [&] (std::size_t i) {
+                return &traversal_.follow(
+                    space, const_cast<Node*>(node), node->axis(), searches_[i].key()) == children[0];
+            });
+            const Node *child0 = children[0]->load(std::memory_order_acquire);
+            const Node *child1 = children[1]->load(std::memory_order_acquire);
+            visit(child0, first, mid);
+            visit(child1, mid, last);
+            visit(child1, first, mid);
+            visit(child0, mid, last);
+        }
+
+    public:
+        static constexpr bool kSupported = has_group_nearest<NearestTraversal<Tree>>::value;
+
+        explicit NearestGroup(const Tree& tree, std::size_t capacity = 0)
+            : tree_(tree)
+            , traversal_(tree.metricSpace())
+        {
+            searches_.reserve(capacity);
+        }
+
+        // adds a query to the group, args are the arguments to the
+        // query's NearSet.
+        template <typename K, typename ... Args>
+        void add(K&& key, Args&& ... args) {
+            searches_.emplace_back(tree_, std::forward<K>(key), std::forward<Args>(args)...);
+        }
+
+        void operator() (const Node *root) {
+            active_.resize(searches_.size());
+            std::iota(active_.begin(), active_.end(), std::size_t(0));
+            visit(root, active_.data(), active_.data() + active_.size());
+        }
+
+        void sort() {
+            for (Search& search : searches_)
+                search.sort();
+        }
+    };
+}
+
+#endif
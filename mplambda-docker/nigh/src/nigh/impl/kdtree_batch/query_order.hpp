@@ -0,0 +1,119 @@
+// Software License Agreement (BSD-3-Clause)
+//
+// Copyright 2018 The University of North Carolina at Chapel Hill
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+// OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//! @author Jeff Ichnowski
+
+#pragma once
+#ifndef NIGH_IMPL_KDTREE_BATCH_QUERY_ORDER_HPP
+#define NIGH_IMPL_KDTREE_BATCH_QUERY_ORDER_HPP
+
+#include "types.hpp"
+#include "traversal.hpp"
+#include "traversals.hpp"
+#include <algorithm>
+#include <functional>
+#include <numeric>
+#include <vector>
+
+namespace unc::robotics::nigh::impl::kdtree_batch {
+
+    // QueryOrder orders a block of queries for Nigh::nearest_batch.
+    // The queries descend the tree together, following the child that
+    // an insert of each query would follow, and the group is split
+    // among the children until it reaches a leaf or a single query.
+    // The resulting order groups queries by the region of the tree
+    // that contains them.  Consecutive searches in the same region
+    // are more likely to find the nodes they visit already in cache,
+    // and a NearestGroup over them shares more node visits.
+    template <typename Tree>
+    class QueryOrder {
+        using Key = key_t<Tree>;
+        using Node = node_t<Tree>;
+        using NodePointer = node_pointer_t<Tree>;
+
+        const Tree& tree_;
+        std::vector<const Key*> keys_;
+        std::vector<Traversal<Tree>> traversals_;
+        std::vector<const NodePointer*> next_;
+
+        void descend(const Node *node, std::size_t *first, std::size_t *last) {
+            // a single query has nothing to be grouped with.
+            if (node->isLeaf() || last - first < 2)
+                return;
+
+            // follow() only reads the node, it is non-const for the
+            // benefit of insert.
+            for (std::size_t *it = first ; it != last ; ++it)
+                next_[*it] = &traversals_[*it].follow(
+                    tree_.metricSpace(), const_cast<Node*>(node), node->axis(), *keys_[*it]);
+
+            std::less<const NodePointer*> less;
+            std::stable_sort(first, last, [&] (std::size_t a, std::size_t b) {
+                return less(next_[a], next_[b]);
+            });
+
+            for (std::size_t *it = first ; it != last ; ) {
+                const NodePointer *p = next_[*it];
+                std::size_t *end = std::find_if(it + 1, last, [&] (std::size_t i) { return next_[i] != p; });
+                if (const Node *child = p->load(std::memory_order_acquire))
+                    descend(child, it, end);
+                it = end;
+            }
+        }
+
+    public:
+        template <typename Keys>
+        QueryOrder(const Tree& tree, const Keys& keys)
+            : tree_(tree)
+            , next_(keys.size())
+        {
+            keys_.reserve(keys.size());
+            traversals_.reserve(keys.size());
+            for (const auto& key : keys) {
+                keys_.push_back(&key);
+                traversals_.emplace_back(tree.metricSpace());
+            }
+        }
+
+        // returns the indexes of the queries in search order.
+        std::vector<std::size_t> order(const Node *root) {
+            std::vector<std::size_t> order(keys_.size());
+            std::iota(order.begin(), order.end(), std::size_t(0));
+            if (root)
+                descend(root, order.data(), order.data() + order.size());
+            return order;
+        }
+    };
+}
+
+#endif
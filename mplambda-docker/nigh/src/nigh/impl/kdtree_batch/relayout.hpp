@@ -0,0 +1,276 @@
+// Software License Agreement (BSD-3-Clause)
+//
+// Copyright 2018 The University of North Carolina at Chapel Hill
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+// OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//! @author Jeff Ichnowski
+
+#pragma once
+#ifndef NIGH_IMPL_KDTREE_BATCH_RELAYOUT_HPP
+#define NIGH_IMPL_KDTREE_BATCH_RELAYOUT_HPP
+
+#include "types.hpp"
+#include "traversal.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace unc::robotics::nigh::impl::kdtree_batch {
+
+    // Bump allocator for the branches copied by Relayout.  The
+    // branches are placed one after the other in the order they are
+    // allocated, in cache-line aligned blocks.  Each relayout starts
+    // a new block that is larger than the memory used by the
+    // previous relayout, thus the copies from one relayout usually
+    // share a single block.  The destructors of the allocated
+    // objects are not called (the copies never own a leaf, see
+    // Relayout::copy).  Each block counts its live objects so that
+    // blocks holding only released copies can be reclaimed.
+    class RelayoutArena {
+        static constexpr std::size_t kAlignment = 64;
+        static constexpr std::size_t kMinBlockSize = 65536;
+
+        struct FreeBlock {
+            void operator() (char *ptr) const {
+                ::operator delete(ptr, std::align_val_t(kAlignment));
+            }
+        };
+
+        struct Block {
+            std::unique_ptr<char, FreeBlock> data_;
+            std::size_t size_;
+            std::size_t used_;
+            std::size_t live_;
+
+            bool contains(const void *ptr) const {
+                const char *p = static_cast<const char*>(ptr);
+                return data_.get() <= p && p < data_.get() + size_;
+            }
+        };
+
+        std::vector<Block> blocks_;
+        std::size_t lastUsed_{0};
+
+        void addBlock(std::size_t size) {
+            char *data = static_cast<char*>(::operator new(size, std::align_val_t(kAlignment)));
+            blocks_.push_back(Block{std::unique_ptr<char, FreeBlock>(data), size, 0, 0});
+        }
+
+    public:
+        // Starts a block for the next relayout, with some room for
+        // it to copy more than the previous one.
+        void start() {
+            std::size_t size = std::max(kMinBlockSize, lastUsed_ + lastUsed_/4);
+            lastUsed_ = 0;
+            if (!blocks_.empty() && blocks_.back().used_ == 0)
+                blocks_.pop_back();
+            addBlock(size);
+        }
+
+        template <typename E, typename ... Args>
+        E* allocate(Args&& ... args) {
+            static_assert(sizeof(E) <= kMinBlockSize, "node too large for arena");
+            for (;;) {
+                assert(!blocks_.empty());
+                Block& block = blocks_.back();
+                void *ptr = block.data_.get() + block.used_;
+                std::size_t space = block.size_ - block.used_;
+                if (std::align(alignof(E), sizeof(E), ptr, space)) {
+                    std::size_t used = block.size_ - space + sizeof(E);
+                    lastUsed_ += used - block.used_;
+                    block.used_ = used;
+                    ++block.live_;
+                    return new (ptr) E(std::forward<Args>(args)...);
+                }
+                addBlock(std::max(kMinBlockSize, block.size_));
+            }
+        }
+
+        bool contains(const void *ptr) const {
+            return std::any_of(blocks_.begin(), blocks_.end(), [&] (const Block& block) {
+                    return block.contains(ptr); });
+        }
+
+        // Drops a copy that is no longer in the tree, returning false
+        // if ptr was not allocated from this arena.
+        bool release(const void *ptr) {
+            for (Block& block : blocks_) {
+                if (block.contains(ptr)) {
+                    assert(block.live_ > 0);
+                    --block.live_;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // Frees the blocks that only hold released copies.  Must not
+        // be called while a search may be in a released copy.
+        void reclaim() {
+            blocks_.erase(
+                std::remove_if(blocks_.begin(), blocks_.end(), [] (const Block& block) {
+                        return block.live_ == 0; }),
+                blocks_.end());
+        }
+
+        // bytes allocated by the most recent relayout.
+        std::size_t lastUsed() const {
+            return lastUsed_;
+        }
+
+        void clear() {
+            blocks_.clear();
+            lastUsed_ = 0;
+        }
+    };
+
+    // A branch that Relayout replaced with a copy.  Concurrent
+    // readers and writers may still be in the branch, thus it is
+    // released later by calling release_ (which knows its type).
+    template <typename Tree>
+    struct RetiredBranch {
+        node_t<Tree> *node_;
+        void (*release_)(Tree&, node_t<Tree>*);
+    };
+
+    // Copies the upper levels of the tree into the tree's
+    // RelayoutArena in breadth-first order, so that the branches
+    // visited by every search are packed into a few contiguous cache
+    // lines instead of being scattered over the heap by the order of
+    // insertion.
+    //
+    // Only branches whose children are all branches are copied.  A
+    // slot that points to a branch is never written by an insert or
+    // erase (they only replace empty slots and leaves), thus the
+    // copy's children stay correct while writers continue in the
+    // lower levels.  The copies are published top-down with a
+    // release store into the slot that pointed to the original, and
+    // the originals are retired to the tree since concurrent
+    // searches may be in them.
+    //
+    // The one thing a writer can change in a copied branch is its
+    // region, which inserts grow on the way down.  A growth applied
+    // to an original after it was copied would be missed by the
+    // copy.  With Concurrent trees, the tree brackets a relayout with
+    // an epoch counter, and inserts that overlap a relayout grow
+    // their path again once it finishes (see Nigh::insert).
+    template <typename Tree>
+    class Relayout {
+        using Key = key_t<Tree>;
+        using Node = node_t<Tree>;
+        using Leaf = leaf_t<Tree>;
+        using NodePointer = node_pointer_t<Tree>;
+        using Traverse = Traversal<Tree, Key>;
+
+        struct Pending {
+            NodePointer *slot_;
+            Traverse traversal_;
+            unsigned level_;
+        };
+
+        Tree& tree_;
+        Traverse traversal_;
+        unsigned levels_;
+        unsigned level_{0};
+        std::deque<Pending> queue_;
+
+        template <typename B>
+        static void release(Tree& tree, Node *node) {
+            tree.dealloc(static_cast<B*>(node));
+        }
+
+    public:
+        Relayout(Tree& tree, unsigned levels)
+            : tree_(tree)
+            , traversal_(tree.metricSpace())
+            , levels_(levels)
+        {
+        }
+
+        // true if no writer will replace the node in its slot.
+        static bool stable(const Node *node) {
+            return node != nullptr && !node->isLeaf();
+        }
+
+        // Called by the traversals to copy a branch into the arena.
+        // The copy has the original's region and axis, and args are
+        // the remaining (branch-specific) constructor arguments.  The
+        // copy does not take ownership of the leaf the original
+        // replaced, that stays with the original.
+        template <typename B, typename ... Args>
+        B* copy(const B *branch, Args&& ... args) {
+            tree_.relayoutRetired_.push_back(
+                RetiredBranch<Tree>{const_cast<B*>(branch), &Relayout::template release<B>});
+            return tree_.relayoutArena_.template allocate<B>(
+                static_cast<Leaf*>(nullptr), branch->region(), branch->axis(),
+                std::forward<Args>(args)...);
+        }
+
+        // Called by the traversals with each child slot of a copy.
+        void operator() (NodePointer& slot) {
+            queue_.push_back(Pending{&slot, Traverse(traversal_), level_ + 1});
+        }
+
+        // Relocates the subtree at root, returning the number of
+        // branches copied.
+        std::size_t operator() (NodePointer *root) {
+            const auto& space = tree_.metricSpace();
+            std::size_t count = 0;
+
+            tree_.relayoutArena_.start();
+            queue_.push_back(Pending{root, Traverse(traversal_), 0});
+            while (!queue_.empty()) {
+                Pending next = std::move(queue_.front());
+                queue_.pop_front();
+
+                Node *node = next.slot_->load(std::memory_order_acquire);
+                if (next.level_ >= levels_ || !stable(node))
+                    continue;
+
+                traversal_ = next.traversal_;
+                level_ = next.level_;
+                if (Node *copy = traversal_.relayout(*this, space, node, node->axis())) {
+                    // linearization point
+                    next.slot_->store(copy, std::memory_order_release);
+                    ++count;
+                }
+            }
+            return count;
+        }
+    };
+}
+
+#endif
@@ -40,13 +40,14 @@
 #include "branch.hpp"
 
 namespace unc::robotics::nigh::impl::kdtree_batch {
-    template <typename T, typename Space, typename Concurrency, std::size_t batchSize>
-    class SO3Branch : public Branch<T, Space, Concurrency, batchSize> {
-        using Base = Branch<T, Space, Concurrency, batchSize>;
+    template <typename T, typename Space, typename Concurrency, std::size_t batchSize, bool inlineKeys>
+    class SO3Branch : public Branch<T, Space, Concurrency, batchSize, inlineKeys> {
+        using Base = Branch<T, Space, Concurrency, batchSize, inlineKeys>;
         using Node = kdtree_batch::Node<T, Space, Concurrency>;
-        using Leaf = kdtree_batch::Leaf<T, Space, Concurrency, batchSize>;
+        using Leaf = kdtree_batch::Leaf<T, Space, Concurrency, batchSize, inlineKeys>;
         using Distance = typename Space::Distance;
         using Split = Eigen::Matrix<Distance, 2, 1>;
+        using NodeRegion = Region<typename Space::Type, typename Space::Metric, Concurrency>;
 
         static constexpr bool concurrentWrites = std::is_same_v<Concurrency, Concurrent>;
 
@@ -61,6 +62,14 @@ namespace unc::robotics::nigh::impl::kdtree_batch {
         {
         }
 
+        // Relocated copy, see Relayout.
+        SO3Branch(Leaf *leaf, const NodeRegion& region, int axis, const Split& split, Node *c0, Node *c1)
+            : Base(leaf, region, axis)
+            , split_(split)
+            , children_{{c0, c1}}
+        {
+        }
+
         const Split& split() const { return split_; }
         auto& child(int i) { return children_[i]; }
         const auto& child(int i) const { return children_[i]; }
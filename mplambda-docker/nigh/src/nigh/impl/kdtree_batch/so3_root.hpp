@@ -40,11 +40,12 @@
 #include "branch.hpp"
 
 namespace unc::robotics::nigh::impl::kdtree_batch {
-    template <typename T, typename Space, typename Concurrency, std::size_t batchSize>
-    class SO3Root : public Branch<T, Space, Concurrency, batchSize> {
-        using Base = Branch<T, Space, Concurrency, batchSize>;
+    template <typename T, typename Space, typename Concurrency, std::size_t batchSize, bool inlineKeys>
+    class SO3Root : public Branch<T, Space, Concurrency, batchSize, inlineKeys> {
+        using Base = Branch<T, Space, Concurrency, batchSize, inlineKeys>;
         using Node = kdtree_batch::Node<T, Space, Concurrency>;
-        using Leaf = kdtree_batch::Leaf<T, Space, Concurrency, batchSize>;
+        using Leaf = kdtree_batch::Leaf<T, Space, Concurrency, batchSize, inlineKeys>;
+        using NodeRegion = Region<typename Space::Type, typename Space::Metric, Concurrency>;
 
         static constexpr bool concurrentWrites = std::is_same_v<Concurrency, Concurrent>;
 
@@ -57,6 +58,13 @@ namespace unc::robotics::nigh::impl::kdtree_batch {
         {
         }
 
+        // Relocated copy, see Relayout.
+        SO3Root(Leaf *leaf, const NodeRegion& region, int axis, Node *const *c)
+            : Base(leaf, region, axis)
+            , children_{{c[0], c[1], c[2], c[3]}}
+        {
+        }
+
         auto& child(int i) { return children_[i]; }
         const auto& child(int i) const { return children_[i]; }
     };
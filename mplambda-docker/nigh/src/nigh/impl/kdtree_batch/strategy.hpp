@@ -38,7 +38,15 @@
 #define NIGH_IMPL_KDTREE_BATCH_STRATEGY_HPP
 
 namespace unc::robotics::nigh {
-    template <std::size_t batchSize = 8>
+    // When inlineKeys is true, each leaf keeps a copy of the keys of
+    // its elements next to the elements, and nearest neighbor
+    // searches compute leaf distances from those copies instead of
+    // calling the KeyFn.  Fixed-dimension L^p keys are stored as a
+    // structure of arrays (see impl::kdtree_batch::KeyBlock).  This
+    // pays off when the values point to keys scattered in memory and
+    // the tree does not fit in cache (see test/leaf_scan_bench.cpp);
+    // when the keys are stored in the values, it only costs memory.
+    template <std::size_t batchSize = 8, bool inlineKeys = false>
     struct KDTreeBatch {};
 }
 
@@ -137,6 +137,20 @@ namespace unc::robotics::nigh::impl::kdtree_batch {
             }
         }
 
+        template <typename Tuple, typename Relayout>
+        static Node* relayout(
+            Tuple& tuple, Relayout& relayout, const Space& space, const Node *node, unsigned axis)
+        {
+            unsigned dim = space.template get<I>().dimensions();
+            if (axis < dim) {
+                return std::get<I>(tuple).relayout(relayout, space.template get<I>(), node, axis);
+            } else if constexpr (I+1 < N) {
+                return Next::relayout(tuple, relayout, space, node, axis - dim);
+            } else {
+                abort();
+            }
+        }
+
         template <typename Tuple, typename Clear>
         static void clear(
             Tuple& tuple, Clear& visitor, const Space& space, Node *node, unsigned axis)
@@ -230,6 +244,12 @@ namespace unc::robotics::nigh::impl::kdtree_batch {
                 tuple_, visitor, space, node, axis);
         }
 
+        template <typename Relayout>
+        Node* relayout(Relayout& relayout, const Space& space, const Node *node, unsigned axis) {
+            return CartesianHelper<0, N, Tree, Key, Metric, Get>::relayout(
+                tuple_, relayout, space, node, axis);
+        }
+
         template <typename Clear>
         void clear(Clear& visitor, const Space& space, Node *node, unsigned axis) {
             CartesianHelper<0, N, Tree, Key, Metric, Get>::clear(
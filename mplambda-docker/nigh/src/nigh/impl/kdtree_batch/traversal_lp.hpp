@@ -57,6 +57,7 @@ namespace unc::robotics::nigh::impl::kdtree_batch {
             space_t<Tree>,
             Concurrency,
             kBatchSize<Tree>,
+            kInlineKeys<Tree>,
             p>;
 
     public:
@@ -114,9 +115,66 @@ namespace unc::robotics::nigh::impl::kdtree_batch {
 		}
             }
 #endif
-            return tree.template alloc<LPBranch>(leaf, axis, split, c0, c1);
+            return tree.template allocBranch<LPBranch>(leaf, axis, split, c0, c1);
         }
 
+        // Bulk insertion support, see BulkInsert.
+        static constexpr bool kBulkBuild = true;
+
+        // Builds a balanced subtree containing the elements pointed
+        // to by [first, last).  Each level splits the range at the
+        // median along the widest axis of its bounding region.  When
+        // leaf is not null the subtree will replace it, and the root
+        // takes ownership of the leaf (see Branch).  The range
+        // is reordered.  The height of the subtree is added to
+        // *depth.
+        template <typename Iter>
+        Node *build(Tree& tree, const Space& space, Leaf *leaf, Iter first, Iter last, unsigned *depth) {
+            static_assert(std::is_same_v<Get, RootGet>, "bulk build is only supported at the root of the metric");
+            using T = value_t<Tree>;
+            using Distance = typename Space::Distance;
+            static constexpr std::size_t batchSize = kBatchSize<Tree>;
+
+            std::size_t n = std::distance(first, last);
+            assert(n > 0);
+            ++*depth;
+
+            if (n <= batchSize) {
+                Leaf *newLeaf = tree.template allocWithSpace<Leaf>(*this, tree.keyFn(), first, last);
+                if (leaf)
+                    tree.retire(newLeaf, leaf);
+                return newLeaf;
+            }
+
+            Region<Key, Metric, Concurrency> region(space, *this, tree.getKey(**first));
+            for (Iter it = std::next(first) ; it != last ; ++it)
+                grow(space, region, tree.getKey(**it));
+
+            unsigned axis;
+            region.selectAxis(&axis);
+
+            auto coeff = [&] (const T* a) { return Space::coeff(tree.getKey(*a), axis); };
+            Iter mid = first + n/2;
+            std::nth_element(
+                first, mid, last,
+                [&] (const T* a, const T* b) { return coeff(a) < coeff(b); });
+
+            Distance lo = coeff(*first);
+            for (Iter it = std::next(first) ; it != mid ; ++it)
+                lo = std::max(lo, coeff(*it));
+            Distance split = (lo + coeff(*mid)) / 2;
+
+            unsigned d0 = 0, d1 = 0;
+            Node *c0 = build(tree, space, nullptr, first, mid, &d0);
+            Node *c1 = build(tree, space, nullptr, mid, last, &d1);
+            *depth += std::max(d0, d1);
+
+            return tree.template allocBranch<LPBranch>(leaf, region, axis, split, c0, c1);
+        }
+
+        // Group nearest search support, see NearestGroup.
+        static constexpr bool kGroupNearest = true;
+
         NodePointer& follow(const Space&, Node* node, unsigned axis, const Key& key) {
             LPBranch *branch = static_cast<LPBranch*>(node);
             int childNo = Space::coeff(key, axis) > branch->split();
@@ -127,8 +185,8 @@ namespace unc::robotics::nigh::impl::kdtree_batch {
         void traverse(Visitor& visitor, const Space&, const Node *node, unsigned axis, const Key& key) {
             const LPBranch *branch = static_cast<const LPBranch*>(node);
             int childNo = Space::coeff(key, axis) > branch->split();
-            visitor(branch->child(childNo).load(std::memory_order_acquire));
-            visitor(branch->child(!childNo).load(std::memory_order_acquire));
+            visitor(branch->child(childNo));
+            visitor(branch->child(!childNo));
         }
 
         template <typename Visitor>
@@ -138,6 +196,21 @@ namespace unc::robotics::nigh::impl::kdtree_batch {
             visitor(branch->child(1));
         }
 
+        // Copies the branch for Relayout, or returns null if a
+        // writer may still replace one of its children.
+        template <typename Relayout>
+        Node* relayout(Relayout& relayout, const Space&, const Node *node, unsigned) {
+            const LPBranch *branch = static_cast<const LPBranch*>(node);
+            Node *c0 = branch->child(0).load(std::memory_order_acquire);
+            Node *c1 = branch->child(1).load(std::memory_order_acquire);
+            if (!Relayout::stable(c0) || !Relayout::stable(c1))
+                return nullptr;
+            LPBranch *copy = relayout.copy(branch, branch->split(), c0, c1);
+            relayout(copy->child(0));
+            relayout(copy->child(1));
+            return copy;
+        }
+
         template <typename Clear>
         void clear(Clear& visitor, const Space&, Node *node, unsigned) {
             LPBranch *branch = static_cast<LPBranch*>(node);
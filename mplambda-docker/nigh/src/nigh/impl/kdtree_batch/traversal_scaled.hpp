@@ -78,6 +78,11 @@ namespace unc::robotics::nigh::impl::kdtree_batch {
             Base::visit(visitor, space.space(), node, axis);
         }
 
+        template <typename Relayout>
+        Node* relayout(Relayout& relayout, const Space& space, const Node *node, unsigned axis) {
+            return Base::relayout(relayout, space.space(), node, axis);
+        }
+
         template <typename Clear>
         void clear(Clear& visitor, const Space& space, Node *node, unsigned axis) {
             Base::clear(visitor, space.space(), node, axis);
@@ -64,6 +64,7 @@ namespace unc::robotics::nigh::impl::kdtree_batch {
             space_t<Tree>,
             Concurrency,
             kBatchSize<Tree>,
+            kInlineKeys<Tree>,
             p>;
 
     public:
@@ -128,7 +129,7 @@ namespace unc::robotics::nigh::impl::kdtree_batch {
             Leaf *c0 = tree.template allocWithSpace<Leaf>(traversal, tree.keyFn(), elements, elements + batchSize/2);
             Leaf *c1 = tree.template allocWithSpace<Leaf>(traversal, tree.keyFn(), elements + batchSize/2, elements + batchSize);
 
-            return tree.template alloc<SO2Branch>(leaf, axis, split, c0, c1);
+            return tree.template allocBranch<SO2Branch>(leaf, axis, split, c0, c1);
         }
 
         NodePointer& follow(const Space& space, Node *node, unsigned axis, const Key& key) {
@@ -145,6 +146,20 @@ namespace unc::robotics::nigh::impl::kdtree_batch {
             visitor(branch->child(1));
         }
 
+        // Copies the branch for Relayout, or returns null if a
+        // writer may still replace one of its children.
+        template <typename Relayout>
+        Node* relayout(Relayout& relayout, const Space&, const Node *node, unsigned) {
+            const SO2Branch *branch = static_cast<const SO2Branch*>(node);
+            Node *c0 = branch->child(0).load(std::memory_order_acquire);
+            Node *c1 = branch->child(1).load(std::memory_order_acquire);
+            if (!Relayout::stable(c0) || !Relayout::stable(c1))
+                return nullptr;
+            SO2Branch *copy = relayout.copy(branch, branch->split(), c0, c1);
+            relayout(copy->child(0));
+            relayout(copy->child(1));
+            return copy;
+        }
 
         template <typename Clear>
         void clear(Clear& visitor, const Space&, Node *node, unsigned) {
@@ -60,8 +60,8 @@ namespace unc::robotics::nigh::impl::kdtree_batch {
 
         static constexpr std::size_t batchSize = kBatchSize<Tree>;
 
-        using SO3Branch = kdtree_batch::SO3Branch<T, space_t<Tree>, Concurrency, batchSize>;
-        using SO3Root = kdtree_batch::SO3Root<T, space_t<Tree>, Concurrency, batchSize>;
+        using SO3Branch = kdtree_batch::SO3Branch<T, space_t<Tree>, Concurrency, batchSize, kInlineKeys<Tree>>;
+        using SO3Root = kdtree_batch::SO3Root<T, space_t<Tree>, Concurrency, batchSize, kInlineKeys<Tree>>;
         using Metric = metric::SO3;
 
         int vol_{-1};
@@ -115,7 +115,7 @@ namespace unc::robotics::nigh::impl::kdtree_batch {
                         ? tree.template allocWithSpace<Leaf>(traversal, tree.keyFn(), blocks[vol_].begin(), blocks[vol_].end())
                         : nullptr;
                 vol_ = -1;
-                return tree.template alloc<SO3Root>(leaf, axis, leaves);
+                return tree.template allocBranch<SO3Root>(leaf, axis, leaves);
             } else {
                 std::array<T*, batchSize> ptrs;
                 std::iota(ptrs.begin(), ptrs.end(), leaf->elements());
@@ -179,7 +179,7 @@ namespace unc::robotics::nigh::impl::kdtree_batch {
                 }
 #endif
 
-                return tree.template alloc<SO3Branch>(leaf, axis, split, c0, c1);
+                return tree.template allocBranch<SO3Branch>(leaf, axis, split, c0, c1);
             }
         }
 
@@ -211,6 +211,35 @@ namespace unc::robotics::nigh::impl::kdtree_batch {
             }
         }
 
+        // Copies the branch for Relayout, or returns null if a
+        // writer may still replace one of its children.  The root
+        // children are not always present, and an empty one is
+        // filled by the next insert that reaches it.
+        template <typename Relayout>
+        Node* relayout(Relayout& relayout, const Space&, const Node *node, unsigned) {
+            if (vol_ == -1) {
+                const SO3Root *branch = static_cast<const SO3Root*>(node);
+                std::array<Node*, 4> children;
+                for (int i=0 ; i<4 ; ++i)
+                    if (!Relayout::stable(children[i] = branch->child(i).load(std::memory_order_acquire)))
+                        return nullptr;
+                SO3Root *copy = relayout.copy(branch, children.data());
+                for (vol_ = 0 ; vol_ < 4 ; ++vol_)
+                    relayout(copy->child(vol_));
+                vol_ = -1;
+                return copy;
+            } else {
+                const SO3Branch *branch = static_cast<const SO3Branch*>(node);
+                Node *c0 = branch->child(0).load(std::memory_order_acquire);
+                Node *c1 = branch->child(1).load(std::memory_order_acquire);
+                if (!Relayout::stable(c0) || !Relayout::stable(c1))
+                    return nullptr;
+                SO3Branch *copy = relayout.copy(branch, branch->split(), c0, c1);
+                relayout(copy->child(0));
+                relayout(copy->child(1));
+                return copy;
+            }
+        }
 
         template <typename Clear>
         void clear(Clear& visitor, const Space&, Node *node, unsigned) {
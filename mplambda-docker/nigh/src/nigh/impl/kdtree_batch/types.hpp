@@ -54,8 +54,9 @@ namespace unc::robotics::nigh::impl::kdtree_batch {
         typename KeyFn_,
         typename Concurrency_,
         std::size_t batchSize,
+        bool inlineKeys,
         typename Allocator_>
-    struct Types<Nigh<T, Space_, KeyFn_, Concurrency_, KDTreeBatch<batchSize>, Allocator_>> {
+    struct Types<Nigh<T, Space_, KeyFn_, Concurrency_, KDTreeBatch<batchSize, inlineKeys>, Allocator_>> {
 
         using Value = T;
         using KeyFn = KeyFn_;
@@ -66,13 +67,14 @@ namespace unc::robotics::nigh::impl::kdtree_batch {
         using Distance = typename Space::Distance;
 
         using Node = kdtree_batch::Node<T, Space, Concurrency>;
-        using Leaf = kdtree_batch::Leaf<T, Space, Concurrency, batchSize>;
+        using Leaf = kdtree_batch::Leaf<T, Space, Concurrency, batchSize, inlineKeys>;
 
         static constexpr bool kConcurrentWrites = std::is_same_v<Concurrency, Concurrent>;
 
         using NodePointer = Atom<Node*, kConcurrentWrites>;
 
         static constexpr std::size_t kBatchSize = batchSize;
+        static constexpr bool kInlineKeys = inlineKeys;
     };
 
 
@@ -97,6 +99,8 @@ namespace unc::robotics::nigh::impl::kdtree_batch {
 
     template <typename Tree>
     static constexpr std::size_t kBatchSize = Types<Tree>::kBatchSize;
+    template <typename Tree>
+    static constexpr bool kInlineKeys = Types<Tree>::kInlineKeys;
 }
 
 #endif
@@ -96,10 +96,11 @@ namespace unc::robotics::nigh::impl::kdtree_median {
                 (Space::coeff(Get::part(builder.getKey(*std::max_element(first, mid, cmp))), axis) +
                  Space::coeff(Get::part(builder.getKey(*mid)), axis)) / 2;
 
-            return builder.template allocate<LPBranch<Distance>>(
-                axis, split,
-                builder(first, mid),
-                builder(mid, last));
+            auto *branch = builder.template allocate<LPBranch<Distance>>(
+                axis, split, nullptr, nullptr);
+            builder(branch->child(0), first, mid);
+            builder(branch->child(1), mid, last);
+            return branch;
         }
     };
 }
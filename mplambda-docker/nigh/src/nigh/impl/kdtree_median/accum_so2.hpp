@@ -118,10 +118,11 @@ namespace unc::robotics::nigh::impl::kdtree_median {
 
             assert(mid1 <= mid && mid <= mid2);
 
-            return builder.template allocate<LPBranch<Distance>>(
-                axis, split,
-                builder(first, mid),
-                builder(mid, last));
+            auto *branch = builder.template allocate<LPBranch<Distance>>(
+                axis, split, nullptr, nullptr);
+            builder(branch->child(0), first, mid);
+            builder(branch->child(1), mid, last);
+            return branch;
         }
     };
 }
@@ -96,13 +96,13 @@ namespace unc::robotics::nigh::impl::kdtree_median {
                     root->offset(i) = std::distance(first, stops[i]);
 
                 vol_ = 0;
-                root->child(0) = builder(first, stops[0]);
+                builder(root->child(0), first, stops[0]);
                 vol_ = 1;
-                root->child(1) = builder(stops[0], stops[1]);
+                builder(root->child(1), stops[0], stops[1]);
                 vol_ = 2;
-                root->child(2) = builder(stops[1], stops[2]);
+                builder(root->child(2), stops[1], stops[2]);
                 vol_ = 3;
-                root->child(3) = builder(stops[2], last);
+                builder(root->child(3), stops[2], last);
                 vol_ = -1;
                 
                 return root;
@@ -118,8 +118,11 @@ namespace unc::robotics::nigh::impl::kdtree_median {
                     (so3::project(Get::part(builder.getKey(*max0)), vol_, axis) +
                      so3::project(Get::part(builder.getKey(*mid)), vol_, axis)).normalized();
 
-                return builder.template allocate<SO3Branch<Distance>>(
-                    axis, split, builder(first, mid), builder(mid, last));
+                auto *branch = builder.template allocate<SO3Branch<Distance>>(
+                    axis, split, nullptr, nullptr);
+                builder(branch->child(0), first, mid);
+                builder(branch->child(1), mid, last);
+                return branch;
             }
         }
     };
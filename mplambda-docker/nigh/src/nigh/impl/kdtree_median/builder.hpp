@@ -40,51 +40,130 @@
 #include "node.hpp"
 #include "accum.hpp"
 #include "accums.hpp"
+#include "../parallel.hpp"
+#include <forward_list>
+#include <iterator>
+#include <memory>
+#include <mutex>
 
 namespace unc::robotics::nigh::impl::kdtree_median {
     template <typename Tree>
     class Builder {
         using Key = typename Tree::Key;
         using Metric = typename Tree::Metric;
+        using Blocks = typename Tree::Blocks;
+
+        // subtrees smaller than this are always built by the thread
+        // that partitioned their parent.
+        static constexpr std::size_t kMinTaskSize = 4096;
+
+        // State shared by all the builders of a parallel build.  Each
+        // forked task allocates from its own BlockAllocator, which
+        // are merged into the tree's once all tasks complete.
+        struct Tasks {
+            TaskGroup group_;
+            std::mutex mutex_;
+            std::forward_list<Blocks> blocks_;
+
+            explicit Tasks(unsigned nThreads) : group_(nThreads) {}
+
+            // the tree creates the blocks, e.g., so that they use
+            // its allocator.
+            Blocks* newBlocks(const Tree& tree) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                return &blocks_.emplace_front(tree.newBlocks());
+            }
+        };
 
         Tree& tree_;
+        Blocks *target_;
+        Blocks *blocks_;
+        std::shared_ptr<Tasks> tasks_;
 
         Accum<Key, Metric> accum_;
+
+        template <typename Iter>
+        Node* build(Iter first, Iter last) {
+            // TODO: we would get better cache locality if we
+            // accumulated the region bounds in a loop here, instead
+            // of having each space iterate individually.  The problem
+            // is that SO(2) needs to sort the elements locally to
+            // find a good partition.
+            
+            // Iter it = first;
+            // accum_.init(tree_.metricSpace(), tree_.getKey(*it));
+            // while (++it != last)
+            //     accum_.grow(tree_.metricSpace(), tree_.getKey(*it));
+
+            unsigned axis;
+            accum_.selectAxis(*this, tree_.metricSpace(), &axis, first, last);
+            return accum_.partition(*this, tree_.metricSpace(), axis, first, last);
+        }
         
     public:
-        Builder(Tree& tree)
+        // When nThreads > 1, subtrees are built in parallel on up to
+        // nThreads threads.  The resulting tree is the same as the
+        // one built sequentially.
+        Builder(Tree& tree, unsigned nThreads = 1)
+            : Builder(tree, tree.blocks_, nThreads)
+        {
+        }
+
+        // Builds into blocks instead of the tree's own.
+        Builder(Tree& tree, Blocks& blocks, unsigned nThreads = 1)
             : tree_(tree)
+            , target_(&blocks)
+            , blocks_(&blocks)
         {
+            if (nThreads > 1)
+                tasks_ = std::make_shared<Tasks>(nThreads);
         }
 
         template <class T, class ... Args>
         T* allocate(Args&& ... args) {
-            return tree_.blocks_.template allocate<T>(std::forward<Args>(args)...);
+            return blocks_->template allocate<T>(std::forward<Args>(args)...);
         }
 
         decltype(auto) getKey(const typename Tree::Type& t) {
             return tree_.getKey(t);
         }
 
+        // Builds the tree over [first, last), and returns its root.
         template <typename Iter>
         Node* operator() (Iter first, Iter last) {
-            if (std::distance(first, last) <= 1)
-                return nullptr;
+            Node *root;
+            (*this)(root, first, last);
+            if (tasks_) {
+                tasks_->group_.wait();
+                for (Blocks& blocks : tasks_->blocks_)
+                    target_->merge(std::move(blocks));
+                tasks_->blocks_.clear();
+            }
+            return root;
+        }
 
-            // TODO: we would get better cache locality if we
-            // accumulated the region bounds in a loop here, instead
-            // of having each space iterate individually.  The problem
-            // is that SO(2) needs to sort the elements locally to
-            // find a good partition.
-            
-            // Iter it = first;
-            // accum_.init(tree_.metricSpace(), tree_.getKey(*it));
-            // while (++it != last)
-            //     accum_.grow(tree_.metricSpace(), tree_.getKey(*it));
+        // Builds the subtree over [first, last) into slot.  This is
+        // called by the Accum partitions for each child.  In a
+        // parallel build, slot may be written by another thread
+        // before the outermost operator() returns.  The forked
+        // builder is a copy of this one, and thus starts with the
+        // same Accum state that a sequential build would have.
+        template <typename Slot, typename Iter>
+        void operator() (Slot& slot, Iter first, Iter last) {
+            std::size_t n = std::distance(first, last);
+            if (n <= 1) {
+                slot = nullptr;
+                return;
+            }
 
-            unsigned axis;
-            accum_.selectAxis(*this, tree_.metricSpace(), &axis, first, last);
-            return accum_.partition(*this, tree_.metricSpace(), axis, first, last);
+            if (tasks_ && n >= kMinTaskSize && tasks_->group_.tryRun(
+                    [sub = *this, &slot, first, last] () mutable {
+                        sub.blocks_ = sub.tasks_->newBlocks(sub.tree_);
+                        slot = sub.build(first, last);
+                    }))
+                return;
+
+            slot = build(first, last);
         }
     };
 }
@@ -43,7 +43,7 @@ namespace unc::robotics::nigh::impl::kdtree_median {
     template <typename Distance>
     class LPBranch : public Node {
         Distance split_;
-        std::array<Node*, 2> children_;
+        std::array<NodeOffset, 2> children_;
 
     public:
         LPBranch(unsigned axis, Distance split, Node* c0, Node * c1)
@@ -61,7 +61,7 @@ namespace unc::robotics::nigh::impl::kdtree_median {
             return children_[i];
         }
 
-        const auto& child(int i) const {
+        const Node* child(int i) const {
             return children_[i];
         }
     };
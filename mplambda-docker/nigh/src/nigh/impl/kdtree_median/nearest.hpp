@@ -41,34 +41,50 @@
 #include "node.hpp"
 #include "traversal.hpp"
 #include "traversals.hpp"
+#include "../../approximate.hpp"
 #include <cassert>
 
 namespace unc::robotics::nigh::impl::kdtree_median {
-    template <class Tree, class NearSet>
-    class Nearest;
+    // NearestTraits provides the types that Nearest needs from the
+    // structure it searches.  It is specialized for the KDTreeMedian
+    // Nigh, and for KDTreeSnapshot.
+    template <class Tree>
+    struct NearestTraits;
 
     template <
         class T,
-        class Space,
+        class Space_,
         class KeyFn,
         class Concurrency,
         std::size_t minTreeSize,
         std::size_t linearSearchSize,
-        class Allocator,
-        class NearSet>
-    class Nearest<
-        Nigh<T, Space, KeyFn, Concurrency, KDTreeMedian<minTreeSize, linearSearchSize>, Allocator>,
-        NearSet>
-        : public NearSet
+        class Allocator>
+    struct NearestTraits<
+        Nigh<T, Space_, KeyFn, Concurrency, KDTreeMedian<minTreeSize, linearSearchSize>, Allocator>>
     {
-        using Tree = Nigh<T, Space, KeyFn, Concurrency, KDTreeMedian<minTreeSize, linearSearchSize>, Allocator>;
+        using Type = T;
+        using Space = Space_;
+        static constexpr std::size_t kLinearSearchSize = linearSearchSize;
+    };
+
+    template <class Tree, class NearSet>
+    class Nearest : public NearSet {
+        using T = typename NearestTraits<Tree>::Type;
+        using Space = typename NearestTraits<Tree>::Space;
         using Key = typename Space::Type;
+        using Distance = typename Space::Distance;
+
+        static constexpr std::size_t linearSearchSize = NearestTraits<Tree>::kLinearSearchSize;
 
         const Tree& tree_;
         const Key key_;
 
         Traversal<Tree, Key, typename Space::Metric> traversal_;
-                
+
+        // see Approximate.  The defaults result in an exact search.
+        Distance pruneScale_{1};
+        std::size_t leafBudget_{std::numeric_limits<std::size_t>::max()};
+
     public:
         template <typename K, typename ... Args>
         Nearest(const Tree& tree, K&& key, Args&& ... args)
@@ -79,6 +95,15 @@ namespace unc::robotics::nigh::impl::kdtree_median {
         {
         }
 
+        const Key& key() const {
+            return key_;
+        }
+
+        // the traversal state of this search, see NearestGroup.
+        auto& traversal() {
+            return traversal_;
+        }
+
         template <class Iter>
         void insert(Iter first, Iter last) {
             NearSet::insert(
@@ -87,11 +112,20 @@ namespace unc::robotics::nigh::impl::kdtree_median {
         }
         
 
+        void approximate(const Approximate& approx) {
+            pruneScale_ = 1 / (1 + static_cast<Distance>(approx.epsilon_));
+            leafBudget_ = approx.maxLeafVisits_;
+        }
+
         template <class Iter>
         void operator() (const Node* node, Iter first, Iter last) {
-            if (NearSet::dist() < traversal_.distToRegion())
+            if (leafBudget_ == 0 && NearSet::full())
+                return;
+            if (NearSet::dist() * pruneScale_ < traversal_.distToRegion())
                 return;
             if (std::distance(first, last) <= linearSearchSize) {
+                if (leafBudget_)
+                    --leafBudget_;
                 insert(first, last);
             } else {
                 assert(node != nullptr);
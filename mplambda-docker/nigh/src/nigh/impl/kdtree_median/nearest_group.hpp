@@ -0,0 +1,191 @@
+// Software License Agreement (BSD-3-Clause)
+//
+// Copyright 2018 The University of North Carolina at Chapel Hill
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+// OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//! @author Jeff Ichnowski
+
+#pragma once
+#ifndef NIGH_IMPL_KDTREE_MEDIAN_NEAREST_GROUP_HPP
+#define NIGH_IMPL_KDTREE_MEDIAN_NEAREST_GROUP_HPP
+
+#include "nearest.hpp"
+#include "lp_branch.hpp"
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <numeric>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace unc::robotics::nigh::impl::kdtree_median {
+
+    // Traversals that can enter the far side of a split for one
+    // query at a time, outside of follow(), declare kGroupNearest.
+    // For the others, nearest_batch searches a block of queries one
+    // at a time per tree.
+    template <class Traversal, class = void>
+    struct has_group_nearest : std::false_type {};
+
+    template <class Traversal>
+    struct has_group_nearest<Traversal, std::void_t<decltype(Traversal::kGroupNearest)>>
+        : std::bool_constant<Traversal::kGroupNearest> {};
+
+    // Searches for the nearest neighbors of a group of queries in a
+    // single traversal of each tree.  Each query keeps its own NearSet
+    // and traversal state (in its own Nearest), and visits the same
+    // nodes in the same order as its own search would: at a branch,
+    // the group splits by the side of the split each query is on, and
+    // each part visits its own side before the other.  Queries that
+    // reach a node at the same point of their searches visit it
+    // together, sharing the load of the node.  Once a single query
+    // remains, it continues on its own.  It has the same interface as
+    // Nearest for Nigh::scan.
+    template <class Tree, class NearSet>
+    class NearestGroup {
+        using Search = Nearest<Tree, NearSet>;
+        using Space = typename NearestTraits<Tree>::Space;
+        using Key = typename Space::Type;
+        using Distance = typename Space::Distance;
+        using Traversal = std::decay_t<decltype(std::declval<Search&>().traversal())>;
+
+        static constexpr std::size_t linearSearchSize = NearestTraits<Tree>::kLinearSearchSize;
+
+        struct Entered {
+            std::size_t search_;
+            typename Traversal::Saved saved_;
+        };
+
+        std::vector<Search> searches_;
+        std::vector<std::size_t> active_;
+
+        // the traversal state saved by the queries that entered the
+        // far side of a branch on the current path, see visitFar().
+        std::vector<Entered> stack_;
+
+        template <class Iter>
+        void visit(const Node *node, Iter first, Iter last, std::size_t *qFirst, std::size_t *qLast) {
+            if (qLast - qFirst == 1) {
+                // nothing left to share.
+                searches_[*qFirst](node, first, last);
+                return;
+            }
+
+            qLast = std::partition(qFirst, qLast, [&] (std::size_t i) {
+                return !(searches_[i].dist() < searches_[i].traversal().distToRegion());
+            });
+            if (qFirst == qLast)
+                return;
+
+            if (static_cast<std::size_t>(std::distance(first, last)) <= linearSearchSize) {
+                for (std::size_t *it = qFirst ; it != qLast ; ++it)
+                    searches_[*it].insert(first, last);
+                return;
+            }
+
+            assert(node != nullptr);
+            const auto *branch = static_cast<const LPBranch<Distance>*>(node);
+            unsigned axis = node->axis();
+            std::array<Iter, 3> iters{{
+                    first,
+                    first + std::distance(first, last)/2,
+                    last}};
+
+            // Each query searches the child on its side of the split
+            // first, then enters the other child, as in its own
+            // search.
+            std::size_t *qMid = std::partition(qFirst, qLast, [&] (std::size_t i) {
+                return !(searches_[i].traversal().splitDelta(node, axis, searches_[i].key()) > 0);
+            });
+            visit(branch->child(0), iters[0], iters[1], qFirst, qMid);
+            visit(branch->child(1), iters[1], iters[2], qMid, qLast);
+            visitFar(branch, axis, 1, iters[1], iters[2], qFirst, qMid);
+            visitFar(branch, axis, 0, iters[0], iters[1], qMid, qLast);
+        }
+
+        // visits the child on the far side of the split for the
+        // queries in [qFirst, qLast).
+        template <class Iter>
+        void visitFar(
+            const LPBranch<Distance> *branch, unsigned axis, int childNo,
+            Iter first, Iter last, std::size_t *qFirst, std::size_t *qLast)
+        {
+            if (qFirst == qLast)
+                return;
+            std::size_t base = stack_.size();
+            for (std::size_t *it = qFirst ; it != qLast ; ++it) {
+                auto& traversal = searches_[*it].traversal();
+                Distance delta = traversal.splitDelta(branch, axis, searches_[*it].key());
+                stack_.push_back(Entered{*it, traversal.enter(axis, delta)});
+            }
+            std::size_t top = stack_.size();
+            visit(branch->child(childNo), first, last, qFirst, qLast);
+            for (std::size_t i = base ; i < top ; ++i)
+                searches_[stack_[i].search_].traversal().leave(axis, stack_[i].saved_);
+            stack_.resize(base);
+        }
+
+    public:
+        static constexpr bool kSupported = has_group_nearest<Traversal>::value;
+
+        explicit NearestGroup(std::size_t capacity = 0) {
+            searches_.reserve(capacity);
+        }
+
+        // adds a query to the group, args are the arguments to
+        // Nearest.
+        template <class ... Args>
+        void add(Args&& ... args) {
+            searches_.emplace_back(std::forward<Args>(args)...);
+        }
+
+        template <class Iter>
+        void insert(Iter first, Iter last) {
+            for (Search& search : searches_)
+                search.insert(first, last);
+        }
+
+        template <class Iter>
+        void operator() (const Node *root, Iter first, Iter last) {
+            active_.resize(searches_.size());
+            std::iota(active_.begin(), active_.end(), std::size_t(0));
+            visit(root, first, last, active_.data(), active_.data() + active_.size());
+        }
+
+        void sort() {
+            for (Search& search : searches_)
+                search.sort();
+        }
+    };
+}
+
+#endif
@@ -37,7 +37,43 @@
 #ifndef NIGH_IMPL_KDTREE_MEDIAN_NODE_HPP
 #define NIGH_IMPL_KDTREE_MEDIAN_NODE_HPP
 
+#include <cstdint>
+
 namespace unc::robotics::nigh::impl::kdtree_median {
+    class Node;
+
+    // A child pointer stored as an offset from itself.  Branches
+    // store their children this way so that a tree built in a single
+    // buffer does not depend on the buffer's address, and can thus be
+    // written out and mapped back in (see KDTreeSnapshot).  An offset
+    // of 0 is null, since a slot cannot point to itself.  Copying
+    // would change the target, and thus is not allowed.
+    class NodeOffset {
+        std::intptr_t offset_{0};
+
+        std::intptr_t addr() const {
+            return reinterpret_cast<std::intptr_t>(this);
+        }
+
+    public:
+        NodeOffset() = default;
+        NodeOffset(const NodeOffset&) = delete;
+
+        inline NodeOffset(Node *node)
+            : offset_(node ? reinterpret_cast<std::intptr_t>(node) - addr() : 0)
+        {
+        }
+
+        inline NodeOffset& operator = (Node *node) {
+            offset_ = node ? reinterpret_cast<std::intptr_t>(node) - addr() : 0;
+            return *this;
+        }
+
+        inline operator Node* () const {
+            return offset_ ? reinterpret_cast<Node*>(addr() + offset_) : nullptr;
+        }
+    };
+
     class Node {
         unsigned axis_;
 
@@ -0,0 +1,240 @@
+// Software License Agreement (BSD-3-Clause)
+//
+// Copyright 2018 The University of North Carolina at Chapel Hill
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+// OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//! @author Jeff Ichnowski
+
+#pragma once
+#ifndef NIGH_IMPL_KDTREE_MEDIAN_SNAPSHOT_HPP
+#define NIGH_IMPL_KDTREE_MEDIAN_SNAPSHOT_HPP
+
+#include "builder.hpp"
+#include "lp_branch.hpp"
+#include "so3_branch.hpp"
+#include "so3_root.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <ostream>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace unc::robotics::nigh::impl::kdtree_median {
+
+    // The layout of a snapshot is:
+    //
+    //   SnapshotHeader
+    //   (padding to kSnapshotAlign)
+    //   Index indices[size_]      (in tree order)
+    //   (padding to kSnapshotAlign)
+    //   node bytes[nodeBytes_]    (a median tree, with NodeOffset children)
+    //
+    // All offsets are from the start of the snapshot, which must be
+    // aligned to kSnapshotAlign (as is an mmap'd file).  Values are
+    // stored in the byte order and layout of the writer, thus
+    // snapshots are only portable between builds with the same ABI.
+    static constexpr std::size_t kSnapshotAlign = 64;
+    static constexpr char kSnapshotMagic[8] = { 'N', 'I', 'G', 'H', 'K', 'D', 'M', 'S' };
+    static constexpr std::uint32_t kSnapshotVersion = 1;
+    static constexpr std::uint64_t kSnapshotNoRoot = ~std::uint64_t(0);
+
+    struct SnapshotHeader {
+        char magic_[8];
+        std::uint32_t version_;
+        std::uint16_t indexSize_;
+        std::uint16_t distanceSize_;
+        std::uint32_t dimensions_;
+        std::uint32_t reserved_;
+        std::uint64_t size_;
+        std::uint64_t indexOffset_;
+        std::uint64_t nodeOffset_;
+        std::uint64_t nodeBytes_;
+        std::uint64_t root_; // offset from nodeOffset_, or kSnapshotNoRoot
+    };
+
+    constexpr std::uint64_t snapshotAlign(std::uint64_t offset) {
+        return (offset + kSnapshotAlign - 1) & ~std::uint64_t(kSnapshotAlign - 1);
+    }
+
+    // A contiguous, fixed capacity allocator for the nodes of a
+    // snapshot.  The capacity is computed from the number of values,
+    // since a median tree has fewer nodes than values.
+    template <typename Distance>
+    class SnapshotArena {
+        static constexpr std::size_t kMaxNodeSize = std::max({
+                sizeof(LPBranch<Distance>),
+                sizeof(SO3Branch<Distance>),
+                sizeof(SO3Root) });
+
+        using Storage = std::aligned_storage_t<alignof(std::max_align_t), alignof(std::max_align_t)>;
+
+        std::unique_ptr<Storage[]> data_;
+        std::size_t capacity_{0};
+        std::size_t offset_{0};
+
+    public:
+        SnapshotArena() = default;
+
+        explicit SnapshotArena(std::size_t nValues)
+            : capacity_(nValues * (kMaxNodeSize + alignof(std::max_align_t)))
+        {
+            data_.reset(new Storage[capacity_ / sizeof(Storage) + 1]);
+        }
+
+        const char* data() const {
+            return reinterpret_cast<const char*>(data_.get());
+        }
+
+        std::size_t size() const {
+            return offset_;
+        }
+
+        template <class E, class ... Args>
+        E* allocate(Args&& ... args) {
+            static_assert(alignof(E) <= alignof(std::max_align_t));
+            std::size_t offset = (offset_ + alignof(E) - 1) & ~(alignof(E) - 1);
+            if (offset + sizeof(E) > capacity_)
+                throw std::length_error("snapshot arena capacity exceeded");
+            offset_ = offset + sizeof(E);
+            return new (reinterpret_cast<char*>(data_.get()) + offset) E(std::forward<Args>(args)...);
+        }
+
+        // snapshots are built on one thread, so there is never
+        // anything to merge.
+        void merge(SnapshotArena&& other) {
+            assert(other.offset_ == 0);
+        }
+    };
+
+    // The Builder's view of the values being written to a snapshot.
+    // Builder partitions positions in the value array, while the
+    // caller's functions map positions to keys and indices.
+    template <typename Space, typename GetKey>
+    struct SnapshotSource {
+        using Type = std::size_t;
+        using Key = typename Space::Type;
+        using Metric = typename Space::Metric;
+        using Blocks = SnapshotArena<typename Space::Distance>;
+
+        const Space& space_;
+        const GetKey& getKey_;
+        Blocks blocks_;
+
+        SnapshotSource(const Space& space, const GetKey& getKey, std::size_t n)
+            : space_(space)
+            , getKey_(getKey)
+            , blocks_(n)
+        {
+        }
+
+        const Space& metricSpace() const {
+            return space_;
+        }
+
+        Blocks newBlocks() const {
+            return Blocks();
+        }
+
+        decltype(auto) getKey(std::size_t i) const {
+            return getKey_(i);
+        }
+    };
+
+    template <typename T>
+    void writeSnapshotBytes(std::ostream& out, const T* data, std::size_t n) {
+        out.write(reinterpret_cast<const char*>(data), n * sizeof(T));
+    }
+
+    inline void writeSnapshotPadding(std::ostream& out, std::uint64_t from, std::uint64_t to) {
+        static const char zeros[kSnapshotAlign] = {};
+        out.write(zeros, to - from);
+    }
+
+    // Builds a single median tree over n values, and writes it as a
+    // snapshot.  getKey(i) returns the key of the i-th value, and
+    // indexOf(i) returns the index to store for it.
+    template <typename Index, typename Space, typename GetKey, typename IndexOf>
+    void writeSnapshot(
+        std::ostream& out, const Space& space, std::size_t n,
+        const GetKey& getKey, const IndexOf& indexOf)
+    {
+        static_assert(std::is_integral_v<Index>, "snapshot indices must be integers");
+        using Distance = typename Space::Distance;
+        using Source = SnapshotSource<Space, GetKey>;
+
+        Source source(space, getKey, n);
+        std::vector<std::size_t> order(n);
+        std::iota(order.begin(), order.end(), std::size_t(0));
+        Node *root = Builder<Source>(source)(order.begin(), order.end());
+
+        std::vector<Index> indices;
+        indices.reserve(n);
+        for (std::size_t i : order) {
+            auto index = indexOf(i);
+            if constexpr (std::is_signed_v<decltype(index)>)
+                if (index < 0)
+                    throw std::out_of_range("snapshot indices must not be negative");
+            if (static_cast<std::uint64_t>(index) > std::numeric_limits<Index>::max())
+                throw std::out_of_range("index does not fit in the snapshot index type");
+            indices.push_back(static_cast<Index>(index));
+        }
+
+        SnapshotHeader header;
+        std::memcpy(header.magic_, kSnapshotMagic, sizeof(kSnapshotMagic));
+        header.version_ = kSnapshotVersion;
+        header.indexSize_ = sizeof(Index);
+        header.distanceSize_ = sizeof(Distance);
+        header.dimensions_ = space.dimensions();
+        header.reserved_ = 0;
+        header.size_ = n;
+        header.indexOffset_ = snapshotAlign(sizeof(SnapshotHeader));
+        header.nodeOffset_ = snapshotAlign(header.indexOffset_ + n * sizeof(Index));
+        header.nodeBytes_ = source.blocks_.size();
+        header.root_ = root
+            ? static_cast<std::uint64_t>(reinterpret_cast<const char*>(root) - source.blocks_.data())
+            : kSnapshotNoRoot;
+
+        writeSnapshotBytes(out, &header, 1);
+        writeSnapshotPadding(out, sizeof(SnapshotHeader), header.indexOffset_);
+        writeSnapshotBytes(out, indices.data(), n);
+        writeSnapshotPadding(out, header.indexOffset_ + n * sizeof(Index), header.nodeOffset_);
+        writeSnapshotBytes(out, source.blocks_.data(), header.nodeBytes_);
+        if (!out)
+            throw std::runtime_error("failed to write snapshot");
+    }
+}
+
+#endif
@@ -38,12 +38,13 @@
 #define NIGH_IMPL_KDTREE_MEDIAN_SO3_BRANCH_HPP
 
 #include "node.hpp"
+#include <Eigen/Dense>
 
 namespace unc::robotics::nigh::impl::kdtree_median {
     template <class Distance>
     class SO3Branch : public Node {
         Eigen::Matrix<Distance, 2, 1> split_;
-        std::array<Node*, 2> children_;
+        std::array<NodeOffset, 2> children_;
 
     public:
         SO3Branch(
@@ -57,6 +58,10 @@ namespace unc::robotics::nigh::impl::kdtree_median {
         {
         }
 
+        auto& child(int i) {
+            return children_[i];
+        }
+
         const Node* child(int i) const {
             return children_[i];
         }
@@ -41,7 +41,7 @@
 
 namespace unc::robotics::nigh::impl::kdtree_median {
     class SO3Root : public Node {
-        std::array<Node*, 4> children_{{}};
+        std::array<NodeOffset, 4> children_;
         std::array<std::size_t, 3> offsets_;
 
     public:
@@ -62,7 +62,7 @@ namespace unc::robotics::nigh::impl::kdtree_median {
             return children_[i];
         }
 
-        inline const auto& child(int i) const {
+        inline const Node* child(int i) const {
             return children_[i];
         }
     };
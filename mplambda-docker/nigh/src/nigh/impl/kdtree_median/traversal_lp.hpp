@@ -39,6 +39,7 @@
 
 #include "traversal.hpp"
 #include "lp_branch.hpp"
+#include <utility>
 
 namespace unc::robotics::nigh::impl::kdtree_median {
     template <class Tree, class Key, int p, class Get>
@@ -61,6 +62,29 @@ namespace unc::robotics::nigh::impl::kdtree_median {
             return distToRegion_;
         }
 
+        // Group nearest search support, see NearestGroup.  A query
+        // searches the child on its side of the split as is, and
+        // enters the other child with splitDelta().
+        static constexpr bool kGroupNearest = true;
+
+        using Saved = std::pair<Distance, Distance>;
+
+        Distance splitDelta(const Node *node, unsigned axis, const Key& key) const {
+            return Space::coeff(key, axis) - static_cast<const LPBranch<Distance>*>(node)->split();
+        }
+
+        Saved enter(unsigned axis, Distance delta) {
+            Saved saved(deltas_[axis], distToRegion_);
+            deltas_[axis] = delta;
+            distToRegion_ = deltas_.template lpNorm<p>();
+            return saved;
+        }
+
+        void leave(unsigned axis, const Saved& saved) {
+            deltas_[axis] = saved.first;
+            distToRegion_ = saved.second;
+        }
+
         template <typename Nearest, typename Iter>
         void follow(
             Nearest& nearest,
@@ -77,7 +77,7 @@ namespace unc::robotics::nigh::impl::kdtree_median {
         template <typename Nearest, typename Iter>
         void recur(
             Nearest& nearest,
-            Distance split, Node *child, int childNo,
+            Distance split, const Node *child, int childNo,
             unsigned axis,
             const Key& key,
             Iter first, Iter last)
@@ -41,6 +41,7 @@
 #include "so3_root.hpp"
 #include "so3_branch.hpp"
 #include "../so3.hpp"
+#include "../constants.hpp"
 #include <Eigen/Dense>
 
 namespace unc::robotics::nigh::impl::kdtree_median {
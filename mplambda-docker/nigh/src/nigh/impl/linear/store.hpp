@@ -67,7 +67,8 @@ namespace unc::robotics::nigh::impl::linear {
 
     public:
         Store(Store&& other)
-            : size_(other.size_.exchange(0))
+            : LinkAllocator(std::move(static_cast<LinkAllocator&>(other)))
+            , size_(other.size_.exchange(0))
             , list_(other.list_.exchange(nullptr))
         {
         }
@@ -136,7 +137,7 @@ namespace unc::robotics::nigh::impl::linear {
 
     template <typename T, typename Allocator>
     class Store<T, ConcurrentRead, Allocator> {
-        std::vector<T> values_;
+        std::vector<T, Allocator> values_;
 
     public:
         Store(Store&& other)
@@ -171,8 +172,8 @@ namespace unc::robotics::nigh::impl::linear {
             std::for_each(values_.begin(), values_.end(), fn);
         }
 
-        const std::vector<T>& list() const {
-            return values_;
+        std::vector<T> list() const {
+            return std::vector<T>(values_.begin(), values_.end());
         }
     };
 
@@ -83,18 +83,36 @@ namespace unc::robotics::nigh::impl {
             Base::insert(std::forward<Args>(args)...);
         }
 
+        template <typename ... Args>
+        void setBuildThreads(Args&& ... args) {
+            WriteLock lock(mutex_);
+            Base::setBuildThreads(std::forward<Args>(args)...);
+        }
+
         template <typename ... Args>
         decltype(auto) nearest(Args&& ... args) const {
             ReadLock lock(mutex_);
             return Base::nearest(std::forward<Args>(args)...);
         }
 
+        template <typename ... Args>
+        void nearest_batch(Args&& ... args) const {
+            ReadLock lock(mutex_);
+            Base::nearest_batch(std::forward<Args>(args)...);
+        }
+
         template <typename Fn>
         void visit(const Fn& fn) const {
             ReadLock lock(mutex_);
             Base::visit(fn);
         }
 
+        template <typename Index = std::uint32_t, typename ... Args>
+        void save(Args&& ... args) const {
+            ReadLock lock(mutex_);
+            Base::template save<Index>(std::forward<Args>(args)...);
+        }
+
         decltype(auto) list() const {
             ReadLock lock(mutex_);
             return Base::list();
@@ -207,6 +207,76 @@ namespace unc::robotics::nigh::impl {
             }
         }
     };
+
+    // Collects every element within a fixed radius, in the order they
+    // are visited.  Unlike NearKSet there is no heap to maintain, and
+    // the bound never shrinks, thus the cost of a search is the
+    // regions it visits plus one append per result.
+    template <typename Tuple, typename Distance, typename Allocator>
+    class NearRadiusSet {
+        static const std::size_t kDistanceIndex =
+            std::is_same_v<Distance, std::remove_cv_t<std::tuple_element_t<1, Tuple>>> ? 1 : 0;
+
+        static_assert(
+            std::is_same_v<Distance, std::remove_cv_t<std::tuple_element_t<kDistanceIndex, Tuple>>>,
+            "nearest vector element type must have a distance element");
+
+        std::vector<Tuple, Allocator>& set_;
+        Distance radius_;
+
+        struct Compare {
+            bool operator() (const Tuple& a, const Tuple& b) const {
+                return std::get<kDistanceIndex>(a) < std::get<kDistanceIndex>(b);
+            }
+        };
+
+        template <typename T>
+        void emplace(const T& n, Distance d) {
+            if constexpr (kDistanceIndex == 1) {
+                set_.emplace_back(n, d);
+            } else {
+                set_.emplace_back(d, n);
+            }
+        }
+
+    public:
+        NearRadiusSet(std::vector<Tuple, Allocator>& set, Distance radius)
+            : set_(set), radius_(radius)
+        {
+            set_.clear();
+        }
+
+        Distance dist() const {
+            return radius_;
+        }
+
+        std::size_t size() const {
+            return set_.size();
+        }
+
+        bool full() const {
+            return false;
+        }
+
+        template <typename T>
+        bool insert(const T& n, Distance d) {
+            if (d > radius_)
+                return false;
+            emplace(n, d);
+            return true;
+        }
+
+        template <typename Iter, typename Fn>
+        void insert(Iter first, Iter last, Fn dist) {
+            for (Distance d ; first != last ; ++first)
+                if ((d = dist(*first)) <= radius_)
+                    emplace(*first, d);
+        }
+
+        void sort() {
+            std::sort(set_.begin(), set_.end(), Compare{});
+        }
+    };
 }
 
 #endif // NIGH_IMPL_NEAR_SET_HPP
@@ -0,0 +1,153 @@
+// Software License Agreement (BSD-3-Clause)
+//
+// Copyright 2018 The University of North Carolina at Chapel Hill
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+// OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//! @author Jeff Ichnowski
+
+#pragma once
+#ifndef NIGH_IMPL_PARALLEL_HPP
+#define NIGH_IMPL_PARALLEL_HPP
+
+#include <algorithm>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace unc::robotics::nigh::impl {
+    // Splits [0, n) into up to nThreads contiguous ranges, and calls
+    // fn(begin, end) for each range on its own thread.  The calling
+    // thread runs the last range.  Returns once all ranges complete,
+    // rethrowing the first exception thrown by fn, if any.
+    template <typename Fn>
+    void parallelRanges(std::size_t n, unsigned nThreads, const Fn& fn) {
+        nThreads = static_cast<unsigned>(std::min<std::size_t>(std::max(nThreads, 1u), n));
+        if (nThreads <= 1) {
+            fn(std::size_t(0), n);
+            return;
+        }
+
+        std::vector<std::exception_ptr> errors(nThreads);
+        std::vector<std::thread> threads;
+        threads.reserve(nThreads - 1);
+        auto run = [&] (unsigned i) {
+            try {
+                fn(n * i / nThreads, n * (i+1) / nThreads);
+            } catch (...) {
+                errors[i] = std::current_exception();
+            }
+        };
+
+        for (unsigned i=0 ; i+1<nThreads ; ++i)
+            threads.emplace_back(run, i);
+        run(nThreads - 1);
+
+        for (auto& t : threads)
+            t.join();
+
+        for (auto& e : errors)
+            if (e)
+                std::rethrow_exception(e);
+    }
+
+    // TaskGroup runs fork-join tasks on at most nThreads threads
+    // (including the thread that calls wait()).  Tasks may fork
+    // further tasks.  tryRun() only forks when a thread is available,
+    // otherwise it returns false and the caller is expected to run the
+    // work itself, thus recursive algorithms degrade to sequential
+    // execution instead of queuing.
+    class TaskGroup {
+        std::mutex mutex_;
+        std::vector<std::thread> threads_;
+        std::exception_ptr error_;
+        unsigned available_;
+
+    public:
+        explicit TaskGroup(unsigned nThreads)
+            : available_(std::max(nThreads, 1u) - 1)
+        {
+        }
+
+        TaskGroup(const TaskGroup&) = delete;
+
+        ~TaskGroup() {
+            join();
+        }
+
+        template <typename Fn>
+        bool tryRun(Fn&& fn) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (available_ == 0)
+                return false;
+
+            --available_;
+            threads_.emplace_back([this, fn = std::forward<Fn>(fn)] () mutable {
+                try {
+                    fn();
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    if (!error_)
+                        error_ = std::current_exception();
+                }
+                std::lock_guard<std::mutex> lock(mutex_);
+                ++available_;
+            });
+            return true;
+        }
+
+        // waits for all tasks, including those forked by tasks, and
+        // rethrows the first exception thrown by a task, if any.
+        void wait() {
+            join();
+            if (std::exception_ptr e = std::exchange(error_, nullptr))
+                std::rethrow_exception(e);
+        }
+
+    private:
+        void join() {
+            for (;;) {
+                std::thread t;
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    if (threads_.empty())
+                        return;
+                    t = std::move(threads_.back());
+                    threads_.pop_back();
+                }
+                t.join();
+            }
+        }
+    };
+}
+
+#endif
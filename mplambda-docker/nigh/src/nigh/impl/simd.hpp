@@ -0,0 +1,218 @@
+// Software License Agreement (BSD-3-Clause)
+//
+// Copyright 2018 The University of North Carolina at Chapel Hill
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+// OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//! @author Jeff Ichnowski
+
+#pragma once
+#ifndef NIGH_IMPL_SIMD_HPP
+#define NIGH_IMPL_SIMD_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// Kernels that compute distances from one query to a block of
+// coordinates stored as a structure of arrays (one row per
+// coordinate, n lanes per row).  The instruction set is selected at
+// compile time: AVX-512 when __AVX512F__ is defined, AVX2 when
+// __AVX2__ is, and otherwise a scalar loop (which the compiler is
+// still free to auto-vectorize).  Types without a vector
+// specialization (e.g. long double) always use the scalar loop.
+
+namespace unc::robotics::nigh::impl::simd {
+    // Vector register operations.  kWidth == 1 is the scalar
+    // fallback, in which case only the scalar tail loops are used.
+    template <typename S>
+    struct Vec {
+        static constexpr std::size_t kWidth = 1;
+    };
+
+#if defined(__AVX512F__)
+    template <>
+    struct Vec<double> {
+        static constexpr std::size_t kWidth = 8;
+        using Reg = __m512d;
+        static Reg load(const double *p) { return _mm512_loadu_pd(p); }
+        static void store(double *p, Reg a) { _mm512_storeu_pd(p, a); }
+        static Reg set1(double x) { return _mm512_set1_pd(x); }
+        static Reg add(Reg a, Reg b) { return _mm512_add_pd(a, b); }
+        static Reg sub(Reg a, Reg b) { return _mm512_sub_pd(a, b); }
+        static Reg max(Reg a, Reg b) { return _mm512_max_pd(a, b); }
+        static Reg abs(Reg a) { return _mm512_abs_pd(a); }
+        static Reg fmadd(Reg a, Reg b, Reg c) { return _mm512_fmadd_pd(a, b, c); }
+        static Reg sqrt(Reg a) { return _mm512_sqrt_pd(a); }
+    };
+
+    template <>
+    struct Vec<float> {
+        static constexpr std::size_t kWidth = 16;
+        using Reg = __m512;
+        static Reg load(const float *p) { return _mm512_loadu_ps(p); }
+        static void store(float *p, Reg a) { _mm512_storeu_ps(p, a); }
+        static Reg set1(float x) { return _mm512_set1_ps(x); }
+        static Reg add(Reg a, Reg b) { return _mm512_add_ps(a, b); }
+        static Reg sub(Reg a, Reg b) { return _mm512_sub_ps(a, b); }
+        static Reg max(Reg a, Reg b) { return _mm512_max_ps(a, b); }
+        static Reg abs(Reg a) { return _mm512_abs_ps(a); }
+        static Reg fmadd(Reg a, Reg b, Reg c) { return _mm512_fmadd_ps(a, b, c); }
+        static Reg sqrt(Reg a) { return _mm512_sqrt_ps(a); }
+    };
+#elif defined(__AVX2__)
+    template <>
+    struct Vec<double> {
+        static constexpr std::size_t kWidth = 4;
+        using Reg = __m256d;
+        static Reg load(const double *p) { return _mm256_loadu_pd(p); }
+        static void store(double *p, Reg a) { _mm256_storeu_pd(p, a); }
+        static Reg set1(double x) { return _mm256_set1_pd(x); }
+        static Reg add(Reg a, Reg b) { return _mm256_add_pd(a, b); }
+        static Reg sub(Reg a, Reg b) { return _mm256_sub_pd(a, b); }
+        static Reg max(Reg a, Reg b) { return _mm256_max_pd(a, b); }
+        static Reg abs(Reg a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a); }
+        static Reg fmadd(Reg a, Reg b, Reg c) {
+#ifdef __FMA__
+            return _mm256_fmadd_pd(a, b, c);
+#else
+            return _mm256_add_pd(_mm256_mul_pd(a, b), c);
+#endif
+        }
+        static Reg sqrt(Reg a) { return _mm256_sqrt_pd(a); }
+    };
+
+    template <>
+    struct Vec<float> {
+        static constexpr std::size_t kWidth = 8;
+        using Reg = __m256;
+        static Reg load(const float *p) { return _mm256_loadu_ps(p); }
+        static void store(float *p, Reg a) { _mm256_storeu_ps(p, a); }
+        static Reg set1(float x) { return _mm256_set1_ps(x); }
+        static Reg add(Reg a, Reg b) { return _mm256_add_ps(a, b); }
+        static Reg sub(Reg a, Reg b) { return _mm256_sub_ps(a, b); }
+        static Reg max(Reg a, Reg b) { return _mm256_max_ps(a, b); }
+        static Reg abs(Reg a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+        static Reg fmadd(Reg a, Reg b, Reg c) {
+#ifdef __FMA__
+            return _mm256_fmadd_ps(a, b, c);
+#else
+            return _mm256_add_ps(_mm256_mul_ps(a, b), c);
+#endif
+        }
+        static Reg sqrt(Reg a) { return _mm256_sqrt_ps(a); }
+    };
+#endif
+
+    // acc[i] (op)= |row[i] - q|, where op is + for p == 1, + of the
+    // square for p == 2, and max for p == -1 (L^Inf).  Other values
+    // of p add |row[i] - q|^p.
+    template <int p, std::size_t n, typename S>
+    void lpAccumulate(S *acc, const S *row, S q) {
+        using V = Vec<S>;
+        std::size_t i = 0;
+        if constexpr (V::kWidth > 1 && (p == 1 || p == 2 || p == -1)) {
+            const auto vq = V::set1(q);
+            for ( ; i + V::kWidth <= n ; i += V::kWidth) {
+                auto d = V::abs(V::sub(V::load(row + i), vq));
+                auto a = V::load(acc + i);
+                if constexpr (p == 1)
+                    a = V::add(a, d);
+                else if constexpr (p == 2)
+                    a = V::fmadd(d, d, a);
+                else
+                    a = V::max(a, d);
+                V::store(acc + i, a);
+            }
+        }
+        for ( ; i<n ; ++i) {
+            S d = std::abs(row[i] - q);
+            if constexpr (p == 1)
+                acc[i] += d;
+            else if constexpr (p == 2)
+                acc[i] += d*d;
+            else if constexpr (p == -1)
+                acc[i] = std::max(acc[i], d);
+            else
+                acc[i] += std::pow(d, p);
+        }
+    }
+
+    // Converts the sums from lpAccumulate into distances.
+    template <int p, std::size_t n, typename S>
+    void lpFinish(S *acc) {
+        if constexpr (p == 2) {
+            using V = Vec<S>;
+            std::size_t i = 0;
+            if constexpr (V::kWidth > 1)
+                for ( ; i + V::kWidth <= n ; i += V::kWidth)
+                    V::store(acc + i, V::sqrt(V::load(acc + i)));
+            for ( ; i<n ; ++i)
+                acc[i] = std::sqrt(acc[i]);
+        } else if constexpr (p != 1 && p != -1) {
+            for (std::size_t i=0 ; i<n ; ++i)
+                acc[i] = std::pow(acc[i], 1/S(p));
+        }
+    }
+
+    // acc[i] += row[i] * q
+    template <std::size_t n, typename S>
+    void dotAccumulate(S *acc, const S *row, S q) {
+        using V = Vec<S>;
+        std::size_t i = 0;
+        if constexpr (V::kWidth > 1) {
+            const auto vq = V::set1(q);
+            for ( ; i + V::kWidth <= n ; i += V::kWidth)
+                V::store(acc + i, V::fmadd(V::load(row + i), vq, V::load(acc + i)));
+        }
+        for ( ; i<n ; ++i)
+            acc[i] += row[i] * q;
+    }
+
+    // out[i] += acc[i] * w
+    template <std::size_t n, typename S>
+    void scaleAdd(S *out, const S *acc, S w) {
+        using V = Vec<S>;
+        std::size_t i = 0;
+        if constexpr (V::kWidth > 1) {
+            const auto vw = V::set1(w);
+            for ( ; i + V::kWidth <= n ; i += V::kWidth)
+                V::store(out + i, V::fmadd(V::load(acc + i), vw, V::load(out + i)));
+        }
+        for ( ; i<n ; ++i)
+            out[i] += acc[i] * w;
+    }
+}
+
+#endif
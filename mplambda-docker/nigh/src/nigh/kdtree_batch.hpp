@@ -39,6 +39,7 @@
 
 #include "nigh_forward.hpp"
 #include "metric/space.hpp"
+#include "approximate.hpp"
 #include "impl/nearest_base.hpp"
 #include "impl/atom.hpp"
 #include "impl/near_set.hpp"
@@ -48,7 +49,14 @@
 #include "impl/kdtree_batch/branch.hpp"
 #include "impl/kdtree_batch/traversals.hpp"
 #include "impl/kdtree_batch/nearest.hpp"
+#include "impl/kdtree_batch/nearest_group.hpp"
+#include "impl/kdtree_batch/query_order.hpp"
 #include "impl/kdtree_batch/clear.hpp"
+#include "impl/kdtree_batch/bulk_insert.hpp"
+#include "impl/kdtree_batch/erase.hpp"
+#include "impl/kdtree_batch/relayout.hpp"
+#include "impl/kdtree_median/snapshot_forward.hpp"
+#include "impl/parallel.hpp"
 
 namespace unc::robotics::nigh {
 
@@ -58,10 +66,11 @@ namespace unc::robotics::nigh {
         typename KeyFn,
         typename Concurrency,
         std::size_t batchSize,
+        bool inlineKeys,
         typename Allocator>
-    class Nigh<T, Space, KeyFn, Concurrency, KDTreeBatch<batchSize>, Allocator>
+    class Nigh<T, Space, KeyFn, Concurrency, KDTreeBatch<batchSize, inlineKeys>, Allocator>
         : public impl::NearestBase<
-            Nigh<T, Space, KeyFn, Concurrency, KDTreeBatch<batchSize>, Allocator>>
+            Nigh<T, Space, KeyFn, Concurrency, KDTreeBatch<batchSize, inlineKeys>, Allocator>>
     {
         using Base = impl::NearestBase<Nigh>;
     public:
@@ -77,7 +86,7 @@ namespace unc::robotics::nigh {
         static constexpr bool concurrentReads = !std::is_same_v<Concurrency, NoThreadSafety>;
 
         using Node = impl::kdtree_batch::Node<T, Space, Concurrency>;
-        using Leaf = impl::kdtree_batch::Leaf<T, Space, Concurrency, batchSize>;
+        using Leaf = impl::kdtree_batch::Leaf<T, Space, Concurrency, batchSize, inlineKeys>;
 
         template <typename, typename, typename, typename>
         friend class impl::kdtree_batch::Traversal;
@@ -85,13 +94,84 @@ namespace unc::robotics::nigh {
         friend class impl::kdtree_batch::Nearest;
         template <typename>
         friend class impl::kdtree_batch::Clear;
+        template <typename>
+        friend class impl::kdtree_batch::BulkInsert;
+        template <typename>
+        friend class impl::kdtree_batch::Erase;
+        template <typename>
+        friend class impl::kdtree_batch::Relayout;
 
         impl::Atom<Node*, concurrentWrites> root_{nullptr};
         impl::Atom<std::size_t, concurrentWrites> size_{0};
 
         impl::Atom<unsigned, concurrentWrites> depth_{0};
 
+        // relayout() state.  The epoch is odd while a relayout is in
+        // progress, see settleRelayout().
+        impl::kdtree_batch::RelayoutArena relayoutArena_;
+        std::vector<impl::kdtree_batch::RetiredBranch<Nigh>> relayoutRetired_;
+        impl::Atom<unsigned, concurrentWrites> relayoutEpoch_{0};
+        impl::Atom<bool, concurrentWrites> relayoutBusy_{false};
+        impl::Atom<unsigned, concurrentWrites> relayoutLevels_{0};
+        impl::Atom<std::size_t, concurrentWrites> relayoutSize_{0};
+
+        static std::size_t firstRelayoutSize(unsigned levels) {
+            return batchSize << std::min(levels, 20u);
+        }
+
+        void relayoutIfDue(std::size_t size);
+        void releaseRetired();
+        void growPath(const Key& key);
+
+        // Concurrent inserts call this after adding their values,
+        // with the relayout epoch read before they started.  If a
+        // relayout overlapped the insert, the insert may have grown
+        // the region of a branch after it was copied, thus once the
+        // relayout is done, grow() is called to grow the regions on
+        // the new path of the inserted keys (see Relayout).
+        template <typename Grow>
+        void settleRelayout(unsigned epoch, const Grow& grow);
+
+        // All nodes are allocated and freed through the Allocator.
+        // A leaf replaced by a branch or a compacted leaf may still
+        // be traversed by concurrent readers, so concurrent trees
+        // keep it with its replacement and free both together.
+        // Non-concurrent trees free it right away.
+        template <typename B, typename ... Args>
+        B* allocBranch(Leaf *leaf, Args&& ... args) {
+            B *branch = Base::template alloc<B>(leaf, std::forward<Args>(args)...);
+            if constexpr (!concurrentWrites)
+                if (leaf)
+                    dealloc(leaf);
+            return branch;
+        }
+
+        void retire(Leaf *replacement, Leaf *leaf) {
+            if constexpr (concurrentWrites)
+                replacement->retire(leaf);
+            else
+                dealloc(leaf);
+        }
+
+        template <typename N>
+        void dealloc(N *node) {
+            if constexpr (std::is_same_v<N, Leaf>) {
+                while (node) {
+                    Leaf *retired = node->retired();
+                    Base::dealloc(node);
+                    node = retired;
+                }
+            } else {
+                if constexpr (concurrentWrites)
+                    dealloc(node->leaf());
+                Base::dealloc(node);
+            }
+        }
+
     public:
+        // default number of levels copied by relayout()
+        static constexpr unsigned kRelayoutLevels = 12;
+
         Nigh(const Nigh&) = delete;
         Nigh(Nigh&& other);
 
@@ -116,8 +196,31 @@ namespace unc::robotics::nigh {
         void clear();
         void insert(const T& value);
 
+        // Inserts all values in the range [first, last).  When the
+        // metric supports it, the values are added in a single pass
+        // that builds balanced subtrees where the range lands (see
+        // impl::kdtree_batch::BulkInsert), otherwise this is the
+        // same as inserting the values one at a time.
+        template <typename Iter>
+        void insert(Iter first, Iter last);
+
+        // Removes one element equal to value (as compared by
+        // operator==), returning true if one was found.  Removal
+        // leaves a tombstone in the element's leaf.  The leaf is
+        // compacted once half of it is removed, or when an insert
+        // would otherwise split it.  Safe to call concurrently with
+        // inserts and queries when Concurrency is Concurrent.
+        bool erase(const T& value);
+
+        // Removes all elements for which pred returns true, returning
+        // the number removed.
+        template <typename Pred>
+        std::size_t erase_if(Pred pred);
+
+        // The optional approx argument relaxes the search (see
+        // Approximate), by default the search is exact.
         template <typename K>
-        std::optional<std::pair<T, Distance>> nearest(const K& q) const;
+        std::optional<std::pair<T, Distance>> nearest(const K& q, const Approximate& approx = Approximate()) const;
 
         template <typename K>
         std::optional<T> nearest(const K& q, Distance* dist) const;
@@ -127,7 +230,70 @@ namespace unc::robotics::nigh {
             std::vector<Tuple, ResultAllocator>& nbh,
             const K& q,
             std::size_t k,
-            Distance maxRadius = std::numeric_limits<Distance>::infinity()) const;
+            Distance maxRadius = std::numeric_limits<Distance>::infinity(),
+            const Approximate& approx = Approximate()) const;
+
+        // Stores in nbh every value within radius of q (inclusive).
+        // The values are in traversal order unless sorted is set, in
+        // which case they are sorted by increasing distance.  This is
+        // cheaper than nearest(nbh, q, k, radius) with a large k,
+        // since the results are appended without maintaining a heap.
+        template <typename Tuple, typename K, typename ResultAllocator>
+        void nearest_radius(
+            std::vector<Tuple, ResultAllocator>& nbh,
+            const K& q,
+            Distance radius,
+            bool sorted = false) const;
+
+        // Searches for the k-nearest neighbors of each key in queries,
+        // storing the result for queries[i] in results[i], as
+        // nearest() would.  The queries are ordered by the region of
+        // the tree that contains them (see QueryOrder).  In L^p spaces
+        // they are then searched in a single traversal of the tree
+        // that shares node visits between queries (see NearestGroup);
+        // in other spaces they are searched one after another in that
+        // order.  When nThreads > 1, the ordered queries are split
+        // into contiguous blocks searched by separate threads.
+        template <typename Keys, typename Tuple, typename ResultAllocator, typename ResultsAllocator>
+        void nearest_batch(
+            const Keys& queries,
+            std::vector<std::vector<Tuple, ResultAllocator>, ResultsAllocator>& results,
+            std::size_t k,
+            Distance maxRadius = std::numeric_limits<Distance>::infinity(),
+            unsigned nThreads = 1) const;
+
+        // Copies the top levels of the tree into a contiguous arena,
+        // laid out in breadth-first order, and returns the number of
+        // branches copied.  As a tree grows by single inserts, its
+        // branches are scattered over the heap in insertion order,
+        // thus the upper levels that every search visits cost a
+        // cache miss per level.  After a relayout, the upper levels
+        // share a few cache lines and pages.  Only levels whose
+        // branches have no leaf children are copied, the lower levels
+        // are left as is and continue to grow.  The replaced branches
+        // are kept until clear() (or released immediately when
+        // Concurrency is NoThreadSafety).
+        //
+        // Safe to call concurrently with queries (and with inserts
+        // and erases when Concurrency is Concurrent).  With
+        // ConcurrentRead it is a write operation.  Returns 0 without
+        // copying anything if another relayout is in progress.
+        std::size_t relayout(unsigned levels = kRelayoutLevels);
+
+        // Enables automatic relayouts of the specified number of
+        // levels.  The first relayout occurs once the tree is large
+        // enough to fill the levels, then again each time the size
+        // doubles.  The relayout runs in the insert that crosses the
+        // threshold, while other writers continue.  0 (the default)
+        // disables automatic relayouts.
+        void setRelayoutLevels(unsigned levels) {
+            relayoutSize_.store(std::max(2*size(), firstRelayoutSize(levels)), std::memory_order_relaxed);
+            relayoutLevels_.store(levels, std::memory_order_relaxed);
+        }
+
+        unsigned relayoutLevels() const {
+            return relayoutLevels_.load(std::memory_order_relaxed);
+        }
 
         template <typename Fn>
         void visit(const Fn& fn) const {
@@ -143,7 +309,9 @@ namespace unc::robotics::nigh {
                     } else {
                         const Leaf *leaf = static_cast<const Leaf*>(node);
                         int size = std::abs(leaf->size());
-                        std::for_each(leaf->elements(), leaf->elements() + size, fn_);
+                        for (int i=0 ; i<size ; ++i)
+                            if (!leaf->isRemoved(i))
+                                fn_(leaf->elements()[i]);
                     }
                 }
             };
@@ -157,43 +325,141 @@ namespace unc::robotics::nigh {
             visit([&] (const T& t) { result.push_back(t); });
             return result;
         }
+
+        // Writes a frozen snapshot of the current values, that may be
+        // loaded (or mmap'd) and searched with KDTreeSnapshot.  The
+        // snapshot is a median kd-tree rebuilt from the values, since
+        // the batch tree's concurrent layout is not relocatable.
+        // indexOf(value) returns the index that the snapshot stores
+        // for the value, which must fit in Index.  Requires
+        // <nigh/kdtree_snapshot.hpp>.
+        template <typename Index = std::uint32_t, typename IndexOf>
+        void save(std::ostream& out, const IndexOf& indexOf) const {
+            std::vector<T> values = list();
+            impl::kdtree_median::writeSnapshot<Index>(
+                out, Base::metricSpace(), values.size(),
+                [&] (std::size_t i) -> decltype(auto) { return Base::getKey(values[i]); },
+                [&] (std::size_t i) { return indexOf(values[i]); });
+        }
     };
 
-    template <typename T, typename Space, typename KeyFn, typename Concurrency, std::size_t batchSize, typename Allocator>
-    Nigh<T, Space, KeyFn, Concurrency, KDTreeBatch<batchSize>, Allocator>::Nigh(Nigh&& other)
+    template <typename T, typename Space, typename KeyFn, typename Concurrency, std::size_t batchSize, bool inlineKeys, typename Allocator>
+    Nigh<T, Space, KeyFn, Concurrency, KDTreeBatch<batchSize, inlineKeys>, Allocator>::Nigh(Nigh&& other)
         : root_(other.root_.exchange(nullptr))
         , size_(other.size_.exchange(0))
         , depth_(other.depth_.exchange(0))
+        , relayoutArena_(std::move(other.relayoutArena_))
+        , relayoutRetired_(std::move(other.relayoutRetired_))
+        , relayoutLevels_(other.relayoutLevels_.load(std::memory_order_relaxed))
+        , relayoutSize_(other.relayoutSize_.load(std::memory_order_relaxed))
     {
     }
 
-    template <typename T, typename Space, typename KeyFn, typename Concurrency, std::size_t batchSize, typename Allocator>
-    Nigh<T, Space, KeyFn, Concurrency, KDTreeBatch<batchSize>, Allocator>::~Nigh() {
+    template <typename T, typename Space, typename KeyFn, typename Concurrency, std::size_t batchSize, bool inlineKeys, typename Allocator>
+    Nigh<T, Space, KeyFn, Concurrency, KDTreeBatch<batchSize, inlineKeys>, Allocator>::~Nigh() {
         clear();
     }
 
-    template <typename T, typename Space, typename KeyFn, typename Concurrency, std::size_t batchSize, typename Allocator>
-    void Nigh<T, Space, KeyFn, Concurrency, KDTreeBatch<batchSize>, Allocator>::clear() {
+    template <typename T, typename Space, typename KeyFn, typename Concurrency, std::size_t batchSize, bool inlineKeys, typename Allocator>
+    void Nigh<T, Space, KeyFn, Concurrency, KDTreeBatch<batchSize, inlineKeys>, Allocator>::clear() {
         size_.store(0, std::memory_order_relaxed);
         depth_.store(0, std::memory_order_relaxed);
         if (Node *root = root_.exchange(nullptr, std::memory_order_release))
             (impl::kdtree_batch::Clear<Nigh>{*this})(root);
+        releaseRetired();
+        relayoutArena_.clear();
+        relayoutSize_.store(firstRelayoutSize(relayoutLevels()), std::memory_order_relaxed);
     }
 
-    template <typename T, typename Space, typename KeyFn, typename Concurrency, std::size_t batchSize, typename Allocator>
+    template <typename T, typename Space, typename KeyFn, typename Concurrency, std::size_t batchSize, bool inlineKeys, typename Allocator>
+    std::size_t Nigh<T, Space, KeyFn, Concurrency, KDTreeBatch<batchSize, inlineKeys>, Allocator>::relayout(unsigned levels) {
+        if (relayoutBusy_.exchange(true, std::memory_order_acquire))
+            return 0;
+
+        if constexpr (concurrentWrites) {
+            // order the start of the relayout before its reads of
+            // the regions, against an insert's growth of the regions
+            // before it reads the epoch.
+            relayoutEpoch_.fetch_add(1, std::memory_order_seq_cst);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+
+        std::size_t count = impl::kdtree_batch::Relayout<Nigh>(*this, levels)(&root_);
+
+        if constexpr (concurrentWrites)
+            relayoutEpoch_.fetch_add(1, std::memory_order_release);
+
+        if constexpr (!concurrentReads)
+            releaseRetired();
+
+        relayoutBusy_.store(false, std::memory_order_release);
+        return count;
+    }
+
+    template <typename T, typename Space, typename KeyFn, typename Concurrency, std::size_t batchSize, bool inlineKeys, typename Allocator>
+    void Nigh<T, Space, KeyFn, Concurrency, KDTreeBatch<batchSize, inlineKeys>, Allocator>::relayoutIfDue(std::size_t size) {
+        unsigned levels = relayoutLevels_.load(std::memory_order_relaxed);
+        if (levels == 0)
+            return;
+
+        // only the insert that moves the threshold runs the relayout
+        std::size_t due = relayoutSize_.load(std::memory_order_relaxed);
+        if (size >= due && relayoutSize_.compare_exchange_strong(due, 2*size, std::memory_order_relaxed))
+            relayout(levels);
+    }
+
+    template <typename T, typename Space, typename KeyFn, typename Concurrency, std::size_t batchSize, bool inlineKeys, typename Allocator>
+    void Nigh<T, Space, KeyFn, Concurrency, KDTreeBatch<batchSize, inlineKeys>, Allocator>::releaseRetired() {
+        for (const auto& retired : relayoutRetired_)
+            if (!relayoutArena_.release(retired.node_))
+                retired.release_(*this, retired.node_);
+        relayoutRetired_.clear();
+        relayoutArena_.reclaim();
+    }
+
+    template <typename T, typename Space, typename KeyFn, typename Concurrency, std::size_t batchSize, bool inlineKeys, typename Allocator>
+    void Nigh<T, Space, KeyFn, Concurrency, KDTreeBatch<batchSize, inlineKeys>, Allocator>::growPath(const Key& key) {
+        impl::kdtree_batch::Traversal<Nigh> traversal(Base::metricSpace());
+        for (Node *node = root_.load(std::memory_order_acquire) ; node && !node->isLeaf() ; ) {
+            traversal.grow(Base::metricSpace(), node->region(), key);
+            node = traversal.follow(Base::metricSpace(), node, node->axis(), key).load(std::memory_order_acquire);
+        }
+    }
+
+    template <typename T, typename Space, typename KeyFn, typename Concurrency, std::size_t batchSize, bool inlineKeys, typename Allocator>
+    template <typename Grow>
+    void Nigh<T, Space, KeyFn, Concurrency, KDTreeBatch<batchSize, inlineKeys>, Allocator>::settleRelayout(unsigned epoch, const Grow& grow) {
+        for (;;) {
+            // pairs with the fence in relayout(), either the relayout
+            // copied the regions after this insert grew them, or
+            // this load sees the relayout's epoch.
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            unsigned current = relayoutEpoch_.load(std::memory_order_acquire);
+            if (current == epoch && (current & 1) == 0)
+                return;
+            epoch = current;
+            if (current & 1)
+                impl::relax_cpu();
+            else
+                grow();
+        }
+    }
+
+    template <typename T, typename Space, typename KeyFn, typename Concurrency, std::size_t batchSize, bool inlineKeys, typename Allocator>
     template <typename K>
-    auto Nigh<T, Space, KeyFn, Concurrency, KDTreeBatch<batchSize>, Allocator>::nearest(const K& q) const
+    auto Nigh<T, Space, KeyFn, Concurrency, KDTreeBatch<batchSize, inlineKeys>, Allocator>::nearest(const K& q, const Approximate& approx) const
         -> std::optional<std::pair<T, Distance>>
     {
         impl::kdtree_batch::Nearest<Nigh, impl::Near1Set<T, Distance>> nearest(*this, q);
+        nearest.approximate(approx);
         if (Node *root = root_.load(std::memory_order_acquire))
             nearest(root);
         return nearest.result();
     }
 
-    template <typename T, typename Space, typename KeyFn, typename Concurrency, std::size_t batchSize, typename Allocator>
+    template <typename T, typename Space, typename KeyFn, typename Concurrency, std::size_t batchSize, bool inlineKeys, typename Allocator>
     template <typename K>
-    auto Nigh<T, Space, KeyFn, Concurrency, KDTreeBatch<batchSize>, Allocator>::nearest(const K& q, Distance *dist) const
+    auto Nigh<T, Space, KeyFn, Concurrency, KDTreeBatch<batchSize, inlineKeys>, Allocator>::nearest(const K& q, Distance *dist) const
         -> std::optional<T>
     {
         impl::kdtree_batch::Nearest<Nigh, impl::Near1Set<T, Distance>> nearest(*this, q);
@@ -202,22 +468,82 @@ namespace unc::robotics::nigh {
         return nearest.result(dist);
     }
 
-    template <typename T, typename Space, typename KeyFn, typename Concurrency, std::size_t batchSize, typename Allocator>
+    template <typename T, typename Space, typename KeyFn, typename Concurrency, std::size_t batchSize, bool inlineKeys, typename Allocator>
     template <typename Tuple, typename K, typename ResultAllocator>
-    void Nigh<T, Space, KeyFn, Concurrency, KDTreeBatch<batchSize>, Allocator>::nearest(
+    void Nigh<T, Space, KeyFn, Concurrency, KDTreeBatch<batchSize, inlineKeys>, Allocator>::nearest(
         std::vector<Tuple, ResultAllocator>& nbh,
         const K& q,
         std::size_t k,
-        Distance maxRadius) const
+        Distance maxRadius,
+        const Approximate& approx) const
     {
         impl::kdtree_batch::Nearest<Nigh, impl::NearKSet<Tuple, Distance, ResultAllocator>> nearest(*this, q, nbh, k, maxRadius);
+        nearest.approximate(approx);
         if (Node *root = root_.load(std::memory_order_acquire))
             nearest(root);
         nearest.sort();
     }
 
-    template <typename T, typename Space, typename KeyFn, typename Concurrency, std::size_t batchSize, typename Allocator>
-    void Nigh<T, Space, KeyFn, Concurrency, KDTreeBatch<batchSize>, Allocator>::insert(const T& q) {
+    template <typename T, typename Space, typename KeyFn, typename Concurrency, std::size_t batchSize, bool inlineKeys, typename Allocator>
+    template <typename Tuple, typename K, typename ResultAllocator>
+    void Nigh<T, Space, KeyFn, Concurrency, KDTreeBatch<batchSize, inlineKeys>, Allocator>::nearest_radius(
+        std::vector<Tuple, ResultAllocator>& nbh,
+        const K& q,
+        Distance radius,
+        bool sorted) const
+    {
+        impl::kdtree_batch::Nearest<Nigh, impl::NearRadiusSet<Tuple, Distance, ResultAllocator>> nearest(*this, q, nbh, radius);
+        if (Node *root = root_.load(std::memory_order_acquire))
+            nearest(root);
+        if (sorted)
+            nearest.sort();
+    }
+
+    template <typename T, typename Space, typename KeyFn, typename Concurrency, std::size_t batchSize, bool inlineKeys, typename Allocator>
+    template <typename Keys, typename Tuple, typename ResultAllocator, typename ResultsAllocator>
+    void Nigh<T, Space, KeyFn, Concurrency, KDTreeBatch<batchSize, inlineKeys>, Allocator>::nearest_batch(
+        const Keys& queries,
+        std::vector<std::vector<Tuple, ResultAllocator>, ResultsAllocator>& results,
+        std::size_t k,
+        Distance maxRadius,
+        unsigned nThreads) const
+    {
+        results.resize(queries.size());
+
+        Node *root = root_.load(std::memory_order_acquire);
+        if (root == nullptr) {
+            for (auto& nbh : results)
+                nbh.clear();
+            return;
+        }
+
+        std::vector<std::size_t> order = impl::kdtree_batch::QueryOrder<Nigh>(*this, queries).order(root);
+
+        using NearSet = impl::NearKSet<Tuple, Distance, ResultAllocator>;
+        using NearestGroup = impl::kdtree_batch::NearestGroup<Nigh, NearSet>;
+
+        impl::parallelRanges(order.size(), nThreads, [&] (std::size_t first, std::size_t last) {
+            if constexpr (NearestGroup::kSupported) {
+                NearestGroup group(*this, last - first);
+                for (std::size_t i = first ; i < last ; ++i)
+                    group.add(queries[order[i]], results[order[i]], k, maxRadius);
+                group(root);
+                group.sort();
+            } else {
+                for (std::size_t i = first ; i < last ; ++i) {
+                    std::size_t q = order[i];
+                    impl::kdtree_batch::Nearest<Nigh, NearSet> nearest(
+                        *this, queries[q], results[q], k, maxRadius);
+                    nearest(root);
+                    nearest.sort();
+                }
+            }
+        });
+    }
+
+    template <typename T, typename Space, typename KeyFn, typename Concurrency, std::size_t batchSize, bool inlineKeys, typename Allocator>
+    void Nigh<T, Space, KeyFn, Concurrency, KDTreeBatch<batchSize, inlineKeys>, Allocator>::insert(const T& q) {
+        [[maybe_unused]] unsigned epoch = relayoutEpoch_.load(std::memory_order_acquire);
         auto* p = &root_;
 
         impl::kdtree_batch::Traversal<Nigh> traversal(Base::metricSpace());
@@ -228,15 +554,14 @@ namespace unc::robotics::nigh {
             Node *node = p->load(std::memory_order_acquire);
 
             if (node == nullptr) {
-                // TODO: allocator!
-                Leaf *leaf = new Leaf(Base::metricSpace(), traversal, q, key);
+                Leaf *leaf = Base::template allocWithSpace<Leaf>(traversal, q, key);
                 if (p->compare_exchange_strong(
                         node, static_cast<Node*>(leaf),
                         std::memory_order_release, std::memory_order_relaxed)) {
                     //std::cout << "new leaf" << std::endl;
                     break;
                 }
-                delete leaf;
+                dealloc(leaf);
             }
 
             if (node->isLeaf()) {
@@ -249,7 +574,7 @@ namespace unc::robotics::nigh {
 
                 if (n < static_cast<int>(batchSize)) {
                     traversal.grow(Base::metricSpace(), leaf->region(), key);
-                    leaf->put(n, q);
+                    leaf->store(n, q, key);
 
                     // std::cout << "inserted value at index " << n << std::endl;
 
@@ -258,6 +583,26 @@ namespace unc::robotics::nigh {
                     break;
                 }
 
+                if (leaf->anyRemoved()) {
+                    // compact the leaf instead of splitting it.  The
+                    // replacement holds the live elements and the new
+                    // one, and takes ownership of the old leaf.
+                    std::array<const T*, batchSize + 1> ptrs;
+                    std::size_t live = 0;
+                    for (int i=0 ; i<n ; ++i)
+                        if (!leaf->isRemoved(i))
+                            ptrs[live++] = leaf->elements() + i;
+                    ptrs[live++] = &q;
+
+                    Leaf *compact = Base::template allocWithSpace<Leaf>(
+                        traversal, Base::keyFn(), ptrs.begin(), ptrs.begin() + live);
+                    retire(compact, leaf);
+
+                    // linearization point
+                    p->store(compact, std::memory_order_release);
+                    break;
+                }
+
                 unsigned axis;
                 // auto d =
                 traversal.selectAxis(*this, Base::metricSpace(), leaf, key, &axis);
@@ -272,12 +617,137 @@ namespace unc::robotics::nigh {
             p = &traversal.follow(Base::metricSpace(), node, node->axis(), key);
         }
 
-        size_.fetch_add(static_cast<std::size_t>(1), std::memory_order_relaxed);
+        std::size_t size = size_.fetch_add(static_cast<std::size_t>(1), std::memory_order_relaxed) + 1;
 
         for (unsigned curDepth = depth_.load(std::memory_order_relaxed) ;
              curDepth < depth &&
             !depth_.compare_exchange_weak(curDepth, depth, std::memory_order_relaxed) ;)
             ;
+
+        if constexpr (concurrentWrites)
+            settleRelayout(epoch, [&] { growPath(key); });
+
+        relayoutIfDue(size);
+    }
+
+    template <typename T, typename Space, typename KeyFn, typename Concurrency, std::size_t batchSize, bool inlineKeys, typename Allocator>
+    bool Nigh<T, Space, KeyFn, Concurrency, KDTreeBatch<batchSize, inlineKeys>, Allocator>::erase(const T& value) {
+        for (;;) {
+            impl::kdtree_batch::Erase<Nigh> search(*this, value);
+            search(root_);
+
+            Leaf *leaf = search.leaf();
+            if (leaf == nullptr)
+                return false;
+
+            // Lock the leaf so that the tombstone cannot be lost to
+            // a concurrent split or compaction.  A leaf that stays
+            // locked has been replaced, so we search again.
+            int n = leaf->size();
+            if (concurrentWrites && (n < 0 || !leaf->tryLock(n))) {
+                impl::relax_cpu();
+                continue;
+            }
+
+            // if another thread removed the element between the
+            // search and the lock, search for another copy.
+            if (!leaf->markRemoved(search.index())) {
+                leaf->setSize(n, std::memory_order_release);
+                continue;
+            }
+
+            size_.fetch_sub(static_cast<std::size_t>(1), std::memory_order_relaxed);
+
+            auto* p = search.slot();
+            if (p == nullptr || leaf->removedCount() * 2 < n) {
+                leaf->setSize(n, std::memory_order_release);
+                return true;
+            }
+
+            // Replace the leaf with one holding only the live
+            // elements so that its region shrinks to fit them.  The
+            // old leaf stays locked.  A leaf cannot be empty, so if
+            // nothing is left it keeps the removed element, still
+            // marked removed, which reduces the region to a point.
+            impl::kdtree_batch::Traversal<Nigh> traversal(Base::metricSpace());
+            std::array<const T*, batchSize> ptrs;
+            std::size_t live = 0;
+            for (int i=0 ; i<n ; ++i)
+                if (!leaf->isRemoved(i))
+                    ptrs[live++] = leaf->elements() + i;
+
+            Leaf *compact;
+            if (live) {
+                compact = Base::template allocWithSpace<Leaf>(
+                    traversal, Base::keyFn(), ptrs.begin(), ptrs.begin() + live);
+            } else {
+                ptrs[0] = leaf->elements() + search.index();
+                compact = Base::template allocWithSpace<Leaf>(
+                    traversal, Base::keyFn(), ptrs.begin(), ptrs.begin() + 1);
+                compact->markRemoved(0);
+            }
+            retire(compact, leaf);
+
+            // linearization point
+            p->store(compact, std::memory_order_release);
+            return true;
+        }
+    }
+
+    template <typename T, typename Space, typename KeyFn, typename Concurrency, std::size_t batchSize, bool inlineKeys, typename Allocator>
+    template <typename Pred>
+    std::size_t Nigh<T, Space, KeyFn, Concurrency, KDTreeBatch<batchSize, inlineKeys>, Allocator>::erase_if(Pred pred) {
+        std::vector<T> matches;
+        visit([&] (const T& t) {
+                if (pred(t))
+                    matches.push_back(t);
+            });
+
+        std::size_t count = 0;
+        for (const T& t : matches)
+            count += erase(t);
+        return count;
+    }
+
+    template <typename T, typename Space, typename KeyFn, typename Concurrency, std::size_t batchSize, bool inlineKeys, typename Allocator>
+    template <typename Iter>
+    void Nigh<T, Space, KeyFn, Concurrency, KDTreeBatch<batchSize, inlineKeys>, Allocator>::insert(Iter first, Iter last) {
+        using BulkInsert = impl::kdtree_batch::BulkInsert<Nigh>;
+
+        if constexpr (!BulkInsert::kSupported) {
+            for ( ; first != last ; ++first)
+                insert(*first);
+        } else {
+            std::vector<const T*> ptrs;
+            for ( ; first != last ; ++first) {
+                assert(Space::isValid(Base::getKey(*first)));
+                ptrs.push_back(&*first);
+            }
+
+            if (ptrs.empty())
+                return;
+
+            [[maybe_unused]] unsigned epoch = relayoutEpoch_.load(std::memory_order_acquire);
+            BulkInsert bulk(*this);
+            bulk(&root_, ptrs.begin(), ptrs.end(), 1);
+
+            std::size_t size = size_.fetch_add(ptrs.size(), std::memory_order_relaxed) + ptrs.size();
+
+            unsigned depth = bulk.depth();
+            for (unsigned curDepth = depth_.load(std::memory_order_relaxed) ;
+                 curDepth < depth &&
+                !depth_.compare_exchange_weak(curDepth, depth, std::memory_order_relaxed) ;)
+                ;
+
+            if constexpr (concurrentWrites) {
+                settleRelayout(epoch, [&] {
+                        for (const T *t : ptrs)
+                            growPath(Base::getKey(*t));
+                    });
+            }
+
+            relayoutIfDue(size);
+        }
     }
 }
 
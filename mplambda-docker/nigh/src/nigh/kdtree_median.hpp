@@ -39,16 +39,24 @@
 
 #include "nigh_forward.hpp"
 #include "metric/space.hpp"
+#include "approximate.hpp"
 #include "impl/nearest_base.hpp"
 #include "impl/atom.hpp"
 #include "impl/bits.hpp"
 #include "impl/near_set.hpp"
 #include "impl/block_allocator.hpp"
-#include "impl/locked_nearest.hpp"
+#include "impl/epoch.hpp"
+#include "impl/parallel.hpp"
 #include "impl/kdtree_median/node.hpp"
 #include "impl/kdtree_median/nearest.hpp"
+#include "impl/kdtree_median/nearest_group.hpp"
 #include "impl/kdtree_median/builder.hpp"
+#include "impl/kdtree_median/snapshot.hpp"
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <memory>
+#include <mutex>
 #include <utility>
 #include <iostream> // TODO: REMOVE!
 
@@ -86,10 +94,16 @@ namespace unc::robotics::nigh {
         Blocks blocks_;
         std::vector<Root> roots_;
         Values values_;
+        unsigned buildThreads_{1};
 
         friend class impl::kdtree_median::Builder<Nigh>;
         template <class Tree, class Set>
         friend class impl::kdtree_median::Nearest;
+
+        // blocks for the subtrees of a parallel build
+        Blocks newBlocks() const {
+            return Blocks(Base::get_allocator());
+        }
         
         void addOne() {
             std::size_t s = values_.size();
@@ -109,7 +123,7 @@ namespace unc::robotics::nigh {
                 // std::clog << "building tree " << newTreeSize << std::endl;
 
                 // Builder builder{Base::metricSpace(), Base::keyFn(), blocks_}
-                Builder builder(*this);
+                Builder builder(*this, buildThreads_);
                 auto mark = blocks_.mark();
                 Node *node = builder(values_.end() - newTreeSize, values_.end());
                 roots_.emplace_back(node, mark);
@@ -130,6 +144,25 @@ namespace unc::robotics::nigh {
             assert(rootIt == roots_.end());
             nearest.insert(elemIt, values_.end());
         }
+
+        // scans a block of searches, tree-major, so that each tree is
+        // searched by the whole block before moving on to the next.
+        template <class NearestIter>
+        void scan(NearestIter first, NearestIter last) const {
+            auto rootIt = roots_.begin();
+            auto elemIt = values_.begin();
+            for (std::size_t remaining = size() ; remaining >= minTreeSize ; ++rootIt) {
+                std::size_t treeSize = 1 << impl::log2(remaining);
+                for (NearestIter it = first ; it != last ; ++it)
+                    (*it)(rootIt->first, elemIt, elemIt + treeSize);
+                elemIt += treeSize;
+                remaining &= ~treeSize;
+            }
+
+            assert(rootIt == roots_.end());
+            for (NearestIter it = first ; it != last ; ++it)
+                it->insert(elemIt, values_.end());
+        }
         
     public:
         Nigh(const Nigh&) = delete;
@@ -138,6 +171,7 @@ namespace unc::robotics::nigh {
             , blocks_(std::move(other.blocks_))
             , roots_(std::move(other.roots_))
             , values_(std::move(other.values_))
+            , buildThreads_(other.buildThreads_)
         {
         }
 
@@ -146,6 +180,8 @@ namespace unc::robotics::nigh {
             const KeyFn& member = KeyFn(),
             Allocator allocator = Allocator())
             : Base(metric, member, allocator)
+            , blocks_(allocator)
+            , values_(allocator)
         {
         }
 
@@ -153,15 +189,30 @@ namespace unc::robotics::nigh {
             return values_.size();
         }
 
+        // Sets the number of threads used to build each tree of the
+        // forest.  Only large trees (such as the rebuilds when the
+        // size reaches a power of two) are split across threads.  The
+        // default of 1 builds on the inserting thread.
+        void setBuildThreads(unsigned nThreads) {
+            buildThreads_ = std::max(nThreads, 1u);
+        }
+
+        unsigned buildThreads() const {
+            return buildThreads_;
+        }
+
         void insert(const T& value) {
             // std::clog << "insert" << std::endl;
             values_.push_back(value);
             addOne();
         }
 
+        // The optional approx argument relaxes the search (see
+        // Approximate), by default the search is exact.
         template <typename K>
-        std::optional<std::pair<T, Distance>> nearest(const K& q) const {
+        std::optional<std::pair<T, Distance>> nearest(const K& q, const Approximate& approx = Approximate()) const {
             impl::kdtree_median::Nearest<Nigh, impl::Near1Set<T, Distance>> nearest(*this, q);
+            nearest.approximate(approx);
             scan(nearest);
             return nearest.result();
         }
@@ -178,37 +229,397 @@ namespace unc::robotics::nigh {
             std::vector<Tuple, ResultAllocator>& nbh,
             const K& q,
             std::size_t k,
-            Distance maxRadius = std::numeric_limits<Distance>::infinity()) const
+            Distance maxRadius = std::numeric_limits<Distance>::infinity(),
+            const Approximate& approx = Approximate()) const
         {
             impl::kdtree_median::Nearest<Nigh, impl::NearKSet<Tuple, Distance, ResultAllocator>>
                 nearest(*this, q, nbh, k, maxRadius);
-            
+            nearest.approximate(approx);
+
             scan(nearest);
             nearest.sort();
         }
 
+        // Searches for the k-nearest neighbors of each key in queries,
+        // storing the result for queries[i] in results[i].  Each tree
+        // of the forest is searched by a block of queries at a time,
+        // keeping the tree in cache between queries.  In L^p spaces
+        // the block searches each tree in a single traversal that
+        // shares node visits between queries (see NearestGroup).  When
+        // nThreads > 1, the queries are split into contiguous blocks
+        // searched by separate threads.
+        template <typename Keys, typename Tuple, typename ResultAllocator, typename ResultsAllocator>
+        void nearest_batch(
+            const Keys& queries,
+            std::vector<std::vector<Tuple, ResultAllocator>, ResultsAllocator>& results,
+            std::size_t k,
+            Distance maxRadius = std::numeric_limits<Distance>::infinity(),
+            unsigned nThreads = 1) const
+        {
+            using NearSet = impl::NearKSet<Tuple, Distance, ResultAllocator>;
+            using Nearest = impl::kdtree_median::Nearest<Nigh, NearSet>;
+            using NearestGroup = impl::kdtree_median::NearestGroup<Nigh, NearSet>;
+            results.resize(queries.size());
+            impl::parallelRanges(queries.size(), nThreads, [&] (std::size_t first, std::size_t last) {
+                if constexpr (NearestGroup::kSupported) {
+                    NearestGroup group(last - first);
+                    for (std::size_t i = first ; i < last ; ++i)
+                        group.add(*this, queries[i], results[i], k, maxRadius);
+                    scan(group);
+                    group.sort();
+                } else {
+                    std::vector<Nearest> block;
+                    block.reserve(last - first);
+                    for (std::size_t i = first ; i < last ; ++i)
+                        block.emplace_back(*this, queries[i], results[i], k, maxRadius);
+                    scan(block.begin(), block.end());
+                    for (Nearest& nearest : block)
+                        nearest.sort();
+                }
+            });
+        }
+
         std::vector<T> list() const {
             return values_; // this is a copy!
         }
+
+        // Writes a snapshot of this structure that may be loaded (or
+        // mmap'd) and searched with KDTreeSnapshot.  indexOf(value)
+        // returns the index that the snapshot stores for the value,
+        // which must fit in Index.
+        template <typename Index = std::uint32_t, typename IndexOf>
+        void save(std::ostream& out, const IndexOf& indexOf) const {
+            impl::kdtree_median::writeSnapshot<Index>(
+                out, Base::metricSpace(), values_.size(),
+                [&] (std::size_t i) -> decltype(auto) { return Base::getKey(values_[i]); },
+                [&] (std::size_t i) { return indexOf(values_[i]); });
+        }
     };
 
-    // Specialization for R/W concurrency.  This version is a
-    // read/write locked version of ConcurrentRead
+    // Specialization for R/W concurrency.  Readers never block, and
+    // never write shared memory.  Each tree of the forest is
+    // immutable once built, and has its own copy of its values.  The
+    // trees and the values not yet in a tree (the tail) are published
+    // together as a Version.  An insert appends to the tail (which
+    // has room for minTreeSize values, and thus never moves), and
+    // when the tail is full, builds the merged tree in new memory and
+    // publishes a new Version (copy-on-write).  Readers pin an epoch
+    // (see impl::Epoch) while they search a Version, and the writer
+    // frees the replaced Versions and trees once no reader is pinned
+    // to an epoch in which they were reachable.  Inserts are
+    // serialized by a mutex that readers never take.
     template <
         typename T,
         typename Space,
         typename KeyFn,
         std::size_t minTreeSize,
+        std::size_t linearSearchSize,
         typename Allocator>
-    class Nigh<T, Space, KeyFn, Concurrent, KDTreeMedian<minTreeSize>, Allocator>
-        : public impl::LockedNearest<
-            Nigh<T, Space, KeyFn, ConcurrentRead, KDTreeMedian<minTreeSize>, Allocator>>
+    class Nigh<T, Space, KeyFn, Concurrent, KDTreeMedian<minTreeSize, linearSearchSize>, Allocator>
+        : public impl::NearestBase<
+            Nigh<T, Space, KeyFn, Concurrent, KDTreeMedian<minTreeSize, linearSearchSize>, Allocator>>
     {
-        using Base = impl::LockedNearest<
-            Nigh<T, Space, KeyFn, ConcurrentRead, KDTreeMedian<minTreeSize>, Allocator>>;
-        
+        using Base = impl::NearestBase<Nigh>;
     public:
-        using Base::Base;
+        using Key = typename Base::Key;
+        using Metric = typename Base::Metric;
+        using Distance = typename Base::Distance;
+
+    private:
+        using Blocks = impl::BlockAllocator<0, Allocator>;
+        using Builder = impl::kdtree_median::Builder<Nigh>;
+        using Node = impl::kdtree_median::Node;
+        using Values = std::vector<T, Allocator>;
+
+        static_assert(minTreeSize > 0, "minTreeSize must be positive");
+
+        // a tree of the forest over its own values.
+        struct Tree {
+            Blocks blocks_;
+            Values values_;
+            Node *root_{nullptr};
+
+            explicit Tree(const Allocator& allocator)
+                : blocks_(allocator)
+                , values_(allocator)
+            {
+            }
+        };
+
+        // the values not yet in a tree.  values_ is reserved to
+        // minTreeSize on construction, thus appends never move the
+        // values that readers may be scanning.  Readers only access
+        // the first size_ values of data_.
+        struct Tail {
+            Values values_;
+            const T *data_;
+            std::atomic<std::size_t> size_{0};
+
+            explicit Tail(const Allocator& allocator)
+                : values_(allocator)
+            {
+                values_.reserve(minTreeSize);
+                data_ = values_.data();
+            }
+        };
+
+        // the immutable part of a Version, trees_ is ordered largest
+        // to smallest, as in the ConcurrentRead forest.  The Trees
+        // are shared with the Versions before and after, and are
+        // owned by the Nigh.
+        struct Version {
+            std::vector<Tree*> trees_;
+            Tail tail_;
+
+            explicit Version(const Allocator& allocator)
+                : tail_(allocator)
+            {
+            }
+        };
+
+        struct Delete {
+            template <class U>
+            void operator() (U *p) const {
+                delete p;
+            }
+        };
+
+        std::atomic<Version*> current_;
+        std::atomic<std::size_t> size_{0};
+
+        // the remaining members are only accessed by the writer,
+        // holding writeMutex_.  A rebuild retires the replaced
+        // Version, and the Trees that were merged into the new one.
+        std::mutex writeMutex_;
+        unsigned buildThreads_{1};
+        impl::EpochRetireList<Version, Delete> retiredVersions_;
+        impl::EpochRetireList<Tree, Delete> retiredTrees_;
+
+        friend class impl::kdtree_median::Builder<Nigh>;
+        template <class Tree_, class Set>
+        friend class impl::kdtree_median::Nearest;
+
+        Blocks newBlocks() const {
+            return Blocks(Base::get_allocator());
+        }
+
+        // builds a tree of the values of the trees [first, version
+        // trees end) and the full tail of version.
+        Tree* merge(const Version& version, std::size_t first, std::size_t treeSize) {
+            auto tree = std::make_unique<Tree>(Base::get_allocator());
+            tree->values_.reserve(treeSize);
+            for (std::size_t i = first ; i < version.trees_.size() ; ++i)
+                tree->values_.insert(
+                    tree->values_.end(),
+                    version.trees_[i]->values_.begin(),
+                    version.trees_[i]->values_.end());
+            tree->values_.insert(
+                tree->values_.end(),
+                version.tail_.values_.begin(),
+                version.tail_.values_.end());
+            assert(tree->values_.size() == treeSize);
+
+            Builder builder(*this, tree->blocks_, buildThreads_);
+            tree->root_ = builder(tree->values_.begin(), tree->values_.end());
+            return tree.release();
+        }
+
+        // same as the ConcurrentRead addOne, with s values including
+        // the one just appended to the tail.
+        void addOne(std::size_t s) {
+            Version *version = current_.load(std::memory_order_relaxed);
+            std::size_t newTreeSize = ((s^(s-1)) + 1) >> 1;
+            if (newTreeSize < minTreeSize)
+                return;
+
+            std::size_t numTrees = impl::popcount(s & ~(minTreeSize - 1));
+            assert(numTrees > 0);
+            std::size_t keep = numTrees - 1;
+            assert(keep <= version->trees_.size());
+
+            Tree *tree = merge(*version, keep, newTreeSize);
+            auto next = std::make_unique<Version>(Base::get_allocator());
+            next->trees_.reserve(numTrees);
+            next->trees_.assign(version->trees_.begin(), version->trees_.begin() + keep);
+            next->trees_.push_back(tree);
+
+            current_.store(next.release(), std::memory_order_seq_cst);
+
+            std::uint64_t epoch = impl::Epoch::retire();
+            for (std::size_t i = keep ; i < version->trees_.size() ; ++i)
+                retiredTrees_.retire(epoch, version->trees_[i]);
+            retiredVersions_.retire(epoch, version);
+        }
+
+        template <class Nearest>
+        void scan(const Version& version, Nearest& nearest) const {
+            for (const Tree *tree : version.trees_)
+                nearest(tree->root_, tree->values_.begin(), tree->values_.end());
+            const T *tail = version.tail_.data_;
+            nearest.insert(tail, tail + version.tail_.size_.load(std::memory_order_acquire));
+        }
+
+        template <class NearestIter>
+        void scan(const Version& version, NearestIter first, NearestIter last) const {
+            for (const Tree *tree : version.trees_)
+                for (NearestIter it = first ; it != last ; ++it)
+                    (*it)(tree->root_, tree->values_.begin(), tree->values_.end());
+            const T *tail = version.tail_.data_;
+            std::size_t tailSize = version.tail_.size_.load(std::memory_order_acquire);
+            for (NearestIter it = first ; it != last ; ++it)
+                it->insert(tail, tail + tailSize);
+        }
+
+        const Version& pinned() const {
+            return *current_.load(std::memory_order_seq_cst);
+        }
+
+    public:
+        Nigh(const Nigh&) = delete;
+
+        explicit Nigh(
+            const Space& metric = Space(),
+            const KeyFn& member = KeyFn(),
+            Allocator allocator = Allocator())
+            : Base(metric, member, allocator)
+            , current_(new Version(allocator))
+        {
+        }
+
+        // No reader or writer may be accessing the structure when it
+        // is destroyed, thus everything is freed immediately.
+        ~Nigh() {
+            Version *version = current_.load(std::memory_order_relaxed);
+            for (Tree *tree : version->trees_)
+                delete tree;
+            delete version;
+        }
+
+        std::size_t size() const {
+            return size_.load(std::memory_order_acquire);
+        }
+
+        void setBuildThreads(unsigned nThreads) {
+            std::lock_guard<std::mutex> lock(writeMutex_);
+            buildThreads_ = std::max(nThreads, 1u);
+        }
+
+        unsigned buildThreads() const {
+            return buildThreads_;
+        }
+
+        void insert(const T& value) {
+            std::lock_guard<std::mutex> lock(writeMutex_);
+            Version *version = current_.load(std::memory_order_relaxed);
+            Tail& tail = version->tail_;
+            assert(tail.values_.size() < minTreeSize);
+            tail.values_.push_back(value);
+            tail.size_.store(tail.values_.size(), std::memory_order_release);
+            std::size_t s = size_.load(std::memory_order_relaxed) + 1;
+            addOne(s);
+            size_.store(s, std::memory_order_release);
+
+            retiredVersions_.reclaim();
+            retiredTrees_.reclaim();
+        }
+
+        template <typename K>
+        std::optional<std::pair<T, Distance>> nearest(const K& q, const Approximate& approx = Approximate()) const {
+            impl::EpochGuard guard;
+            impl::kdtree_median::Nearest<Nigh, impl::Near1Set<T, Distance>> nearest(*this, q);
+            nearest.approximate(approx);
+            scan(pinned(), nearest);
+            return nearest.result();
+        }
+
+        template <typename K>
+        std::optional<T> nearest(const K& q, Distance* dist) const {
+            impl::EpochGuard guard;
+            impl::kdtree_median::Nearest<Nigh, impl::Near1Set<T, Distance>> nearest(*this, q);
+            scan(pinned(), nearest);
+            return nearest.result(dist);
+        }
+
+        template <typename Tuple, typename K, typename ResultAllocator>
+        void nearest(
+            std::vector<Tuple, ResultAllocator>& nbh,
+            const K& q,
+            std::size_t k,
+            Distance maxRadius = std::numeric_limits<Distance>::infinity(),
+            const Approximate& approx = Approximate()) const
+        {
+            impl::EpochGuard guard;
+            impl::kdtree_median::Nearest<Nigh, impl::NearKSet<Tuple, Distance, ResultAllocator>>
+                nearest(*this, q, nbh, k, maxRadius);
+            nearest.approximate(approx);
+            scan(pinned(), nearest);
+            nearest.sort();
+        }
+
+        // See the ConcurrentRead nearest_batch.  The whole block
+        // searches the Version pinned by the calling thread.
+        template <typename Keys, typename Tuple, typename ResultAllocator, typename ResultsAllocator>
+        void nearest_batch(
+            const Keys& queries,
+            std::vector<std::vector<Tuple, ResultAllocator>, ResultsAllocator>& results,
+            std::size_t k,
+            Distance maxRadius = std::numeric_limits<Distance>::infinity(),
+            unsigned nThreads = 1) const
+        {
+            using NearSet = impl::NearKSet<Tuple, Distance, ResultAllocator>;
+            using Nearest = impl::kdtree_median::Nearest<Nigh, NearSet>;
+            using NearestGroup = impl::kdtree_median::NearestGroup<Nigh, NearSet>;
+            impl::EpochGuard guard;
+            const Version& version = pinned();
+            results.resize(queries.size());
+            impl::parallelRanges(queries.size(), nThreads, [&] (std::size_t first, std::size_t last) {
+                if constexpr (NearestGroup::kSupported) {
+                    NearestGroup group(last - first);
+                    for (std::size_t i = first ; i < last ; ++i)
+                        group.add(*this, queries[i], results[i], k, maxRadius);
+                    scan(version, group);
+                    group.sort();
+                } else {
+                    std::vector<Nearest> block;
+                    block.reserve(last - first);
+                    for (std::size_t i = first ; i < last ; ++i)
+                        block.emplace_back(*this, queries[i], results[i], k, maxRadius);
+                    scan(version, block.begin(), block.end());
+                    for (Nearest& nearest : block)
+                        nearest.sort();
+                }
+            });
+        }
+
+        std::vector<T> list() const {
+            impl::EpochGuard guard;
+            const Version& version = pinned();
+            std::vector<T> result;
+            for (const Tree *tree : version.trees_)
+                result.insert(result.end(), tree->values_.begin(), tree->values_.end());
+            const T *tail = version.tail_.data_;
+            result.insert(result.end(), tail, tail + version.tail_.size_.load(std::memory_order_acquire));
+            return result;
+        }
+
+        // See the ConcurrentRead save.  The snapshot is of the values
+        // present when the call starts.
+        template <typename Index = std::uint32_t, typename IndexOf>
+        void save(std::ostream& out, const IndexOf& indexOf) const {
+            impl::EpochGuard guard;
+            const Version& version = pinned();
+            std::vector<const T*> values;
+            for (const Tree *tree : version.trees_)
+                for (const T& t : tree->values_)
+                    values.push_back(&t);
+            const T *tail = version.tail_.data_;
+            for (std::size_t i = 0, n = version.tail_.size_.load(std::memory_order_acquire) ; i < n ; ++i)
+                values.push_back(tail + i);
+            impl::kdtree_median::writeSnapshot<Index>(
+                out, Base::metricSpace(), values.size(),
+                [&] (std::size_t i) -> decltype(auto) { return Base::getKey(*values[i]); },
+                [&] (std::size_t i) { return indexOf(*values[i]); });
+        }
     };
     
 }
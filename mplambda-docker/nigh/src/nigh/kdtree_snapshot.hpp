@@ -0,0 +1,210 @@
+// Software License Agreement (BSD-3-Clause)
+//
+// Copyright 2018 The University of North Carolina at Chapel Hill
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+// OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//! @author Jeff Ichnowski
+
+#pragma once
+#ifndef NIGH_KDTREE_SNAPSHOT_HPP
+#define NIGH_KDTREE_SNAPSHOT_HPP
+
+#include "kdtree_median.hpp"
+#include "approximate.hpp"
+#include "metric/space.hpp"
+#include "impl/near_set.hpp"
+#include "impl/kdtree_median/node.hpp"
+#include "impl/kdtree_median/nearest.hpp"
+#include "impl/kdtree_median/snapshot.hpp"
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+namespace unc::robotics::nigh {
+
+    // KDTreeSnapshot is a read-only nearest neighbor structure over a
+    // snapshot written by the save() method of KDTreeMedian or
+    // KDTreeBatch.  The snapshot is a single median kd-tree, in a
+    // relocatable (offset-based) layout.  It is queried in place,
+    // without deserialization, thus it may be read from an mmap'd
+    // file (see MappedFile), and shared by processes through the page
+    // cache.
+    //
+    // The snapshot stores the index of each value (as returned by the
+    // indexOf argument to save) rather than the value itself.  The
+    // caller supplies the keys, such that keys[index] is the key of
+    // the value with that index.  Keys may be a pointer or any
+    // container with operator[], it is copied, thus a large array
+    // should be passed by pointer or by a reference-like type.
+    // Queries return indices.
+    //
+    // The Space must be the same type used to save the snapshot, and
+    // the snapshot data must remain valid for the lifetime of this
+    // object.  All methods are const and thread-safe.
+    template <
+        typename Space_,
+        typename Keys,
+        typename Index = std::uint32_t,
+        std::size_t linearSearchSize = 8>
+    class KDTreeSnapshot {
+    public:
+        using Type = Index;
+        using Space = Space_;
+        using Key = typename Space::Type;
+        using Metric = typename Space::Metric;
+        using Distance = typename Space::Distance;
+
+    private:
+        using Node = impl::kdtree_median::Node;
+        using Header = impl::kdtree_median::SnapshotHeader;
+
+        template <class Tree, class Set>
+        friend class impl::kdtree_median::Nearest;
+
+        Space space_;
+        Keys keys_;
+        const Index *indices_{nullptr};
+        std::size_t size_{0};
+        const Node *root_{nullptr};
+
+        auto distToKey(Index i, const Key& key) const {
+            return space_.distance(keys_[i], key);
+        }
+
+        template <class Nearest>
+        void scan(Nearest& nearest) const {
+            nearest(root_, indices_, indices_ + size_);
+        }
+
+    public:
+        // data must be aligned to 64 bytes (as an mmap'd file is).
+        // Throws std::invalid_argument if data is not a snapshot
+        // compatible with Space and Index.
+        KDTreeSnapshot(
+            const void *data, std::size_t bytes,
+            const Keys& keys,
+            const Space& space = Space())
+            : space_(space)
+            , keys_(keys)
+        {
+            using namespace impl::kdtree_median;
+            const char *base = static_cast<const char*>(data);
+            if (reinterpret_cast<std::uintptr_t>(base) % kSnapshotAlign != 0)
+                throw std::invalid_argument("snapshot data is not aligned");
+            if (bytes < sizeof(Header))
+                throw std::invalid_argument("snapshot is truncated");
+
+            const Header& header = *reinterpret_cast<const Header*>(base);
+            if (std::memcmp(header.magic_, kSnapshotMagic, sizeof(kSnapshotMagic)) != 0)
+                throw std::invalid_argument("not a nigh snapshot");
+            if (header.version_ != kSnapshotVersion)
+                throw std::invalid_argument("unsupported snapshot version");
+            if (header.indexSize_ != sizeof(Index) || header.distanceSize_ != sizeof(Distance))
+                throw std::invalid_argument("snapshot index or distance type mismatch");
+            if (header.dimensions_ != space_.dimensions())
+                throw std::invalid_argument("snapshot dimensions mismatch");
+            if (header.indexOffset_ % kSnapshotAlign != 0 ||
+                header.indexOffset_ > bytes ||
+                header.nodeOffset_ % kSnapshotAlign != 0 ||
+                header.size_ > (bytes - header.indexOffset_) / sizeof(Index) ||
+                header.indexOffset_ + header.size_ * sizeof(Index) > header.nodeOffset_ ||
+                header.nodeOffset_ > bytes ||
+                header.nodeBytes_ > bytes - header.nodeOffset_ ||
+                (header.root_ != kSnapshotNoRoot && header.root_ >= header.nodeBytes_))
+                throw std::invalid_argument("snapshot is truncated or corrupt");
+
+            indices_ = reinterpret_cast<const Index*>(base + header.indexOffset_);
+            size_ = header.size_;
+            if (header.root_ != kSnapshotNoRoot)
+                root_ = reinterpret_cast<const Node*>(base + header.nodeOffset_ + header.root_);
+        }
+
+        std::size_t size() const {
+            return size_;
+        }
+
+        const Space& metricSpace() const {
+            return space_;
+        }
+
+        const Keys& keys() const {
+            return keys_;
+        }
+
+        template <typename K>
+        std::optional<std::pair<Index, Distance>> nearest(const K& q, const Approximate& approx = Approximate()) const {
+            impl::kdtree_median::Nearest<KDTreeSnapshot, impl::Near1Set<Index, Distance>> nearest(*this, q);
+            nearest.approximate(approx);
+            scan(nearest);
+            return nearest.result();
+        }
+
+        template <typename Tuple, typename K, typename ResultAllocator>
+        void nearest(
+            std::vector<Tuple, ResultAllocator>& nbh,
+            const K& q,
+            std::size_t k,
+            Distance maxRadius = std::numeric_limits<Distance>::infinity(),
+            const Approximate& approx = Approximate()) const
+        {
+            impl::kdtree_median::Nearest<KDTreeSnapshot, impl::NearKSet<Tuple, Distance, ResultAllocator>>
+                nearest(*this, q, nbh, k, maxRadius);
+            nearest.approximate(approx);
+            scan(nearest);
+            nearest.sort();
+        }
+
+        template <typename K>
+        std::vector<std::pair<Index, Distance>> nearest(
+            const K& q,
+            std::size_t k,
+            Distance maxRadius = std::numeric_limits<Distance>::infinity()) const
+        {
+            std::vector<std::pair<Index, Distance>> results;
+            results.reserve(k+1);
+            nearest(results, q, k, maxRadius);
+            return results;
+        }
+    };
+}
+
+namespace unc::robotics::nigh::impl::kdtree_median {
+    template <typename Space_, typename Keys, typename Index, std::size_t linearSearchSize>
+    struct NearestTraits<KDTreeSnapshot<Space_, Keys, Index, linearSearchSize>> {
+        using Type = Index;
+        using Space = Space_;
+        static constexpr std::size_t kLinearSearchSize = linearSearchSize;
+    };
+}
+
+#endif
@@ -0,0 +1,109 @@
+// Software License Agreement (BSD-3-Clause)
+//
+// Copyright 2018 The University of North Carolina at Chapel Hill
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+// OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//! @author Jeff Ichnowski
+
+#pragma once
+#ifndef NIGH_MAPPED_FILE_HPP
+#define NIGH_MAPPED_FILE_HPP
+
+#include <cerrno>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace unc::robotics::nigh {
+
+    // A read-only, shared memory mapping of a file (POSIX only), for
+    // loading a KDTreeSnapshot.  Mappings of the same file by
+    // separate processes share physical pages through the page cache.
+    // Throws std::system_error if the file cannot be opened or mapped.
+    class MappedFile {
+        void *data_{nullptr};
+        std::size_t size_{0};
+
+    public:
+        explicit MappedFile(const std::string& path) {
+            int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd == -1)
+                throw std::system_error(errno, std::generic_category(), "open " + path);
+
+            struct stat st;
+            if (::fstat(fd, &st) == -1) {
+                int err = errno;
+                ::close(fd);
+                throw std::system_error(err, std::generic_category(), "fstat " + path);
+            }
+
+            size_ = static_cast<std::size_t>(st.st_size);
+            if (size_ > 0) {
+                void *data = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+                if (data == MAP_FAILED) {
+                    int err = errno;
+                    ::close(fd);
+                    throw std::system_error(err, std::generic_category(), "mmap " + path);
+                }
+                data_ = data;
+            }
+            ::close(fd);
+        }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator = (const MappedFile&) = delete;
+
+        MappedFile(MappedFile&& other)
+            : data_(std::exchange(other.data_, nullptr))
+            , size_(std::exchange(other.size_, 0))
+        {
+        }
+
+        ~MappedFile() {
+            if (data_)
+                ::munmap(data_, size_);
+        }
+
+        const void* data() const {
+            return data_;
+        }
+
+        std::size_t size() const {
+            return size_;
+        }
+    };
+}
+
+#endif
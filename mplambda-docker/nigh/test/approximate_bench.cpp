@@ -0,0 +1,159 @@
+// Software License Agreement (BSD-3-Clause)
+//
+// Copyright 2018 The University of North Carolina at Chapel Hill
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+// OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//! @author Jeff Ichnowski
+
+// Measures the recall/speed tradeoff of approximate k-nearest
+// queries (see nigh/approximate.hpp).  For each strategy and setting
+// of epsilon and the leaf budget, prints the mean query time, the
+// recall (the fraction of the true k nearest returned), and the mean
+// ratio of the returned k-th distance to the true k-th distance.
+// Running plot-style over the output gives the tradeoff curves.
+
+#include "bench_template.hpp"
+#include <nigh/se3_space.hpp>
+
+namespace nigh_test {
+    template <typename Strategy, typename Space>
+    void runApproximateBench(
+        const std::string& label, const Space& space,
+        std::size_t N, std::size_t K, std::size_t nQueries)
+    {
+        using Clock = std::chrono::steady_clock;
+        using State = typename Space::Type;
+        using Distance = typename Space::Distance;
+        using namespace unc::robotics::nigh;
+
+        struct Node {
+            State state_;
+            std::size_t index_;
+        };
+
+        struct NodeKey {
+            const State& operator() (const Node& n) const {
+                return n.state_;
+            }
+        };
+
+        Sampler<State, typename Space::Metric> sampler(space);
+        std::mt19937_64 rng;
+
+        Nigh<Node, Space, NodeKey, NoThreadSafety, Strategy> nn(space);
+        for (std::size_t i=0 ; i<N ; ++i)
+            nn.insert(Node{sampler(rng), i});
+
+        std::vector<State> queries;
+        std::vector<std::vector<std::pair<Node, Distance>>> exact(nQueries);
+        for (std::size_t i=0 ; i<nQueries ; ++i) {
+            queries.push_back(sampler(rng));
+            nn.nearest(exact[i], queries[i], K);
+        }
+
+        static constexpr std::size_t kNoBudget = std::numeric_limits<std::size_t>::max();
+        static const double epsilons[] = { 0, 0.1, 0.25, 0.5, 1, 2, 4 };
+        static const std::size_t budgets[] = { kNoBudget, 256, 64, 16, 4, 1 };
+
+        std::vector<std::pair<Node, Distance>> nbh;
+        std::vector<bool> found(N);
+        for (std::size_t budget : budgets) {
+            for (double epsilon : epsilons) {
+                Approximate approx(epsilon, budget);
+                auto start = Clock::now();
+                Distance sum = 0;
+                for (std::size_t i=0 ; i<nQueries ; ++i) {
+                    nn.nearest(nbh, queries[i], K, std::numeric_limits<Distance>::infinity(), approx);
+                    sum += nbh.back().second;
+                }
+                double us = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / nQueries;
+
+                std::size_t hits = 0;
+                double ratio = 0;
+                for (std::size_t i=0 ; i<nQueries ; ++i) {
+                    nn.nearest(nbh, queries[i], K, std::numeric_limits<Distance>::infinity(), approx);
+                    for (auto& n : nbh)
+                        found[n.first.index_] = true;
+                    for (auto& n : exact[i])
+                        hits += found[n.first.index_];
+                    for (auto& n : nbh)
+                        found[n.first.index_] = false;
+                    if (exact[i].back().second > 0)
+                        ratio += nbh.back().second / exact[i].back().second;
+                }
+
+                std::cout << label
+                          << '\t' << Name<Strategy>::name()
+                          << '\t' << epsilon
+                          << '\t' << (budget == kNoBudget ? 0 : budget)
+                          << '\t' << us
+                          << '\t' << double(hits) / (nQueries * K)
+                          << '\t' << ratio / nQueries
+                          << "\t# " << sum << std::endl;
+            }
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    using namespace unc::robotics::nigh;
+    using namespace nigh_test;
+
+    std::size_t N = 100000;
+    std::size_t K = 20;
+    std::size_t Q = 2000;
+
+    for (int opt ; (opt = getopt(argc, argv, "n:k:q:")) != -1 ; ) {
+        switch (opt) {
+        case 'n':
+            N = std::atoi(optarg);
+            break;
+        case 'k':
+            K = std::atoi(optarg);
+            break;
+        case 'q':
+            Q = std::atoi(optarg);
+            break;
+        default:
+            std::cerr << "Usage: " << argv[0] << " [-n nn-size] [-k query-size] [-q query-count]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << "# size = " << N << ", k = " << K << ", queries = " << Q << std::endl;
+    std::cout << "# space strategy epsilon max_leaf_visits(0=unbounded)"
+        " us_per_query recall kth_dist_ratio" << std::endl;
+
+    runApproximateBench<KDTreeBatch<>>("se3", metric::SE3Space<double, 50, 1>{}, N, K, Q);
+    runApproximateBench<KDTreeMedian<>>("se3", metric::SE3Space<double, 50, 1>{}, N, K, Q);
+    runApproximateBench<KDTreeBatch<>>("l1_8", metric::L1Space<double, 8>{}, N, K, Q);
+    runApproximateBench<KDTreeMedian<>>("l1_8", metric::L1Space<double, 8>{}, N, K, Q);
+}
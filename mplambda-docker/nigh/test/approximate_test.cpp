@@ -0,0 +1,135 @@
+// Software License Agreement (BSD-3-Clause)
+//
+// Copyright 2018 The University of North Carolina at Chapel Hill
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+// OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//! @author Jeff Ichnowski
+
+#include "test.hpp"
+#include <nigh/lp_space.hpp>
+#include <nigh/so3_space.hpp>
+#include <nigh/se3_space.hpp>
+#include <nigh/kdtree_batch.hpp>
+#include <nigh/kdtree_median.hpp>
+#include <nigh/linear.hpp>
+#include <random>
+#include "sampler_lp.hpp"
+#include "sampler_so3.hpp"
+#include "sampler_scaled.hpp"
+#include "sampler_cartesian.hpp"
+#include "linear_reference.hpp"
+
+using namespace unc::robotics::nigh;
+using nigh_test::IndexedNode;
+using nigh_test::IndexedNodeKey;
+
+namespace {
+    // Checks that a default Approximate matches a linear scan exactly,
+    // that the i-th result of an epsilon-approximate query is within
+    // (1+epsilon) of the true i-th distance, and that a leaf budget
+    // still returns a full result set.
+    template <typename Strategy, typename Space>
+    void approxTest(const Space& space, std::size_t N) {
+        using State = typename Space::Type;
+        using Distance = typename Space::Distance;
+        using N_ = IndexedNode<State>;
+        static constexpr std::size_t K = 20;
+        static constexpr double kEpsilon = 0.5;
+
+        nigh_test::Sampler<State, typename Space::Metric> sampler(space);
+        std::mt19937_64 rng(N);
+
+        Nigh<N_, Space, IndexedNodeKey<State>, NoThreadSafety, Strategy> nn(space);
+        nigh_test::LinearReference<Space> linear(space);
+
+        for (const N_& n : nigh_test::sampleNodes(space, N, rng)) {
+            nn.insert(n);
+            linear.insert(n);
+        }
+
+        std::vector<std::pair<N_, Distance>> nbh;
+        std::vector<std::pair<N_, Distance>> expected;
+        for (std::size_t i=0 ; i<100 ; ++i) {
+            State q = sampler(rng);
+            linear.nearest(expected, q, K);
+
+            nn.nearest(nbh, q, K, std::numeric_limits<Distance>::infinity(), Approximate());
+            EXPECT(nbh.size()) == expected.size();
+            for (std::size_t j=0 ; j<nbh.size() ; ++j)
+                EXPECT(nbh[j].second) == expected[j].second;
+
+            nn.nearest(nbh, q, K, std::numeric_limits<Distance>::infinity(), Approximate(kEpsilon));
+            EXPECT(nbh.size()) == expected.size();
+            for (std::size_t j=0 ; j<nbh.size() ; ++j)
+                EXPECT(nbh[j].second) <= expected[j].second * (1 + kEpsilon);
+
+            auto exact = nn.nearest(q, Approximate());
+            EXPECT(exact->second) == expected[0].second;
+            auto approx = nn.nearest(q, Approximate(kEpsilon));
+            EXPECT(approx->second) <= expected[0].second * (1 + kEpsilon);
+
+            nn.nearest(nbh, q, K, std::numeric_limits<Distance>::infinity(), Approximate(0, 1));
+            EXPECT(nbh.size()) == K;
+            for (std::size_t j=0 ; j<nbh.size() ; ++j)
+                EXPECT(nbh[j].second) >= expected[j].second;
+
+            EXPECT(!!nn.nearest(q, Approximate(0, 0))) == true;
+        }
+    }
+}
+
+TEST(batch_l2_3) {
+    approxTest<KDTreeBatch<>>(L2Space<double, 3>{}, 10000);
+}
+
+TEST(batch_l1_8) {
+    approxTest<KDTreeBatch<>>(L1Space<double, 8>{}, 10000);
+}
+
+TEST(batch_so3) {
+    approxTest<KDTreeBatch<>>(SO3Space<double>{}, 10000);
+}
+
+TEST(batch_se3) {
+    approxTest<KDTreeBatch<>>(SE3Space<double, 50, 1>{}, 10000);
+}
+
+TEST(median_l2_3) {
+    approxTest<KDTreeMedian<>>(L2Space<double, 3>{}, 10000);
+}
+
+TEST(median_l1_8) {
+    approxTest<KDTreeMedian<>>(L1Space<double, 8>{}, 10000);
+}
+
+TEST(median_se3) {
+    approxTest<KDTreeMedian<>>(SE3Space<double, 50, 1>{}, 10000);
+}
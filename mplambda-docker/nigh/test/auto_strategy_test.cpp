@@ -78,7 +78,7 @@ TEST(strategies) {
     EXPECT((
         std::is_same_v<
             auto_strategy_t<nigh_test::NonMetricSpace, Concurrent, false>,
-            Linear>)) == true;
+            GNAT<>>)) == true;
 
     EXPECT((
         std::is_same_v<
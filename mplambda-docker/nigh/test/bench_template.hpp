@@ -48,8 +48,16 @@
 #include <random>
 #include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <cstdint>
 #include <iostream>
 #include <getopt.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 #include "sampler_lp.hpp"
 #include "sampler_so2.hpp"
 #include "sampler_so3.hpp"
@@ -146,10 +154,11 @@ namespace nigh_test {
     };
 
 
-    template <std::size_t batchSize>
-    struct Name<unc::robotics::nigh::KDTreeBatch<batchSize>> {
+    template <std::size_t batchSize, bool inlineKeys>
+    struct Name<unc::robotics::nigh::KDTreeBatch<batchSize, inlineKeys>> {
         static std::string name() {
-            return "KDTreeBatch<" + std::to_string(batchSize) + ">";
+            return "KDTreeBatch<" + std::to_string(batchSize)
+                + (inlineKeys ? ", inline>" : ">");
         }
     };
 
@@ -187,6 +196,88 @@ namespace nigh_test {
         constexpr const T& operator () (const T& q) const { return q; }
     };
 
+    // Counts last-level cache misses of the calling thread with a
+    // perf_event counter.  Where the counter is not available (not
+    // Linux, no PMU access in a VM or container, or
+    // perf_event_paranoid is too high), available() is false and
+    // perQuery() returns NaN, so that benchmark output keeps the same
+    // columns.  When the counter is unavailable, the same numbers
+    // can be collected for a whole run with
+    // `perf stat -e LLC-load-misses <bench>`.
+    class LLCMissCounter {
+        int fd_{-1};
+        std::uint64_t count_{0};
+
+#ifdef __linux__
+        static int open(std::uint32_t type, std::uint64_t config) {
+            perf_event_attr attr{};
+            attr.size = sizeof(attr);
+            attr.type = type;
+            attr.config = config;
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+        }
+#endif
+
+    public:
+        LLCMissCounter() {
+#ifdef __linux__
+            fd_ = open(PERF_TYPE_HW_CACHE,
+                       PERF_COUNT_HW_CACHE_LL
+                       | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                       | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+            if (fd_ == -1)
+                fd_ = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+#endif
+        }
+
+        LLCMissCounter(const LLCMissCounter&) = delete;
+
+        ~LLCMissCounter() {
+#ifdef __linux__
+            if (fd_ != -1)
+                close(fd_);
+#endif
+        }
+
+        bool available() const {
+            return fd_ != -1;
+        }
+
+        void start() {
+#ifdef __linux__
+            if (fd_ != -1) {
+                ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+                ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+            }
+#endif
+        }
+
+        void stop() {
+            count_ = 0;
+#ifdef __linux__
+            if (fd_ != -1) {
+                ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+                if (::read(fd_, &count_, sizeof(count_)) != sizeof(count_))
+                    count_ = 0;
+            }
+#endif
+        }
+
+        // misses counted between start() and stop()
+        std::uint64_t count() const {
+            return count_;
+        }
+
+        double perQuery(std::size_t queryCount) const {
+            return available() && queryCount
+                ? static_cast<double>(count_) / queryCount
+                : std::nan("");
+        }
+    };
+
     template <typename Clock>
     double nanosPerClock(typename Clock::duration stepDuration) {
         typename Clock::duration elapsed;
@@ -273,7 +364,9 @@ namespace nigh_test {
         std::cout << "# Strategy = " << Name<Strategy>::name() << std::endl;
         std::cout << "# Concurrency = " << Name<Concurrency>::name() << std::endl;
         std::cout << "# k = " << K << std::endl;
-        std::cout << "# size nanos_elapsed query_count ms_per_query" << std::endl;
+        std::cout << "# size nanos_elapsed query_count ms_per_query llc_misses_per_query" << std::endl;
+
+        LLCMissCounter llcMisses;
 
         std::size_t queryNo = 0;
         for (;;) {
@@ -286,11 +379,13 @@ namespace nigh_test {
 
             std::size_t prevQueryNo = queryNo;
             Clock::duration elapsed;
+            llcMisses.start();
             auto start = Clock::now();
             do {
                 nns[queryNo % nTrees].nearest(nbh, queries[queryNo % nQueries], K);
                 ++queryNo;
             } while ((elapsed = Clock::now() - start) < stepDuration);
+            llcMisses.stop();
 
             std::size_t queryCount = (queryNo - prevQueryNo);
             auto nanos = std::chrono::duration<long long, std::nano>(elapsed).count()
@@ -300,6 +395,7 @@ namespace nigh_test {
                       << '\t' << nanos
                       << '\t' << queryCount
                       << '\t' << (nanos * 1e-6 / queryCount)
+                      << '\t' << llcMisses.perQuery(queryCount)
                       << std::endl;
 
             if (size >= N)
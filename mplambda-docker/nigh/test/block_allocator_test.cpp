@@ -194,3 +194,43 @@ TEST(mark_rollback_across_blocks) {
     EXPECT(counters.bytes()) == (1024 + sizeof(void*))*2;
 }
 
+
+TEST(merge) {
+    using namespace unc::robotics::nigh::impl;
+    using Alloc = TestAllocator<char>;
+    using Item = std::array<double, 1024/sizeof(double) / 3>;
+
+    Alloc counters;
+    BlockAllocator<1024, Alloc> alloc(counters);
+    BlockAllocator<1024, Alloc> other(counters);
+
+    Item *a0 = alloc.allocate<Item>();
+    auto markB = alloc.mark();
+    Item *b0 = alloc.allocate<Item>();
+
+    // fills other's first block, and one item into a second.
+    Item *x0 = other.allocate<Item>();
+    other.allocate<Item>();
+    other.allocate<Item>();
+    Item *y0 = other.allocate<Item>();
+    EXPECT(counters.count()) == 3;
+
+    alloc.merge(std::move(other));
+
+    // allocation continues after y0 in the merged block.
+    Item *c0 = alloc.allocate<Item>();
+    EXPECT(addr(c0) - addr(y0)) == sizeof(Item);
+
+    // rolling back reuses the merged blocks.
+    alloc.rollback(markB);
+    Item *b1 = alloc.allocate<Item>();
+    Item *c1 = alloc.allocate<Item>();
+    Item *x1 = alloc.allocate<Item>();
+    EXPECT(b1 == b0) == true;
+    EXPECT(x1 == x0) == true;
+    EXPECT(a0 != c1) == true;
+
+    // other remains usable.
+    other.allocate<Item>();
+    EXPECT(counters.count()) == 4;
+}
@@ -0,0 +1,131 @@
+// Software License Agreement (BSD-3-Clause)
+//
+// Copyright 2018 The University of North Carolina at Chapel Hill
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+// OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//! @author Jeff Ichnowski
+
+// Compares building a KDTreeBatch with one insert per element
+// against a single bulk insert of the same elements.  For each size
+// the output reports the build time, the resulting depth, and the
+// time per k-nearest query on the resulting tree.
+
+#include "bench_template.hpp"
+
+namespace nigh_test {
+    template <typename State, typename Space, typename Concurrency>
+    void runBulkBench(int argc, char *argv[], const Space& space, const Concurrency&) {
+        using Clock = std::chrono::steady_clock;
+        using Distance = typename Space::Distance;
+        using namespace unc::robotics::nigh;
+        using NN = Nigh<State, Space, Identity, Concurrency, KDTreeBatch<>>;
+
+        static constexpr std::size_t nQueries = 10000;
+
+        std::size_t N = 1000000;
+        std::size_t K = 20;
+
+        for (int opt ; (opt = getopt(argc, argv, "n:k:")) != -1 ; ) {
+            switch (opt) {
+            case 'n':
+                N = std::atoi(optarg);
+                break;
+            case 'k':
+                K = std::atoi(optarg);
+                break;
+            default:
+                std::cerr << "Usage: " << argv[0] << " [-n max-nn-size] [-k query-size]" << std::endl;
+                return;
+            }
+        }
+
+        Sampler<State, typename Space::Metric> sampler(space);
+        std::mt19937_64 rng;
+
+        std::vector<State> states;
+        states.reserve(N);
+        while (states.size() < N)
+            states.push_back(sampler(rng));
+
+        std::vector<State> queries;
+        queries.reserve(nQueries);
+        while (queries.size() < nQueries)
+            queries.push_back(sampler(rng));
+
+        std::vector<std::pair<State, Distance>> nbh;
+        nbh.reserve(K+1);
+
+        auto queryTime = [&] (const NN& nn) {
+            auto start = Clock::now();
+            for (const State& q : queries)
+                nn.nearest(nbh, q, K);
+            return std::chrono::duration<double, std::milli>(Clock::now() - start).count() / nQueries;
+        };
+
+        std::cout << "# State = " << Name<State>::name() << std::endl;
+        std::cout << "# Metric = " << Name<typename Space::Metric>::name() << std::endl;
+        std::cout << "# Strategy = " << Name<KDTreeBatch<>>::name() << std::endl;
+        std::cout << "# Concurrency = " << Name<Concurrency>::name() << std::endl;
+        std::cout << "# k = " << K << std::endl;
+        std::cout << "# size single_build_ms single_depth single_ms_per_query"
+            " bulk_build_ms bulk_depth bulk_ms_per_query" << std::endl;
+
+        for (std::size_t size = 1000 ; size <= N ; size *= 10) {
+            NN single(space);
+            auto start = Clock::now();
+            for (std::size_t i=0 ; i<size ; ++i)
+                single.insert(states[i]);
+            double singleBuild = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+            NN bulk(space);
+            start = Clock::now();
+            bulk.insert(states.begin(), states.begin() + size);
+            double bulkBuild = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+            std::cout << size
+                      << '\t' << singleBuild
+                      << '\t' << single.depth()
+                      << '\t' << queryTime(single)
+                      << '\t' << bulkBuild
+                      << '\t' << bulk.depth()
+                      << '\t' << queryTime(bulk)
+                      << std::endl;
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    using namespace unc::robotics::nigh;
+    using namespace nigh_test;
+
+    metric::L2Space<double, 3> space;
+    runBulkBench<Eigen::Vector3d>(argc, argv, space, Concurrent{});
+}
@@ -0,0 +1,173 @@
+// Software License Agreement (BSD-3-Clause)
+//
+// Copyright 2018 The University of North Carolina at Chapel Hill
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+// OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//! @author Jeff Ichnowski
+
+#include "test.hpp"
+#include <nigh/lp_space.hpp>
+#include <nigh/so3_space.hpp>
+#include <nigh/kdtree_batch.hpp>
+#include <nigh/linear.hpp>
+#include <random>
+#include <thread>
+#include "sampler_lp.hpp"
+#include "sampler_so3.hpp"
+#include "linear_reference.hpp"
+
+using namespace unc::robotics::nigh;
+using nigh_test::IndexedNode;
+using nigh_test::IndexedNodeKey;
+
+namespace {
+    struct Identity {
+        template <typename T>
+        const T& operator() (const T& q) const { return q; }
+    };
+
+    // Inserts N nodes into a KDTreeBatch, the first `single` one at a
+    // time and the rest in chunks of increasing size, then checks
+    // that nearest neighbor queries match a linear scan.
+    template <typename Concurrency, typename Space>
+    void bulkTest(const Space& space, std::size_t N, std::size_t single) {
+        using State = typename Space::Type;
+        using N_ = IndexedNode<State>;
+        static constexpr std::size_t K = 20;
+
+        std::mt19937_64 rng(N + single);
+        std::vector<N_> nodes = nigh_test::sampleNodes(space, N, rng);
+
+        Nigh<N_, Space, IndexedNodeKey<State>, Concurrency, KDTreeBatch<8>> nn(space);
+
+        for (std::size_t i=0 ; i<single ; ++i)
+            nn.insert(nodes[i]);
+
+        for (std::size_t i = single, chunk = 1 ; i < N ; i += chunk, chunk *= 3)
+            nn.insert(nodes.begin() + i, nodes.begin() + std::min(N, i + chunk));
+
+        // empty ranges are allowed
+        nn.insert(nodes.end(), nodes.end());
+
+        EXPECT(nn.size()) == N;
+        EXPECT(nn.list().size()) == N;
+        nigh_test::expectNearestMatchesLinear(nn, nodes, rng, K, 100);
+
+        // every node must be its own nearest neighbor.
+        for (std::size_t i=0 ; i<N ; i += 7) {
+            auto n = nn.nearest(nodes[i].state_);
+            EXPECT(n.has_value()) == true;
+            EXPECT(n->first.index_) == i;
+        }
+    }
+}
+
+TEST(bulk_l2_empty) {
+    bulkTest<NoThreadSafety>(L2Space<double, 3>{}, 5000, 0);
+}
+
+TEST(bulk_l2_mixed) {
+    bulkTest<NoThreadSafety>(L2Space<double, 3>{}, 5000, 1000);
+}
+
+TEST(bulk_linf_concurrent_read) {
+    bulkTest<ConcurrentRead>(LInfSpace<float, 6>{}, 5000, 1000);
+}
+
+TEST(bulk_l2_concurrent) {
+    bulkTest<Concurrent>(L2Space<double, 3>{}, 5000, 1000);
+}
+
+TEST(bulk_l1_dynamic) {
+    bulkTest<Concurrent>(metric::Space<std::vector<double>, metric::LP<1>>(5), 3000, 100);
+}
+
+TEST(bulk_so3_fallback) {
+    bulkTest<Concurrent>(SO3Space<double>{}, 2000, 100);
+}
+
+TEST(bulk_l2_balanced) {
+    using State = Eigen::Vector3d;
+    L2Space<double, 3> space;
+    nigh_test::Sampler<State, metric::LP<2>> sampler(space);
+    std::mt19937_64 rng;
+    std::vector<State> states;
+    for (std::size_t i=0 ; i<(1 << 14) ; ++i)
+        states.push_back(sampler(rng));
+
+    Nigh<State, L2Space<double, 3>, Identity, Concurrent, KDTreeBatch<8>> nn(space);
+    nn.insert(states.begin(), states.end());
+
+    // 2^14 elements with at most 8 per leaf is 11 levels when
+    // perfectly balanced.
+    EXPECT(nn.size()) == states.size();
+    EXPECT(nn.depth()) == 12u;
+}
+
+TEST(bulk_l2_threads) {
+    using State = Eigen::Vector3d;
+    using Space = L2Space<double, 3>;
+    using N_ = IndexedNode<State>;
+    static constexpr std::size_t nThreads = 4;
+    static constexpr std::size_t nPerThread = 4000;
+    static constexpr std::size_t chunk = 50;
+
+    Space space;
+    Nigh<N_, Space, IndexedNodeKey<State>, Concurrent, KDTreeBatch<8>> nn(space);
+
+    std::vector<std::vector<N_>> nodes;
+    for (std::size_t t=0 ; t<nThreads ; ++t) {
+        std::mt19937_64 rng(t);
+        nodes.push_back(nigh_test::sampleNodes(space, nPerThread, rng, t*nPerThread));
+    }
+
+    std::atomic_bool failed{false};
+    std::vector<std::thread> threads;
+    for (std::size_t t=0 ; t<nThreads ; ++t) {
+        threads.emplace_back([&, t] {
+            for (std::size_t i=0 ; i<nPerThread ; i += chunk) {
+                nn.insert(nodes[t].begin() + i, nodes[t].begin() + i + chunk);
+                // everything inserted by this thread must be visible.
+                for (std::size_t j=i ; j<i+chunk ; ++j) {
+                    auto n = nn.nearest(nodes[t][j].state_);
+                    if (!n || n->second != 0)
+                        failed = true;
+                }
+            }
+        });
+    }
+    for (auto& t : threads)
+        t.join();
+
+    EXPECT(failed.load()) == false;
+    EXPECT(nn.size()) == nThreads * nPerThread;
+    EXPECT(nn.list().size()) == nThreads * nPerThread;
+}
@@ -0,0 +1,114 @@
+// Software License Agreement (BSD-3-Clause)
+//
+// Copyright 2018 The University of North Carolina at Chapel Hill
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+// OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//! @author Jeff Ichnowski
+
+// Concurrency scaling benchmark.  Sweeps the thread count and the
+// mix of queries and inserts (pure query, 90/10, 50/50, pure insert)
+// for each strategy, including KDTreeBatch at several batch sizes,
+// in one space per sampler.  Writes CSV (see
+// concurrent_bench_template.hpp) to stdout.
+//
+//   -n values inserted before each run
+//   -o timed operations per run, split across the threads
+//   -k k of the queries
+//   -t maximum thread count (default: hardware concurrency)
+//   -s only run the spaces whose name contains the argument
+
+#include "concurrent_bench_template.hpp"
+#include <nigh/metric/scaled.hpp>
+
+namespace nigh_test {
+    template <typename Space>
+    void runConcurrentBenches(
+        const std::string& label, const Space& space,
+        const ConcurrentBenchOptions& options)
+    {
+        using namespace unc::robotics::nigh;
+        runConcurrentBench<Linear>(label, space, options);
+        runConcurrentBench<GNAT<>>(label, space, options);
+        runConcurrentBench<KDTreeMedian<>>(label, space, options);
+        runConcurrentBench<KDTreeBatch<8>>(label, space, options);
+        runConcurrentBench<KDTreeBatch<16>>(label, space, options);
+        runConcurrentBench<KDTreeBatch<32>>(label, space, options);
+        runConcurrentBench<KDTreeBatch<64>>(label, space, options);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    using namespace unc::robotics::nigh;
+    using namespace unc::robotics::nigh::metric;
+    using namespace nigh_test;
+
+    ConcurrentBenchOptions options;
+    std::string only;
+
+    for (int opt ; (opt = getopt(argc, argv, "n:o:k:t:s:")) != -1 ; ) {
+        switch (opt) {
+        case 'n':
+            options.prefill = std::atoi(optarg);
+            break;
+        case 'o':
+            options.ops = std::atoi(optarg);
+            break;
+        case 'k':
+            options.k = std::atoi(optarg);
+            break;
+        case 't':
+            options.maxThreads = std::max(1, std::atoi(optarg));
+            break;
+        case 's':
+            only = optarg;
+            break;
+        default:
+            std::cerr << "Usage: " << argv[0]
+                      << " [-n prefill-size] [-o op-count] [-k query-size] [-t max-threads] [-s space]"
+                      << std::endl;
+            return 1;
+        }
+    }
+
+    auto run = [&] (const std::string& label, const auto& space) {
+        if (label.find(only) != std::string::npos)
+            runConcurrentBenches(label, space, options);
+    };
+
+    printConcurrentBenchHeader();
+    run("l2_3", Space<Eigen::Matrix<double, 3, 1>, L2>{});
+    run("so2_7", Space<Eigen::Matrix<double, 7, 1>, SO2<1>>{});
+    run("so3", Space<Eigen::Quaterniond, SO3>{});
+    run("scaled_se3_7_3", Space<
+        std::tuple<Eigen::Quaterniond, Eigen::Vector3d>,
+        Cartesian<RatioScaled<SO3, 7>, RatioScaled<L2, 3>>>{});
+    run("se3", Space<std::tuple<Eigen::Quaterniond, Eigen::Vector3d>, Cartesian<SO3, L2>>{});
+}
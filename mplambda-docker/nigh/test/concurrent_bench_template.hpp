@@ -0,0 +1,217 @@
+// Software License Agreement (BSD-3-Clause)
+//
+// Copyright 2018 The University of North Carolina at Chapel Hill
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+// OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//! @author Jeff Ichnowski
+
+#pragma once
+#ifndef NIGH_TEST_CONCURRENT_BENCH_TEMPLATE_HPP
+#define NIGH_TEST_CONCURRENT_BENCH_TEMPLATE_HPP
+
+#include "bench_template.hpp"
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+namespace nigh_test {
+
+    // Options of a concurrency scaling benchmark, see
+    // runConcurrentBench.
+    struct ConcurrentBenchOptions {
+        // number of values inserted before the timed operations
+        std::size_t prefill = 20000;
+
+        // total number of timed operations, split across the threads
+        std::size_t ops = 10000;
+
+        // k of the nearest neighbor queries
+        std::size_t k = 10;
+
+        // thread counts 1, 2, 4, ... up to maxThreads
+        unsigned maxThreads = std::max(1u, std::thread::hardware_concurrency());
+
+        // percentages of the operations that are queries, the rest
+        // are inserts.
+        std::vector<unsigned> queryPercents{100, 90, 50, 0};
+    };
+
+    // Bytes of heap in use by the process, or -1 where it is not
+    // available.  With glibc this is the allocator's count of bytes
+    // in use, which (unlike the resident set) drops when memory is
+    // freed.  Elsewhere on Linux, it falls back to the resident set
+    // size.
+    inline long long heapBytes() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+        struct mallinfo2 info = mallinfo2();
+        return static_cast<long long>(info.uordblks + info.hblkhd);
+#elif defined(__linux__)
+        std::ifstream statm("/proc/self/statm");
+        long long pages, resident;
+        if (statm >> pages >> resident)
+            return resident * sysconf(_SC_PAGESIZE);
+        return -1;
+#else
+        return -1;
+#endif
+    }
+
+    // The strategy names contain commas, thus they are quoted.
+    inline void printConcurrentBenchHeader() {
+        std::cout << "space,strategy,threads,query_percent,size,ops,seconds,ops_per_sec,"
+            "p50_us,p99_us,memory_bytes,bytes_per_value" << std::endl;
+    }
+
+    // Runs a mix of inserts and queries on a Concurrent nearest
+    // neighbor structure, for each thread count and query percentage
+    // in the options, and prints one CSV row per run (see
+    // printConcurrentBenchHeader).  Each run starts with a new
+    // structure prefilled from a single thread.  The samples are
+    // generated before the run, so the timed loop only calls insert
+    // and nearest.  The latency percentiles are over all timed
+    // operations of all threads.  Memory is the growth in heap use
+    // (see heapBytes) from before the structure was created to the
+    // end of the run.
+    template <typename Strategy, typename Space>
+    void runConcurrentBench(
+        const std::string& label,
+        const Space& space,
+        const ConcurrentBenchOptions& options)
+    {
+        using Clock = std::chrono::steady_clock;
+        using Key = typename Space::Type;
+        using Distance = typename Space::Distance;
+        using namespace unc::robotics::nigh;
+        using NN = Nigh<Key, Space, Identity, Concurrent, Strategy>;
+
+        Sampler<Key, typename Space::Metric> sampler(space);
+
+        for (unsigned queryPercent : options.queryPercents) {
+            for (unsigned nThreads = 1 ; nThreads <= options.maxThreads ; nThreads *= 2) {
+                std::mt19937_64 rng(nThreads * 101 + queryPercent);
+
+                std::vector<Key> prefill;
+                prefill.reserve(options.prefill);
+                for (std::size_t i=0 ; i<options.prefill ; ++i)
+                    prefill.push_back(sampler(rng));
+
+                // per thread operations, in order, true for a query
+                std::size_t opsPerThread = options.ops / nThreads;
+                std::vector<std::vector<std::pair<bool, Key>>> work(nThreads);
+                std::uniform_int_distribution<unsigned> percent(0, 99);
+                for (auto& ops : work) {
+                    ops.reserve(opsPerThread);
+                    for (std::size_t i=0 ; i<opsPerThread ; ++i)
+                        ops.emplace_back(percent(rng) < queryPercent, sampler(rng));
+                }
+
+                std::vector<std::vector<double>> latencies(nThreads);
+                for (auto& l : latencies)
+                    l.reserve(opsPerThread);
+
+                long long memoryBefore = heapBytes();
+                NN nn(space);
+                for (const Key& q : prefill)
+                    nn.insert(q);
+
+                std::atomic<unsigned> ready{0};
+                std::atomic<bool> go{false};
+                std::vector<std::thread> threads;
+                threads.reserve(nThreads);
+                for (unsigned t=0 ; t<nThreads ; ++t) {
+                    threads.emplace_back([&, t] {
+                        std::vector<std::pair<Key, Distance>> nbh;
+                        nbh.reserve(options.k + 1);
+                        ++ready;
+                        while (!go.load(std::memory_order_acquire))
+                            std::this_thread::yield();
+                        for (const auto& [query, q] : work[t]) {
+                            auto start = Clock::now();
+                            if (query)
+                                nn.nearest(nbh, q, options.k);
+                            else
+                                nn.insert(q);
+                            latencies[t].push_back(
+                                std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+                        }
+                    });
+                }
+
+                while (ready.load() < nThreads)
+                    std::this_thread::yield();
+                auto start = Clock::now();
+                go.store(true, std::memory_order_release);
+                for (std::thread& t : threads)
+                    t.join();
+                double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+                long long memoryAfter = heapBytes();
+
+                std::vector<double> all;
+                for (const auto& l : latencies)
+                    all.insert(all.end(), l.begin(), l.end());
+                auto percentile = [&] (double p) {
+                    if (all.empty())
+                        return std::nan("");
+                    auto it = all.begin() + static_cast<std::size_t>(p * (all.size() - 1));
+                    std::nth_element(all.begin(), it, all.end());
+                    return *it;
+                };
+                double p50 = percentile(0.50);
+                double p99 = percentile(0.99);
+
+                long long memory = (memoryBefore < 0 || memoryAfter < 0) ? -1 : memoryAfter - memoryBefore;
+
+                std::cout << label
+                          << ",\"" << Name<Strategy>::name() << '"'
+                          << ',' << nThreads
+                          << ',' << queryPercent
+                          << ',' << nn.size()
+                          << ',' << all.size()
+                          << ',' << seconds
+                          << ',' << all.size() / seconds
+                          << ',' << p50
+                          << ',' << p99
+                          << ',' << memory
+                          << ',' << (memory < 0 ? std::nan("") : static_cast<double>(memory) / nn.size())
+                          << std::endl;
+            }
+        }
+    }
+}
+
+#endif
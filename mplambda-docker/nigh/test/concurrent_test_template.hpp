@@ -45,6 +45,8 @@
 #include <random>
 #include <algorithm>
 #include <thread>
+#include <chrono>
+#include <iostream>
 #include "sampler_lp.hpp"
 #include "sampler_so2.hpp"
 #include "sampler_so3.hpp"
@@ -132,11 +134,15 @@ namespace nigh_test {
         }
     };
 
+    // runs nThreads concurrent writer/reader threads, each inserting
+    // N elements, then checks the contents of the resulting nearest
+    // neighbor structure.  Returns the elapsed time in seconds.
     template <typename Strategy, typename Space>
-    void runConcurrentTest(
-        const Space& space = Space(),
-        std::size_t N = 10000,
-        std::size_t K = 20)
+    double runConcurrentTest(
+        const Space& space,
+        std::size_t N,
+        std::size_t K,
+        unsigned nThreads)
     {
         using namespace unc::robotics::nigh;
         using Key = typename Space::Type;
@@ -146,9 +152,7 @@ namespace nigh_test {
 
         NN nn(space);
 
-        unsigned nThreads = std::thread::hardware_concurrency();
-        EXPECT(nThreads) > 1u;
-
+        auto start = std::chrono::steady_clock::now();
         std::vector<TestThread<NN>> threads;
         threads.reserve(nThreads);
         for (unsigned i=0 ; i<nThreads ; ++i)
@@ -156,6 +160,7 @@ namespace nigh_test {
 
         for (auto& t : threads)
             t.thread_.join();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
 
         for (auto& t : threads)
             if (t.eptr_)
@@ -176,5 +181,104 @@ namespace nigh_test {
             EXPECT(!!bits[n.thread_][n.index_]) == false;
             bits[n.thread_][n.index_] = true;
         }
+
+        return elapsed.count();
+    }
+
+    template <typename Strategy, typename Space>
+    void runConcurrentTest(
+        const Space& space = Space(),
+        std::size_t N = 10000,
+        std::size_t K = 20)
+    {
+        unsigned nThreads = std::thread::hardware_concurrency();
+        EXPECT(nThreads) > 1u;
+
+        runConcurrentTest<Strategy>(space, N, K, nThreads);
+    }
+
+    struct NoExtraCheck {
+        template <typename NN, typename Linear, typename Queries>
+        void operator () (const NN&, const Linear&, const Queries&) const {}
+    };
+
+    // concurrently inserts N elements from nThreads threads, then
+    // checks that 200 K-nearest queries against the result match a
+    // linear scan.  extraCheck(nn, linear, queries) is then called
+    // with the built structure, the linear reference and the queries
+    // so that strategies can check anything else they support.
+    template <typename Strategy, typename Space, typename ExtraCheck = NoExtraCheck>
+    void runConcurrentMatchLinearTest(
+        const Space& space,
+        std::size_t N,
+        unsigned nThreads,
+        const ExtraCheck& extraCheck = ExtraCheck())
+    {
+        using namespace unc::robotics::nigh;
+        using State = typename Space::Type;
+        using Distance = typename Space::Distance;
+        using Node = TestNode<State>;
+        static constexpr std::size_t K = 20;
+
+        Nigh<Node, Space, TestNodeKey<State>, Concurrent, Strategy> nn(space);
+        Nigh<Node, Space, TestNodeKey<State>, NoThreadSafety, Linear> linear(space);
+
+        std::vector<Node> nodes;
+        std::mt19937_64 rng(1);
+        Sampler<State, typename Space::Metric> sampler(space);
+        for (std::size_t i=0 ; i<N ; ++i)
+            nodes.emplace_back(i % nThreads, i, sampler(rng));
+
+        std::vector<std::thread> threads;
+        for (unsigned t=0 ; t<nThreads ; ++t)
+            threads.emplace_back([&, t] {
+                for (std::size_t i=t ; i<N ; i += nThreads)
+                    nn.insert(nodes[i]);
+            });
+        for (auto& t : threads)
+            t.join();
+
+        for (const Node& n : nodes)
+            linear.insert(n);
+        EXPECT(nn.size()) == N;
+        EXPECT(nn.list().size()) == N;
+
+        std::vector<std::pair<Node, Distance>> nbh;
+        std::vector<std::pair<Node, Distance>> expected;
+        std::vector<State> queries;
+        for (std::size_t i=0 ; i<200 ; ++i) {
+            State q = sampler(rng);
+            queries.push_back(q);
+            nn.nearest(nbh, q, K);
+            linear.nearest(expected, q, K);
+            EXPECT(nbh.size()) == expected.size();
+            for (std::size_t j=0 ; j<nbh.size() ; ++j)
+                EXPECT(nbh[j].second) == expected[j].second;
+
+            auto nearest = nn.nearest(q);
+            EXPECT(!!nearest) == true;
+            EXPECT(nearest->second) == expected[0].second;
+        }
+
+        extraCheck(nn, linear, queries);
+    }
+
+    // runs the same total number of inserts and queries split across
+    // 1, 2, 4, ... threads, up to at least 4 threads (oversubscribing
+    // the hardware if necessary to exercise contention), and reports
+    // the throughput at each thread count.
+    template <typename Strategy, typename Space>
+    void runConcurrentScalingTest(
+        const Space& space = Space(),
+        std::size_t N = 40000,
+        std::size_t K = 20)
+    {
+        unsigned maxThreads = std::max(std::thread::hardware_concurrency(), 4u);
+        for (unsigned nThreads = 1 ; nThreads <= maxThreads ; nThreads *= 2) {
+            double elapsed = runConcurrentTest<Strategy>(space, N / nThreads, K, nThreads);
+            std::clog << "  " << nThreads << " threads: "
+                      << (N / nThreads) * nThreads / elapsed << " inserts+queries/s"
+                      << std::endl;
+        }
     }
 }
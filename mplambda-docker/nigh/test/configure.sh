@@ -192,6 +192,20 @@ for src in *_test.cpp ; do
 	EOF
 done
 
+######################################################################
+# Create benchmarks for all files that match '*_bench.cpp'
+benches=""
+for src in *_bench.cpp ; do
+    base="${src%.*}"
+    benches+=" $base"
+    cat <<-EOF >&3
+	build \$builddir/$base: cxx $src
+	  ndebug = -DNDEBUG
+	build \$builddir/$base.dat: bench \$builddir/$base
+	build $base: phony \$builddir/$base.dat
+	EOF
+done
+
 ######################################################################
 # Create generated test cases and benchmarks
 GENDIR="generated"
@@ -288,7 +302,7 @@ for space in l1_2 l2_3 linf_7 so2_1 so2_7 so3 se3 se3r scaled_se3_7_3 scaled_se3
                         ;;
                 esac
                 
-                for strategy in batch_8 median linear gnat ; do
+                for strategy in batch_8 batch_8i median linear gnat ; do
                     concurrency_list="rw"
                     [[ $space = l2_3 && $state = eigen_vector && $value = state ]] &&
                         concurrency_list="rw ro nt"
@@ -297,6 +311,10 @@ for space in l1_2 l2_3 linf_7 so2_1 so2_7 so3 se3 se3r scaled_se3_7_3 scaled_se3
                             strat_include="linear.hpp"
                             strategy_type=Linear
                             ;;
+                        batch_*i)
+                            strat_include="kdtree_batch.hpp"
+                            strategy_type="KDTreeBatch<$(echo ${strategy#*_} | tr -d i), true>"
+                            ;;
                         batch_*)
                             strat_include="kdtree_batch.hpp"
                             strategy_type="KDTreeBatch<${strategy#*_}>"
@@ -361,7 +379,7 @@ for space in l2_3 so3 so2_7 se3 scaled_se3_7_3 ; do
     #     se3) state=tuple ;;
     #     scaled_se3_7_3) state=tuple ;;
     # esac
-    for strategy in batch_8 median linear gnat ; do
+    for strategy in batch_8 batch_8i median linear gnat ; do
         echo -n " \$builddir/$GENDIR/${space}_double_${strategy}_bench.dat" >&3
     done
     printf "\n  title = " >&3
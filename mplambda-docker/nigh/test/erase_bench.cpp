@@ -0,0 +1,138 @@
+// Software License Agreement (BSD-3-Clause)
+//
+// Copyright 2018 The University of North Carolina at Chapel Hill
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+// OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//! @author Jeff Ichnowski
+
+// Measures k-nearest query time on a KDTreeBatch as it is
+// progressively pruned.  This mimics the informed pruning of an
+// asymptotically-optimal planner: elements outside of a shrinking
+// ball are removed, and queries are drawn from inside the ball.  For
+// each radius the output reports the query time on the unpruned
+// tree, on the pruned tree, and on a tree rebuilt from only the live
+// elements (the lower bound for pruning with tombstones).
+
+#include "bench_template.hpp"
+
+namespace nigh_test {
+    template <typename State, typename Space, typename Concurrency>
+    void runEraseBench(int argc, char *argv[], const Space& space, const Concurrency&) {
+        using Clock = std::chrono::steady_clock;
+        using Distance = typename Space::Distance;
+        using namespace unc::robotics::nigh;
+        using NN = Nigh<State, Space, Identity, Concurrency, KDTreeBatch<>>;
+
+        static constexpr std::size_t nQueries = 10000;
+
+        std::size_t N = 100000;
+        std::size_t K = 20;
+
+        for (int opt ; (opt = getopt(argc, argv, "n:k:")) != -1 ; ) {
+            switch (opt) {
+            case 'n':
+                N = std::atoi(optarg);
+                break;
+            case 'k':
+                K = std::atoi(optarg);
+                break;
+            default:
+                std::cerr << "Usage: " << argv[0] << " [-n nn-size] [-k query-size]" << std::endl;
+                return;
+            }
+        }
+
+        Sampler<State, typename Space::Metric> sampler(space);
+        std::mt19937_64 rng;
+
+        NN full(space);
+        NN pruned(space);
+        std::vector<State> states;
+        states.reserve(N);
+        while (states.size() < N) {
+            states.push_back(sampler(rng));
+            full.insert(states.back());
+            pruned.insert(states.back());
+        }
+
+        std::vector<std::pair<State, Distance>> nbh;
+        nbh.reserve(K+1);
+
+        auto queryTime = [&] (const NN& nn, const std::vector<State>& queries) {
+            auto start = Clock::now();
+            for (const State& q : queries)
+                nn.nearest(nbh, q, K);
+            return std::chrono::duration<double, std::milli>(Clock::now() - start).count() / queries.size();
+        };
+
+        std::cout << "# State = " << Name<State>::name() << std::endl;
+        std::cout << "# Metric = " << Name<typename Space::Metric>::name() << std::endl;
+        std::cout << "# Strategy = " << Name<KDTreeBatch<>>::name() << std::endl;
+        std::cout << "# Concurrency = " << Name<Concurrency>::name() << std::endl;
+        std::cout << "# k = " << K << std::endl;
+        std::cout << "# radius live_size erase_ms full_ms_per_query pruned_ms_per_query rebuilt_ms_per_query" << std::endl;
+
+        const State origin = State::Zero();
+        for (Distance r = 8 ; r > 1 ; r *= 0.8) {
+            std::vector<State> queries;
+            queries.reserve(nQueries);
+            while (queries.size() < nQueries) {
+                State q = sampler(rng);
+                if (space.distance(q, origin) <= r)
+                    queries.push_back(q);
+            }
+
+            auto start = Clock::now();
+            pruned.erase_if([&] (const State& q) { return space.distance(q, origin) > r; });
+            double eraseTime = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+            std::vector<State> live = pruned.list();
+            NN rebuilt(space);
+            rebuilt.insert(live.begin(), live.end());
+
+            std::cout << r
+                      << '\t' << pruned.size()
+                      << '\t' << eraseTime
+                      << '\t' << queryTime(full, queries)
+                      << '\t' << queryTime(pruned, queries)
+                      << '\t' << queryTime(rebuilt, queries)
+                      << std::endl;
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    using namespace unc::robotics::nigh;
+    using namespace nigh_test;
+
+    metric::L2Space<double, 3> space;
+    runEraseBench<Eigen::Vector3d>(argc, argv, space, Concurrent{});
+}
@@ -0,0 +1,187 @@
+// Software License Agreement (BSD-3-Clause)
+//
+// Copyright 2018 The University of North Carolina at Chapel Hill
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+// OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//! @author Jeff Ichnowski
+
+#include "test.hpp"
+#include <nigh/lp_space.hpp>
+#include <nigh/so3_space.hpp>
+#include <nigh/se3_space.hpp>
+#include <nigh/kdtree_batch.hpp>
+#include <nigh/linear.hpp>
+#include <random>
+#include <thread>
+#include "sampler_lp.hpp"
+#include "sampler_so3.hpp"
+#include "sampler_cartesian.hpp"
+#include "linear_reference.hpp"
+
+using namespace unc::robotics::nigh;
+using nigh_test::IndexedNode;
+using nigh_test::IndexedNodeKey;
+
+namespace {
+    // Inserts N nodes, removes every other one, then inserts N more
+    // (forcing leaves with tombstones to compact), and checks that
+    // queries match a linear scan of the live nodes.
+    template <typename Concurrency, typename Space>
+    void eraseTest(const Space& space, std::size_t N) {
+        using State = typename Space::Type;
+        using N_ = IndexedNode<State>;
+        static constexpr std::size_t K = 20;
+
+        std::mt19937_64 rng(N);
+        std::vector<N_> nodes = nigh_test::sampleNodes(space, 2*N, rng);
+
+        Nigh<N_, Space, IndexedNodeKey<State>, Concurrency, KDTreeBatch<8>> nn(space);
+
+        for (std::size_t i=0 ; i<N ; ++i)
+            nn.insert(nodes[i]);
+
+        for (std::size_t i=0 ; i<N ; i += 2)
+            EXPECT(nn.erase(nodes[i])) == true;
+
+        // already removed
+        EXPECT(nn.erase(nodes[0])) == false;
+        // never inserted
+        EXPECT(nn.erase(nodes[N])) == false;
+
+        EXPECT(nn.size()) == N/2;
+        EXPECT(nn.list().size()) == N/2;
+
+        std::vector<N_> live;
+        for (std::size_t i=1 ; i<N ; i += 2)
+            live.push_back(nodes[i]);
+        for (std::size_t i=N ; i<2*N ; ++i) {
+            nn.insert(nodes[i]);
+            live.push_back(nodes[i]);
+        }
+
+        EXPECT(nn.list().size()) == live.size();
+        nigh_test::expectNearestMatchesLinear(nn, live, rng, K, 100, nigh_test::Match::kIndex);
+
+        for (std::size_t i=0 ; i<N ; i += 2) {
+            auto n = nn.nearest(nodes[i].state_);
+            EXPECT(n.has_value()) == true;
+            EXPECT(n->first.index_ != i) == true;
+        }
+    }
+}
+
+TEST(erase_l2) {
+    eraseTest<NoThreadSafety>(L2Space<double, 3>{}, 3000);
+}
+
+TEST(erase_l2_concurrent) {
+    eraseTest<Concurrent>(L2Space<double, 3>{}, 3000);
+}
+
+TEST(erase_so3) {
+    eraseTest<Concurrent>(SO3Space<double>{}, 2000);
+}
+
+TEST(erase_se3) {
+    eraseTest<ConcurrentRead>(SE3Space<double>{}, 2000);
+}
+
+TEST(erase_all) {
+    using State = Eigen::Vector3d;
+    using Space = L2Space<double, 3>;
+    using N_ = IndexedNode<State>;
+    Space space;
+    std::mt19937_64 rng;
+
+    Nigh<N_, Space, IndexedNodeKey<State>, Concurrent, KDTreeBatch<8>> nn(space);
+    std::vector<N_> nodes = nigh_test::sampleNodes(space, 500, rng);
+    for (const N_& n : nodes)
+        nn.insert(n);
+
+    std::size_t count = nn.erase_if([] (const N_& n) { return n.index_ % 3 != 0; });
+    EXPECT(count) == 333u;
+    EXPECT(nn.size()) == 167u;
+    count = nn.erase_if([] (const N_&) { return true; });
+    EXPECT(count) == 167u;
+    EXPECT(nn.size()) == 0u;
+    EXPECT(nn.nearest(nodes[0].state_).has_value()) == false;
+
+    nn.insert(nodes[0]);
+    EXPECT(nn.nearest(nodes[1].state_)->first.index_) == 0u;
+}
+
+TEST(erase_threads) {
+    using State = Eigen::Vector3d;
+    using Space = L2Space<double, 3>;
+    using N_ = IndexedNode<State>;
+    static constexpr std::size_t nThreads = 4;
+    static constexpr std::size_t nPerThread = 5000;
+
+    Space space;
+    Nigh<N_, Space, IndexedNodeKey<State>, Concurrent, KDTreeBatch<8>> nn(space);
+
+    std::vector<std::vector<N_>> nodes;
+    for (std::size_t t=0 ; t<nThreads ; ++t) {
+        std::mt19937_64 rng(t);
+        nodes.push_back(nigh_test::sampleNodes(space, nPerThread, rng, t*nPerThread));
+    }
+
+    // each thread inserts its nodes and erases every other one
+    // shortly after inserting it, while the other threads are
+    // splitting and compacting leaves.
+    std::atomic_bool failed{false};
+    std::vector<std::thread> threads;
+    for (std::size_t t=0 ; t<nThreads ; ++t) {
+        threads.emplace_back([&, t] {
+            for (std::size_t i=0 ; i<nPerThread ; ++i) {
+                nn.insert(nodes[t][i]);
+                if (i >= 10 && (i % 2) == 0 && !nn.erase(nodes[t][i-10]))
+                    failed = true;
+            }
+        });
+    }
+    for (auto& t : threads)
+        t.join();
+
+    EXPECT(failed.load()) == false;
+
+    std::size_t expected = 0;
+    for (std::size_t t=0 ; t<nThreads ; ++t) {
+        for (std::size_t i=0 ; i<nPerThread ; ++i) {
+            bool erased = i+10 < nPerThread && (i % 2) == 0;
+            expected += !erased;
+            auto n = nn.nearest(nodes[t][i].state_);
+            EXPECT(n->first.index_ == nodes[t][i].index_) == !erased;
+        }
+    }
+    EXPECT(nn.size()) == expected;
+    EXPECT(nn.list().size()) == expected;
+}
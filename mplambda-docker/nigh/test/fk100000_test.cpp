@@ -39,6 +39,7 @@
 #include <nigh/lp_space.hpp>
 #include <nigh/so2_space.hpp>
 #include <nigh/kdtree_batch.hpp>
+#include <nigh/huge_page_allocator.hpp>
 #include <fstream>
 
 namespace nigh_test {
@@ -71,11 +72,11 @@ namespace nigh_test {
     }
 }
 
-TEST(fkmap100000_double) {
+template <typename Strategy, template <typename> class Allocator = std::allocator>
+static void fkmap100000() {
     using namespace unc::robotics::nigh;
 
     using Scalar = double;
-    using Strategy = KDTreeBatch<>;
     using Space = CartesianSpace<SO2LPSpace<Scalar, 3>, L1Space<Scalar, 3>>;
     using State = typename Space::Type;
     using Data = Eigen::Matrix<Scalar, 3, 1>;
@@ -93,7 +94,7 @@ TEST(fkmap100000_double) {
 
     Space space;
 
-    Nigh<Node, Space, KeyFn, Concurrent, Strategy> nn(space);
+    Nigh<Node, Space, KeyFn, Concurrent, Strategy, Allocator<Node>> nn(space);
 
     nigh_test::loadFK<Scalar>(
         "fkmap100000.txt",
@@ -101,3 +102,15 @@ TEST(fkmap100000_double) {
             nn.insert(Node{q, data});
         });
 }
+
+TEST(fkmap100000_double) {
+    fkmap100000<unc::robotics::nigh::KDTreeBatch<>>();
+}
+
+TEST(fkmap100000_double_inline_keys) {
+    fkmap100000<unc::robotics::nigh::KDTreeBatch<8, true>>();
+}
+
+TEST(fkmap100000_double_huge_pages) {
+    fkmap100000<unc::robotics::nigh::KDTreeBatch<>, unc::robotics::nigh::HugePageAllocator>();
+}
@@ -0,0 +1,77 @@
+// Software License Agreement (BSD-3-Clause)
+//
+// Copyright 2018 The University of North Carolina at Chapel Hill
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+// OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//! @author Jeff Ichnowski
+
+#include "concurrent_test_template.hpp"
+#include <nigh/lp_space.hpp>
+#include <nigh/so3_space.hpp>
+#include <nigh/se3_space.hpp>
+#include <nigh/auto_strategy.hpp>
+
+using namespace unc::robotics::nigh;
+using namespace nigh_test;
+
+namespace {
+    // small leaves and degrees to force frequent splits under
+    // contention.
+    using SmallGNAT = GNAT<4, 2, 6, 8>;
+}
+
+TEST(auto_strategy_non_space) {
+    EXPECT((std::is_same_v<auto_strategy_t<void, Concurrent, true>, GNAT<>>)) == true;
+}
+
+TEST(scaling_l2_3) {
+    runConcurrentScalingTest<GNAT<>>(L2Space<double, 3>());
+}
+
+TEST(scaling_so3) {
+    runConcurrentScalingTest<GNAT<>>(SO3Space<double>());
+}
+
+TEST(scaling_se3_small) {
+    runConcurrentScalingTest<SmallGNAT>(SE3Space<double>(), 20000);
+}
+
+TEST(match_linear_l2_3) {
+    runConcurrentMatchLinearTest<GNAT<>>(L2Space<double, 3>(), 20000, 4);
+}
+
+TEST(match_linear_l1_6_small) {
+    runConcurrentMatchLinearTest<SmallGNAT>(L1Space<float, 6>(), 20000, 4);
+}
+
+TEST(match_linear_so3_small) {
+    runConcurrentMatchLinearTest<SmallGNAT>(SO3Space<double>(), 20000, 4);
+}
@@ -0,0 +1,224 @@
+// Software License Agreement (BSD-3-Clause)
+//
+// Copyright 2018 The University of North Carolina at Chapel Hill
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+// OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//! @author Jeff Ichnowski
+
+#include "test.hpp"
+#include <nigh/lp_space.hpp>
+#include <nigh/so3_space.hpp>
+#include <nigh/kdtree_batch.hpp>
+#include <nigh/kdtree_median.hpp>
+#include <nigh/linear.hpp>
+#include <nigh/huge_page_allocator.hpp>
+#include <random>
+#include <thread>
+#include "sampler_lp.hpp"
+#include "sampler_so3.hpp"
+#include "linear_reference.hpp"
+
+using namespace unc::robotics::nigh;
+using nigh_test::IndexedNode;
+using nigh_test::IndexedNodeKey;
+
+namespace {
+    template <typename State>
+    using Alloc = HugePageAllocator<IndexedNode<State>>;
+
+    // neighbors per query checked against a linear scan
+    constexpr std::size_t K = 10;
+
+    // Inserts, erases (which compacts leaves) and clears a
+    // KDTreeBatch that allocates from resource.
+    template <typename Concurrency, typename Space>
+    void batchTest(HugePageResource& resource, const Space& space, std::size_t N) {
+        using State = typename Space::Type;
+        using N_ = IndexedNode<State>;
+
+        std::mt19937_64 rng(N);
+
+        Nigh<N_, Space, IndexedNodeKey<State>, Concurrency, KDTreeBatch<8>, Alloc<State>>
+            nn(space, IndexedNodeKey<State>(), Alloc<State>(&resource));
+        EXPECT(nn.get_allocator().resource() == &resource) == true;
+
+        std::vector<N_> nodes = nigh_test::sampleNodes(space, N, rng);
+        for (const N_& n : nodes)
+            nn.insert(n);
+        EXPECT(resource.mappedBytes() > 0) == true;
+        nigh_test::expectNearestMatchesLinear(nn, nodes, rng, K, 50, nigh_test::Match::kIndex);
+
+        std::vector<N_> live;
+        for (const N_& n : nodes) {
+            if (n.index_ % 3)
+                live.push_back(n);
+            else
+                EXPECT(nn.erase(n)) == true;
+        }
+        for (const N_& n : nigh_test::sampleNodes(space, N/2, rng, N)) {
+            live.push_back(n);
+            nn.insert(n);
+        }
+        nigh_test::expectNearestMatchesLinear(nn, live, rng, K, 50, nigh_test::Match::kIndex);
+
+        nn.relayout();
+        nigh_test::expectNearestMatchesLinear(nn, live, rng, K, 50, nigh_test::Match::kIndex);
+
+        nn.clear();
+        EXPECT(nn.size()) == 0;
+    }
+}
+
+TEST(resource_reuse) {
+    HugePageResource resource(HugePageOptions{HugePages::kNone, 1});
+    EXPECT(resource.options().regionSize) == std::size_t(2) << 20;
+    EXPECT(resource.mappedBytes()) == 0;
+
+    void *a = resource.allocate(24, 8);
+    void *b = resource.allocate(24, 8);
+    EXPECT(resource.mappedBytes()) == std::size_t(2) << 20;
+    EXPECT(reinterpret_cast<std::uintptr_t>(a) % 64) == 0;
+    EXPECT(static_cast<char*>(b) - static_cast<char*>(a)) == 64;
+
+    // freed blocks are reused by allocations of the same class
+    resource.deallocate(a, 24, 8);
+    EXPECT(resource.allocate(60, 8)) == a;
+    resource.deallocate(b, 24, 8);
+    EXPECT(resource.allocate(100, 8) == b) == false;
+
+    for (std::size_t align : { 128, 256, 4096 }) {
+        void *p = resource.allocate(100, align);
+        EXPECT(reinterpret_cast<std::uintptr_t>(p) % align) == 0;
+        std::memset(p, 0xff, 100);
+        resource.deallocate(p, 100, align);
+        EXPECT(resource.allocate(100, align)) == p;
+    }
+
+    // large allocations are mapped and unmapped on their own
+    std::size_t mapped = resource.mappedBytes();
+    void *large = resource.allocate(std::size_t(3) << 20, 8);
+    EXPECT(resource.mappedBytes()) == mapped + (std::size_t(4) << 20);
+    std::memset(large, 0, std::size_t(3) << 20);
+    resource.deallocate(large, std::size_t(3) << 20, 8);
+    EXPECT(resource.mappedBytes()) == mapped;
+}
+
+TEST(allocator_rebind) {
+    HugePageResource resource;
+    HugePageAllocator<double> a(&resource);
+    HugePageAllocator<char> b(a);
+    EXPECT(a == b) == true;
+    EXPECT(a == HugePageAllocator<double>()) == false;
+    EXPECT(HugePageAllocator<int>() == HugePageAllocator<double>()) == true;
+
+    std::vector<int, HugePageAllocator<int>> v(HugePageAllocator<int>{&resource});
+    for (int i=0 ; i<1000000 ; ++i)
+        v.push_back(i);
+    EXPECT(v[999999]) == 999999;
+}
+
+TEST(kdtree_batch_l2) {
+    HugePageResource resource;
+    batchTest<NoThreadSafety>(resource, L2Space<double, 3>(), 5000);
+    batchTest<Concurrent>(resource, L2Space<double, 3>(), 5000);
+}
+
+TEST(kdtree_batch_so3) {
+    HugePageResource resource(HugePageOptions{HugePages::kTransparent, std::size_t(4) << 20, true});
+    batchTest<NoThreadSafety>(resource, SO3Space<double>(), 5000);
+    batchTest<Concurrent>(resource, SO3Space<double>(), 5000);
+}
+
+TEST(kdtree_batch_explicit) {
+    // falls back to transparent huge pages if none are reserved.
+    HugePageResource resource(HugePageOptions{HugePages::kExplicit});
+    batchTest<Concurrent>(resource, L2Space<double, 3>(), 2000);
+    EXPECT(resource.pages() != HugePages::kNone) == true;
+}
+
+TEST(kdtree_batch_concurrent_inserts) {
+    using Space = SO3Space<double>;
+    using State = typename Space::Type;
+    using N_ = IndexedNode<State>;
+    static constexpr std::size_t N = 4000;
+    static constexpr unsigned kThreads = 4;
+
+    HugePageResource resource(HugePageOptions{HugePages::kTransparent, 0, true});
+    Nigh<N_, Space, IndexedNodeKey<State>, Concurrent, KDTreeBatch<8>, Alloc<State>>
+        nn(Space{}, IndexedNodeKey<State>{}, Alloc<State>(&resource));
+
+    std::mt19937_64 rng(N);
+    std::vector<N_> nodes = nigh_test::sampleNodes(nn.metricSpace(), N, rng);
+
+    std::vector<std::thread> threads;
+    for (unsigned t=0 ; t<kThreads ; ++t)
+        threads.emplace_back([&, t] {
+            for (std::size_t i=t ; i<N ; i+=kThreads)
+                nn.insert(nodes[i]);
+        });
+    for (auto& thread : threads)
+        thread.join();
+
+    nigh_test::expectNearestMatchesLinear(nn, nodes, rng, K, 50, nigh_test::Match::kIndex);
+}
+
+TEST(kdtree_median_so3) {
+    using Space = SO3Space<double>;
+    using State = typename Space::Type;
+    using N_ = IndexedNode<State>;
+    static constexpr std::size_t N = 20000;
+
+    HugePageResource resource;
+    Nigh<N_, Space, IndexedNodeKey<State>, NoThreadSafety, KDTreeMedian<>, Alloc<State>>
+        nn(Space{}, IndexedNodeKey<State>{}, Alloc<State>(&resource));
+    nn.setBuildThreads(4);
+
+    std::mt19937_64 rng(N);
+    std::vector<N_> nodes = nigh_test::sampleNodes(nn.metricSpace(), N, rng);
+    for (const N_& n : nodes)
+        nn.insert(n);
+    nigh_test::expectNearestMatchesLinear(nn, nodes, rng, K, 50, nigh_test::Match::kIndex);
+}
+
+TEST(linear) {
+    using Space = L2Space<double, 3>;
+    using State = typename Space::Type;
+    using N_ = IndexedNode<State>;
+
+    Nigh<N_, Space, IndexedNodeKey<State>, NoThreadSafety, Linear, Alloc<State>> nn;
+    EXPECT(nn.get_allocator().resource()) == HugePageResource::defaultResource();
+
+    std::mt19937_64 rng(1);
+    std::vector<N_> nodes = nigh_test::sampleNodes(nn.metricSpace(), 1000, rng);
+    for (const N_& n : nodes)
+        nn.insert(n);
+    nigh_test::expectNearestMatchesLinear(nn, nodes, rng, K, 50, nigh_test::Match::kIndex);
+}
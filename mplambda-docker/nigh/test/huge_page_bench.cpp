@@ -0,0 +1,172 @@
+// Software License Agreement (BSD-3-Clause)
+//
+// Copyright 2018 The University of North Carolina at Chapel Hill
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+// OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//! @author Jeff Ichnowski
+
+// Compares std::allocator with HugePageAllocator for trees built by
+// single inserts.  The fk workload has the state space and node type
+// of fk100000_test (with uniform random states instead of the data
+// file), and the so3 workload uses the SO(3) space.  For each
+// allocator, prints the mean time per insert, the mean time per
+// query, and the last-level cache misses per query (NaN when the
+// perf counter is not available, see LLCMissCounter).
+
+#include "bench_template.hpp"
+#include <nigh/cartesian_space.hpp>
+#include <nigh/so2_space.hpp>
+#include <nigh/huge_page_allocator.hpp>
+
+namespace nigh_test {
+    template <typename Space, typename Data>
+    struct FKNode {
+        typename Space::Type state_;
+        Data data_;
+    };
+
+    template <typename Space, typename Data>
+    struct FKNodeKey {
+        const typename Space::Type& operator() (const FKNode<Space, Data>& n) const {
+            return n.state_;
+        }
+    };
+
+    template <typename Strategy, typename Concurrency, typename Space, typename Allocator>
+    void runHugePageBench(
+        const std::string& label, const std::string& allocLabel,
+        const Space& space, const Allocator& allocator,
+        std::size_t N, std::size_t K, std::size_t nQueries)
+    {
+        using Clock = std::chrono::steady_clock;
+        using State = typename Space::Type;
+        using Distance = typename Space::Distance;
+        using Data = Eigen::Matrix<double, 3, 1>;
+        using Node = FKNode<Space, Data>;
+        using namespace unc::robotics::nigh;
+
+        Sampler<State, typename Space::Metric> sampler(space);
+        std::mt19937_64 rng;
+
+        std::vector<Node> nodes;
+        for (std::size_t i=0 ; i<N ; ++i)
+            nodes.push_back(Node{sampler(rng), Data::Constant(double(i))});
+
+        std::vector<State> queries;
+        for (std::size_t i=0 ; i<nQueries ; ++i)
+            queries.push_back(sampler(rng));
+
+        Nigh<Node, Space, FKNodeKey<Space, Data>, Concurrency, Strategy, Allocator>
+            nn(space, FKNodeKey<Space, Data>{}, allocator);
+
+        auto start = Clock::now();
+        for (const Node& n : nodes)
+            nn.insert(n);
+        double insertUs = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / N;
+
+        LLCMissCounter llcMisses;
+        std::vector<std::pair<Node, Distance>> nbh;
+        Distance sum = 0;
+        llcMisses.start();
+        start = Clock::now();
+        for (const State& q : queries) {
+            nn.nearest(nbh, q, K);
+            sum += nbh.back().second;
+        }
+        double queryUs = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / nQueries;
+        llcMisses.stop();
+
+        std::cout << label
+                  << '\t' << Name<Strategy>::name()
+                  << '\t' << allocLabel
+                  << '\t' << insertUs
+                  << '\t' << queryUs
+                  << '\t' << llcMisses.perQuery(nQueries)
+                  << "\t# " << sum << std::endl;
+    }
+
+    template <typename Strategy, typename Concurrency, typename Space>
+    void runHugePageBenches(
+        const std::string& label, const Space& space,
+        std::size_t N, std::size_t K, std::size_t nQueries)
+    {
+        using namespace unc::robotics::nigh;
+        using Node = FKNode<Space, Eigen::Matrix<double, 3, 1>>;
+
+        runHugePageBench<Strategy, Concurrency>(
+            label, "std", space, std::allocator<Node>(), N, K, nQueries);
+
+        for (auto [pages, allocLabel] : {
+                std::pair(HugePages::kNone, "none"),
+                std::pair(HugePages::kTransparent, "transparent"),
+                std::pair(HugePages::kExplicit, "explicit") })
+        {
+            HugePageResource resource(HugePageOptions{pages});
+            runHugePageBench<Strategy, Concurrency>(
+                label, allocLabel, space, HugePageAllocator<Node>(&resource), N, K, nQueries);
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    using namespace unc::robotics::nigh;
+    using namespace nigh_test;
+
+    std::size_t N = 1000000;
+    std::size_t K = 1;
+    std::size_t Q = 100000;
+
+    for (int opt ; (opt = getopt(argc, argv, "n:k:q:")) != -1 ; ) {
+        switch (opt) {
+        case 'n':
+            N = std::atoi(optarg);
+            break;
+        case 'k':
+            K = std::atoi(optarg);
+            break;
+        case 'q':
+            Q = std::atoi(optarg);
+            break;
+        default:
+            std::cerr << "Usage: " << argv[0] << " [-n nn-size] [-k query-size] [-q query-count]" << std::endl;
+            return 1;
+        }
+    }
+
+    using FKSpace = CartesianSpace<SO2LPSpace<double, 3>, L1Space<double, 3>>;
+
+    std::cout << "# size = " << N << ", k = " << K << ", queries = " << Q << std::endl;
+    std::cout << "# space strategy allocator us_per_insert us_per_query llc_misses_per_query" << std::endl;
+
+    runHugePageBenches<KDTreeBatch<>, Concurrent>("fk", FKSpace{}, N, K, Q);
+    runHugePageBenches<KDTreeBatch<>, Concurrent>("so3", metric::SO3Space<double>{}, N, K, Q);
+    runHugePageBenches<KDTreeMedian<>, NoThreadSafety>("so3", metric::SO3Space<double>{}, N, K, Q);
+}
@@ -0,0 +1,183 @@
+// Software License Agreement (BSD-3-Clause)
+//
+// Copyright 2018 The University of North Carolina at Chapel Hill
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+// OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//! @author Jeff Ichnowski
+
+#include "test.hpp"
+#include <nigh/lp_space.hpp>
+#include <nigh/so3_space.hpp>
+#include <nigh/se3_space.hpp>
+#include <nigh/scaled_space.hpp>
+#include <nigh/kdtree_batch.hpp>
+#include <nigh/linear.hpp>
+#include <random>
+#include <thread>
+#include "sampler_lp.hpp"
+#include "sampler_so3.hpp"
+#include "sampler_cartesian.hpp"
+#include "sampler_scaled.hpp"
+#include "linear_reference.hpp"
+
+using namespace unc::robotics::nigh;
+using nigh_test::IndexedNode;
+using nigh_test::IndexedNodeKey;
+
+namespace {
+    // Builds a tree with inline keys through single inserts, a bulk
+    // insert, and erases, and checks that queries match a linear
+    // scan.  Results are compared by index since the inline distance
+    // may differ from the space's in the last bit.
+    template <typename Concurrency, typename Space>
+    void inlineKeysTest(const Space& space, std::size_t N) {
+        using State = typename Space::Type;
+        using Distance = typename Space::Distance;
+        using N_ = IndexedNode<State>;
+        static constexpr std::size_t K = 20;
+
+        nigh_test::Sampler<State, typename Space::Metric> sampler(space);
+        std::mt19937_64 rng(N);
+        std::vector<N_> nodes = nigh_test::sampleNodes(space, 3*N, rng);
+
+        Nigh<N_, Space, IndexedNodeKey<State>, Concurrency, KDTreeBatch<8, true>> nn(space);
+        nigh_test::LinearReference<Space> linear(space);
+
+        for (std::size_t i=0 ; i<N ; ++i)
+            nn.insert(nodes[i]);
+        nn.insert(nodes.begin() + N, nodes.begin() + 2*N);
+        for (std::size_t i=0 ; i<2*N ; i += 3)
+            EXPECT(nn.erase(nodes[i])) == true;
+        for (std::size_t i=2*N ; i<3*N ; ++i)
+            nn.insert(nodes[i]);
+
+        for (std::size_t i=0 ; i<3*N ; ++i)
+            if (i >= 2*N || i % 3 != 0)
+                linear.insert(nodes[i]);
+
+        EXPECT(nn.size()) == linear.size();
+
+        std::vector<std::pair<N_, Distance>> nbh;
+        std::vector<std::pair<N_, Distance>> expected;
+        for (std::size_t i=0 ; i<100 ; ++i) {
+            State q = sampler(rng);
+            nn.nearest(nbh, q, K);
+            linear.nearest(expected, q, K);
+            EXPECT(nbh.size()) == expected.size();
+            for (std::size_t j=0 ; j<nbh.size() ; ++j)
+                EXPECT(nbh[j].first.index_) == expected[j].first.index_;
+
+            auto n = nn.nearest(q);
+            EXPECT(n.has_value()) == true;
+            EXPECT(n->first.index_) == expected[0].first.index_;
+        }
+    }
+}
+
+TEST(inline_keys_l1) {
+    inlineKeysTest<NoThreadSafety>(L1Space<double, 4>{}, 2000);
+}
+
+TEST(inline_keys_l2) {
+    inlineKeysTest<NoThreadSafety>(L2Space<double, 3>{}, 2000);
+}
+
+TEST(inline_keys_l2_float) {
+    inlineKeysTest<ConcurrentRead>(L2Space<float, 6>{}, 2000);
+}
+
+TEST(inline_keys_linf) {
+    inlineKeysTest<Concurrent>(LInfSpace<double, 7>{}, 2000);
+}
+
+TEST(inline_keys_l3) {
+    inlineKeysTest<NoThreadSafety>(LPSpace<double, 5, 3>{}, 2000);
+}
+
+TEST(inline_keys_l2_dynamic) {
+    // dynamic dimensions store keys as an array of keys
+    inlineKeysTest<NoThreadSafety>(LPSpace<double, -1, 2>{4}, 2000);
+}
+
+TEST(inline_keys_so3) {
+    inlineKeysTest<NoThreadSafety>(SO3Space<double>{}, 2000);
+}
+
+TEST(inline_keys_se3) {
+    inlineKeysTest<Concurrent>(SE3Space<double>{}, 2000);
+}
+
+TEST(inline_keys_so3_float) {
+    inlineKeysTest<NoThreadSafety>(SO3Space<float>{}, 2000);
+}
+
+TEST(inline_keys_se3_50_1) {
+    inlineKeysTest<NoThreadSafety>(SE3Space<double, 50, 1>{}, 2000);
+}
+
+TEST(inline_keys_scaled_se3) {
+    inlineKeysTest<NoThreadSafety>(ScaledSE3Space<double, void>(3.21, L2Space<double, 3>{}), 2000);
+}
+
+TEST(inline_keys_scaled_l1) {
+    inlineKeysTest<NoThreadSafety>(ScaledSpace<L1Space<float, 5>>{0.5f}, 2000);
+}
+
+TEST(inline_keys_concurrent) {
+    using Space = L2Space<double, 3>;
+    using State = typename Space::Type;
+    using N_ = IndexedNode<State>;
+    static constexpr std::size_t N = 4000;
+    static constexpr unsigned nThreads = 4;
+
+    Space space;
+    std::mt19937_64 rng(1);
+    std::vector<N_> nodes = nigh_test::sampleNodes(space, N, rng);
+
+    Nigh<N_, Space, IndexedNodeKey<State>, Concurrent, KDTreeBatch<8, true>> nn(space);
+    std::vector<std::thread> threads;
+    for (unsigned t=0 ; t<nThreads ; ++t)
+        threads.emplace_back([&, t] {
+            for (std::size_t i=t ; i<N ; i += nThreads) {
+                nn.insert(nodes[i]);
+                nn.nearest(nodes[i].state_);
+            }
+        });
+    for (auto& thread : threads)
+        thread.join();
+
+    EXPECT(nn.size()) == N;
+    for (std::size_t i=0 ; i<N ; ++i) {
+        auto n = nn.nearest(nodes[i].state_);
+        EXPECT(n.has_value()) == true;
+        EXPECT(n->first.index_) == i;
+    }
+}
@@ -0,0 +1,132 @@
+// Software License Agreement (BSD-3-Clause)
+//
+// Copyright 2018 The University of North Carolina at Chapel Hill
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+// OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//! @author Jeff Ichnowski
+
+// Measures how KDTreeMedian build time scales with the number of
+// build threads (see setBuildThreads).  Inserting 2^n values ends in
+// a rebuild of a single tree of all 2^n values, the stall that
+// dominates insertion into a large tree.  For each space and thread
+// count, prints the time of that final insert and the total time of
+// all inserts.
+
+#include "bench_template.hpp"
+#include <nigh/se3_space.hpp>
+
+namespace nigh_test {
+    template <typename Space>
+    void runMedianBuildBench(
+        const std::string& label, const Space& space,
+        std::size_t N, unsigned maxThreads)
+    {
+        using Clock = std::chrono::steady_clock;
+        using State = typename Space::Type;
+        using namespace unc::robotics::nigh;
+
+        struct Node {
+            State state_;
+            std::size_t index_;
+        };
+
+        struct NodeKey {
+            const State& operator() (const Node& n) const {
+                return n.state_;
+            }
+        };
+
+        Sampler<State, typename Space::Metric> sampler(space);
+        std::mt19937_64 rng;
+        std::vector<Node> nodes;
+        nodes.reserve(N);
+        for (std::size_t i=0 ; i<N ; ++i)
+            nodes.push_back(Node{sampler(rng), i});
+
+        double baseline = 0;
+        for (unsigned nThreads = 1 ; nThreads <= maxThreads ; nThreads *= 2) {
+            Nigh<Node, Space, NodeKey, NoThreadSafety, KDTreeMedian<>> nn(space);
+            nn.setBuildThreads(nThreads);
+
+            auto start = Clock::now();
+            for (std::size_t i=0 ; i+1<N ; ++i)
+                nn.insert(nodes[i]);
+            auto lastStart = Clock::now();
+            nn.insert(nodes.back());
+            auto end = Clock::now();
+
+            double lastMs = std::chrono::duration<double, std::milli>(end - lastStart).count();
+            double totalMs = std::chrono::duration<double, std::milli>(end - start).count();
+            if (nThreads == 1)
+                baseline = lastMs;
+
+            std::cout << label
+                      << '\t' << N
+                      << '\t' << nThreads
+                      << '\t' << lastMs
+                      << '\t' << totalMs
+                      << '\t' << baseline / lastMs
+                      << "\t# " << nn.nearest(nodes[0].state_)->second << std::endl;
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    using namespace unc::robotics::nigh;
+    using namespace nigh_test;
+
+    unsigned log2N = 20;
+    unsigned T = std::max(1u, std::thread::hardware_concurrency());
+
+    for (int opt ; (opt = getopt(argc, argv, "n:t:")) != -1 ; ) {
+        switch (opt) {
+        case 'n':
+            log2N = std::atoi(optarg);
+            break;
+        case 't':
+            T = std::atoi(optarg);
+            break;
+        default:
+            std::cerr << "Usage: " << argv[0] << " [-n log2-size] [-t max-threads]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::size_t N = std::size_t(1) << log2N;
+
+    std::cout << "# size = " << N << std::endl;
+    std::cout << "# space size threads last_insert_ms total_insert_ms speedup" << std::endl;
+
+    runMedianBuildBench("l2_3", metric::L2Space<double, 3>{}, N, T);
+    runMedianBuildBench("l2_8", metric::L2Space<double, 8>{}, N, T);
+    runMedianBuildBench("so3", metric::SO3Space<double>{}, N, T);
+    runMedianBuildBench("se3", metric::SE3Space<double, 50, 1>{}, N, T);
+}
@@ -0,0 +1,94 @@
+// Software License Agreement (BSD-3-Clause)
+//
+// Copyright 2018 The University of North Carolina at Chapel Hill
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+// OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//! @author Jeff Ichnowski
+
+#include "test.hpp"
+#include <nigh/lp_space.hpp>
+#include <nigh/so3_space.hpp>
+#include <nigh/se3_space.hpp>
+#include <nigh/kdtree_median.hpp>
+#include <random>
+#include "sampler_lp.hpp"
+#include "sampler_so3.hpp"
+#include "sampler_scaled.hpp"
+#include "sampler_cartesian.hpp"
+#include "linear_reference.hpp"
+
+using namespace unc::robotics::nigh;
+using nigh_test::IndexedNode;
+using nigh_test::IndexedNodeKey;
+
+namespace {
+    // Checks that a KDTreeMedian built with multiple threads returns
+    // the same results as a linear scan.  N is large enough that the
+    // rebuilds are split across threads.
+    template <typename Concurrency = NoThreadSafety, typename Space>
+    void parallelBuildTest(const Space& space, std::size_t N = 20000) {
+        using State = typename Space::Type;
+        using N_ = IndexedNode<State>;
+        static constexpr std::size_t K = 10;
+
+        std::mt19937_64 rng(N);
+        std::vector<N_> nodes = nigh_test::sampleNodes(space, N, rng);
+
+        Nigh<N_, Space, IndexedNodeKey<State>, Concurrency, KDTreeMedian<>> nn(space);
+        nn.setBuildThreads(4);
+
+        for (const N_& n : nodes)
+            nn.insert(n);
+
+        EXPECT(nn.size()) == N;
+        nigh_test::expectNearestMatchesLinear(nn, nodes, rng, K, 200);
+    }
+}
+
+TEST(l2_3) {
+    parallelBuildTest(L2Space<double, 3>{});
+}
+
+TEST(l1_6) {
+    parallelBuildTest(L1Space<double, 6>{});
+}
+
+TEST(so3) {
+    parallelBuildTest(SO3Space<double>{});
+}
+
+TEST(se3) {
+    parallelBuildTest(SE3Space<double, 50, 1>{});
+}
+
+TEST(se3_concurrent) {
+    parallelBuildTest<Concurrent>(SE3Space<double, 50, 1>{});
+}
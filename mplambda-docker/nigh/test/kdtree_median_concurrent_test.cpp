@@ -0,0 +1,159 @@
+// Software License Agreement (BSD-3-Clause)
+//
+// Copyright 2018 The University of North Carolina at Chapel Hill
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+// OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//! @author Jeff Ichnowski
+
+#include "concurrent_test_template.hpp"
+#include <nigh/kdtree_median.hpp>
+#include <nigh/lp_space.hpp>
+#include <nigh/so3_space.hpp>
+#include <nigh/se3_space.hpp>
+#include <atomic>
+
+using namespace unc::robotics::nigh;
+using namespace nigh_test;
+
+namespace {
+    // small trees to force frequent rebuilds (and thus new versions)
+    // under contention.
+    using SmallMedian = KDTreeMedian<4>;
+
+    // checks that nearest_batch on the concurrently built forest
+    // matches a linear scan too.
+    struct BatchMatchesLinear {
+        template <typename NN, typename Linear, typename Queries>
+        void operator () (const NN& nn, const Linear& linear, const Queries& queries) const {
+            using Node = TestNode<typename Queries::value_type>;
+            using Distance = typename NN::Distance;
+            static constexpr std::size_t K = 20;
+
+            std::vector<std::vector<std::pair<Node, Distance>>> results;
+            std::vector<std::pair<Node, Distance>> expected;
+            nn.nearest_batch(queries, results, K, std::numeric_limits<Distance>::infinity(), 2);
+            for (std::size_t i=0 ; i<queries.size() ; ++i) {
+                linear.nearest(expected, queries[i], K);
+                EXPECT(results[i].size()) == expected.size();
+                for (std::size_t j=0 ; j<expected.size() ; ++j)
+                    EXPECT(results[i][j].second) == expected[j].second;
+            }
+        }
+    };
+
+    // a single writer inserts while readers search.  A reader must
+    // find every value that was inserted before its search started,
+    // and nothing that had not been inserted when its search ended.
+    template <typename Strategy, typename Space>
+    void readersDuringWritesTest(const Space& space, std::size_t N, unsigned nReaders) {
+        using State = typename Space::Type;
+        using Distance = typename Space::Distance;
+        using Node = TestNode<State>;
+        static constexpr std::size_t K = 5;
+
+        Nigh<Node, Space, TestNodeKey<State>, Concurrent, Strategy> nn(space);
+
+        std::vector<Node> nodes;
+        std::mt19937_64 rng(2);
+        Sampler<State, typename Space::Metric> sampler(space);
+        for (std::size_t i=0 ; i<N ; ++i)
+            nodes.emplace_back(0, i, sampler(rng));
+
+        std::atomic<bool> done{false};
+        std::vector<std::exception_ptr> errors(nReaders);
+        std::vector<std::thread> readers;
+        for (unsigned t=0 ; t<nReaders ; ++t)
+            readers.emplace_back([&, t] {
+                try {
+                    std::mt19937_64 rng(t + 10);
+                    std::vector<std::pair<Node, Distance>> nbh;
+                    while (!done.load(std::memory_order_acquire)) {
+                        std::size_t before = nn.size();
+                        if (before == 0)
+                            continue;
+                        std::size_t j = std::uniform_int_distribution<std::size_t>(0, before - 1)(rng);
+                        nn.nearest(nbh, nodes[j].key_, K);
+                        std::size_t after = nn.size();
+                        EXPECT(nbh.empty()) == false;
+                        EXPECT(nbh[0].first.index_) == j;
+                        EXPECT(nbh[0].second) == 0;
+                        for (auto& n : nbh)
+                            EXPECT(n.first.index_) < after + 1;
+                    }
+                } catch (...) {
+                    errors[t] = std::current_exception();
+                }
+            });
+
+        for (const Node& n : nodes)
+            nn.insert(n);
+        done.store(true, std::memory_order_release);
+        for (auto& t : readers)
+            t.join();
+        for (auto& e : errors)
+            if (e)
+                std::rethrow_exception(e);
+
+        EXPECT(nn.size()) == N;
+    }
+}
+
+TEST(scaling_l2_3) {
+    runConcurrentScalingTest<KDTreeMedian<>>(L2Space<double, 3>());
+}
+
+TEST(scaling_so3) {
+    runConcurrentScalingTest<KDTreeMedian<>>(SO3Space<double>());
+}
+
+TEST(scaling_se3_small) {
+    runConcurrentScalingTest<SmallMedian>(SE3Space<double>(), 20000);
+}
+
+TEST(match_linear_l2_3) {
+    runConcurrentMatchLinearTest<KDTreeMedian<>>(L2Space<double, 3>(), 20000, 4, BatchMatchesLinear());
+}
+
+TEST(match_linear_l1_6_small) {
+    runConcurrentMatchLinearTest<SmallMedian>(L1Space<float, 6>(), 20000, 4, BatchMatchesLinear());
+}
+
+TEST(match_linear_so3_small) {
+    runConcurrentMatchLinearTest<SmallMedian>(SO3Space<double>(), 20000, 4, BatchMatchesLinear());
+}
+
+TEST(readers_during_writes_l2_3) {
+    readersDuringWritesTest<KDTreeMedian<>>(L2Space<double, 3>(), 50000, 3);
+}
+
+TEST(readers_during_writes_l1_6_small) {
+    readersDuringWritesTest<SmallMedian>(L1Space<float, 6>(), 20000, 3);
+}
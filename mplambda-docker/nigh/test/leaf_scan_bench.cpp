@@ -0,0 +1,172 @@
+// Software License Agreement (BSD-3-Clause)
+//
+// Copyright 2018 The University of North Carolina at Chapel Hill
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+// OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//! @author Jeff Ichnowski
+
+// Compares leaf scans that call space.distance() once per element
+// against the KeyBlock kernels used by KDTreeBatch<batchSize, true>
+// (see impl/simd.hpp), then compares k-nearest queries on trees with
+// and without inline keys.  The trees hold pointers to states
+// scattered in memory, as a planner's tree holds pointers to its
+// nodes.  Build with -march=native (the default in
+// configure.sh) to use the AVX2/AVX-512 kernels.
+
+#include "bench_template.hpp"
+#include <nigh/scaled_space.hpp>
+
+namespace nigh_test {
+    struct DerefKey {
+        template <typename T>
+        const T& operator() (const T* p) const {
+            return *p;
+        }
+    };
+
+    template <typename State, std::size_t batchSize, typename Space>
+    void runLeafScanBench(const std::string& label, const Space& space, std::size_t N, std::size_t K) {
+        using Clock = std::chrono::steady_clock;
+        using Distance = typename Space::Distance;
+        using namespace unc::robotics::nigh;
+        using Block = impl::kdtree_batch::KeyBlock<Space, batchSize>;
+
+        static constexpr std::size_t nBlocks = 1024;
+        static constexpr std::size_t nScans = 1 << 20;
+        static constexpr std::size_t nQueries = 10000;
+
+        Sampler<State, typename Space::Metric> sampler(space);
+        std::mt19937_64 rng;
+
+        std::vector<State> states;
+        states.reserve(std::max(N, nBlocks * batchSize));
+        while (states.size() < states.capacity())
+            states.push_back(sampler(rng));
+
+        std::vector<State> queries;
+        queries.reserve(nQueries);
+        while (queries.size() < nQueries)
+            queries.push_back(sampler(rng));
+
+        auto blocks = std::make_unique<Block[]>(nBlocks);
+        for (std::size_t b=0 ; b<nBlocks ; ++b)
+            for (std::size_t i=0 ; i<batchSize ; ++i)
+                blocks[b].put(i, states[b*batchSize + i]);
+
+        Distance sum = 0;
+        Distance dist[batchSize];
+        auto start = Clock::now();
+        for (std::size_t s=0 ; s<nScans ; ++s) {
+            const State *keys = &states[(s % nBlocks) * batchSize];
+            const State& q = queries[s % nQueries];
+            for (std::size_t i=0 ; i<batchSize ; ++i)
+                dist[i] = space.distance(keys[i], q);
+            sum += dist[s % batchSize];
+        }
+        double scalarNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / nScans;
+
+        start = Clock::now();
+        for (std::size_t s=0 ; s<nScans ; ++s) {
+            blocks[s % nBlocks].distances(
+                space, queries[s % nQueries], batchSize, std::numeric_limits<Distance>::infinity(), dist);
+            sum += dist[s % batchSize];
+        }
+        double blockNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / nScans;
+
+        std::vector<const State*> ptrs;
+        for (std::size_t i=0 ; i<N ; ++i)
+            ptrs.push_back(&states[i]);
+        std::shuffle(ptrs.begin(), ptrs.end(), rng);
+
+        auto queryTime = [&] (auto& nn) {
+            for (std::size_t i=0 ; i<N ; ++i)
+                nn.insert(ptrs[i]);
+            std::vector<std::pair<const State*, Distance>> nbh;
+            auto start = Clock::now();
+            for (const State& q : queries) {
+                nn.nearest(nbh, q, K);
+                sum += nbh[0].second;
+            }
+            return std::chrono::duration<double, std::micro>(Clock::now() - start).count() / nQueries;
+        };
+
+        Nigh<const State*, Space, DerefKey, Concurrent, KDTreeBatch<batchSize>> keyFnTree(space);
+        Nigh<const State*, Space, DerefKey, Concurrent, KDTreeBatch<batchSize, true>> inlineTree(space);
+        double keyFnUs = queryTime(keyFnTree);
+        double inlineUs = queryTime(inlineTree);
+
+        std::cout << label
+                  << '\t' << batchSize
+                  << '\t' << scalarNs
+                  << '\t' << blockNs
+                  << '\t' << keyFnUs
+                  << '\t' << inlineUs
+                  << "\t# " << sum << std::endl;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    using namespace unc::robotics::nigh;
+    using namespace nigh_test;
+
+    std::size_t N = 100000;
+    std::size_t K = 20;
+
+    for (int opt ; (opt = getopt(argc, argv, "n:k:")) != -1 ; ) {
+        switch (opt) {
+        case 'n':
+            N = std::atoi(optarg);
+            break;
+        case 'k':
+            K = std::atoi(optarg);
+            break;
+        default:
+            std::cerr << "Usage: " << argv[0] << " [-n nn-size] [-k query-size]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << "# size = " << N << ", k = " << K << std::endl;
+    std::cout << "# space batch scalar_ns_per_leaf block_ns_per_leaf"
+        " keyfn_us_per_query inline_us_per_query" << std::endl;
+
+    using SE3State = std::tuple<Eigen::Quaternion<double>, Eigen::Vector3d>;
+
+    runLeafScanBench<Eigen::Matrix<double, 7, 1>, 8>("l1_7", metric::L1Space<double, 7>{}, N, K);
+    runLeafScanBench<Eigen::Matrix<double, 7, 1>, 8>("l2_7", metric::L2Space<double, 7>{}, N, K);
+    runLeafScanBench<Eigen::Matrix<double, 7, 1>, 8>("linf_7", metric::LInfSpace<double, 7>{}, N, K);
+    runLeafScanBench<Eigen::Matrix<double, 7, 1>, 32>("l2_7", metric::L2Space<double, 7>{}, N, K);
+    runLeafScanBench<Eigen::Matrix<float, 7, 1>, 16>("l2_7f", metric::L2Space<float, 7>{}, N, K);
+    runLeafScanBench<Eigen::Matrix<double, 7, 1>, 8>(
+        "scaled_l2_7", metric::ScaledSpace<metric::L2Space<double, 7>>{2.5}, N, K);
+    runLeafScanBench<Eigen::Quaterniond, 8>("so3", metric::SO3Space<double>{}, N, K);
+    runLeafScanBench<SE3State, 8>("se3_50_1", metric::SE3Space<double, 50, 1>{}, N, K);
+}
@@ -0,0 +1,129 @@
+// Software License Agreement (BSD-3-Clause)
+//
+// Copyright 2018 The University of North Carolina at Chapel Hill
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+// OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//! @author Jeff Ichnowski
+
+#pragma once
+#ifndef NIGH_TEST_LINEAR_REFERENCE_HPP
+#define NIGH_TEST_LINEAR_REFERENCE_HPP
+
+#include "test.hpp"
+#include "sampler.hpp"
+#include <nigh/linear.hpp>
+#include <random>
+#include <vector>
+
+namespace nigh_test {
+
+    // The value type of the tests that check a nearest neighbor
+    // structure against a linear scan.  Nodes are equal when their
+    // indexes are, which is what erase needs.
+    template <typename State>
+    struct IndexedNode {
+        State state_;
+        std::size_t index_;
+
+        bool operator == (const IndexedNode& other) const {
+            return index_ == other.index_;
+        }
+    };
+
+    template <typename State>
+    struct IndexedNodeKey {
+        const State& operator() (const IndexedNode<State>& n) const {
+            return n.state_;
+        }
+    };
+
+    // A linear scan to check results against.
+    template <typename Space>
+    using LinearReference = unc::robotics::nigh::Nigh<
+        IndexedNode<typename Space::Type>, Space, IndexedNodeKey<typename Space::Type>,
+        unc::robotics::nigh::NoThreadSafety, unc::robotics::nigh::Linear>;
+
+    // Samples N nodes, with indexes starting at first.
+    template <typename Space, typename RNG>
+    std::vector<IndexedNode<typename Space::Type>> sampleNodes(
+        const Space& space, std::size_t N, RNG& rng, std::size_t first = 0)
+    {
+        using State = typename Space::Type;
+        Sampler<State, typename Space::Metric> sampler(space);
+        std::vector<IndexedNode<State>> nodes;
+        nodes.reserve(N);
+        for (std::size_t i=0 ; i<N ; ++i)
+            nodes.push_back(IndexedNode<State>{sampler(rng), first + i});
+        return nodes;
+    }
+
+    // What expectNearestMatchesLinear compares: the distances of the
+    // results, or the nodes themselves (by index).
+    enum class Match { kDistance, kIndex };
+
+    // Checks that nn holds as many nodes as live, and that the K
+    // nearest neighbors it finds for nQueries random queries match
+    // those a linear scan of live finds.
+    template <typename NN, typename Nodes, typename RNG>
+    void expectNearestMatchesLinear(
+        const NN& nn, const Nodes& live, RNG& rng, std::size_t K, std::size_t nQueries,
+        Match match = Match::kDistance)
+    {
+        using Space = typename NN::Space;
+        using State = typename Space::Type;
+        using Distance = typename Space::Distance;
+        using Node = IndexedNode<State>;
+
+        LinearReference<Space> linear(nn.metricSpace());
+        for (const Node& n : live)
+            linear.insert(n);
+
+        EXPECT(nn.size()) == linear.size();
+
+        Sampler<State, typename Space::Metric> sampler(nn.metricSpace());
+        std::vector<std::pair<Node, Distance>> nbh;
+        std::vector<std::pair<Node, Distance>> expected;
+        for (std::size_t i=0 ; i<nQueries ; ++i) {
+            State q = sampler(rng);
+            nn.nearest(nbh, q, K);
+            linear.nearest(expected, q, K);
+            EXPECT(nbh.size()) == expected.size();
+            for (std::size_t j=0 ; j<nbh.size() ; ++j) {
+                if (match == Match::kIndex)
+                    EXPECT(nbh[j].first.index_) == expected[j].first.index_;
+                else
+                    EXPECT(nbh[j].second) == expected[j].second;
+            }
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,152 @@
+// Software License Agreement (BSD-3-Clause)
+//
+// Copyright 2018 The University of North Carolina at Chapel Hill
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+// OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//! @author Jeff Ichnowski
+
+// Compares nearest_batch against a loop of nearest() calls over the
+// same queries, for batch sizes from 8 to 4096.  For each strategy,
+// batch size, and thread count, prints the mean time per query of
+// both forms and the speedup of the batch.
+
+#include "bench_template.hpp"
+#include <nigh/se3_space.hpp>
+
+namespace nigh_test {
+    template <typename Strategy, typename Space>
+    void runNearestBatchBench(
+        const std::string& label, const Space& space,
+        std::size_t N, std::size_t K, std::size_t nQueries, unsigned maxThreads)
+    {
+        using Clock = std::chrono::steady_clock;
+        using State = typename Space::Type;
+        using Distance = typename Space::Distance;
+        using namespace unc::robotics::nigh;
+
+        struct Node {
+            State state_;
+            std::size_t index_;
+        };
+
+        struct NodeKey {
+            const State& operator() (const Node& n) const {
+                return n.state_;
+            }
+        };
+
+        Sampler<State, typename Space::Metric> sampler(space);
+        std::mt19937_64 rng;
+
+        Nigh<Node, Space, NodeKey, ConcurrentRead, Strategy> nn(space);
+        for (std::size_t i=0 ; i<N ; ++i)
+            nn.insert(Node{sampler(rng), i});
+
+        std::vector<State> queries;
+        for (std::size_t i=0 ; i<nQueries ; ++i)
+            queries.push_back(sampler(rng));
+
+        std::vector<std::pair<Node, Distance>> nbh;
+        for (std::size_t batchSize = 8 ; batchSize <= 4096 && batchSize <= nQueries ; batchSize *= 2) {
+            std::size_t nBatches = nQueries / batchSize;
+            std::size_t n = nBatches * batchSize;
+
+            Distance loopSum = 0;
+            auto start = Clock::now();
+            for (std::size_t i=0 ; i<n ; ++i) {
+                nn.nearest(nbh, queries[i], K);
+                loopSum += nbh.back().second;
+            }
+            double loopUs = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / n;
+
+            for (unsigned nThreads = 1 ; nThreads <= maxThreads ; nThreads *= 2) {
+                std::vector<State> batch(batchSize);
+                std::vector<std::vector<std::pair<Node, Distance>>> results;
+                Distance batchSum = 0;
+                start = Clock::now();
+                for (std::size_t b=0 ; b<nBatches ; ++b) {
+                    std::copy(queries.begin() + b*batchSize, queries.begin() + (b+1)*batchSize, batch.begin());
+                    nn.nearest_batch(batch, results, K, std::numeric_limits<Distance>::infinity(), nThreads);
+                    for (auto& r : results)
+                        batchSum += r.back().second;
+                }
+                double batchUs = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / n;
+
+                std::cout << label
+                          << '\t' << Name<Strategy>::name()
+                          << '\t' << batchSize
+                          << '\t' << nThreads
+                          << '\t' << loopUs
+                          << '\t' << batchUs
+                          << '\t' << loopUs / batchUs
+                          << "\t# " << loopSum << ' ' << batchSum << std::endl;
+            }
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    using namespace unc::robotics::nigh;
+    using namespace nigh_test;
+
+    std::size_t N = 100000;
+    std::size_t K = 20;
+    std::size_t Q = 16384;
+    unsigned T = std::max(1u, std::thread::hardware_concurrency());
+
+    for (int opt ; (opt = getopt(argc, argv, "n:k:q:t:")) != -1 ; ) {
+        switch (opt) {
+        case 'n':
+            N = std::atoi(optarg);
+            break;
+        case 'k':
+            K = std::atoi(optarg);
+            break;
+        case 'q':
+            Q = std::atoi(optarg);
+            break;
+        case 't':
+            T = std::atoi(optarg);
+            break;
+        default:
+            std::cerr << "Usage: " << argv[0] << " [-n nn-size] [-k query-size] [-q query-count] [-t max-threads]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << "# size = " << N << ", k = " << K << ", queries = " << Q << std::endl;
+    std::cout << "# space strategy batch_size threads us_per_query_loop us_per_query_batch speedup" << std::endl;
+
+    runNearestBatchBench<KDTreeBatch<>>("se3", metric::SE3Space<double, 50, 1>{}, N, K, Q, T);
+    runNearestBatchBench<KDTreeMedian<>>("se3", metric::SE3Space<double, 50, 1>{}, N, K, Q, T);
+    runNearestBatchBench<KDTreeBatch<>>("l2_3", metric::L2Space<double, 3>{}, N, K, Q, T);
+    runNearestBatchBench<KDTreeMedian<>>("l2_3", metric::L2Space<double, 3>{}, N, K, Q, T);
+}
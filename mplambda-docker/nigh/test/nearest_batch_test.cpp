@@ -0,0 +1,152 @@
+// Software License Agreement (BSD-3-Clause)
+//
+// Copyright 2018 The University of North Carolina at Chapel Hill
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+// OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//! @author Jeff Ichnowski
+
+#include "test.hpp"
+#include <nigh/lp_space.hpp>
+#include <nigh/so3_space.hpp>
+#include <nigh/se3_space.hpp>
+#include <nigh/kdtree_batch.hpp>
+#include <nigh/kdtree_median.hpp>
+#include <nigh/linear.hpp>
+#include <random>
+#include "sampler_lp.hpp"
+#include "sampler_so3.hpp"
+#include "sampler_scaled.hpp"
+#include "sampler_cartesian.hpp"
+#include "linear_reference.hpp"
+
+using namespace unc::robotics::nigh;
+using nigh_test::IndexedNode;
+using nigh_test::IndexedNodeKey;
+
+namespace {
+    // Checks that nearest_batch finds the same neighbors as a linear
+    // scan for each query, both single threaded and split across
+    // threads, and that an empty tree produces empty results.
+    // Neighbors are compared by index since inline-key trees compute
+    // distances with a different summation order.
+    template <typename Strategy, typename Concurrency = NoThreadSafety, typename Space>
+    void batchTest(const Space& space, std::size_t N, std::size_t nQueries) {
+        using State = typename Space::Type;
+        using Distance = typename Space::Distance;
+        using N_ = IndexedNode<State>;
+        static constexpr std::size_t K = 10;
+
+        nigh_test::Sampler<State, typename Space::Metric> sampler(space);
+        std::mt19937_64 rng(N);
+
+        Nigh<N_, Space, IndexedNodeKey<State>, Concurrency, Strategy> nn(space);
+        nigh_test::LinearReference<Space> linear(space);
+
+        std::vector<State> queries;
+        for (std::size_t i=0 ; i<nQueries ; ++i)
+            queries.push_back(sampler(rng));
+
+        std::vector<std::vector<std::pair<N_, Distance>>> results(3);
+        nn.nearest_batch(queries, results, K);
+        EXPECT(results.size()) == nQueries;
+        for (auto& nbh : results)
+            EXPECT(nbh.empty()) == true;
+
+        for (const N_& n : nigh_test::sampleNodes(space, N, rng)) {
+            nn.insert(n);
+            linear.insert(n);
+        }
+
+        std::vector<std::pair<N_, Distance>> expected;
+        for (unsigned nThreads : { 1u, 3u }) {
+            nn.nearest_batch(queries, results, K, std::numeric_limits<Distance>::infinity(), nThreads);
+            EXPECT(results.size()) == nQueries;
+            for (std::size_t i=0 ; i<nQueries ; ++i) {
+                linear.nearest(expected, queries[i], K);
+                EXPECT(results[i].size()) == expected.size();
+                for (std::size_t j=0 ; j<expected.size() ; ++j)
+                    EXPECT(results[i][j].first.index_) == expected[j].first.index_;
+            }
+        }
+
+        // radius-bounded
+        Distance r = results[0].empty() ? Distance(0) : results[0][K/2].second;
+        nn.nearest_batch(queries, results, K, r);
+        for (std::size_t i=0 ; i<nQueries ; ++i) {
+            linear.nearest(expected, queries[i], K, r);
+            EXPECT(results[i].size()) == expected.size();
+        }
+    }
+}
+
+TEST(batch_l2_3) {
+    batchTest<KDTreeBatch<>>(L2Space<double, 3>{}, 10000, 1000);
+}
+
+TEST(batch_l1_8) {
+    batchTest<KDTreeBatch<>>(L1Space<double, 8>{}, 10000, 500);
+}
+
+TEST(batch_l2_3_concurrent) {
+    batchTest<KDTreeBatch<>, Concurrent>(L2Space<double, 3>{}, 5000, 200);
+}
+
+TEST(batch_inline_l2_3) {
+    batchTest<KDTreeBatch<8, true>>(L2Space<double, 3>{}, 10000, 500);
+}
+
+TEST(batch_so3) {
+    batchTest<KDTreeBatch<>>(SO3Space<double>{}, 10000, 500);
+}
+
+TEST(batch_se3) {
+    batchTest<KDTreeBatch<>>(SE3Space<double, 50, 1>{}, 10000, 500);
+}
+
+TEST(batch_se3_concurrent) {
+    batchTest<KDTreeBatch<>, Concurrent>(SE3Space<double, 50, 1>{}, 5000, 200);
+}
+
+TEST(median_l2_3) {
+    batchTest<KDTreeMedian<>>(L2Space<double, 3>{}, 10000, 1000);
+}
+
+TEST(median_l1_8_concurrent) {
+    batchTest<KDTreeMedian<>, Concurrent>(L1Space<double, 8>{}, 5000, 200);
+}
+
+TEST(median_se3) {
+    batchTest<KDTreeMedian<>>(SE3Space<double, 50, 1>{}, 10000, 500);
+}
+
+TEST(median_se3_concurrent) {
+    batchTest<KDTreeMedian<>, Concurrent>(SE3Space<double, 50, 1>{}, 5000, 200);
+}
@@ -0,0 +1,146 @@
+// Software License Agreement (BSD-3-Clause)
+//
+// Copyright 2018 The University of North Carolina at Chapel Hill
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+// OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//! @author Jeff Ichnowski
+
+#include "test.hpp"
+#include <nigh/lp_space.hpp>
+#include <nigh/so3_space.hpp>
+#include <nigh/se3_space.hpp>
+#include <nigh/kdtree_batch.hpp>
+#include <nigh/linear.hpp>
+#include <random>
+#include "sampler_lp.hpp"
+#include "sampler_so3.hpp"
+#include "sampler_scaled.hpp"
+#include "sampler_cartesian.hpp"
+#include "linear_reference.hpp"
+
+using namespace unc::robotics::nigh;
+using nigh_test::IndexedNode;
+using nigh_test::IndexedNodeKey;
+
+namespace {
+    // Checks nearest_radius, unsorted and sorted, against a linear
+    // scan with an unbounded k, at radii that capture a few to a few
+    // hundred values, before and after erasing a third of the tree.
+    template <typename Strategy, typename Concurrency = NoThreadSafety, typename Space>
+    void radiusTest(const Space& space, std::size_t N, std::size_t nQueries) {
+        using State = typename Space::Type;
+        using Distance = typename Space::Distance;
+        using N_ = IndexedNode<State>;
+
+        nigh_test::Sampler<State, typename Space::Metric> sampler(space);
+        std::mt19937_64 rng(N);
+
+        Nigh<N_, Space, IndexedNodeKey<State>, Concurrency, Strategy> nn(space);
+        nigh_test::LinearReference<Space> linear(space);
+
+        std::vector<State> queries;
+        for (std::size_t i=0 ; i<nQueries ; ++i)
+            queries.push_back(sampler(rng));
+
+        std::vector<std::pair<N_, Distance>> nbh;
+        nn.nearest_radius(nbh, queries[0], std::numeric_limits<Distance>::infinity());
+        EXPECT(nbh.empty()) == true;
+
+        std::vector<N_> nodes = nigh_test::sampleNodes(space, N, rng);
+        for (const N_& n : nodes)
+            nn.insert(n);
+
+        auto check = [&] {
+            std::vector<std::pair<N_, Distance>> expected;
+            std::vector<std::size_t> found;
+            for (const State& q : queries) {
+                for (std::size_t k : { 1, 10, 200 }) {
+                    // the slack keeps values at the boundary in the
+                    // ball when inline keys round distances
+                    // differently than the linear scan.
+                    linear.nearest(expected, q, k);
+                    Distance r = expected.back().second * (1 + 1e-12);
+
+                    linear.nearest(expected, q, N, r);
+                    nn.nearest_radius(nbh, q, r);
+                    EXPECT(nbh.size()) == expected.size();
+                    found.clear();
+                    for (const auto& [n, d] : nbh) {
+                        EXPECT(d <= r) == true;
+                        EXPECT(d) == Approx(nn.metricSpace().distance(n.state_, q), 1000);
+                        found.push_back(n.index_);
+                    }
+                    std::sort(found.begin(), found.end());
+                    for (const auto& [n, d] : expected)
+                        EXPECT(std::binary_search(found.begin(), found.end(), n.index_)) == true;
+
+                    nn.nearest_radius(nbh, q, r, true);
+                    EXPECT(nbh.size()) == expected.size();
+                    for (std::size_t j=0 ; j<nbh.size() ; ++j)
+                        EXPECT(nbh[j].second) == Approx(expected[j].second, 1000);
+                }
+            }
+        };
+
+        for (const N_& n : nodes)
+            linear.insert(n);
+        check();
+
+        linear.clear();
+        for (const N_& n : nodes) {
+            if (n.index_ % 3 == 0)
+                EXPECT(nn.erase(n)) == true;
+            else
+                linear.insert(n);
+        }
+        check();
+    }
+}
+
+TEST(radius_l2_3) {
+    radiusTest<KDTreeBatch<>>(L2Space<double, 3>{}, 5000, 100);
+}
+
+TEST(radius_l1_8) {
+    radiusTest<KDTreeBatch<>>(L1Space<double, 8>{}, 5000, 50);
+}
+
+TEST(radius_so3) {
+    radiusTest<KDTreeBatch<>>(SO3Space<double>{}, 5000, 50);
+}
+
+TEST(radius_se3_inline_keys) {
+    radiusTest<KDTreeBatch<8, true>>(SE3Space<double, 50, 1>{}, 5000, 50);
+}
+
+TEST(radius_se3_concurrent) {
+    radiusTest<KDTreeBatch<>, Concurrent>(SE3Space<double, 50, 1>{}, 5000, 50);
+}
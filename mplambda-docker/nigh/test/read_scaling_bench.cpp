@@ -0,0 +1,203 @@
+// Software License Agreement (BSD-3-Clause)
+//
+// Copyright 2018 The University of North Carolina at Chapel Hill
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+// OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//! @author Jeff Ichnowski
+
+// Read scaling of the Concurrent KDTreeMedian.  Compares the
+// epoch-based Concurrent specialization with the ConcurrentRead
+// forest wrapped in impl::LockedNearest (a std::shared_mutex, which
+// every reader writes to), and with the unsynchronized ConcurrentRead
+// forest as the upper bound.  For each thread count, every thread
+// runs the same number of k-nearest queries (thus ideal scaling
+// keeps the time constant), optionally while one more thread inserts
+// continuously.  Writes CSV to stdout.
+//
+//   -n values inserted before each run
+//   -q queries per thread
+//   -k k of the queries
+//   -t maximum thread count (default: hardware concurrency, at least 4)
+//   -w also run with a concurrent writer
+
+#include "bench_template.hpp"
+#include <nigh/impl/locked_nearest.hpp>
+#include <nigh/se3_space.hpp>
+#include <atomic>
+#include <thread>
+
+namespace nigh_test {
+    struct ReadScalingOptions {
+        std::size_t prefill = 100000;
+        std::size_t queries = 20000;
+        std::size_t k = 10;
+        unsigned maxThreads = std::max(4u, std::thread::hardware_concurrency());
+        bool writer = false;
+    };
+
+    template <typename NN, typename Space>
+    void runReadScaling(
+        const std::string& label, const std::string& sync,
+        const Space& space, const ReadScalingOptions& options, bool writer)
+    {
+        using Clock = std::chrono::steady_clock;
+        using Key = typename Space::Type;
+        using Distance = typename Space::Distance;
+
+        Sampler<Key, typename Space::Metric> sampler(space);
+
+        for (unsigned nThreads = 1 ; nThreads <= options.maxThreads ; nThreads *= 2) {
+            std::mt19937_64 rng(nThreads);
+            NN nn(space);
+            for (std::size_t i=0 ; i<options.prefill ; ++i)
+                nn.insert(sampler(rng));
+
+            std::vector<std::vector<Key>> queries(nThreads);
+            for (auto& q : queries)
+                for (std::size_t i=0 ; i<options.queries ; ++i)
+                    q.push_back(sampler(rng));
+            std::vector<Key> inserts;
+            if (writer)
+                for (std::size_t i=0 ; i<options.prefill ; ++i)
+                    inserts.push_back(sampler(rng));
+
+            std::atomic<unsigned> ready{0};
+            std::atomic<unsigned> running{nThreads};
+            std::atomic<bool> go{false};
+            std::atomic<std::size_t> inserted{0};
+            std::vector<double> sums(nThreads);
+            std::vector<std::thread> threads;
+            for (unsigned t=0 ; t<nThreads ; ++t) {
+                threads.emplace_back([&, t] {
+                    std::vector<std::pair<Key, Distance>> nbh;
+                    ++ready;
+                    while (!go.load(std::memory_order_acquire))
+                        std::this_thread::yield();
+                    for (const Key& q : queries[t]) {
+                        nn.nearest(nbh, q, options.k);
+                        sums[t] += nbh.back().second;
+                    }
+                    --running;
+                });
+            }
+
+            std::thread writerThread;
+            if (writer) {
+                writerThread = std::thread([&] {
+                    while (!go.load(std::memory_order_acquire))
+                        std::this_thread::yield();
+                    for (std::size_t i=0 ; i<inserts.size() && running.load(std::memory_order_relaxed) ; ++i) {
+                        nn.insert(inserts[i]);
+                        inserted.store(i + 1, std::memory_order_relaxed);
+                    }
+                });
+            }
+
+            while (ready.load() < nThreads)
+                std::this_thread::yield();
+            auto start = Clock::now();
+            go.store(true, std::memory_order_release);
+            for (std::thread& t : threads)
+                t.join();
+            double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            if (writerThread.joinable())
+                writerThread.join();
+
+            double sum = 0;
+            for (double s : sums)
+                sum += s;
+
+            std::size_t nQueries = nThreads * options.queries;
+            std::cout << label
+                      << ',' << sync
+                      << ',' << nThreads
+                      << ',' << writer
+                      << ',' << inserted.load()
+                      << ',' << seconds
+                      << ',' << nQueries / seconds
+                      << ',' << nQueries / seconds / nThreads
+                      << ",# " << sum << std::endl;
+        }
+    }
+
+    template <typename Space>
+    void runReadScaling(const std::string& label, const Space& space, const ReadScalingOptions& options) {
+        using namespace unc::robotics::nigh;
+        using Key = typename Space::Type;
+        using Epoch = Nigh<Key, Space, Identity, Concurrent, KDTreeMedian<>>;
+        using Unsynchronized = Nigh<Key, Space, Identity, ConcurrentRead, KDTreeMedian<>>;
+        using SharedMutex = impl::LockedNearest<Unsynchronized>;
+
+        for (bool writer : { false, true }) {
+            if (writer && !options.writer)
+                continue;
+            runReadScaling<Epoch>(label, "epoch", space, options, writer);
+            runReadScaling<SharedMutex>(label, "shared_mutex", space, options, writer);
+            if (!writer)
+                runReadScaling<Unsynchronized>(label, "none", space, options, writer);
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    using namespace unc::robotics::nigh;
+    using namespace nigh_test;
+
+    ReadScalingOptions options;
+
+    for (int opt ; (opt = getopt(argc, argv, "n:q:k:t:w")) != -1 ; ) {
+        switch (opt) {
+        case 'n':
+            options.prefill = std::atoi(optarg);
+            break;
+        case 'q':
+            options.queries = std::atoi(optarg);
+            break;
+        case 'k':
+            options.k = std::atoi(optarg);
+            break;
+        case 't':
+            options.maxThreads = std::max(1, std::atoi(optarg));
+            break;
+        case 'w':
+            options.writer = true;
+            break;
+        default:
+            std::cerr << "Usage: " << argv[0]
+                      << " [-n prefill] [-q queries-per-thread] [-k k] [-t max-threads] [-w]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << "space,sync,threads,writer,inserted,seconds,queries_per_sec,queries_per_sec_per_thread" << std::endl;
+    runReadScaling("l2_3", metric::L2Space<double, 3>{}, options);
+    runReadScaling("se3", metric::SE3Space<double, 50, 1>{}, options);
+}
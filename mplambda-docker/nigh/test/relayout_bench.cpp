@@ -0,0 +1,134 @@
+// Software License Agreement (BSD-3-Clause)
+//
+// Copyright 2018 The University of North Carolina at Chapel Hill
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+// OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//! @author Jeff Ichnowski
+
+// Measures KDTreeBatch queries before and after relayout().  The
+// tree is built by single inserts, which scatters its branches over
+// the heap.  For each number of relayout levels, prints the mean time
+// per query and the last-level cache misses per query (NaN when the
+// perf counter is not available, see LLCMissCounter).  The levels
+// column is 0 for the tree as built.
+
+#include "bench_template.hpp"
+#include <nigh/se3_space.hpp>
+
+namespace nigh_test {
+    template <typename Space>
+    void runRelayoutBench(
+        const std::string& label, const Space& space,
+        std::size_t N, std::size_t K, std::size_t nQueries)
+    {
+        using Clock = std::chrono::steady_clock;
+        using State = typename Space::Type;
+        using Distance = typename Space::Distance;
+        using namespace unc::robotics::nigh;
+
+        struct Node {
+            State state_;
+            std::size_t index_;
+        };
+
+        struct NodeKey {
+            const State& operator() (const Node& n) const {
+                return n.state_;
+            }
+        };
+
+        Sampler<State, typename Space::Metric> sampler(space);
+        std::mt19937_64 rng;
+
+        Nigh<Node, Space, NodeKey, Concurrent, KDTreeBatch<>> nn(space);
+        for (std::size_t i=0 ; i<N ; ++i)
+            nn.insert(Node{sampler(rng), i});
+
+        std::vector<State> queries;
+        for (std::size_t i=0 ; i<nQueries ; ++i)
+            queries.push_back(sampler(rng));
+
+        LLCMissCounter llcMisses;
+        std::vector<std::pair<Node, Distance>> nbh;
+        for (unsigned levels : { 0u, 8u, 12u, 16u, 20u }) {
+            std::size_t copied = levels ? nn.relayout(levels) : 0;
+
+            Distance sum = 0;
+            llcMisses.start();
+            auto start = Clock::now();
+            for (const State& q : queries) {
+                nn.nearest(nbh, q, K);
+                sum += nbh.back().second;
+            }
+            double us = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / nQueries;
+            llcMisses.stop();
+
+            std::cout << label
+                      << '\t' << levels
+                      << '\t' << copied
+                      << '\t' << us
+                      << '\t' << llcMisses.perQuery(nQueries)
+                      << "\t# " << sum << std::endl;
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    using namespace unc::robotics::nigh;
+    using namespace nigh_test;
+
+    std::size_t N = 1000000;
+    std::size_t K = 1;
+    std::size_t Q = 100000;
+
+    for (int opt ; (opt = getopt(argc, argv, "n:k:q:")) != -1 ; ) {
+        switch (opt) {
+        case 'n':
+            N = std::atoi(optarg);
+            break;
+        case 'k':
+            K = std::atoi(optarg);
+            break;
+        case 'q':
+            Q = std::atoi(optarg);
+            break;
+        default:
+            std::cerr << "Usage: " << argv[0] << " [-n nn-size] [-k query-size] [-q query-count]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << "# size = " << N << ", k = " << K << ", queries = " << Q << std::endl;
+    std::cout << "# space levels branches_copied us_per_query llc_misses_per_query" << std::endl;
+
+    runRelayoutBench("l2_3", metric::L2Space<double, 3>{}, N, K, Q);
+    runRelayoutBench("se3", metric::SE3Space<double, 50, 1>{}, N, K, Q);
+}
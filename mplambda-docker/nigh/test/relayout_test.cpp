@@ -0,0 +1,203 @@
+// Software License Agreement (BSD-3-Clause)
+//
+// Copyright 2018 The University of North Carolina at Chapel Hill
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+// OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//! @author Jeff Ichnowski
+
+#include "test.hpp"
+#include <nigh/lp_space.hpp>
+#include <nigh/so3_space.hpp>
+#include <nigh/se3_space.hpp>
+#include <nigh/kdtree_batch.hpp>
+#include <atomic>
+#include <random>
+#include <thread>
+#include "sampler_lp.hpp"
+#include "sampler_so3.hpp"
+#include "sampler_cartesian.hpp"
+#include "linear_reference.hpp"
+
+using namespace unc::robotics::nigh;
+using nigh_test::IndexedNode;
+using nigh_test::IndexedNodeKey;
+
+namespace {
+    // checks the queries against a linear scan of the live nodes.
+    template <typename NN, typename RNG>
+    void checkQueries(const NN& nn, const std::vector<typename NN::Type>& live, RNG& rng) {
+        static constexpr std::size_t K = 20;
+
+        EXPECT(nn.list().size()) == live.size();
+        nigh_test::expectNearestMatchesLinear(nn, live, rng, K, 100, nigh_test::Match::kIndex);
+    }
+
+    // Relays out the tree, then continues to insert and erase in
+    // both the copied and the dynamic levels, and relays out again,
+    // checking the queries against a linear scan at each step.
+    template <typename Concurrency, typename Space>
+    void relayoutTest(const Space& space, std::size_t N) {
+        using State = typename Space::Type;
+        using N_ = IndexedNode<State>;
+
+        std::mt19937_64 rng(N);
+        std::vector<N_> nodes = nigh_test::sampleNodes(space, 2*N, rng);
+
+        Nigh<N_, Space, IndexedNodeKey<State>, Concurrency, KDTreeBatch<8>> nn(space);
+        std::vector<N_> live;
+
+        EXPECT(nn.relayout()) == 0;
+
+        for (std::size_t i=0 ; i<N ; ++i) {
+            nn.insert(nodes[i]);
+            live.push_back(nodes[i]);
+        }
+
+        EXPECT(nn.relayout(0)) == 0;
+        EXPECT(nn.relayout() > 0) == true;
+        checkQueries(nn, live, rng);
+
+        live.clear();
+        for (std::size_t i=N ; i<2*N ; ++i)
+            nn.insert(nodes[i]);
+        for (std::size_t i=0 ; i<2*N ; ++i) {
+            if (i % 3 == 0)
+                EXPECT(nn.erase(nodes[i])) == true;
+            else
+                live.push_back(nodes[i]);
+        }
+        checkQueries(nn, live, rng);
+
+        EXPECT(nn.relayout(4) > 0) == true;
+        EXPECT(nn.relayout() > 0) == true;
+        checkQueries(nn, live, rng);
+
+        nn.clear();
+        EXPECT(nn.size()) == 0;
+        EXPECT(nn.nearest(nodes[0].state_).has_value()) == false;
+    }
+
+    // Automatic relayouts as the tree grows, through single and bulk
+    // inserts.
+    template <typename Concurrency, typename Space>
+    void autoRelayoutTest(const Space& space, std::size_t N) {
+        using State = typename Space::Type;
+        using N_ = IndexedNode<State>;
+
+        std::mt19937_64 rng(N);
+        std::vector<N_> nodes = nigh_test::sampleNodes(space, 2*N, rng);
+
+        Nigh<N_, Space, IndexedNodeKey<State>, Concurrency, KDTreeBatch<8>> nn(space);
+        nn.setRelayoutLevels(4);
+        EXPECT(nn.relayoutLevels()) == 4;
+
+        for (std::size_t i=0 ; i<N ; ++i)
+            nn.insert(nodes[i]);
+        checkQueries(nn, std::vector<N_>(nodes.begin(), nodes.begin() + N), rng);
+
+        nn.insert(nodes.begin() + N, nodes.end());
+        checkQueries(nn, nodes, rng);
+    }
+
+    // Relays out repeatedly while other threads insert.  A region
+    // growth lost to a relayout would make a search prune a subtree
+    // that holds the nearest neighbor.
+    template <typename Space>
+    void concurrentRelayoutTest(const Space& space, std::size_t N, unsigned nThreads) {
+        using State = typename Space::Type;
+        using N_ = IndexedNode<State>;
+
+        std::mt19937_64 rng(N);
+        std::vector<N_> nodes = nigh_test::sampleNodes(space, N, rng);
+
+        Nigh<N_, Space, IndexedNodeKey<State>, Concurrent, KDTreeBatch<8>> nn(space);
+
+        std::atomic<std::size_t> next{0};
+        std::atomic<unsigned> running{nThreads};
+        std::vector<std::thread> threads;
+        for (unsigned t=0 ; t<nThreads ; ++t) {
+            threads.emplace_back([&] {
+                for (std::size_t i ; (i = next.fetch_add(1)) < N ; )
+                    nn.insert(nodes[i]);
+                --running;
+            });
+        }
+
+        std::size_t relayouts = 0;
+        while (running.load() > 0) {
+            nn.relayout(6);
+            ++relayouts;
+            std::this_thread::yield();
+        }
+
+        for (std::thread& t : threads)
+            t.join();
+
+        EXPECT(relayouts > 0) == true;
+        checkQueries(nn, nodes, rng);
+    }
+}
+
+TEST(relayout_l2) {
+    relayoutTest<NoThreadSafety>(L2Space<double, 3>{}, 5000);
+}
+
+TEST(relayout_l1_concurrent_read) {
+    relayoutTest<ConcurrentRead>(L1Space<double, 6>{}, 5000);
+}
+
+TEST(relayout_l2_concurrent) {
+    relayoutTest<Concurrent>(L2Space<double, 3>{}, 5000);
+}
+
+TEST(relayout_so3) {
+    relayoutTest<NoThreadSafety>(SO3Space<double>{}, 5000);
+}
+
+TEST(relayout_se3_concurrent) {
+    relayoutTest<Concurrent>(SE3Space<double, 1, 1>{}, 5000);
+}
+
+TEST(relayout_auto_l2) {
+    autoRelayoutTest<NoThreadSafety>(L2Space<double, 3>{}, 5000);
+}
+
+TEST(relayout_auto_se3_concurrent) {
+    autoRelayoutTest<Concurrent>(SE3Space<double, 1, 1>{}, 5000);
+}
+
+TEST(relayout_during_inserts_l2) {
+    concurrentRelayoutTest(L2Space<double, 3>{}, 20000, 4);
+}
+
+TEST(relayout_during_inserts_se3) {
+    concurrentRelayoutTest(SE3Space<double, 1, 1>{}, 20000, 4);
+}
@@ -0,0 +1,164 @@
+// Software License Agreement (BSD-3-Clause)
+//
+// Copyright 2018 The University of North Carolina at Chapel Hill
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+// OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//! @author Jeff Ichnowski
+
+// Compares the two neighborhoods an RRG/RRT* planner can rewire over
+// (see mpl/pcforest.hpp): the k-nearest with k = kRRG log(n), and the
+// r-disc with r = gamma (log(n)/n)^(1/d).  The planner's growth is
+// simulated by alternating a neighborhood query at a new random
+// sample with the insertion of that sample.  gamma is chosen so that
+// (ignoring the boundary) the r-disc has the same expected size as
+// the k-nearest, thus the difference in time is that of the search.
+// For each doubling of the tree size, prints the mean time per sample of
+// the query (in microseconds) and the mean neighborhood size, for the
+// k-nearest, the r-disc, and the r-disc sorted by distance.
+
+#include "bench_template.hpp"
+
+namespace nigh_test {
+    enum class RewireMode { kNearest, kRadius, kRadiusSorted };
+
+    static const char *rewireModeName(RewireMode mode) {
+        switch (mode) {
+        case RewireMode::kNearest: return "k-nearest";
+        case RewireMode::kRadius: return "r-disc";
+        case RewireMode::kRadiusSorted: return "r-disc-sorted";
+        }
+        return "?";
+    }
+
+    template <int kDim>
+    void runRewireBench(RewireMode mode, std::size_t N) {
+        using Clock = std::chrono::steady_clock;
+        using Space = unc::robotics::nigh::metric::L2Space<double, kDim>;
+        using State = typename Space::Type;
+        using Distance = double;
+        using namespace unc::robotics::nigh;
+
+        struct Node {
+            State state_;
+            std::size_t index_;
+        };
+
+        struct NodeKey {
+            const State& operator() (const Node *n) const {
+                return n->state_;
+            }
+        };
+
+        static constexpr Distance E = 2.71828182845904523536;
+        const Distance d = kDim;
+        const Distance kRRG = E * (1 + 1/d);
+        // volume of the unit d-ball
+        const Distance zeta = std::pow(M_PI, d/2) / std::tgamma(d/2 + 1);
+        // the sampler's box is [-5, 5]^d
+        const Distance gamma = 10 * std::pow(kRRG / zeta, 1/d);
+
+        Space space;
+        Sampler<State, typename Space::Metric> sampler(space);
+        std::mt19937_64 rng;
+
+        std::vector<Node> nodes(N);
+        Nigh<Node*, Space, NodeKey, Concurrent, KDTreeBatch<>> nn(space);
+        std::vector<std::tuple<Node*, Distance>> nbh;
+
+        Clock::duration elapsed{};
+        std::size_t nbhSum = 0;
+        Distance check = 0;
+        std::size_t windowStart = 0;
+        for (std::size_t n = 0 ; n < N ; ++n) {
+            nodes[n].state_ = sampler(rng);
+            nodes[n].index_ = n;
+            if (n) {
+                Distance logN = std::log(Distance(n + 1));
+                auto start = Clock::now();
+                if (mode == RewireMode::kNearest) {
+                    nn.nearest(nbh, nodes[n].state_, static_cast<std::size_t>(std::ceil(kRRG * logN)));
+                } else {
+                    Distance r = gamma * std::pow(logN / (n + 1), 1/d);
+                    nn.nearest_radius(nbh, nodes[n].state_, r, mode == RewireMode::kRadiusSorted);
+                }
+                elapsed += Clock::now() - start;
+                nbhSum += nbh.size();
+                if (!nbh.empty())
+                    check += std::get<1>(nbh[0]);
+            }
+            nn.insert(&nodes[n]);
+
+            // report at each power of two
+            if (n + 1 >= 1024 && ((n + 1) & n) == 0) {
+                std::size_t count = n + 1 - windowStart;
+                std::cout << "l2_" << kDim
+                          << '\t' << rewireModeName(mode)
+                          << '\t' << (n + 1)
+                          << '\t' << std::chrono::duration<double, std::micro>(elapsed).count() / count
+                          << '\t' << double(nbhSum) / count
+                          << "\t# " << check << std::endl;
+                elapsed = {};
+                nbhSum = 0;
+                windowStart = n + 1;
+            }
+        }
+    }
+
+    template <int kDim>
+    void runRewireBench(std::size_t N) {
+        for (RewireMode mode : { RewireMode::kNearest, RewireMode::kRadius, RewireMode::kRadiusSorted })
+            runRewireBench<kDim>(mode, N);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    using namespace nigh_test;
+
+    std::size_t N = std::size_t(1) << 17;
+
+    for (int opt ; (opt = getopt(argc, argv, "n:")) != -1 ; ) {
+        switch (opt) {
+        case 'n':
+            N = std::atoi(optarg);
+            break;
+        default:
+            std::cerr << "Usage: " << argv[0] << " [-n max-tree-size]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << "# max size = " << N << std::endl;
+    std::cout << "# space mode tree_size us_per_sample mean_neighborhood_size" << std::endl;
+
+    runRewireBench<3>(N);
+    runRewireBench<6>(N);
+    runRewireBench<12>(N);
+}
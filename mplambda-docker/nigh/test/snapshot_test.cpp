@@ -0,0 +1,207 @@
+// Software License Agreement (BSD-3-Clause)
+//
+// Copyright 2018 The University of North Carolina at Chapel Hill
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+// OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//! @author Jeff Ichnowski
+
+#include "test.hpp"
+#include <nigh/lp_space.hpp>
+#include <nigh/so3_space.hpp>
+#include <nigh/se3_space.hpp>
+#include <nigh/kdtree_batch.hpp>
+#include <nigh/kdtree_median.hpp>
+#include <nigh/kdtree_snapshot.hpp>
+#include <nigh/mapped_file.hpp>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include "sampler_lp.hpp"
+#include "sampler_so3.hpp"
+#include "sampler_scaled.hpp"
+#include "sampler_cartesian.hpp"
+#include "linear_reference.hpp"
+
+using namespace unc::robotics::nigh;
+using nigh_test::IndexedNode;
+using nigh_test::IndexedNodeKey;
+
+namespace {
+    // copies a snapshot into a buffer with the alignment of a mapping.
+    struct AlignedBuffer {
+        std::vector<std::max_align_t> storage_;
+        const char *data_;
+
+        explicit AlignedBuffer(const std::string& bytes)
+            : storage_(bytes.size() / sizeof(std::max_align_t) + 64)
+        {
+            char *p = reinterpret_cast<char*>(storage_.data());
+            p += (64 - reinterpret_cast<std::uintptr_t>(p) % 64) % 64;
+            std::memcpy(p, bytes.data(), bytes.size());
+            data_ = p;
+        }
+    };
+
+    // Checks that a snapshot of a tree returns the same results as a
+    // linear scan, with the keys supplied as a separate array.
+    template <typename Strategy, typename Space>
+    void snapshotTest(const Space& space, std::size_t N) {
+        using State = typename Space::Type;
+        using Distance = typename Space::Distance;
+        using N_ = IndexedNode<State>;
+        static constexpr std::size_t K = 10;
+
+        nigh_test::Sampler<State, typename Space::Metric> sampler(space);
+        std::mt19937_64 rng(N);
+
+        Nigh<N_, Space, IndexedNodeKey<State>, NoThreadSafety, Strategy> nn(space);
+        nigh_test::LinearReference<Space> linear(space);
+        std::vector<State> keys;
+
+        for (const N_& n : nigh_test::sampleNodes(space, N, rng)) {
+            keys.push_back(n.state_);
+            nn.insert(n);
+            linear.insert(n);
+        }
+
+        std::ostringstream out;
+        nn.save(out, [] (const N_& n) { return n.index_; });
+        std::string bytes = out.str();
+        AlignedBuffer buffer(bytes);
+
+        KDTreeSnapshot<Space, const State*> snapshot(buffer.data_, bytes.size(), keys.data(), space);
+        EXPECT(snapshot.size()) == N;
+
+        std::vector<std::pair<N_, Distance>> expected;
+        std::vector<std::pair<std::uint32_t, Distance>> nbh;
+        for (std::size_t i=0 ; i<200 ; ++i) {
+            State q = sampler(rng);
+            linear.nearest(expected, q, K);
+            snapshot.nearest(nbh, q, K);
+            EXPECT(nbh.size()) == expected.size();
+            for (std::size_t j=0 ; j<expected.size() ; ++j) {
+                EXPECT(nbh[j].second) == expected[j].second;
+                EXPECT(space.distance(keys[nbh[j].first], q)) == nbh[j].second;
+            }
+
+            if (N) {
+                auto one = snapshot.nearest(q);
+                EXPECT(one->second) == expected[0].second;
+            }
+        }
+    }
+}
+
+TEST(median_l2_3) {
+    snapshotTest<KDTreeMedian<>>(L2Space<double, 3>{}, 10000);
+}
+
+TEST(median_so3) {
+    snapshotTest<KDTreeMedian<>>(SO3Space<double>{}, 10000);
+}
+
+TEST(median_se3) {
+    snapshotTest<KDTreeMedian<>>(SE3Space<double, 50, 1>{}, 10000);
+}
+
+TEST(median_small) {
+    snapshotTest<KDTreeMedian<>>(L2Space<double, 3>{}, 0);
+    snapshotTest<KDTreeMedian<>>(L2Space<double, 3>{}, 1);
+    snapshotTest<KDTreeMedian<>>(L2Space<double, 3>{}, 13);
+}
+
+TEST(batch_l1_6) {
+    snapshotTest<KDTreeBatch<>>(L1Space<double, 6>{}, 10000);
+}
+
+TEST(batch_se3) {
+    snapshotTest<KDTreeBatch<>>(SE3Space<double, 50, 1>{}, 10000);
+}
+
+TEST(mapped_file) {
+    using Space = SE3Space<double, 50, 1>;
+    using State = Space::Type;
+    using N_ = IndexedNode<State>;
+
+    Space space;
+    nigh_test::Sampler<State, Space::Metric> sampler(space);
+    std::mt19937_64 rng;
+    Nigh<N_, Space, IndexedNodeKey<State>, Concurrent, KDTreeMedian<>> nn(space);
+    std::vector<State> keys;
+    for (std::size_t i=0 ; i<5000 ; ++i) {
+        keys.push_back(sampler(rng));
+        nn.insert(N_{keys.back(), i});
+    }
+
+    std::string path = "/tmp/nigh_snapshot_test_" + std::to_string(::getpid());
+    {
+        std::ofstream out(path, std::ios::binary);
+        nn.save(out, [] (const N_& n) { return n.index_; });
+    }
+
+    {
+        MappedFile file(path);
+        KDTreeSnapshot<Space, const State*> snapshot(file.data(), file.size(), keys.data());
+        for (std::size_t i=0 ; i<100 ; ++i) {
+            State q = sampler(rng);
+            EXPECT(snapshot.nearest(q)->second) == nn.nearest(q)->second;
+        }
+
+        // a snapshot with a different index size is rejected.
+        bool threw = false;
+        try {
+            KDTreeSnapshot<Space, const State*, std::uint64_t> wrong(file.data(), file.size(), keys.data());
+        } catch (const std::invalid_argument&) {
+            threw = true;
+        }
+        EXPECT(threw) == true;
+    }
+    std::remove(path.c_str());
+}
+
+TEST(index_out_of_range) {
+    using Space = L2Space<double, 3>;
+    using State = Space::Type;
+    using N_ = IndexedNode<State>;
+
+    Nigh<N_, Space, IndexedNodeKey<State>, NoThreadSafety, KDTreeMedian<>> nn;
+    nn.insert(N_{State::Zero(), 1000});
+
+    std::ostringstream out;
+    bool threw = false;
+    try {
+        nn.save<std::uint8_t>(out, [] (const N_& n) { return n.index_; });
+    } catch (const std::out_of_range&) {
+        threw = true;
+    }
+    EXPECT(threw) == true;
+}
@@ -67,6 +67,7 @@
 //       nt = NoThreadSafety
 //    STRATEGY:
 //       batch_8 = KDTreeBatch<8>
+//       batch_8i = KDTreeBatch<8, true>
 //       linear  = Linear
 //    K: (number of search results)
 //    N: (number of inserts)
@@ -220,6 +221,40 @@ namespace nigh_test {
         static T* get(std::vector<T>& nodes, std::size_t i) { return &nodes[i]; }
     };
 
+    // True for the strategies that compute leaf distances from
+    // inline copies of the keys (KDTreeBatch<n, true>).
+    template <typename Strategy>
+    struct InlineKeys : std::false_type {};
+
+    template <std::size_t batchSize>
+    struct InlineKeys<unc::robotics::nigh::KDTreeBatch<batchSize, true>> : std::true_type {};
+
+    // An expected distance.  The inline key strategies compute
+    // distances with different rounding than Space::distance, so for
+    // them (approximate = true) distances are compared with a relative
+    // tolerance.  The absolute floor is for SO(3), where acos turns a
+    // rounding error in a dot product near 1 into an error of about
+    // sqrt(epsilon) near 0, times the weight in a scaled space.  Other
+    // strategies must match exactly.
+    template <typename Distance, bool approximate>
+    struct ExpectedDistance {
+        Distance value_;
+
+        ExpectedDistance(Distance value) : value_(value) {}
+
+        operator Distance () const { return value_; }
+    };
+
+    template <typename Distance, bool approximate>
+    bool operator == (Distance a, const ExpectedDistance<Distance, approximate>& b) {
+        if constexpr (approximate) {
+            constexpr Distance eps = std::numeric_limits<Distance>::epsilon();
+            return std::abs(a - b.value_) <= 64 * eps * std::abs(b.value_) + 16 * std::sqrt(eps);
+        } else {
+            return a == b.value_;
+        }
+    }
+
     template <typename T>
     void emplace(std::vector<Node<T>>& nodes, const T& q) {
         nodes.emplace_back(std::to_string(nodes.size()), q);
@@ -241,6 +276,7 @@ namespace nigh_test {
         using Key = std::decay_t<std::result_of_t<KeyFn(T)>>;
         using Distance = typename Space::Distance;
         using Helper = TestHelper<T>;
+        using Expected = ExpectedDistance<Distance, InlineKeys<Strategy>::value>;
 
         Nigh<T, Space, KeyFn, Concurrency, Strategy> nn(metricSpace);
 
@@ -273,7 +309,7 @@ namespace nigh_test {
             std::optional<std::pair<T, Distance>> result = nn.nearest(q);
             EXPECT(!!result) == true;
             // TODO: EXPECT(result->first) == value;
-            EXPECT(result->second) == metricSpace.distance(q, q); //< 1e-9;
+            EXPECT(result->second) == Expected(metricSpace.distance(q, q));
 
             // std::cout << "size = " << size << std::endl;
             std::size_t maxK = std::min(K, size);
@@ -283,7 +319,7 @@ namespace nigh_test {
                 EXPECT(results.size()) == k;
 
                 for (std::size_t i=0 ; i<k ; ++i) {
-                    EXPECT(std::get<1>(results[i])) == metricSpace.distance(q, keyFn(std::get<0>(results[i])));
+                    EXPECT(std::get<1>(results[i])) == Expected(metricSpace.distance(q, keyFn(std::get<0>(results[i]))));
                     if (i>0)
                         EXPECT(std::get<1>(results[i-1]) <= std::get<1>(results[i])) == true;
                 }
@@ -307,7 +343,7 @@ namespace nigh_test {
                 //               << std::get<1>(results[i+1])
                 //               << std::endl;
 
-                EXPECT(std::get<1>(results[i])) == metricSpace.distance(q, keyFn(Helper::get(nodes, linear[i])));
+                EXPECT(std::get<1>(results[i])) == Expected(metricSpace.distance(q, keyFn(Helper::get(nodes, linear[i]))));
                 // The following occasionally fails when two values
                 // have the exact same distance, and get sorted
                 // arbitrarily different: